@@ -6,6 +6,9 @@
 #include "stp_bridge.h"
 #include "stp_log.h"
 #include "stp_md5.h"
+#include "stp_procedures.h"
+#include "stp_recorder.h"
+#include "stp_trace.h"
 #include <string.h>
 
 static void RunStateMachines (STP_BRIDGE* bridge, unsigned int timestamp);
@@ -15,6 +18,42 @@ static void ComputeMstConfigDigest (STP_BRIDGE* bridge);
 
 // ============================================================================
 
+static void RecordLatency (STP_LATENCY_HISTOGRAM* histogram, unsigned int latency);
+
+// Not in the standard. Brackets an API call: the constructor emits API_BEGIN and starts measuring the latency,
+// the destructor emits API_END and counts the latency in the histogram of entryPoint, on whichever path the call returns.
+// STP_LATENCY_ENTRY_POINT_COUNT for an entry point without a histogram. With tracing and latency histograms disabled,
+// this costs a few comparisons.
+struct ApiCallScope
+{
+	STP_BRIDGE* const bridge;
+	int const port;
+	int const tree;
+	const char* const name;
+	STP_LATENCY_ENTRY_POINT const entryPoint;
+	unsigned int const latencyStart;
+
+	ApiCallScope (STP_BRIDGE* bridge, int port, int tree, const char* name, STP_LATENCY_ENTRY_POINT entryPoint)
+		: bridge(bridge), port(port), tree(tree), name(name), entryPoint(entryPoint)
+		, latencyStart((bridge->latencyHistograms != NULL) ? bridge->latencyClock(bridge) : 0)
+	{
+		TRACE (bridge, STP_TRACE_EVENT_API_BEGIN, port, tree, 0, name, NULL);
+	}
+
+	~ApiCallScope()
+	{
+		TRACE (bridge, STP_TRACE_EVENT_API_END, port, tree, 0, name, NULL);
+		if ((bridge->latencyHistograms != NULL) && (entryPoint != STP_LATENCY_ENTRY_POINT_COUNT))
+			RecordLatency (&bridge->latencyHistograms[entryPoint], bridge->latencyClock(bridge) - latencyStart);
+	}
+
+private:
+	ApiCallScope (const ApiCallScope&);
+	ApiCallScope& operator= (const ApiCallScope&);
+};
+
+// ============================================================================
+
 STP_BRIDGE* STP_CreateBridge (unsigned int portCount,
 							  unsigned int mstiCount,
 							  unsigned int maxVlanNumber,
@@ -69,6 +108,13 @@ STP_BRIDGE* STP_CreateBridge (unsigned int portCount,
 	bridge->logBufferUsedSize = 0;
 	bridge->logCurrentPort = -1;
 	bridge->logCurrentTree = -1;
+	bridge->logCategoryMask = STP_LOG_CATEGORY_ALL;
+	bridge->logPortFilter = -1;
+	bridge->logTreeFilter = -1;
+#endif
+
+#if STP_USE_PROFILE
+	bridge->profilePassLimit = 16;
 #endif
 
 	// ------------------------------------------------------------------------
@@ -138,6 +184,19 @@ STP_BRIDGE* STP_CreateBridge (unsigned int portCount,
 	bridge->mstConfigTable = (uint16_nbo*) callbacks->allocAndZeroMemory ((1 + maxVlanNumber) * 2);
 	assert (bridge->mstConfigTable != NULL);
 
+	if (callbacks->applyPortStates != NULL)
+	{
+		bridge->portStateChanges = (STP_PORT_STATE_CHANGE*) callbacks->allocAndZeroMemory (portCount * (1 + mstiCount) * sizeof (STP_PORT_STATE_CHANGE));
+		assert (bridge->portStateChanges != NULL);
+	}
+
+	if (callbacks->flushFdbPorts != NULL)
+	{
+		bridge->fdbFlushPortMaskSize = (portCount + 7) / 8;
+		bridge->fdbFlushPortMasks = (unsigned char*) callbacks->allocAndZeroMemory ((1 + mstiCount) * bridge->fdbFlushPortMaskSize);
+		assert (bridge->fdbFlushPortMasks != NULL);
+	}
+
 	// The config table is all zeroes now, so all VIDs map to the CIST, no VID mapped to any MSTI.
 	ComputeMstConfigDigest (bridge);
 
@@ -148,6 +207,12 @@ STP_BRIDGE* STP_CreateBridge (unsigned int portCount,
 
 void STP_DestroyBridge (STP_BRIDGE* bridge)
 {
+	if (bridge->portStateChanges != NULL)
+		bridge->callbacks.freeMemory (bridge->portStateChanges);
+
+	if (bridge->fdbFlushPortMasks != NULL)
+		bridge->callbacks.freeMemory (bridge->fdbFlushPortMasks);
+
 	bridge->callbacks.freeMemory (bridge->mstConfigTable);
 
 	for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
@@ -163,30 +228,143 @@ void STP_DestroyBridge (STP_BRIDGE* bridge)
 	for (unsigned int treeIndex = 0; treeIndex < (1 + bridge->mstiCount); treeIndex++)
 		bridge->callbacks.freeMemory (bridge->trees [treeIndex]);
 
+	if (bridge->latencyHistograms != NULL)
+		bridge->callbacks.freeMemory (bridge->latencyHistograms);
+
 	bridge->callbacks.freeMemory (bridge->ports);
 	bridge->callbacks.freeMemory (bridge->trees);
 #if STP_USE_LOG
+	if (bridge->binaryLog != NULL)
+		bridge->callbacks.freeMemory (bridge->binaryLog);
+	if (bridge->logRing != NULL)
+	{
+		bridge->callbacks.freeMemory (bridge->logRing);
+		bridge->callbacks.freeMemory (bridge->logRingReadBuffer);
+	}
 	bridge->callbacks.freeMemory (bridge->logBuffer);
+#endif
+#if STP_USE_TRACE
+	if (bridge->traceRing != NULL)
+		bridge->callbacks.freeMemory (bridge->traceRing);
 #endif
 	bridge->callbacks.freeMemory (bridge);
 }
 
 // ============================================================================
 
+static void* CloneMemory (const STP_CALLBACKS* callbacks, const void* source, unsigned int size)
+{
+	void* clone = callbacks->allocAndZeroMemory (size);
+	assert (clone != NULL);
+	memcpy (clone, source, size);
+	return clone;
+}
+
+STP_BRIDGE* STP_CloneBridge (const STP_BRIDGE* bridge, const STP_CALLBACKS* callbacks, void* applicationContext)
+{
+	// The state of a bridge is consistent only between calls into the library, so the clone can't be made from a callback.
+	assert (bridge->receivedBpduContent == NULL);
+
+	// The buffers for these two callbacks are allocated only when they are present, so the clone needs the same ones.
+	assert ((callbacks->applyPortStates != NULL) == (bridge->portStateChanges != NULL));
+	assert ((callbacks->flushFdbPorts != NULL) == (bridge->fdbFlushPortMasks != NULL));
+
+	STP_BRIDGE* clone = (STP_BRIDGE*) CloneMemory (callbacks, bridge, sizeof (STP_BRIDGE));
+	clone->callbacks = *callbacks;
+	clone->applicationContext = applicationContext;
+	clone->receivedBpduPort = NULL;
+
+	clone->trees = (BRIDGE_TREE**) callbacks->allocAndZeroMemory ((1 + bridge->mstiCount) * sizeof (BRIDGE_TREE*));
+	assert (clone->trees != NULL);
+	for (unsigned int treeIndex = 0; treeIndex < (1 + bridge->mstiCount); treeIndex++)
+		clone->trees [treeIndex] = (BRIDGE_TREE*) CloneMemory (callbacks, bridge->trees [treeIndex], sizeof (BRIDGE_TREE));
+
+	clone->ports = (PORT**) callbacks->allocAndZeroMemory (bridge->portCount * sizeof (PORT*));
+	assert (clone->ports != NULL);
+	for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
+	{
+		const PORT* port = bridge->ports [portIndex];
+		PORT* clonePort = (PORT*) CloneMemory (callbacks, port, sizeof (PORT));
+		clone->ports [portIndex] = clonePort;
+
+		clonePort->trees = (PORT_TREE**) callbacks->allocAndZeroMemory ((1 + bridge->mstiCount) * sizeof (PORT_TREE*));
+		assert (clonePort->trees != NULL);
+		for (unsigned int treeIndex = 0; treeIndex < (1 + bridge->mstiCount); treeIndex++)
+			clonePort->trees [treeIndex] = (PORT_TREE*) CloneMemory (callbacks, port->trees [treeIndex], sizeof (PORT_TREE));
+	}
+
+	clone->mstConfigTable = (uint16_nbo*) CloneMemory (callbacks, bridge->mstConfigTable, (1 + bridge->maxVlanNumber) * 2);
+
+	if (bridge->portStateChanges != NULL)
+		clone->portStateChanges = (STP_PORT_STATE_CHANGE*) CloneMemory (callbacks, bridge->portStateChanges, bridge->portCount * (1 + bridge->mstiCount) * sizeof (STP_PORT_STATE_CHANGE));
+
+	if (bridge->fdbFlushPortMasks != NULL)
+		clone->fdbFlushPortMasks = (unsigned char*) CloneMemory (callbacks, bridge->fdbFlushPortMasks, (1 + bridge->mstiCount) * bridge->fdbFlushPortMaskSize);
+
+	if (bridge->latencyHistograms != NULL)
+		clone->latencyHistograms = (STP_LATENCY_HISTOGRAM*) CloneMemory (callbacks, bridge->latencyHistograms, STP_LATENCY_ENTRY_POINT_COUNT * sizeof (STP_LATENCY_HISTOGRAM));
+
+	// Recording isn't carried over: a recording replays from the state right after STP_CreateBridge, which the clone doesn't have.
+	clone->recordOut = NULL;
+	memset (&clone->recordedCallbacks, 0, sizeof (clone->recordedCallbacks));
+
+#if STP_USE_LOG
+	// The clone logs the same way, as text, starting with an empty buffer; the binary log and the log ring stay with the original.
+	clone->logBuffer = (char*) callbacks->allocAndZeroMemory (bridge->logBufferMaxSize);
+	assert (clone->logBuffer != NULL);
+	clone->logBufferUsedSize = 0;
+	clone->logIndent = 0;
+	clone->logLineStarting = true;
+	clone->binaryLog = NULL;
+	clone->binaryLogSize = 0;
+	clone->binaryLogStart = 0;
+	clone->binaryLogUsed = 0;
+	clone->binaryLogLost = 0;
+	clone->logRing = NULL;
+	clone->logRingSize = 0;
+	clone->logRingHead = 0;
+	clone->logRingTail = 0;
+	clone->logRingPendingDrops = 0;
+	clone->logRingDroppedBytes = 0;
+	clone->logRingDroppedChunks = 0;
+	clone->logRingReadBuffer = NULL;
+	clone->logRingLineComplete = false;
+#endif
+
+#if STP_USE_TRACE
+	clone->traceRing = NULL;
+	clone->traceRingSize = 0;
+	clone->traceRingStart = 0;
+	clone->traceRingUsed = 0;
+	clone->traceLost = 0;
+#endif
+
+	return clone;
+}
+
+// ============================================================================
+
 void STP_StartBridge (STP_BRIDGE* bridge, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Starting the bridge...\r\n", timestamp);
+	RECORD (bridge, RECORD_START_BRIDGE, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_StartBridge", STP_LATENCY_START_STOP_BRIDGE);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Starting the bridge...\r\n", timestamp);
 
 	assert (bridge->started == false);
 
+	TRACE (bridge, STP_TRACE_EVENT_CALLBACK, -1, -1, true, "enableBpduTrapping", NULL);
 	bridge->callbacks.enableBpduTrapping (bridge, true, timestamp);
 
 	bridge->started = true;
 
+	for (unsigned int treeIndex = 0; treeIndex < 1 + bridge->mstiCount; treeIndex++)
+		bridge->trees[treeIndex]->convergence.converging = false;
+
 	RestartStateMachines(bridge, timestamp);
 
-	LOG (bridge, -1, -1, "Bridge started.\r\n");
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "Bridge started.\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -194,8 +372,12 @@ void STP_StartBridge (STP_BRIDGE* bridge, unsigned int timestamp)
 
 void STP_StopBridge (STP_BRIDGE* bridge, unsigned int timestamp, bool fallbackLearning, bool fallbackForwarding)
 {
+	RECORD (bridge, RECORD_STOP_BRIDGE, fallbackLearning, fallbackForwarding, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_StopBridge", STP_LATENCY_START_STOP_BRIDGE);
+
 	assert (bridge->started);
 
+	TRACE (bridge, STP_TRACE_EVENT_CALLBACK, -1, -1, false, "enableBpduTrapping", NULL);
 	bridge->callbacks.enableBpduTrapping (bridge, false, timestamp);
 
 	for (unsigned int pi = 0; pi < bridge->portCount; pi++)
@@ -205,42 +387,137 @@ void STP_StopBridge (STP_BRIDGE* bridge, unsigned int timestamp, bool fallbackLe
 		{
 			PORT_TREE* tree = port->trees[ti];
 
-			if ((!tree->learning && fallbackLearning) || (tree->learning && !fallbackLearning))
+			// With deferred hardware actions, the hardware might still be working on a request that differs from
+			// the current value of learning/forwarding, so we compare with what we last requested.
+			// We don't wait for completion here, and later completions are ignored since the bridge is stopped.
+			if ((!tree->learningRequested && fallbackLearning) || (tree->learningRequested && !fallbackLearning))
 			{
-				bridge->callbacks.enableLearning(bridge, pi, ti, fallbackLearning, timestamp);
-				tree->learning = fallbackLearning;
+				if (fallbackLearning)
+					enableLearning (bridge, (PortIndex) pi, (TreeIndex) ti, timestamp);
+				else
+					disableLearning (bridge, (PortIndex) pi, (TreeIndex) ti, timestamp);
 			}
+			tree->learning = fallbackLearning;
 
-			if ((!tree->forwarding && fallbackForwarding) || (tree->forwarding && !fallbackForwarding))
+			if ((!tree->forwardingRequested && fallbackForwarding) || (tree->forwardingRequested && !fallbackForwarding))
 			{
-				bridge->callbacks.enableForwarding(bridge, pi, ti, fallbackForwarding, timestamp);
-				tree->forwarding = fallbackForwarding;
+				if (fallbackForwarding)
+					enableForwarding (bridge, (PortIndex) pi, (TreeIndex) ti, timestamp);
+				else
+					disableForwarding (bridge, (PortIndex) pi, (TreeIndex) ti, timestamp);
 			}
+			tree->forwarding = fallbackForwarding;
+
+			tree->fdbFlushesOutstanding = 0;
+			tree->fdbFlush = false;
 		}
 	}
 
+	if (bridge->callbacks.applyPortStates != NULL)
+		ApplyPortStateChanges (bridge, timestamp);
+
+	if (bridge->callbacks.flushFdbPorts != NULL)
+		DeliverFdbFlushes (bridge, true, timestamp);
+
 	// This one last, to allow the callbacks to still call "const" library functions.
 	bridge->started = false;
 
-	LOG (bridge, -1, -1, "{T}: Bridge stopped.\r\n", timestamp);
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Bridge stopped.\r\n", timestamp);
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
 // ============================================================================
 
+void STP_EnableDeferredHardwareActions (STP_BRIDGE* bridge, bool enable)
+{
+	RECORD (bridge, RECORD_ENABLE_DEFERRED_HARDWARE_ACTIONS, enable);
+	assert (!bridge->started);
+
+	bridge->deferHardwareActions = enable;
+}
+
+bool STP_AreHardwareActionsDeferred (const STP_BRIDGE* bridge)
+{
+	return bridge->deferHardwareActions;
+}
+
+void STP_OnHardwareActionComplete (STP_BRIDGE* bridge, enum STP_HARDWARE_ACTION action, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp)
+{
+	RECORD (bridge, RECORD_ON_HARDWARE_ACTION_COMPLETE, action, portIndex, treeIndex, enable, timestamp);
+	assert (bridge->deferHardwareActions);
+	assert (portIndex < bridge->portCount);
+	assert (treeIndex < 1 + bridge->mstiCount);
+	ApiCallScope apiCall (bridge, portIndex, treeIndex, "STP_OnHardwareActionComplete", STP_LATENCY_ENTRY_POINT_COUNT);
+
+	if (!bridge->started)
+		return; // STP_StopBridge has already set the variables.
+
+	PORT_TREE* tree = bridge->ports[portIndex]->trees[treeIndex];
+	bool changed = false;
+
+	if (action == STP_HARDWARE_ACTION_LEARNING)
+	{
+		// If the state machines requested the opposite in the meantime, this completion is stale, and we keep waiting.
+		if ((enable == tree->learningRequested) && (enable != tree->learning))
+		{
+			tree->learning = enable;
+			changed = true;
+		}
+	}
+	else if (action == STP_HARDWARE_ACTION_FORWARDING)
+	{
+		if ((enable == tree->forwardingRequested) && (enable != tree->forwarding))
+		{
+			tree->forwarding = enable;
+			changed = true;
+		}
+	}
+	else if (action == STP_HARDWARE_ACTION_FLUSH_FDB)
+	{
+		if (tree->fdbFlushesOutstanding > 0)
+		{
+			tree->fdbFlushesOutstanding--;
+			if (tree->fdbFlushesOutstanding == 0)
+			{
+				tree->fdbFlush = false;
+				changed = true;
+			}
+		}
+	}
+	else
+		assert (false);
+
+	if (changed)
+	{
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: {S} complete on port {D} tree {D}\r\n", timestamp,
+			(action == STP_HARDWARE_ACTION_LEARNING) ? "Learning change" : (action == STP_HARDWARE_ACTION_FORWARDING) ? "Forwarding change" : "FDB flush",
+			1 + portIndex, treeIndex);
+
+		RunStateMachines (bridge, timestamp);
+
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
+		FLUSH_LOG (bridge);
+	}
+}
+
+// ============================================================================
+
 void STP_SetBridgeAddress (STP_BRIDGE* bridge, const unsigned char* address, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Setting bridge MAC address to {BA}...", timestamp, address);
+	RECORD (bridge, RECORD_SET_BRIDGE_ADDRESS, timestamp, address, 6u);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetBridgeAddress", STP_LATENCY_ADMIN_SETTERS);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting bridge MAC address to {BA}...", timestamp, address);
 
 	const unsigned char* currentAddress = bridge->trees[CIST_INDEX]->GetBridgeIdentifier().GetAddress().bytes;
 	if (memcmp (currentAddress, address, 6) == 0)
 	{
-		LOG (bridge, -1, -1, " nothing changed.\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, " nothing changed.\r\n");
 	}
 	else
 	{
-		LOG (bridge, -1, -1, "\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "\r\n");
 
 		for (unsigned int treeIndex = 0; treeIndex < (1 + bridge->mstiCount); treeIndex++)
 		{
@@ -254,7 +531,7 @@ void STP_SetBridgeAddress (STP_BRIDGE* bridge, const unsigned char* address, uns
 			RecomputePrioritiesAndPortRoles (bridge, CIST_INDEX, timestamp);
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -290,7 +567,10 @@ static unsigned int GetDefaultPortPathCost (unsigned int speedMegabitsPerSecond)
 
 void STP_OnPortEnabled (STP_BRIDGE* bridge, unsigned int portIndex, unsigned int speedMegabitsPerSecond, bool detectedPointToPointMAC, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Port {D} good\r\n", timestamp, 1 + portIndex);
+	RECORD (bridge, RECORD_ON_PORT_ENABLED, portIndex, speedMegabitsPerSecond, detectedPointToPointMAC, timestamp);
+	ApiCallScope apiCall (bridge, portIndex, -1, "STP_OnPortEnabled", STP_LATENCY_ON_PORT_ENABLED);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Port {D} good\r\n", timestamp, 1 + portIndex);
 
 	PORT* port = bridge->ports [portIndex];
 
@@ -322,7 +602,7 @@ void STP_OnPortEnabled (STP_BRIDGE* bridge, unsigned int portIndex, unsigned int
 	if (bridge->started)
 		RunStateMachines (bridge, timestamp);
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -330,7 +610,10 @@ void STP_OnPortEnabled (STP_BRIDGE* bridge, unsigned int portIndex, unsigned int
 
 void STP_OnPortDisabled (STP_BRIDGE* bridge, unsigned int portIndex, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Port {D} down\r\n", timestamp, 1 + portIndex);
+	RECORD (bridge, RECORD_ON_PORT_DISABLED, portIndex, timestamp);
+	ApiCallScope apiCall (bridge, portIndex, -1, "STP_OnPortDisabled", STP_LATENCY_ON_PORT_DISABLED);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Port {D} down\r\n", timestamp, 1 + portIndex);
 
 	PORT* port = bridge->ports[portIndex];
 	// We allow calling this function on an already disabled port.
@@ -348,7 +631,7 @@ void STP_OnPortDisabled (STP_BRIDGE* bridge, unsigned int portIndex, unsigned in
 			RunStateMachines (bridge, timestamp);
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -356,16 +639,19 @@ void STP_OnPortDisabled (STP_BRIDGE* bridge, unsigned int portIndex, unsigned in
 
 void STP_OnOneSecondTick (STP_BRIDGE* bridge, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_ON_ONE_SECOND_TICK, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_OnOneSecondTick", STP_LATENCY_ON_ONE_SECOND_TICK);
+
 	if (bridge->started)
 	{
-		LOG (bridge, -1, -1, "{T}: One second:\r\n", timestamp);
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: One second:\r\n", timestamp);
 
 		for (unsigned int givenPort = 0; givenPort < bridge->portCount; givenPort++)
 			bridge->ports [givenPort]->tick = true;
 
 		RunStateMachines (bridge, timestamp);
 
-		LOG (bridge, -1, -1, "------------------------------------\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 		FLUSH_LOG (bridge);
 	}
 }
@@ -374,56 +660,66 @@ void STP_OnOneSecondTick (STP_BRIDGE* bridge, unsigned int timestamp)
 
 void STP_OnBpduReceived (STP_BRIDGE* bridge, unsigned int portIndex, const unsigned char* bpdu, unsigned int bpduSize, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_ON_BPDU_RECEIVED, portIndex, timestamp, bpdu, bpduSize);
+	ApiCallScope apiCall (bridge, portIndex, -1, "STP_OnBpduReceived", STP_LATENCY_ON_BPDU_RECEIVED);
+	TRACE (bridge, STP_TRACE_EVENT_BPDU_RX, portIndex, -1, bpduSize, NULL, NULL);
+
 	if (bridge->started)
 	{
 		if (bridge->ports [portIndex]->portEnabled == false)
 		{
-			LOG (bridge, -1, -1, "{T}: WARNING: BPDU received on disabled port {D}. The STP library is discarding it.\r\n", timestamp, 1 + portIndex);
+			bridge->ports [portIndex]->counters.rxDiscardedPortDisabled++;
+			LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: WARNING: BPDU received on disabled port {D}. The STP library is discarding it.\r\n", timestamp, 1 + portIndex);
 		}
 		else
 		{
-			LOG (bridge, -1, -1, "{T}: BPDU received on Port {D}:\r\n", timestamp, 1 + portIndex);
+			LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: BPDU received on Port {D}:\r\n", timestamp, 1 + portIndex);
 
 			enum VALIDATED_BPDU_TYPE type = STP_GetValidatedBpduType (bridge->ForceProtocolVersion, bpdu, bpduSize);
 			switch (type)
 			{
 				case VALIDATED_BPDU_TYPE_STP_CONFIG:
+					bridge->ports [portIndex]->counters.rxConfigBpdus++;
 					#if STP_USE_LOG
-						LOG (bridge, portIndex, -1, "Config BPDU:\r\n");
+						LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, "Config BPDU:\r\n");
 						LOG_INDENT (bridge);
-						DumpConfigBpdu (bridge, portIndex, -1, (const MSTP_BPDU*) bpdu);
+						DumpConfigBpdu (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, (const MSTP_BPDU*) bpdu);
 						LOG_UNINDENT (bridge);
 					#endif
 					break;
 
 				case VALIDATED_BPDU_TYPE_RST:
+					bridge->ports [portIndex]->counters.rxRstpBpdus++;
 					#if STP_USE_LOG
-						LOG (bridge, portIndex, -1, "RSTP BPDU:\r\n");
+						LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, "RSTP BPDU:\r\n");
 						LOG_INDENT (bridge);
-						DumpRstpBpdu (bridge, portIndex, -1, (const MSTP_BPDU*) bpdu);
+						DumpRstpBpdu (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, (const MSTP_BPDU*) bpdu);
 						LOG_UNINDENT (bridge);
 					#endif
 					break;
 
 				case VALIDATED_BPDU_TYPE_MST:
 				case VALIDATED_BPDU_TYPE_SPT:
+					bridge->ports [portIndex]->counters.rxMstpBpdus++;
 					#if STP_USE_LOG
 						if (type == VALIDATED_BPDU_TYPE_MST)
-							LOG (bridge, portIndex, -1, "MSTP BPDU:\r\n");
+							LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, "MSTP BPDU:\r\n");
 						else
-							LOG (bridge, portIndex, -1, "SPT BPDU (processed as MSTP):\r\n");
+							LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, "SPT BPDU (processed as MSTP):\r\n");
 						LOG_INDENT (bridge);
-						DumpMstpBpdu (bridge, portIndex, -1, (const MSTP_BPDU*) bpdu);
+						DumpMstpBpdu (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, (const MSTP_BPDU*) bpdu);
 						LOG_UNINDENT (bridge);
 					#endif
 					break;
 
 				case VALIDATED_BPDU_TYPE_STP_TCN:
-					LOG (bridge, portIndex, -1, "TCN BPDU.\r\n");
+					bridge->ports [portIndex]->counters.rxTcnBpdus++;
+					LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, "TCN BPDU.\r\n");
 					break;
 
 				case VALIDATED_BPDU_TYPE_UNKNOWN:
-					LOG (bridge, portIndex, -1, "Invalid BPDU received. Discarding it.\r\n");
+					bridge->ports [portIndex]->counters.rxInvalidBpdus++;
+					LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, portIndex, -1, "Invalid BPDU received. Discarding it.\r\n");
 					break;
 
 				default:
@@ -452,7 +748,7 @@ void STP_OnBpduReceived (STP_BRIDGE* bridge, unsigned int portIndex, const unsig
 			}
 		}
 
-		LOG (bridge, -1, -1, "------------------------------------\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 		FLUSH_LOG (bridge);
 	}
 }
@@ -487,63 +783,145 @@ bool STP_IsLoggingEnabled (const STP_BRIDGE* bridge)
 
 // ============================================================================
 
+void STP_SetLogFilter (STP_BRIDGE* bridge, unsigned int categoryMask, int portIndex, int treeIndex)
+{
+	assert ((categoryMask & ~STP_LOG_CATEGORY_ALL) == 0);
+	assert ((portIndex == -1) || ((portIndex >= 0) && ((unsigned int) portIndex < bridge->portCount)));
+	assert ((treeIndex == -1) || ((treeIndex >= 0) && ((unsigned int) treeIndex <= bridge->mstiCount)));
+
+	#if STP_USE_LOG
+		bridge->logCategoryMask = categoryMask;
+		bridge->logPortFilter = portIndex;
+		bridge->logTreeFilter = treeIndex;
+	#endif
+}
+
+// ============================================================================
+
+void STP_GetLogFilter (const STP_BRIDGE* bridge, unsigned int* categoryMaskOut, int* portIndexOut, int* treeIndexOut)
+{
+	#if STP_USE_LOG
+		*categoryMaskOut = bridge->logCategoryMask;
+		*portIndexOut = bridge->logPortFilter;
+		*treeIndexOut = bridge->logTreeFilter;
+	#else
+		*categoryMaskOut = 0;
+		*portIndexOut = -1;
+		*treeIndexOut = -1;
+	#endif
+}
+
+// ============================================================================
+
 #if STP_USE_LOG
 template<typename PortTreeArgs>
-static void LogTransition (STP_BRIDGE* bridge, const char* smName, const char* newStateName, PortTreeArgs args);
+static void LogTransition (STP_BRIDGE* bridge, unsigned int category, const char* smName, const char* newStateName, PortTreeArgs args);
 
 template<>
-void LogTransition (STP_BRIDGE* bridge, const char* smName, const char* newStateName, TreeIndex ti)
+void LogTransition (STP_BRIDGE* bridge, unsigned int category, const char* smName, const char* newStateName, TreeIndex ti)
 {
-	LOG (bridge, -1, ti, "Bridge: ");
+	LOG (bridge, category, -1, ti, "Bridge: ");
 	if (bridge->ForceProtocolVersion >= STP_VERSION_MSTP)
 	{
 		if (ti == CIST_INDEX)
-			LOG (bridge, -1, ti, "CIST: ");
+			LOG (bridge, category, -1, ti, "CIST: ");
 		else
-			LOG (bridge, -1, ti, "MST{D}: ", ti);
+			LOG (bridge, category, -1, ti, "MST{D}: ", ti);
 	}
 
-	LOG (bridge, -1, ti, "{S}: -> {S}\r\n", smName, newStateName);
+	LOG (bridge, category, -1, ti, "{S}: -> {S}\r\n", smName, newStateName);
 }
 
 template<>
-void LogTransition (STP_BRIDGE* bridge, const char* smName, const char* newStateName, PortIndex pi)
+void LogTransition (STP_BRIDGE* bridge, unsigned int category, const char* smName, const char* newStateName, PortIndex pi)
 {
-	LOG (bridge, pi, -1, "Port {D}: ", 1 + pi);
-	LOG (bridge, pi, -1, "{S}: -> {S}\r\n", smName, newStateName);
+	LOG (bridge, category, pi, -1, "Port {D}: ", 1 + pi);
+	LOG (bridge, category, pi, -1, "{S}: -> {S}\r\n", smName, newStateName);
 }
 
 template<>
-void LogTransition (STP_BRIDGE* bridge, const char* smName, const char* newStateName, PortAndTree pt)
+void LogTransition (STP_BRIDGE* bridge, unsigned int category, const char* smName, const char* newStateName, PortAndTree pt)
 {
 	PortIndex pi = pt.portIndex;
 	TreeIndex ti = pt.treeIndex;
-	LOG (bridge, pi, ti, "Port {D}: ", 1 + pi);
+	LOG (bridge, category, pi, ti, "Port {D}: ", 1 + pi);
 	if (bridge->ForceProtocolVersion >= STP_VERSION_MSTP)
 	{
 		if (ti == CIST_INDEX)
-			LOG (bridge, pi, ti, "CIST: ");
+			LOG (bridge, category, pi, ti, "CIST: ");
 		else
-			LOG (bridge, pi, ti, "MST{D}: ", ti);
+			LOG (bridge, category, pi, ti, "MST{D}: ", ti);
 	}
-	LOG (bridge, pi, ti, "{S}: -> {S}\r\n", smName, newStateName);
+	LOG (bridge, category, pi, ti, "{S}: -> {S}\r\n", smName, newStateName);
 }
 #endif
 
 // ============================================================================
 
+#if STP_USE_PROFILE
+static unsigned int GetProfileKey (PortIndex pi) { return pi; }
+static unsigned int GetProfileKey (TreeIndex ti) { return 0x10000u | ti; }
+static unsigned int GetProfileKey (PortAndTree pt) { return ((unsigned int) pt.portIndex << 7) | pt.treeIndex; }
+
+// Mixes a transition into the signature of the current pass, so that passes making the same transitions
+// (same state machines, same ports and trees, same new states, in the same order) end up with the same signature.
+static void ProfileTransition (STP_BRIDGE* bridge, STP_PROFILE_SM profileId, unsigned int key, unsigned int newState)
+{
+	bridge->profile.stateMachines[profileId].transitions++;
+	bridge->profilePassTransitions++;
+	bridge->profilePassSignature = (bridge->profilePassSignature * 31) ^ (((unsigned int) profileId << 24) ^ (key << 6) ^ newState);
+}
+
+static unsigned int GetPassHistogramIndex (unsigned int passes)
+{
+	unsigned int index = 0;
+	while ((index < STP_PROFILE_PASS_HISTOGRAM_SIZE - 1) && (passes > (1u << index)))
+		index++;
+	return index;
+}
+#endif
+
+// ============================================================================
+
+#if STP_USE_TRACE
+static int GetTracePort (PortIndex pi) { return pi; }
+static int GetTracePort (TreeIndex) { return -1; }
+static int GetTracePort (PortAndTree pt) { return pt.portIndex; }
+static int GetTraceTree (PortIndex) { return -1; }
+static int GetTraceTree (TreeIndex ti) { return ti; }
+static int GetTraceTree (PortAndTree pt) { return pt.treeIndex; }
+#endif
+
+// ============================================================================
+
 template<typename State, typename PortTreeArgs>
 static bool RunStateMachineInstance (STP_BRIDGE* bridge, const StateMachine<State, PortTreeArgs>& smInfo, State& state, unsigned int timestamp, PortTreeArgs portTreeArgs)
 {
 	volatile bool changed = false;
 
+	#if STP_USE_PROFILE
+		STP_PROFILE_SM_STATS* smStats = &bridge->profile.stateMachines[smInfo.profileId];
+		unsigned int startTime = (bridge->profileClock != NULL) ? bridge->profileClock(bridge) : 0;
+	#endif
+
 rep:
+	#if STP_USE_PROFILE
+		smStats->checks++;
+	#endif
+
 	State newState = smInfo.checkConditions (bridge, portTreeArgs, state);
 	if (newState != 0)
 	{
 		#if STP_USE_LOG
 			const char* newStateName = smInfo.getStateName(newState);
-			LogTransition (bridge, smInfo.smName, newStateName, portTreeArgs);
+			LogTransition (bridge, smInfo.logCategory, smInfo.smName, newStateName, portTreeArgs);
+			TRACE (bridge, STP_TRACE_EVENT_TRANSITION, GetTracePort(portTreeArgs), GetTraceTree(portTreeArgs), newState, smInfo.smName, newStateName);
+		#else
+			TRACE (bridge, STP_TRACE_EVENT_TRANSITION, GetTracePort(portTreeArgs), GetTraceTree(portTreeArgs), newState, NULL, NULL);
+		#endif
+
+		#if STP_USE_PROFILE
+			ProfileTransition (bridge, smInfo.profileId, GetProfileKey(portTreeArgs), newState);
 		#endif
 
 		smInfo.initState (bridge, portTreeArgs, newState, timestamp);
@@ -553,6 +931,11 @@ rep:
 		goto rep;
 	}
 
+	#if STP_USE_PROFILE
+		if (bridge->profileClock != NULL)
+			smStats->time += bridge->profileClock(bridge) - startTime;
+	#endif
+
 	return changed;
 }
 
@@ -562,10 +945,32 @@ static void RunStateMachines (STP_BRIDGE* bridge, unsigned int timestamp)
 {
 	bool changed;
 
+	#if STP_USE_PROFILE
+		unsigned int startTime = (bridge->profileClock != NULL) ? bridge->profileClock(bridge) : 0;
+		unsigned int passes = 0;
+		unsigned int transitions = 0;
+		unsigned int prevSignatures[2] = { 0, 0 };
+		bool oscillating = false;
+	#endif
+
+	#if STP_USE_TRACE
+		unsigned int tracePass = 0;
+	#endif
+
 	do
 	{
 		changed = false;
 
+		#if STP_USE_TRACE
+			tracePass++;
+			TRACE (bridge, STP_TRACE_EVENT_PASS_BEGIN, -1, -1, tracePass, "pass", NULL);
+		#endif
+
+		#if STP_USE_PROFILE
+			bridge->profilePassSignature = 0;
+			bridge->profilePassTransitions = 0;
+		#endif
+
 		for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
 		{
 			PORT* port = bridge->ports[portIndex];
@@ -597,13 +1002,67 @@ static void RunStateMachines (STP_BRIDGE* bridge, unsigned int timestamp)
 		// See Note 1 on page 541 of 802.1Q-2018.
 		if (!changed)
 		{
+			// Same for the hardware port states: write them all before any BPDU can advertise them.
+			if (bridge->callbacks.applyPortStates != NULL)
+				ApplyPortStateChanges (bridge, timestamp);
+
+			if (bridge->callbacks.flushFdbPorts != NULL)
+				DeliverFdbFlushes (bridge, false, timestamp);
+
 			for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
 			{
 				PORT* port = bridge->ports[portIndex];
 				changed |= RunStateMachineInstance (bridge, PortTransmit::sm, port->portTransmitState, timestamp, (PortIndex) portIndex);
 			}
 		}
+
+		#if STP_USE_PROFILE
+			passes++;
+			transitions += bridge->profilePassTransitions;
+			if (bridge->profilePassTransitions != 0)
+			{
+				if ((bridge->profilePassSignature == prevSignatures[0]) || (bridge->profilePassSignature == prevSignatures[1]))
+					oscillating = true;
+				prevSignatures[1] = prevSignatures[0];
+				prevSignatures[0] = bridge->profilePassSignature;
+			}
+		#endif
+
+		TRACE (bridge, STP_TRACE_EVENT_PASS_END, -1, -1, tracePass, "pass", NULL);
 	} while (changed);
+
+	if (!bridge->BEGIN)
+		CheckTreeConvergence (bridge, timestamp);
+
+	#if STP_USE_PROFILE
+		STP_PROFILE_STATS* profile = &bridge->profile;
+		profile->events++;
+		profile->passes += passes;
+		profile->passHistogram[GetPassHistogramIndex(passes)]++;
+		if (profile->maxPasses < passes)
+			profile->maxPasses = passes;
+		profile->lastEventPasses = passes;
+		profile->lastEventTransitions = transitions;
+		profile->lastEventTime = 0;
+		if (bridge->profileClock != NULL)
+		{
+			profile->lastEventTime = bridge->profileClock(bridge) - startTime;
+			if (profile->maxEventTime < profile->lastEventTime)
+				profile->maxEventTime = profile->lastEventTime;
+		}
+
+		if (oscillating)
+			profile->oscillatingEvents++;
+
+		if (passes > bridge->profilePassLimit)
+		{
+			profile->longEvents++;
+			LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "WARNING: the state machines needed {D} passes ({D} transitions) to settle.\r\n", passes, transitions);
+		}
+
+		if (oscillating)
+			LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "WARNING: the state machines repeated the same transitions in more than one pass.\r\n");
+	#endif
 }
 
 static void RestartStateMachines (STP_BRIDGE* bridge, unsigned int timestamp)
@@ -641,6 +1100,7 @@ static void RestartStateMachines (STP_BRIDGE* bridge, unsigned int timestamp)
 
 void STP_SetPortAdminEdge (struct STP_BRIDGE* bridge, unsigned int portIndex, bool adminEdge, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_PORT_ADMIN_EDGE, portIndex, adminEdge, timestamp);
 	bridge->ports [portIndex]->AdminEdge = adminEdge;
 }
 
@@ -653,6 +1113,7 @@ bool STP_GetPortAdminEdge (const struct STP_BRIDGE* bridge, unsigned int portInd
 
 void STP_SetPortAutoEdge (struct STP_BRIDGE* bridge, unsigned int portIndex, bool autoEdge, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_PORT_AUTO_EDGE, portIndex, autoEdge, timestamp);
 	bridge->ports [portIndex]->AutoEdge = autoEdge;
 }
 
@@ -665,8 +1126,11 @@ bool STP_GetPortAutoEdge (const struct STP_BRIDGE* bridge, unsigned int portInde
 
 void STP_SetAdminPointToPointMAC (struct STP_BRIDGE* bridge, unsigned int portIndex, enum STP_ADMIN_P2P adminPointToPointMAC, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_ADMIN_POINT_TO_POINT_MAC, portIndex, adminPointToPointMAC, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetAdminPointToPointMAC", STP_LATENCY_ADMIN_SETTERS);
+
 	const char* p2pString = STP_GetAdminP2PString (adminPointToPointMAC);
-	LOG (bridge, portIndex, -1, "{T}: Setting adminPointToPointMAC = {S} on port {D}...\r\n", timestamp, p2pString, 1 + portIndex);
+	LOG (bridge, STP_LOG_CATEGORY_API, portIndex, -1, "{T}: Setting adminPointToPointMAC = {S} on port {D}...\r\n", timestamp, p2pString, 1 + portIndex);
 
 	PORT* port = bridge->ports[portIndex];
 
@@ -685,7 +1149,7 @@ void STP_SetAdminPointToPointMAC (struct STP_BRIDGE* bridge, unsigned int portIn
 		}
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -755,18 +1219,21 @@ static void RecomputePrioritiesAndPortRoles (STP_BRIDGE* bridge, unsigned int tr
 // it might leads to the formation of loops. I don't think this could be resolved given the current BPDU format.
 void STP_SetBridgePriority (STP_BRIDGE* bridge, unsigned int treeIndex, unsigned short bridgePriority, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_BRIDGE_PRIORITY, treeIndex, bridgePriority, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetBridgePriority", STP_LATENCY_ADMIN_SETTERS);
+
 	// See table 13-3 on page 501 of 802.1Q-2018.
 
 	assert ((bridgePriority & 0x0FFF) == 0);
 
 	assert (treeIndex <= bridge->mstiCount);
 
-	LOG (bridge, -1, -1, "{T}: Setting bridge priority: tree {TN} prio = {D}...\r\n", timestamp, treeIndex, bridgePriority);
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting bridge priority: tree {TN} prio = {D}...\r\n", timestamp, treeIndex, bridgePriority);
 
 	BRIDGE_ID bid = bridge->trees[treeIndex]->GetBridgeIdentifier();
 	if (bid.GetPriorityWithoutMstid() != bridgePriority)
 	{
-		LOG (bridge, -1, -1, "\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "\r\n");
 
 		bid.SetPriorityAndMstid(bridgePriority, treeIndex);
 		bridge->trees[treeIndex]->SetBridgeIdentifier(bid);
@@ -775,9 +1242,9 @@ void STP_SetBridgePriority (STP_BRIDGE* bridge, unsigned int treeIndex, unsigned
 			RecomputePrioritiesAndPortRoles (bridge, treeIndex, timestamp);
 	}
 	else
-		LOG (bridge, -1, -1, " nothing changed.\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, " nothing changed.\r\n");
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -792,6 +1259,9 @@ unsigned short STP_GetBridgePriority (const STP_BRIDGE* bridge, unsigned int tre
 
 void STP_SetPortPriority (STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, unsigned char portPriority, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_PORT_PRIORITY, portIndex, treeIndex, portPriority, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetPortPriority", STP_LATENCY_ADMIN_SETTERS);
+
 	// See table 13-3 on page 501 of 802.1Q-2018.
 	// See 13.27.46 in 802.1Q-2018.
 
@@ -799,7 +1269,7 @@ void STP_SetPortPriority (STP_BRIDGE* bridge, unsigned int portIndex, unsigned i
 	assert (portIndex < bridge->portCount);
 	assert (treeIndex <= bridge->mstiCount);
 
-	LOG (bridge, -1, -1, "{T}: Setting port priority: port {D} tree {TN} prio = {D}...\r\n",
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting port priority: port {D} tree {TN} prio = {D}...\r\n",
 		 timestamp,
 		 1 + portIndex,
 		 treeIndex,
@@ -813,7 +1283,7 @@ void STP_SetPortPriority (STP_BRIDGE* bridge, unsigned int portIndex, unsigned i
 	if (bridge->started && (treeIndex < bridge->treeCount()))
 		RecomputePrioritiesAndPortRoles (bridge, treeIndex, timestamp);
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -855,9 +1325,12 @@ void STP_GetDefaultMstConfigName (const unsigned char bridgeAddress[6], char nam
 
 void STP_SetMstConfigName (STP_BRIDGE* bridge, const char* name, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_MST_CONFIG_NAME, timestamp, name, (unsigned int) strlen (name));
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetMstConfigName", STP_LATENCY_ADMIN_SETTERS);
+
 	assert (strlen (name) <= 32);
 
-	LOG (bridge, -1, -1, "{T}: Setting MST Config Name to \"{S}\"...\r\n", timestamp, name);
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting MST Config Name to \"{S}\"...\r\n", timestamp, name);
 
 	memset (bridge->MstConfigId.ConfigurationName, 0, 32);
 	memcpy (bridge->MstConfigId.ConfigurationName, name, strlen (name));
@@ -865,7 +1338,7 @@ void STP_SetMstConfigName (STP_BRIDGE* bridge, const char* name, unsigned int ti
 	if (bridge->started)
 		RestartStateMachines(bridge, timestamp);
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -873,7 +1346,10 @@ void STP_SetMstConfigName (STP_BRIDGE* bridge, const char* name, unsigned int ti
 
 void STP_SetMstConfigRevisionLevel (STP_BRIDGE* bridge, unsigned short revisionLevel, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Setting MST Config Revision Level to {D}...\r\n", timestamp, (int) revisionLevel);
+	RECORD (bridge, RECORD_SET_MST_CONFIG_REVISION_LEVEL, revisionLevel, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetMstConfigRevisionLevel", STP_LATENCY_ADMIN_SETTERS);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting MST Config Revision Level to {D}...\r\n", timestamp, (int) revisionLevel);
 
 	bridge->MstConfigId.RevisionLevelHigh = revisionLevel >> 8;
 	bridge->MstConfigId.RevisionLevelLow = revisionLevel & 0xff;
@@ -881,7 +1357,7 @@ void STP_SetMstConfigRevisionLevel (STP_BRIDGE* bridge, unsigned short revisionL
 	if (bridge->started)
 		RestartStateMachines(bridge, timestamp);
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -902,13 +1378,16 @@ static void ComputeMstConfigDigest (STP_BRIDGE* bridge)
 
 void STP_SetMstConfigTable (struct STP_BRIDGE* bridge, const STP_CONFIG_TABLE_ENTRY* entries, unsigned int entryCount, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_MST_CONFIG_TABLE, timestamp, (const void*) entries, entryCount * (unsigned int) sizeof (STP_CONFIG_TABLE_ENTRY));
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetMstConfigTable", STP_LATENCY_ADMIN_SETTERS);
+
 	assert (entryCount == 1 + bridge->maxVlanNumber);
 
-	LOG (bridge, -1, -1, "{T}: Setting MST Config Table... ", timestamp);
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting MST Config Table... ", timestamp);
 
 	if (memcmp (bridge->mstConfigTable, entries, entryCount * 2) == 0)
 	{
-		LOG (bridge, -1, -1, "... nothing changed.\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "... nothing changed.\r\n");
 	}
 	else
 	{
@@ -928,7 +1407,7 @@ void STP_SetMstConfigTable (struct STP_BRIDGE* bridge, const STP_CONFIG_TABLE_EN
 
 		ComputeMstConfigDigest (bridge);
 
-		LOG (bridge, -1, -1, "New digest: 0x{X2}{X2}...{X2}{X2}.\r\n",
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "New digest: 0x{X2}{X2}...{X2}{X2}.\r\n",
 			 bridge->MstConfigId.ConfigurationDigest[0], bridge->MstConfigId.ConfigurationDigest[1],
 			 bridge->MstConfigId.ConfigurationDigest[14], bridge->MstConfigId.ConfigurationDigest[15]);
 
@@ -936,19 +1415,22 @@ void STP_SetMstConfigTable (struct STP_BRIDGE* bridge, const STP_CONFIG_TABLE_EN
 			RestartStateMachines(bridge, timestamp);
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
 void STP_SetMstConfigTableEntry (struct STP_BRIDGE* bridge, unsigned int vlanNumber, unsigned int treeIndex, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_MST_CONFIG_TABLE_ENTRY, vlanNumber, treeIndex, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetMstConfigTableEntry", STP_LATENCY_ADMIN_SETTERS);
+
 	assert (vlanNumber <= bridge->maxVlanNumber);
 
-	LOG (bridge, -1, -1, "{T}: Setting MST Config Table... ", timestamp);
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting MST Config Table... ", timestamp);
 
 	if (bridge->mstConfigTable[vlanNumber] == treeIndex)
 	{
-		LOG (bridge, -1, -1, "... nothing changed.\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "... nothing changed.\r\n");
 	}
 	else
 	{
@@ -962,7 +1444,7 @@ void STP_SetMstConfigTableEntry (struct STP_BRIDGE* bridge, unsigned int vlanNum
 
 		ComputeMstConfigDigest (bridge);
 
-		LOG (bridge, -1, -1, "New digest: 0x{X2}{X2}...{X2}{X2}.\r\n",
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "New digest: 0x{X2}{X2}...{X2}{X2}.\r\n",
 			bridge->MstConfigId.ConfigurationDigest[0], bridge->MstConfigId.ConfigurationDigest[1],
 			bridge->MstConfigId.ConfigurationDigest[14], bridge->MstConfigId.ConfigurationDigest[15]);
 
@@ -970,7 +1452,7 @@ void STP_SetMstConfigTableEntry (struct STP_BRIDGE* bridge, unsigned int vlanNum
 			RestartStateMachines(bridge, timestamp);
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -999,15 +1481,18 @@ enum STP_VERSION STP_GetStpVersion (const STP_BRIDGE* bridge)
 
 void STP_SetStpVersion (STP_BRIDGE* bridge, enum STP_VERSION version, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Switching to {S}... ", timestamp, STP_GetVersionString(version));
+	RECORD (bridge, RECORD_SET_STP_VERSION, version, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetStpVersion", STP_LATENCY_ADMIN_SETTERS);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Switching to {S}... ", timestamp, STP_GetVersionString(version));
 
 	if (bridge->ForceProtocolVersion == version)
 	{
-		LOG (bridge, -1, -1, "... bridge was already running {S}.\r\n", STP_GetVersionString(version));
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "... bridge was already running {S}.\r\n", STP_GetVersionString(version));
 	}
 	else
 	{
-		LOG (bridge, -1, -1, "\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "\r\n");
 
 		bridge->ForceProtocolVersion = version;
 
@@ -1015,7 +1500,7 @@ void STP_SetStpVersion (STP_BRIDGE* bridge, enum STP_VERSION version, unsigned i
 			RestartStateMachines (bridge, timestamp);
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -1198,12 +1683,12 @@ void* STP_GetApplicationContext (const STP_BRIDGE* bridge)
 
 // ============================================================================
 
-void STP_MST_CONFIG_ID::Dump (STP_BRIDGE* bridge, int port, int tree) const
+void STP_MST_CONFIG_ID::Dump (STP_BRIDGE* bridge, unsigned int category, int port, int tree) const
 {
 	char namesz [33];
 	memcpy (namesz, ConfigurationName, 32);
 	namesz [32] = 0;
-	LOG (bridge, port, tree, "Name=\"{S}\", Rev={D}, Digest={X2}{X2}..{X2}{X2}\r\n",
+	LOG (bridge, category, port, tree, "Name=\"{S}\", Rev={D}, Digest={X2}{X2}..{X2}{X2}\r\n",
 		 namesz,
 		 (RevisionLevelHigh << 8) | RevisionLevelLow,
 		 ConfigurationDigest [0], ConfigurationDigest [1], ConfigurationDigest [14], ConfigurationDigest [15]);
@@ -1225,7 +1710,10 @@ bool STP_MST_CONFIG_ID::operator< (const STP_MST_CONFIG_ID& rhs) const
 
 void STP_SetAdminExternalPortPathCost (struct STP_BRIDGE* bridge, unsigned int portIndex, unsigned int adminExternalPortPathCost, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Setting Port {D} AdminExternalPortPathCost to {D}...\r\n", timestamp, 1 + portIndex, adminExternalPortPathCost);
+	RECORD (bridge, RECORD_SET_ADMIN_EXTERNAL_PORT_PATH_COST, portIndex, adminExternalPortPathCost, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetAdminExternalPortPathCost", STP_LATENCY_ADMIN_SETTERS);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting Port {D} AdminExternalPortPathCost to {D}...\r\n", timestamp, 1 + portIndex, adminExternalPortPathCost);
 
 	PORT* port = bridge->ports[portIndex];
 
@@ -1245,13 +1733,16 @@ void STP_SetAdminExternalPortPathCost (struct STP_BRIDGE* bridge, unsigned int p
 		}
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
 void STP_SetAdminInternalPortPathCost (struct STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, unsigned int adminInternalPortPathCost, unsigned int timestamp)
 {
-	LOG (bridge, -1, -1, "{T}: Setting Port {D} {TN} AdminInternalPortPathCost to {D}...\r\n", timestamp, 1 + portIndex, treeIndex, adminInternalPortPathCost);
+	RECORD (bridge, RECORD_SET_ADMIN_INTERNAL_PORT_PATH_COST, portIndex, treeIndex, adminInternalPortPathCost, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetAdminInternalPortPathCost", STP_LATENCY_ADMIN_SETTERS);
+
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "{T}: Setting Port {D} {TN} AdminInternalPortPathCost to {D}...\r\n", timestamp, 1 + portIndex, treeIndex, adminInternalPortPathCost);
 
 	PORT* port = bridge->ports[portIndex];
 	PORT_TREE* portTree = port->trees[treeIndex];
@@ -1272,7 +1763,7 @@ void STP_SetAdminInternalPortPathCost (struct STP_BRIDGE* bridge, unsigned int p
 		}
 	}
 
-	LOG (bridge, -1, -1, "------------------------------------\r\n");
+	LOG (bridge, STP_LOG_CATEGORY_API, -1, -1, "------------------------------------\r\n");
 	FLUSH_LOG (bridge);
 }
 
@@ -1313,6 +1804,7 @@ unsigned int STP_GetAdminInternalPortPathCost (const struct STP_BRIDGE* bridge,
 
 extern "C" void STP_SetBridgeHelloTime (struct STP_BRIDGE* bridge, unsigned int helloTime, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_BRIDGE_HELLO_TIME, helloTime, timestamp);
 	// Note AG: In recent versions of the standard this is fixed to two seconds (Table 13-5 on page 510 in 802.1Q-2018),
 	// and it's even required to ignore any HelloTime value received and to use two seconds instead (13.29.20 in 802.1Q-2018).
 	// I wrote this function only as a placeholder for this comment, so people won't wonder about "missing" functionality.
@@ -1333,6 +1825,9 @@ extern "C" unsigned int STP_GetHelloTime (const struct STP_BRIDGE* bridge)
 
 extern "C" void STP_SetBridgeMaxAge (struct STP_BRIDGE* bridge, unsigned int maxAge, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_BRIDGE_MAX_AGE, maxAge, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetBridgeMaxAge", STP_LATENCY_ADMIN_SETTERS);
+
 	assert ((maxAge >= 6) && (maxAge <= 40)); // Table 13-5 in 802.1Q-2018
 
 	if (bridge->trees[CIST_INDEX]->BridgeTimes.MaxAge != maxAge)
@@ -1357,6 +1852,9 @@ extern "C" unsigned int STP_GetMaxAge (const struct STP_BRIDGE* bridge)
 
 extern "C" void STP_SetBridgeForwardDelay (struct STP_BRIDGE* bridge, unsigned int forwardDelay, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_BRIDGE_FORWARD_DELAY, forwardDelay, timestamp);
+	ApiCallScope apiCall (bridge, -1, -1, "STP_SetBridgeForwardDelay", STP_LATENCY_ADMIN_SETTERS);
+
 	assert ((forwardDelay >= 4) && (forwardDelay <= 30)); // Table 13-5 in 802.1Q-2018
 
 	if (bridge->trees[CIST_INDEX]->BridgeTimes.ForwardDelay != forwardDelay)
@@ -1381,6 +1879,7 @@ extern "C" unsigned int STP_GetForwardDelay (const struct STP_BRIDGE* bridge)
 
 extern "C" void STP_SetTxHoldCount (struct STP_BRIDGE* bridge, unsigned int txHoldCount, unsigned int timestamp)
 {
+	RECORD (bridge, RECORD_SET_TX_HOLD_COUNT, txHoldCount, timestamp);
 	assert (txHoldCount >= 1 && txHoldCount <= 10); // Table 13-5 in 802.1Q-2018.
 	if (bridge->TxHoldCount != txHoldCount)
 	{
@@ -1399,3 +1898,203 @@ extern "C" unsigned int STP_GetTxCount (const struct STP_BRIDGE* bridge, unsigne
 {
 	return bridge->ports[portIndex]->txCount;
 }
+
+// ============================================================================
+
+extern "C" void STP_SetFdbFlushWindow (struct STP_BRIDGE* bridge, unsigned int window)
+{
+	RECORD (bridge, RECORD_SET_FDB_FLUSH_WINDOW, window);
+	bridge->fdbFlushWindow = window;
+}
+
+extern "C" unsigned int STP_GetFdbFlushWindow (const struct STP_BRIDGE* bridge)
+{
+	return bridge->fdbFlushWindow;
+}
+
+// ============================================================================
+
+extern "C" void STP_GetConvergenceInfo (const struct STP_BRIDGE* bridge, unsigned int treeIndex, struct STP_CONVERGENCE_INFO* infoOut)
+{
+	assert (treeIndex <= bridge->mstiCount);
+
+	*infoOut = bridge->trees[treeIndex]->convergence;
+}
+
+// ============================================================================
+
+extern "C" void STP_ReadCounters (const struct STP_BRIDGE* bridge, struct STP_PORT_COUNTERS* portCountersOut, struct STP_PORT_TREE_COUNTERS* portTreeCountersOut)
+{
+	unsigned int treeCount = 1 + bridge->mstiCount;
+
+	for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
+	{
+		const PORT* port = bridge->ports[portIndex];
+
+		if (portCountersOut != NULL)
+			portCountersOut[portIndex] = port->counters;
+
+		if (portTreeCountersOut != NULL)
+		{
+			for (unsigned int treeIndex = 0; treeIndex < treeCount; treeIndex++)
+				portTreeCountersOut[portIndex * treeCount + treeIndex] = port->trees[treeIndex]->counters;
+		}
+	}
+}
+
+extern "C" void STP_ResetCounters (struct STP_BRIDGE* bridge)
+{
+	unsigned int treeCount = 1 + bridge->mstiCount;
+
+	for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
+	{
+		PORT* port = bridge->ports[portIndex];
+
+		memset (&port->counters, 0, sizeof (port->counters));
+
+		for (unsigned int treeIndex = 0; treeIndex < treeCount; treeIndex++)
+			memset (&port->trees[treeIndex]->counters, 0, sizeof (port->trees[treeIndex]->counters));
+	}
+}
+
+// ============================================================================
+
+// Index of the histogram bucket that counts the given value. Values up to 2^SubBucketBits have a bucket each;
+// above that, the position of the highest set bit selects a group of 2^SubBucketBits buckets, and the next
+// SubBucketBits bits select the bucket within the group.
+static const unsigned int SubBucketBits = STP_LATENCY_SUB_BUCKET_BITS;
+static const unsigned int SubBucketCount = 1u << STP_LATENCY_SUB_BUCKET_BITS;
+
+static unsigned int GetLatencyBucketIndex (unsigned int value)
+{
+	if (value < SubBucketCount)
+		return value;
+
+	unsigned int magnitude = SubBucketBits;
+	while ((value >> magnitude) > 1)
+		magnitude++;
+
+	unsigned int shift = magnitude - SubBucketBits;
+	return ((shift + 1) << SubBucketBits) + (value >> shift) - SubBucketCount;
+}
+
+// Highest value counted in the given bucket.
+static unsigned int GetLatencyBucketHighestValue (unsigned int index)
+{
+	if (index < SubBucketCount)
+		return index;
+
+	unsigned int shift = (index >> SubBucketBits) - 1;
+	unsigned int lowest = ((index & (SubBucketCount - 1)) + SubBucketCount) << shift;
+	return lowest + ((1u << shift) - 1);
+}
+
+static void RecordLatency (STP_LATENCY_HISTOGRAM* histogram, unsigned int latency)
+{
+	if ((histogram->count == 0) || (latency < histogram->min))
+		histogram->min = latency;
+
+	if (latency > histogram->max)
+		histogram->max = latency;
+
+	histogram->count++;
+	histogram->buckets[GetLatencyBucketIndex(latency)]++;
+}
+
+extern "C" void STP_EnableLatencyHistograms (struct STP_BRIDGE* bridge, STP_CALLBACK_CLOCK clock)
+{
+	if ((clock != NULL) && (bridge->latencyHistograms == NULL))
+	{
+		bridge->latencyHistograms = (STP_LATENCY_HISTOGRAM*) bridge->callbacks.allocAndZeroMemory (STP_LATENCY_ENTRY_POINT_COUNT * sizeof (STP_LATENCY_HISTOGRAM));
+		assert (bridge->latencyHistograms != NULL);
+	}
+	else if ((clock == NULL) && (bridge->latencyHistograms != NULL))
+	{
+		bridge->callbacks.freeMemory (bridge->latencyHistograms);
+		bridge->latencyHistograms = NULL;
+	}
+
+	bridge->latencyClock = clock;
+}
+
+extern "C" void STP_GetLatencyHistogram (const struct STP_BRIDGE* bridge, enum STP_LATENCY_ENTRY_POINT entryPoint, struct STP_LATENCY_HISTOGRAM* histogramOut)
+{
+	assert (entryPoint < STP_LATENCY_ENTRY_POINT_COUNT);
+
+	if (bridge->latencyHistograms != NULL)
+		*histogramOut = bridge->latencyHistograms[entryPoint];
+	else
+		memset (histogramOut, 0, sizeof (STP_LATENCY_HISTOGRAM));
+}
+
+extern "C" void STP_ResetLatencyHistograms (struct STP_BRIDGE* bridge)
+{
+	if (bridge->latencyHistograms != NULL)
+		memset (bridge->latencyHistograms, 0, STP_LATENCY_ENTRY_POINT_COUNT * sizeof (STP_LATENCY_HISTOGRAM));
+}
+
+extern "C" void STP_MergeLatencyHistogram (struct STP_LATENCY_HISTOGRAM* destination, const struct STP_LATENCY_HISTOGRAM* source)
+{
+	if (source->count == 0)
+		return;
+
+	if ((destination->count == 0) || (source->min < destination->min))
+		destination->min = source->min;
+
+	if (source->max > destination->max)
+		destination->max = source->max;
+
+	destination->count += source->count;
+	for (unsigned int i = 0; i < STP_LATENCY_BUCKET_COUNT; i++)
+		destination->buckets[i] += source->buckets[i];
+}
+
+extern "C" unsigned int STP_GetLatencyPercentile (const struct STP_LATENCY_HISTOGRAM* histogram, unsigned int hundredthsOfPercent)
+{
+	assert (hundredthsOfPercent <= 10000);
+
+	if (histogram->count == 0)
+		return 0;
+
+	// Rank of the value we're looking for, rounded up, computed so as not to overflow.
+	unsigned int rank = (histogram->count / 10000) * hundredthsOfPercent + ((histogram->count % 10000) * hundredthsOfPercent + 9999) / 10000;
+	if (rank == 0)
+		rank = 1;
+
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < STP_LATENCY_BUCKET_COUNT; i++)
+	{
+		total += histogram->buckets[i];
+		if (total >= rank)
+		{
+			unsigned int value = GetLatencyBucketHighestValue(i);
+			return (value < histogram->max) ? value : histogram->max;
+		}
+	}
+
+	return histogram->max;
+}
+
+// ============================================================================
+
+#if STP_USE_PROFILE
+extern "C" void STP_SetProfileClock (struct STP_BRIDGE* bridge, STP_CALLBACK_CLOCK clock)
+{
+	bridge->profileClock = clock;
+}
+
+extern "C" void STP_SetProfilePassLimit (struct STP_BRIDGE* bridge, unsigned int passLimit)
+{
+	bridge->profilePassLimit = passLimit;
+}
+
+extern "C" void STP_GetProfile (const struct STP_BRIDGE* bridge, struct STP_PROFILE_STATS* statsOut)
+{
+	*statsOut = bridge->profile;
+}
+
+extern "C" void STP_ResetProfile (struct STP_BRIDGE* bridge)
+{
+	memset (&bridge->profile, 0, sizeof (bridge->profile));
+}
+#endif
@@ -238,29 +238,32 @@ enum VALIDATED_BPDU_TYPE STP_GetValidatedBpduType (enum STP_VERSION bridgeStpVer
 // ============================================================================
 
 #if STP_USE_LOG
-void DumpMstpBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bpdu)
+void DumpMstpBpdu (STP_BRIDGE* bridge, unsigned int category, int port, int tree, const MSTP_BPDU* bpdu)
 {
-	LOG (bridge, port, tree, "Flags: TC={D}, Proposal={D}, PortRole={S}, Learning={D}, Forwarding={D}, Agreement={D}\r\n",
+	if (!LOG_ENABLED (bridge, category, port, tree))
+		return;
+
+	LOG (bridge, category, port, tree, "Flags: TC={D}, Proposal={D}, PortRole={S}, Learning={D}, Forwarding={D}, Agreement={D}\r\n",
 			(int) GetBpduFlagTc (bpdu->cistFlags),
 			(int) GetBpduFlagProposal (bpdu->cistFlags),
 			GetBpduPortRoleName (GetBpduFlagPortRole (bpdu->cistFlags)),
 			(int) GetBpduFlagLearning (bpdu->cistFlags),
 			(int) GetBpduFlagForwarding (bpdu->cistFlags),
 			(int) GetBpduFlagAgreement (bpdu->cistFlags));
-	LOG (bridge, port, tree, "CIST Root ID                 : {BID}\r\n", &bpdu->cistRootId);
-	LOG (bridge, port, tree, "CIST External Path Cost      : {D7}\r\n",  (int) bpdu->cistExternalPathCost);
-	LOG (bridge, port, tree, "CIST Regional Root ID        : {BID}\r\n", &bpdu->cistRegionalRootId);
-	LOG (bridge, port, tree, "CIST Internal Root Path Cost : {D7}\r\n",  (int) bpdu->cistInternalRootPathCost);
-	LOG (bridge, port, tree, "CIST Bridge ID               : {BID}\r\n", &bpdu->cistBridgeId);
-	LOG (bridge, port, tree, "CIST Port ID                 : {PID}\r\n", &bpdu->cistPortId);
-	LOG (bridge, port, tree, "CIST MessageAge={D}, MaxAge={D}, HelloTime={D}, ForwardDelay={D}, remainingHops={D}\r\n",
+	LOG (bridge, category, port, tree, "CIST Root ID                 : {BID}\r\n", &bpdu->cistRootId);
+	LOG (bridge, category, port, tree, "CIST External Path Cost      : {D7}\r\n",  (int) bpdu->cistExternalPathCost);
+	LOG (bridge, category, port, tree, "CIST Regional Root ID        : {BID}\r\n", &bpdu->cistRegionalRootId);
+	LOG (bridge, category, port, tree, "CIST Internal Root Path Cost : {D7}\r\n",  (int) bpdu->cistInternalRootPathCost);
+	LOG (bridge, category, port, tree, "CIST Bridge ID               : {BID}\r\n", &bpdu->cistBridgeId);
+	LOG (bridge, category, port, tree, "CIST Port ID                 : {PID}\r\n", &bpdu->cistPortId);
+	LOG (bridge, category, port, tree, "CIST MessageAge={D}, MaxAge={D}, HelloTime={D}, ForwardDelay={D}, remainingHops={D}\r\n",
 		 (int) bpdu->MessageAge / 256,
 		 (int) bpdu->MaxAge / 256,
 		 (int) bpdu->HelloTime / 256,
 		 (int) bpdu->ForwardDelay / 256,
 		 (int) bpdu->cistRemainingHops);
 
-	bpdu->mstConfigId.Dump (bridge, port, tree);
+	bpdu->mstConfigId.Dump (bridge, category, port, tree);
 
 	unsigned short headerRemainder = (unsigned short) sizeof (MSTP_BPDU) - (unsigned short) offsetof (struct MSTP_BPDU, mstConfigId);
 	assert (bpdu->Version3Length >= headerRemainder);
@@ -270,45 +273,45 @@ void DumpMstpBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bpdu
 	MSTI_CONFIG_MESSAGE* mstis = (MSTI_CONFIG_MESSAGE*) &bpdu [1];
 	for (int mstiIndex = 0; mstiIndex < mstiCount; mstiIndex++)
 	{
-		LOG (bridge, port, tree, "MSTI #{D}\r\n", mstiIndex + 1);
+		LOG (bridge, category, port, tree, "MSTI #{D}\r\n", mstiIndex + 1);
 		LOG_INDENT (bridge);
-		mstis [mstiIndex].Dump (bridge, port, tree);
+		mstis [mstiIndex].Dump (bridge, category, port, tree);
 		LOG_UNINDENT (bridge);
 	}
 }
 
 // ============================================================================
 
-void DumpRstpBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bpdu)
+void DumpRstpBpdu (STP_BRIDGE* bridge, unsigned int category, int port, int tree, const MSTP_BPDU* bpdu)
 {
-	LOG (bridge, port, tree, "Flags: TC={D}, Proposal={D}, PortRole={S}, Learning={D}, Forwarding={D}, Agreement={D}\r\n",
+	LOG (bridge, category, port, tree, "Flags: TC={D}, Proposal={D}, PortRole={S}, Learning={D}, Forwarding={D}, Agreement={D}\r\n",
 			(int) GetBpduFlagTc (bpdu->cistFlags),
 			(int) GetBpduFlagProposal (bpdu->cistFlags),
 			GetBpduPortRoleName (GetBpduFlagPortRole (bpdu->cistFlags)),
 			(int) GetBpduFlagLearning (bpdu->cistFlags),
 			(int) GetBpduFlagForwarding (bpdu->cistFlags),
 			(int) GetBpduFlagAgreement (bpdu->cistFlags));
-	LOG (bridge, port, tree, "  Root ID        : {BID}\r\n", &bpdu->cistRootId);
-	LOG (bridge, port, tree, "  Root Path Cost : {D7}\r\n", (int) bpdu->cistExternalPathCost);
-	LOG (bridge, port, tree, "  Bridge ID      : {BID}\r\n", &bpdu->cistRegionalRootId);
-	LOG (bridge, port, tree, "  Port ID        : {PID}\r\n", &bpdu->cistPortId);
-	LOG (bridge, port, tree, "  MessageAge={D}, MaxAge={D}, HelloTime={D}, ForwardDelay={D}\r\n",
+	LOG (bridge, category, port, tree, "  Root ID        : {BID}\r\n", &bpdu->cistRootId);
+	LOG (bridge, category, port, tree, "  Root Path Cost : {D7}\r\n", (int) bpdu->cistExternalPathCost);
+	LOG (bridge, category, port, tree, "  Bridge ID      : {BID}\r\n", &bpdu->cistRegionalRootId);
+	LOG (bridge, category, port, tree, "  Port ID        : {PID}\r\n", &bpdu->cistPortId);
+	LOG (bridge, category, port, tree, "  MessageAge={D}, MaxAge={D}, HelloTime={D}, ForwardDelay={D}\r\n",
 		 (int) bpdu->MessageAge / 256,
 		 (int) bpdu->MaxAge / 256,
 		 (int) bpdu->HelloTime / 256,
 		 (int) bpdu->ForwardDelay / 256);
 }
 
-void DumpConfigBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bpdu)
+void DumpConfigBpdu (STP_BRIDGE* bridge, unsigned int category, int port, int tree, const MSTP_BPDU* bpdu)
 {
-	LOG (bridge, port, tree, "Flags: TC={D}, TCAck={D}\r\n",
+	LOG (bridge, category, port, tree, "Flags: TC={D}, TCAck={D}\r\n",
 			(int) GetBpduFlagTc    (bpdu->cistFlags),
 			(int) GetBpduFlagTcAck (bpdu->cistFlags));
-	LOG (bridge, port, tree, "  Root ID        : {BID}\r\n", &bpdu->cistRootId);
-	LOG (bridge, port, tree, "  Root Path Cost : {D7}\r\n", (int) bpdu->cistExternalPathCost);
-	LOG (bridge, port, tree, "  Bridge ID      : {BID}\r\n", &bpdu->cistRegionalRootId);
-	LOG (bridge, port, tree, "  Port ID        : {PID}\r\n", &bpdu->cistPortId);
-	LOG (bridge, port, tree, "  MessageAge={D}, MaxAge={D}, HelloTime={D}, ForwardDelay={D}\r\n",
+	LOG (bridge, category, port, tree, "  Root ID        : {BID}\r\n", &bpdu->cistRootId);
+	LOG (bridge, category, port, tree, "  Root Path Cost : {D7}\r\n", (int) bpdu->cistExternalPathCost);
+	LOG (bridge, category, port, tree, "  Bridge ID      : {BID}\r\n", &bpdu->cistRegionalRootId);
+	LOG (bridge, category, port, tree, "  Port ID        : {PID}\r\n", &bpdu->cistPortId);
+	LOG (bridge, category, port, tree, "  MessageAge={D}, MaxAge={D}, HelloTime={D}, ForwardDelay={D}\r\n",
 		 (int) bpdu->MessageAge / 256,
 		 (int) bpdu->MaxAge / 256,
 		 (int) bpdu->HelloTime / 256,
@@ -317,9 +320,9 @@ void DumpConfigBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bp
 
 // ============================================================================
 
-void MSTI_CONFIG_MESSAGE::Dump (STP_BRIDGE* bridge, int port, int tree) const
+void MSTI_CONFIG_MESSAGE::Dump (STP_BRIDGE* bridge, unsigned int category, int port, int tree) const
 {
-	LOG (bridge, port, tree, "Flags: TC={D}, Proposal={D}, PortRole={S}, Learning={D}, Forwarding={D}, Agreement={D}, Master={D}\r\n",
+	LOG (bridge, category, port, tree, "Flags: TC={D}, Proposal={D}, PortRole={S}, Learning={D}, Forwarding={D}, Agreement={D}, Master={D}\r\n",
 			(int) GetBpduFlagTc (flags),
 			(int) GetBpduFlagProposal (flags),
 			GetBpduPortRoleName (GetBpduFlagPortRole (flags)),
@@ -327,10 +330,10 @@ void MSTI_CONFIG_MESSAGE::Dump (STP_BRIDGE* bridge, int port, int tree) const
 			(int) GetBpduFlagForwarding (flags),
 			(int) GetBpduFlagAgreement (flags),
 			(int) GetBpduFlagMaster (flags));
-	LOG (bridge, port, tree, "RegionalRootId       : {BID}\r\n", &RegionalRootId);
-	LOG (bridge, port, tree, "InternalRootPathCost : {D}\r\n", (int)InternalRootPathCost);
-	LOG (bridge, port, tree, "BridgePriority       : 0x{X2}\r\n", BridgePriority);
-	LOG (bridge, port, tree, "PortPriority         : 0x{X2}\r\n", PortPriority);
-	LOG (bridge, port, tree, "RemainingHops        : {D}\r\n", RemainingHops);
+	LOG (bridge, category, port, tree, "RegionalRootId       : {BID}\r\n", &RegionalRootId);
+	LOG (bridge, category, port, tree, "InternalRootPathCost : {D}\r\n", (int)InternalRootPathCost);
+	LOG (bridge, category, port, tree, "BridgePriority       : 0x{X2}\r\n", BridgePriority);
+	LOG (bridge, category, port, tree, "PortPriority         : 0x{X2}\r\n", PortPriority);
+	LOG (bridge, category, port, tree, "RemainingHops        : {D}\r\n", RemainingHops);
 }
 #endif
@@ -43,7 +43,7 @@ struct MSTI_CONFIG_MESSAGE
 
 	unsigned char RemainingHops; // f)
 
-	void Dump (STP_BRIDGE* bridge, int port, int tree) const;
+	void Dump (STP_BRIDGE* bridge, unsigned int category, int port, int tree) const;
 };
 
 // ============================================================================
@@ -105,9 +105,9 @@ enum VALIDATED_BPDU_TYPE STP_GetValidatedBpduType (enum STP_VERSION bridgeStpVer
 BPDU_PORT_ROLE GetBpduPortRole (STP_PORT_ROLE role);
 
 #if STP_USE_LOG
-void DumpMstpBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bpdu);
-void DumpRstpBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bpdu);
-void DumpConfigBpdu (STP_BRIDGE* bridge, int port, int tree, const MSTP_BPDU* bpdu);
+void DumpMstpBpdu (STP_BRIDGE* bridge, unsigned int category, int port, int tree, const MSTP_BPDU* bpdu);
+void DumpRstpBpdu (STP_BRIDGE* bridge, unsigned int category, int port, int tree, const MSTP_BPDU* bpdu);
+void DumpConfigBpdu (STP_BRIDGE* bridge, unsigned int category, int port, int tree, const MSTP_BPDU* bpdu);
 #endif
 
 #endif
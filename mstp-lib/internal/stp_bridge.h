@@ -67,6 +67,15 @@ public:
 	}
 
 	PortRoleSelection::State portRoleSelectionState;
+
+	// Not in the standard. Used only when the application supplied the flushFdbPorts callback.
+	bool               fdbFlushPending;       // some bit is set in this tree's port mask
+	bool               fdbFlushDone;          // fdbFlushTimestamp is valid
+	STP_FLUSH_FDB_TYPE fdbFlushPendingType;
+	unsigned int       fdbFlushTimestamp;     // when the flushFdbPorts callback was last called for this tree
+
+	// Not in the standard. Convergence timing, read with STP_GetConvergenceInfo.
+	STP_CONVERGENCE_INFO convergence;
 };
 
 // ============================================================================
@@ -83,10 +92,34 @@ struct STP_BRIDGE
 	bool loggingEnabled;
 	int logCurrentPort;
 	int logCurrentTree;
+
+	// Not in the standard. Set by STP_SetLogFilter; checked by the LOG macro before any formatting.
+	unsigned int logCategoryMask;
+	int logPortFilter; // -1 for all ports
+	int logTreeFilter; // -1 for all trees
+
+	// Not in the standard. Ring buffer for STP_EnableBinaryLogging; NULL while logging produces text.
+	unsigned char* binaryLog;
+	unsigned int binaryLogSize;
+	unsigned int binaryLogStart; // offset of the oldest record
+	unsigned int binaryLogUsed;
+	unsigned int binaryLogLost;  // records overwritten since the last STP_ExportBinaryLog
+
+	// Not in the standard. Single-producer/single-consumer ring for STP_EnableLogRing; NULL while text goes straight to debugStrOut.
+	unsigned char* logRing;
+	unsigned int logRingSize;
+	volatile unsigned int logRingHead; // written only by the protocol thread
+	volatile unsigned int logRingTail; // written only by the thread that calls STP_DrainLogRing
+	unsigned int logRingPendingDrops;  // bytes dropped and not yet reported with a drop marker; protocol thread only
+	unsigned int logRingDroppedBytes;  // totals for STP_GetLogRingStats; protocol thread only
+	unsigned int logRingDroppedChunks;
+	char* logRingReadBuffer;           // used only by STP_DrainLogRing
+	bool logRingLineComplete;          // used only by STP_DrainLogRing
 #endif
 
 	bool BEGIN; // Defined in 13.23.1 in 802.1Q-2005. Widely used but definition was removed subsequent versions of the standard.
 	bool started; // Added by me. STP_StartBridge sets it, STP_StopBridge clears it.
+	bool deferHardwareActions; // Added by me. Set by STP_EnableDeferredHardwareActions.
 
 	STP_CALLBACKS callbacks;
 
@@ -124,6 +157,50 @@ struct STP_BRIDGE
 	const MSTP_BPDU*		receivedBpduContent;
 	VALIDATED_BPDU_TYPE		receivedBpduType;
 	PORT*                   receivedBpduPort;
+
+	// Not in the standard. Used only when the application supplied the applyPortStates callback.
+	// The learning/forwarding changes made while running the state machines are collected here,
+	// and passed to the application in a single call before any BPDU is transmitted.
+	// One entry at most for each port/tree, so the array has portCount * (1 + mstiCount) entries.
+	STP_PORT_STATE_CHANGE*  portStateChanges;
+	unsigned int            portStateChangeCount;
+
+	// Not in the standard. Used only when the application supplied the flushFdbPorts callback.
+	// The ports to be flushed are collected here as one bitmask per tree (bit n of byte n/8 for port n),
+	// and passed to the application at the end of the state machine run, at most once per fdbFlushWindow for each tree.
+	unsigned char*          fdbFlushPortMasks;
+	unsigned int            fdbFlushPortMaskSize;
+	unsigned int            fdbFlushWindow;
+
+#if STP_USE_PROFILE
+	// Not in the standard. Filled in while running the state machines; read with STP_GetProfile.
+	STP_PROFILE_STATS  profile;
+	STP_CALLBACK_CLOCK profileClock;
+	unsigned int       profilePassLimit;
+	unsigned int       profilePassSignature;   // the transitions made in the current pass, hashed together
+	unsigned int       profilePassTransitions; // number of transitions made in the current pass
+#endif
+
+	// Not in the standard. STP_LATENCY_ENTRY_POINT_COUNT histograms, allocated by STP_EnableLatencyHistograms; NULL while disabled.
+	STP_LATENCY_HISTOGRAM*  latencyHistograms;
+	STP_CALLBACK_CLOCK      latencyClock;
+
+	// Not in the standard. Set by STP_EnableRecording; NULL while not recording. While recording, the members of
+	// callbacks point to wrappers that record each call and then call the application's callbacks, saved here.
+	STP_CALLBACK_RECORD_OUT recordOut;
+	STP_CALLBACKS           recordedCallbacks;
+	unsigned int            recordTxPortIndex; // arguments of the last transmitGetBuffer call, for the transmitReleaseBuffer wrapper
+	unsigned int            recordTxSize;
+
+#if STP_USE_TRACE
+	// Not in the standard. Overwrite-oldest ring of trace events, allocated by STP_EnableTracing; NULL while disabled.
+	struct TRACE_RECORD*    traceRing;
+	unsigned int            traceRingSize;  // in records
+	unsigned int            traceRingStart; // index of the oldest record
+	unsigned int            traceRingUsed;
+	unsigned int            traceLost;      // records overwritten since the last STP_ExportTrace
+	STP_CALLBACK_CLOCK      traceClock;
+#endif
 };
 
 
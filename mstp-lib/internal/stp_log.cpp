@@ -8,92 +8,230 @@
 #include "stp_bridge.h"
 #include <assert.h>
 #include <stdarg.h>
-#include <stdio.h>
 #include <string.h>
 
-#ifdef _MSC_VER
-	#define snprintf _snprintf
+// Full memory barrier for the log ring (see STP_EnableLogRing). Define it in the compiler options
+// for toolchains not listed here, if the ring is drained by a thread running on another core.
+#ifndef STP_MEMORY_BARRIER
+	#if defined(__GNUC__)
+		#define STP_MEMORY_BARRIER() __sync_synchronize()
+	#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+		#include <intrin.h>
+		// x86 doesn't reorder stores with other stores or loads with other loads, so we only need to stop the compiler.
+		#define STP_MEMORY_BARRIER() _ReadWriteBarrier()
+	#elif defined(_MSC_VER) && (defined(_M_ARM) || defined(_M_ARM64))
+		#include <intrin.h>
+		#define STP_MEMORY_BARRIER() __dmb(0xB)
+	#elif defined(__ICCARM__)
+		#include <intrinsics.h>
+		#define STP_MEMORY_BARRIER() __DMB()
+	#else
+		#define STP_MEMORY_BARRIER() ((void)0)
+	#endif
 #endif
 
 #if STP_USE_LOG
 
-void STP_FlushLog (STP_BRIDGE* bridge)
+// ============================================================================
+// Log ring.
+//
+// With STP_EnableLogRing, chunks of text are copied to a single-producer/single-consumer ring instead of being
+// passed to debugStrOut. The producer is the thread that calls all other STP functions; the consumer is
+// the thread (or idle loop) that calls STP_DrainLogRing, which passes the chunks to debugStrOut.
+// logRingHead is written only by the producer, logRingTail only by the consumer. Both stay below logRingSize.
+//
+// Each record in the ring is laid out as:
+//   2 bytes - size of the text, little-endian
+//   2 bytes - port, little-endian
+//   2 bytes - tree, little-endian
+//   1 byte  - flags (LogRingFlagFlush, LogRingFlagDropMarker)
+//   1 byte  - unused
+//   rest    - the text, without null terminator; for a drop marker, the number of dropped bytes (4 bytes, little-endian)
+//
+// Drop policy: when a chunk doesn't fit in the free space, the chunk is dropped (never older text), so the producer
+// never waits for the consumer. The next chunk that fits is preceded by a drop marker, which STP_DrainLogRing turns into a line
+// telling how much text was lost.
+//
+// The size field limits chunks to 65535 bytes, so STP_EnableLogRing requires a debugLogBufferSize no larger than that.
+
+static const unsigned int LogRingHeaderSize = 8;
+static const unsigned int LogRingMaxLogBufferSize = 0xFFFF;
+static const unsigned char LogRingFlagFlush = 1;
+static const unsigned char LogRingFlagDropMarker = 2;
+
+static unsigned int LogRingFreeSpace (const STP_BRIDGE* bridge)
 {
-	assert (bridge->logBufferUsedSize < bridge->logBufferMaxSize);
+	unsigned int tail = bridge->logRingTail;
+	STP_MEMORY_BARRIER(); // don't overwrite bytes the consumer might still be reading
+	return (tail + bridge->logRingSize - bridge->logRingHead - 1) % bridge->logRingSize;
+}
 
-	bridge->logBuffer [bridge->logBufferUsedSize] = 0;
-	bridge->callbacks.debugStrOut (bridge, bridge->logCurrentPort, bridge->logCurrentTree, bridge->logBuffer, bridge->logBufferUsedSize, true);
-	bridge->logBufferUsedSize = 0;
+static unsigned int LogRingCopyIn (STP_BRIDGE* bridge, unsigned int offset, const void* src, unsigned int size)
+{
+	const unsigned char* s = (const unsigned char*) src;
+	unsigned int firstPart = bridge->logRingSize - offset;
+	if (firstPart > size)
+		firstPart = size;
+	memcpy (&bridge->logRing [offset], s, firstPart);
+	memcpy (&bridge->logRing [0], s + firstPart, size - firstPart);
+	return (offset + size) % bridge->logRingSize;
 }
 
-static void WriteChar (STP_BRIDGE* bridge, int port, int tree, char c)
+static unsigned int LogRingCopyOut (const STP_BRIDGE* bridge, unsigned int offset, void* dest, unsigned int size)
 {
-	// We're supposed to have enough space for the character and for a null-terminator,
-	// in case we'll have to add it. Otherwise we have a bug somewhere in this function.
-	assert (bridge->logBufferUsedSize <= bridge->logBufferMaxSize - 2);
+	unsigned char* d = (unsigned char*) dest;
+	unsigned int firstPart = bridge->logRingSize - offset;
+	if (firstPart > size)
+		firstPart = size;
+	memcpy (d, &bridge->logRing [offset], firstPart);
+	memcpy (d + firstPart, &bridge->logRing [0], size - firstPart);
+	return (offset + size) % bridge->logRingSize;
+}
 
-	if (c == '\n')
+static unsigned int LogRingWriteRecord (STP_BRIDGE* bridge, unsigned int offset, int port, int tree, unsigned char flags, const void* data, unsigned int size)
+{
+	unsigned char header [LogRingHeaderSize] =
 	{
-		// The line is completing.
+		(unsigned char) size, (unsigned char) (size >> 8),
+		(unsigned char) port, (unsigned char) (port >> 8),
+		(unsigned char) tree, (unsigned char) (tree >> 8),
+		flags, 0
+	};
+
+	offset = LogRingCopyIn (bridge, offset, header, LogRingHeaderSize);
+	return LogRingCopyIn (bridge, offset, data, size);
+}
 
-		if (bridge->logLineStarting)
+// Producer side. Never waits: drops the chunk if there's no space for it.
+static void LogRingPut (STP_BRIDGE* bridge, int port, int tree, const char* text, unsigned int size, bool flush)
+{
+	if (size == 0)
+		return; // STP_DrainLogRing generates the flush hints by itself
+
+	unsigned int needed = LogRingHeaderSize + size;
+	if (bridge->logRingPendingDrops > 0)
+		needed += LogRingHeaderSize + 4;
+
+	if (needed > LogRingFreeSpace (bridge))
+	{
+		bridge->logRingPendingDrops += size;
+		bridge->logRingDroppedBytes += size;
+		bridge->logRingDroppedChunks++;
+		return;
+	}
+
+	unsigned int head = bridge->logRingHead;
+	if (bridge->logRingPendingDrops > 0)
+	{
+		unsigned char count[4] =
 		{
-			// Some library code called us with a line consisting of a single '\n' (without '\r').
-			// We're not supposed to have something like this, as the library currently generates only "\r\n" line endings.
-			assert (false);
+			(unsigned char) bridge->logRingPendingDrops, (unsigned char) (bridge->logRingPendingDrops >> 8),
+			(unsigned char) (bridge->logRingPendingDrops >> 16), (unsigned char) (bridge->logRingPendingDrops >> 24)
+		};
+		head = LogRingWriteRecord (bridge, head, -1, -1, LogRingFlagDropMarker, count, 4);
+		bridge->logRingPendingDrops = 0;
+	}
 
-			// When we'll support this, we should write logCurrentPort and logCurrentTree here, and maybe do something else too.
-		}
+	head = LogRingWriteRecord (bridge, head, port, tree, flush ? LogRingFlagFlush : 0, text, size);
 
-		// We're supposed to have the same port and tree for a \n character.
-		assert ((port == bridge->logCurrentPort) && (tree == bridge->logCurrentTree));
+	STP_MEMORY_BARRIER(); // the record must be complete before the consumer can see it
+	bridge->logRingHead = head;
+}
 
-		bridge->logBuffer [bridge->logBufferUsedSize] = '\n';
-		bridge->logBuffer [bridge->logBufferUsedSize + 1] = 0;
-		bridge->callbacks.debugStrOut (bridge, port, tree, bridge->logBuffer, bridge->logBufferUsedSize + 1, false);
-		bridge->logBufferUsedSize = 0;
+// ============================================================================
+// Text log.
+//
+// Text accumulates in logBuffer and goes to the application in chunks made of whole lines, not one line at a time.
+// A chunk ends when FLUSH_LOG is called, when a line for a different port or tree starts, or when the buffer is full;
+// so all the text in a chunk belongs to the port and tree passed to debugStrOut.
 
-		bridge->logLineStarting = true;
-	}
+static const char Spaces[] = "                                ";
+
+static void PassBufferToApplication (STP_BRIDGE* bridge, bool flush)
+{
+	if (bridge->logRing != NULL)
+		LogRingPut (bridge, bridge->logCurrentPort, bridge->logCurrentTree, bridge->logBuffer, bridge->logBufferUsedSize, flush);
 	else
 	{
-		// Some other char.
+		bridge->logBuffer [bridge->logBufferUsedSize] = 0;
+		bridge->callbacks.debugStrOut (bridge, bridge->logCurrentPort, bridge->logCurrentTree, bridge->logBuffer, bridge->logBufferUsedSize, flush);
+	}
+
+	bridge->logBufferUsedSize = 0;
+}
+
+void STP_FlushLog (STP_BRIDGE* bridge)
+{
+	if (bridge->binaryLog != NULL)
+		return;
+
+	assert (bridge->logBufferUsedSize < bridge->logBufferMaxSize);
+
+	PassBufferToApplication (bridge, true);
+}
+
+// Copies text to the buffer, passing the buffer to the application each time it fills up.
+static void Append (STP_BRIDGE* bridge, const char* text, unsigned int length)
+{
+	while (length > 0)
+	{
+		// We always keep space for the null terminator.
+		unsigned int space = bridge->logBufferMaxSize - 1 - bridge->logBufferUsedSize;
+		unsigned int n = (length < space) ? length : space;
+		memcpy (&bridge->logBuffer [bridge->logBufferUsedSize], text, n);
+		bridge->logBufferUsedSize += n;
+		text += n;
+		length -= n;
+
+		if (bridge->logBufferUsedSize == bridge->logBufferMaxSize - 1)
+			PassBufferToApplication (bridge, false);
+	}
+}
+
+static void AppendSpaces (STP_BRIDGE* bridge, unsigned int count)
+{
+	while (count > 0)
+	{
+		unsigned int n = (count < sizeof (Spaces) - 1) ? count : (unsigned int) (sizeof (Spaces) - 1);
+		Append (bridge, Spaces, n);
+		count -= n;
+	}
+}
 
+static void WriteText (STP_BRIDGE* bridge, int port, int tree, const char* text, unsigned int length)
+{
+	while (length > 0)
+	{
 		if (bridge->logLineStarting)
 		{
-			// First char on this line. We're supposed to have passed the previous line to the application (code above).
-			assert (bridge->logBufferUsedSize == 0);
+			// Some library code called us with a line consisting of a single '\n' (without '\r').
+			// We're not supposed to have something like this, as the library currently generates only "\r\n" line endings.
+			assert (text[0] != '\n');
+
+			// This new line might be for a different combination of port/tree, in which case
+			// the lines we have so far must go to the application in a chunk of their own.
+			if ((bridge->logBufferUsedSize > 0) && ((port != bridge->logCurrentPort) || (tree != bridge->logCurrentTree)))
+				PassBufferToApplication (bridge, false);
 
-			// This new line might be for a different combination of port/tree, so let's update the values
-			// before trying to indent, in case the buffer is really small and we need to call the callback
-			// while writing the indentation spaces.
 			bridge->logCurrentPort = port;
 			bridge->logCurrentTree = tree;
-
-			// This line _before_ writing any indentation chars.
 			bridge->logLineStarting = false;
 
-			for (unsigned int i = 0; i < bridge->logIndent; i++)
-			{
-				// Call ourselves recursively to keep things simple.
-				WriteChar (bridge, port, tree, ' ');
-			}
+			AppendSpaces (bridge, bridge->logIndent);
 		}
 
 		// We're somewhere in the middle of the line. We're not supposed to be changing
 		// the tree or the port here, or else we have a bug somewhere in the library.
 		assert ((port == bridge->logCurrentPort) && (tree == bridge->logCurrentTree));
 
-		bridge->logBuffer [bridge->logBufferUsedSize] = c;
-		bridge->logBufferUsedSize++;
+		const char* lineEnd = (const char*) memchr (text, '\n', length);
+		unsigned int n = (lineEnd != NULL) ? (unsigned int) (lineEnd + 1 - text) : length;
+		Append (bridge, text, n);
+		text += n;
+		length -= n;
 
-		if (bridge->logBufferUsedSize == bridge->logBufferMaxSize - 1)
-		{
-			// We only have space for one additional char, so let's write the null-terminator and pass the buffer to the application.
-			bridge->logBuffer [bridge->logBufferUsedSize] = 0;
-			bridge->callbacks.debugStrOut (bridge, port, tree, bridge->logBuffer, bridge->logBufferUsedSize, false);
-			bridge->logBufferUsedSize = 0;
-		}
+		if (lineEnd != NULL)
+			bridge->logLineStarting = true;
 	}
 }
 
@@ -116,165 +254,737 @@ void STP_Unindent (STP_BRIDGE* bridge)
 	bridge->logIndent -= STP_BRIDGE::LogIndentSize;
 }
 
-void STP_Log (STP_BRIDGE* bridge, int port, int tree, const char* format, ...)
+// Where the arguments of a log call come from: the variable argument list passed to STP_Log,
+// or (when ap is NULL) the raw arguments saved in a binary log record.
+struct LOG_ARG_READER
+{
+	va_list* ap;
+	const unsigned char* data;
+};
+
+// Binary log records keep integers as four bytes, little-endian, so that
+// they can be decoded on a host with a different byte order.
+static void WriteUInt32LE (unsigned char* dest, unsigned int value)
+{
+	dest[0] = (unsigned char) value;
+	dest[1] = (unsigned char) (value >> 8);
+	dest[2] = (unsigned char) (value >> 16);
+	dest[3] = (unsigned char) (value >> 24);
+}
+
+static unsigned int ReadUInt32LE (const unsigned char* src)
+{
+	return (unsigned int) src[0] | ((unsigned int) src[1] << 8) | ((unsigned int) src[2] << 16) | ((unsigned int) src[3] << 24);
+}
+
+static int ReadIntArg (LOG_ARG_READER* args)
+{
+	if (args->ap != NULL)
+		return va_arg (*args->ap, int);
+
+	int v = (int) ReadUInt32LE (args->data);
+	args->data += 4;
+	return v;
+}
+
+static unsigned int ReadUIntArg (LOG_ARG_READER* args)
+{
+	if (args->ap != NULL)
+		return va_arg (*args->ap, unsigned int);
+
+	unsigned int v = ReadUInt32LE (args->data);
+	args->data += 4;
+	return v;
+}
+
+static const char* ReadStringArg (LOG_ARG_READER* args)
+{
+	if (args->ap != NULL)
+		return va_arg (*args->ap, const char*);
+
+	const char* str = (const char*) args->data;
+	args->data += strlen (str) + 1;
+	return str;
+}
+
+// For the placeholders that take a pointer to one of our network-byte-order structures (BRIDGE_ID etc.).
+// The record holds a copy of the structure, which we copy again to get it properly aligned.
+static const void* ReadObjectArg (LOG_ARG_READER* args, void* copy, size_t size)
+{
+	if (args->ap != NULL)
+		return va_arg (*args->ap, const void*);
+
+	memcpy (copy, args->data, size);
+	args->data += size;
+	return copy;
+}
+
+// TIMES has host-order members, so records hold its fields one by one.
+static const TIMES* ReadTimesArg (LOG_ARG_READER* args, TIMES* copy)
+{
+	if (args->ap != NULL)
+		return va_arg (*args->ap, const TIMES*);
+
+	copy->ForwardDelay  = (unsigned short) ReadUInt32LE (&args->data[0]);
+	copy->HelloTime     = (unsigned short) ReadUInt32LE (&args->data[4]);
+	copy->MaxAge        = (unsigned short) ReadUInt32LE (&args->data[8]);
+	copy->MessageAge    = (unsigned short) ReadUInt32LE (&args->data[12]);
+	copy->remainingHops = (unsigned char)  ReadUInt32LE (&args->data[16]);
+	args->data += 20;
+	return copy;
+}
+
+// The functions below format a placeholder into a caller-supplied buffer and return the number of characters written.
+// The buffer passed to FormatV's helpers is always large enough for the longest placeholder ({PVS}).
+
+// Same as "%0*d".
+static unsigned int FormatDecimal (char* dest, int value, unsigned int width)
+{
+	char digits [10];
+	unsigned int digitCount = 0;
+	unsigned int v = (value < 0) ? (0u - (unsigned int) value) : (unsigned int) value;
+	do
+	{
+		digits [digitCount++] = (char) ('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+
+	unsigned int length = 0;
+	if (value < 0)
+		dest [length++] = '-';
+	while (length + digitCount < width)
+		dest [length++] = '0';
+	while (digitCount > 0)
+		dest [length++] = digits [--digitCount];
+	return length;
+}
+
+// Same as "%0*x".
+static unsigned int FormatHex (char* dest, unsigned int value, unsigned int width)
+{
+	static const char HexDigits[] = "0123456789abcdef";
+	char digits [8];
+	unsigned int digitCount = 0;
+	do
+	{
+		digits [digitCount++] = HexDigits [value & 15];
+		value >>= 4;
+	} while (value != 0);
+
+	unsigned int length = 0;
+	while (length + digitCount < width)
+		dest [length++] = '0';
+	while (digitCount > 0)
+		dest [length++] = digits [--digitCount];
+	return length;
+}
+
+static unsigned int FormatString (char* dest, const char* str)
+{
+	unsigned int length = (unsigned int) strlen (str);
+	memcpy (dest, str, length);
+	return length;
+}
+
+static unsigned int FormatBridgeAddress (char* dest, const unsigned char* a)
+{
+	unsigned int length = 0;
+	for (unsigned int i = 0; i < 6; i++)
+		length += FormatHex (&dest [length], a[i], 2);
+	return length;
+}
+
+static unsigned int FormatBridgeId (char* dest, const BRIDGE_ID* bid)
+{
+	unsigned int length = FormatHex (dest, bid->GetPriorityAndMstid(), 4);
+	dest [length++] = '.';
+	length += FormatBridgeAddress (&dest [length], bid->GetAddress().bytes);
+	return length;
+}
+
+static unsigned int FormatPortId (char* dest, const PORT_ID* pid)
+{
+	if (pid->IsInitialized ())
+		return FormatHex (dest, pid->GetPortIdentifier (), 4);
+	else
+		return FormatString (dest, "(undefined)");
+}
+
+// Parses the optional single-digit width of {Dn} and {Xn}, and the closing brace.
+static unsigned int ParseWidth (const char** format)
 {
-	char _buffer [10];
+	unsigned int width = 0;
+	if ((**format >= '0') && (**format <= '9'))
+	{
+		width = **format - '0';
+		(*format)++;
+	}
+
+	assert (**format == '}');
+	(*format)++;
+	return width;
+}
 
-    va_list ap;
-    va_start (ap, format);
+static void FormatV (STP_BRIDGE* bridge, int port, int tree, const char* format, LOG_ARG_READER* args)
+{
+	char text [128];
 
 	while (*format != 0)
 	{
+		if (*format != '{')
+		{
+			// Write all the text up to the next placeholder in one go.
+			const char* end = strchr (format, '{');
+			if (end == NULL)
+				end = format + strlen (format);
+			WriteText (bridge, port, tree, format, (unsigned int) (end - format));
+			format = end;
+			continue;
+		}
+
+		unsigned int length;
+
 		if (strncmp (format, "{BID}", 5) == 0)
 		{
-			const BRIDGE_ID* bid = va_arg (ap, BRIDGE_ID*);
-			STP_Log (bridge, port, tree, "{X4}.{BA}", bid->GetPriorityAndMstid(), &bid->GetAddress());
+			BRIDGE_ID copy;
+			const BRIDGE_ID* bid = (const BRIDGE_ID*) ReadObjectArg (args, &copy, sizeof (copy));
+			length = FormatBridgeId (text, bid);
 			format += 5;
 		}
 		else if (strncmp (format, "{PID}", 5) == 0)
 		{
-			const PORT_ID* pid = va_arg (ap, PORT_ID*);
-			if (pid->IsInitialized ())
-			{
-				unsigned short id = pid->GetPortIdentifier ();
-				STP_Log (bridge, port, tree, "{X4}", (int) id);
-			}
-			else
-				STP_Log (bridge, port, tree, "(undefined)");
+			PORT_ID copy;
+			const PORT_ID* pid = (const PORT_ID*) ReadObjectArg (args, &copy, sizeof (copy));
+			length = FormatPortId (text, pid);
 			format += 5;
 		}
 		else if (strncmp (format, "{BA}", 4) == 0)
 		{
-			const unsigned char* a = va_arg (ap, unsigned char*);
-			STP_Log (bridge, port, tree, "{X2}{X2}{X2}{X2}{X2}{X2}", a[0], a[1], a[2], a[3], a[4], a[5]);
+			STP_BRIDGE_ADDRESS copy;
+			const unsigned char* a = (const unsigned char*) ReadObjectArg (args, &copy, sizeof (copy));
+			length = FormatBridgeAddress (text, a);
 			format += 4;
 		}
 		else if (strncmp (format, "{PVS}", 5) == 0)
 		{
-			const PRIORITY_VECTOR* pv = va_arg (ap, PRIORITY_VECTOR*);
-			STP_Log (bridge, port, tree, "{BID}-{D7}-{BID}-{D7}-{BID}-{PID}",
-					 &pv->RootId,
-					 (int) pv->ExternalRootPathCost,
-					 &pv->RegionalRootId,
-					 (int) pv->InternalRootPathCost,
-					 &pv->DesignatedBridgeId,
-					 &pv->DesignatedPortId);
+			PRIORITY_VECTOR copy;
+			const PRIORITY_VECTOR* pv = (const PRIORITY_VECTOR*) ReadObjectArg (args, &copy, sizeof (copy));
+			length = FormatBridgeId (text, &pv->RootId);
+			text [length++] = '-';
+			length += FormatDecimal (&text [length], (int) pv->ExternalRootPathCost, 7);
+			text [length++] = '-';
+			length += FormatBridgeId (&text [length], &pv->RegionalRootId);
+			text [length++] = '-';
+			length += FormatDecimal (&text [length], (int) pv->InternalRootPathCost, 7);
+			text [length++] = '-';
+			length += FormatBridgeId (&text [length], &pv->DesignatedBridgeId);
+			text [length++] = '-';
+			length += FormatPortId (&text [length], &pv->DesignatedPortId);
 			format += 5;
 		}
 		else if (strncmp (format, "{S", 2) == 0)
 		{
 			format += 2;
-			size_t size = 0;
-			while (true)
+			unsigned int size = 0;
+			while ((*format >= '0') && (*format <= '9'))
 			{
-				char ch = *format;
-				if ((ch < '0') || (ch > '9'))
-					break;
-
-				size = 10 * size + ch - '0';
+				size = 10 * size + *format - '0';
 				format++;
 			}
 
 			assert (*format == '}');
 			format++;
 
-			const char* str = va_arg (ap, const char*);
-			size_t strLen = strlen (str);
-
-			size_t paddingSize = (strLen >= size) ? 0 : (size - strLen);
-			for (size_t i = 0; i < paddingSize; i++)
-				WriteChar (bridge, port, tree, ' ');
+			// Strings can be longer than our buffer, so they're written directly.
+			const char* str = ReadStringArg (args);
+			unsigned int strLen = (unsigned int) strlen (str);
+			for (unsigned int padding = (strLen >= size) ? 0 : (size - strLen); padding > 0; )
+			{
+				unsigned int n = (padding < sizeof (Spaces) - 1) ? padding : (unsigned int) (sizeof (Spaces) - 1);
+				WriteText (bridge, port, tree, Spaces, n);
+				padding -= n;
+			}
 
-			STP_Log (bridge, port, tree, str);
+			WriteText (bridge, port, tree, str, strLen);
+			continue;
 		}
 		else if (strncmp (format, "{T}", 3) == 0)
 		{
-			unsigned int v = va_arg (ap, unsigned int);
-			STP_Log (bridge, port, tree, "{D}.{D3}", (int) (v / 1000), (int) (v % 1000));
+			unsigned int v = ReadUIntArg (args);
+			length = FormatDecimal (text, (int) (v / 1000), 0);
+			text [length++] = '.';
+			length += FormatDecimal (&text [length], (int) (v % 1000), 3);
 			format += 3;
 		}
-		/*
-		else if (strncmp (format, "{I}", 3) == 0)
-		{
-			int i = va_arg (ap, int);
-			while (i--)
-				WriteChar (bridge, port, tree, ' ');
-
-			format += 3;
-		}
-		*/
 		else if (strncmp (format, "{TN}", 4) == 0)
 		{
-			int i = va_arg (ap, int);
+			int i = ReadIntArg (args);
 			if (i == 0)
-				STP_Log (bridge, port, tree, "CIST");
+				length = FormatString (text, "CIST");
 			else
-				STP_Log (bridge, port, tree, "MST{D}", i);
+			{
+				length = FormatString (text, "MST");
+				length += FormatDecimal (&text [length], i, 0);
+			}
 
 			format += 4;
 		}
 		else if (strncmp (format, "{TMS}", 5) == 0)
 		{
-			const TIMES* times = va_arg (ap, TIMES*);
-			STP_Log (bridge, port, tree, "MessageAge={D}, MaxAge={D}, HelloTime={D}, FwDelay={D}, remainingHops={D}",
-					  times->MessageAge, times->MaxAge, times->HelloTime, times->ForwardDelay, times->remainingHops);
+			TIMES copy;
+			const TIMES* times = ReadTimesArg (args, &copy);
+			length = FormatString (text, "MessageAge=");
+			length += FormatDecimal (&text [length], times->MessageAge, 0);
+			length += FormatString (&text [length], ", MaxAge=");
+			length += FormatDecimal (&text [length], times->MaxAge, 0);
+			length += FormatString (&text [length], ", HelloTime=");
+			length += FormatDecimal (&text [length], times->HelloTime, 0);
+			length += FormatString (&text [length], ", FwDelay=");
+			length += FormatDecimal (&text [length], times->ForwardDelay, 0);
+			length += FormatString (&text [length], ", remainingHops=");
+			length += FormatDecimal (&text [length], times->remainingHops, 0);
 			format += 5;
 		}
 		else if (strncmp (format, "{D", 2) == 0)
 		{
 			format += 2;
-			int size;
-			if (*format >= '0' && *format <= '9')
-			{
-				size = *format - '0';
-				format++;
-			}
-			else
-				size = 0;
-
-			assert (*format == '}');
+			unsigned int width = ParseWidth (&format);
+			length = FormatDecimal (text, ReadIntArg (args), width);
+		}
+		else if (strncmp (format, "{X", 2) == 0)
+		{
+			format += 2;
+			unsigned int width = ParseWidth (&format);
+			length = FormatHex (text, ReadUIntArg (args), width);
+		}
+		else
+		{
+			assert (false); // not implemented
+			length = FormatString (text, "{");
 			format++;
+		}
+
+		assert (length <= sizeof (text));
+		WriteText (bridge, port, tree, text, length);
+	}
+}
 
-			int v = va_arg (ap, int);
+// Formats text that isn't recorded to the binary log (used by the decoder for its own lines).
+static void Format (STP_BRIDGE* bridge, int port, int tree, const char* format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+	LOG_ARG_READER args = { &ap, NULL };
+	FormatV (bridge, port, tree, format, &args);
+	va_end (ap);
+}
 
-			snprintf (_buffer, sizeof (_buffer), "%0*d", size, v);
+// ============================================================================
+// Binary log.
+//
+// Each record in the ring is laid out as:
+//   2 bytes        - size of the whole record, little-endian
+//   sizeof(char*)  - pointer to the format string (format strings are always string literals)
+//   2 bytes        - port, little-endian
+//   1 byte         - tree
+//   1 byte         - indentation
+//   rest           - the arguments, in the order of the placeholders in the format string
+//
+// STP_ExportBinaryLog replaces the format pointer with the format text, so that the exported data can be
+// decoded anywhere. An exported record is laid out as:
+//   2 bytes        - size of the format string including its null terminator, little-endian;
+//                    zero for a marker of lost records, in which case a 4-byte count follows
+//   N bytes        - the format string
+//   2 bytes        - port
+//   1 byte         - tree
+//   1 byte         - indentation
+//   2 bytes        - size of the arguments
+//   M bytes        - the arguments
+
+static const unsigned int BinaryLogHeaderSize = 2 + sizeof(const char*) + 4;
+static const unsigned int BinaryLogMaxArgsSize = 256;
+
+static void RingWrite (STP_BRIDGE* bridge, unsigned int offset, const unsigned char* src, unsigned int size)
+{
+	for (unsigned int i = 0; i < size; i++)
+		bridge->binaryLog [(offset + i) % bridge->binaryLogSize] = src[i];
+}
 
-			for (unsigned int i = 0; i < sizeof (_buffer) && _buffer [i] != 0; i++)
-				WriteChar (bridge, port, tree, _buffer [i]);
+static void RingRead (const STP_BRIDGE* bridge, unsigned int offset, unsigned char* dest, unsigned int size)
+{
+	for (unsigned int i = 0; i < size; i++)
+		dest[i] = bridge->binaryLog [(offset + i) % bridge->binaryLogSize];
+}
+
+static unsigned int RingRecordSize (const STP_BRIDGE* bridge)
+{
+	unsigned char sizeBytes[2];
+	RingRead (bridge, bridge->binaryLogStart, sizeBytes, 2);
+	return sizeBytes[0] | (sizeBytes[1] << 8);
+}
+
+static void RingDropOldest (STP_BRIDGE* bridge)
+{
+	unsigned int size = RingRecordSize (bridge);
+	bridge->binaryLogStart = (bridge->binaryLogStart + size) % bridge->binaryLogSize;
+	bridge->binaryLogUsed -= size;
+}
+
+// Saves the arguments without formatting anything. We only need to walk the format string
+// to learn the types of the arguments, the same way FormatV will read them when decoding.
+static void RecordBinary (STP_BRIDGE* bridge, int port, int tree, const char* format, va_list* ap)
+{
+	unsigned char record [BinaryLogHeaderSize + BinaryLogMaxArgsSize];
+	unsigned int size = BinaryLogHeaderSize;
+
+	for (const char* f = format; *f != 0; f++)
+	{
+		if (*f != '{')
+			continue;
+
+		const void* object = NULL;
+		unsigned int objectSize = 0;
+		unsigned int argSize;
+		if (strncmp (f, "{BID}", 5) == 0)
+		{
+			object = va_arg (*ap, const void*);
+			objectSize = argSize = sizeof (BRIDGE_ID);
 		}
-		else if (strncmp (format, "{X", 2) == 0)
+		else if (strncmp (f, "{PID}", 5) == 0)
 		{
-			format += 2;
-			int size;
-			if (*format >= '0' && *format <= '9')
+			object = va_arg (*ap, const void*);
+			objectSize = argSize = sizeof (PORT_ID);
+		}
+		else if (strncmp (f, "{BA}", 4) == 0)
+		{
+			object = va_arg (*ap, const void*);
+			objectSize = argSize = sizeof (STP_BRIDGE_ADDRESS);
+		}
+		else if (strncmp (f, "{PVS}", 5) == 0)
+		{
+			object = va_arg (*ap, const void*);
+			objectSize = argSize = sizeof (PRIORITY_VECTOR);
+		}
+		else if (strncmp (f, "{S", 2) == 0)
+		{
+			object = va_arg (*ap, const char*);
+			objectSize = (unsigned int) strlen ((const char*) object) + 1;
+			argSize = objectSize;
+		}
+		else if (strncmp (f, "{TMS}", 5) == 0)
+			argSize = 20;
+		else
+			argSize = 4; // {T}, {TN}, {D..}, {X..}
+
+		if (size + argSize > sizeof (record))
+		{
+			assert (false); // Increase BinaryLogMaxArgsSize.
+			return;
+		}
+
+		if (object != NULL)
+			memcpy (&record[size], object, objectSize);
+		else if (argSize == 20)
+		{
+			const TIMES* times = va_arg (*ap, const TIMES*);
+			WriteUInt32LE (&record[size],      times->ForwardDelay);
+			WriteUInt32LE (&record[size + 4],  times->HelloTime);
+			WriteUInt32LE (&record[size + 8],  times->MaxAge);
+			WriteUInt32LE (&record[size + 12], times->MessageAge);
+			WriteUInt32LE (&record[size + 16], times->remainingHops);
+		}
+		else
+			WriteUInt32LE (&record[size], va_arg (*ap, unsigned int));
+
+		size += argSize;
+	}
+
+	record[0] = (unsigned char) size;
+	record[1] = (unsigned char) (size >> 8);
+	memcpy (&record[2], &format, sizeof(const char*));
+	record[2 + sizeof(const char*)] = (unsigned char) port;
+	record[3 + sizeof(const char*)] = (unsigned char) (port >> 8);
+	record[4 + sizeof(const char*)] = (unsigned char) tree;
+	record[5 + sizeof(const char*)] = (unsigned char) bridge->logIndent;
+
+	if (size > bridge->binaryLogSize)
+	{
+		bridge->binaryLogLost++;
+		return;
+	}
+
+	// Overwrite the oldest records when the ring is full.
+	while (bridge->binaryLogSize - bridge->binaryLogUsed < size)
+	{
+		RingDropOldest (bridge);
+		bridge->binaryLogLost++;
+	}
+
+	RingWrite (bridge, (bridge->binaryLogStart + bridge->binaryLogUsed) % bridge->binaryLogSize, record, size);
+	bridge->binaryLogUsed += size;
+}
+
+void STP_Log (STP_BRIDGE* bridge, int port, int tree, const char* format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+
+	if (bridge->binaryLog != NULL)
+	{
+		if (*format != 0)
+			RecordBinary (bridge, port, tree, format, &ap);
+	}
+	else
+	{
+		LOG_ARG_READER args = { &ap, NULL };
+		FormatV (bridge, port, tree, format, &args);
+	}
+
+	va_end (ap);
+}
+
+#endif
+
+// ============================================================================
+
+extern "C" void STP_EnableBinaryLogging (STP_BRIDGE* bridge, unsigned int ringBufferSize)
+{
+	#if STP_USE_LOG
+		// Pass on whatever text is still in the buffer, and start afresh on a new line.
+		if (bridge->loggingEnabled && (bridge->binaryLog == NULL) && (bridge->logBufferUsedSize > 0))
+			STP_FlushLog (bridge);
+		bridge->logLineStarting = true;
+
+		if (bridge->binaryLog != NULL)
+		{
+			bridge->callbacks.freeMemory (bridge->binaryLog);
+			bridge->binaryLog = NULL;
+		}
+
+		if (ringBufferSize > 0)
+		{
+			bridge->binaryLog = (unsigned char*) bridge->callbacks.allocAndZeroMemory (ringBufferSize);
+			assert (bridge->binaryLog != NULL);
+		}
+
+		bridge->binaryLogSize  = ringBufferSize;
+		bridge->binaryLogStart = 0;
+		bridge->binaryLogUsed  = 0;
+		bridge->binaryLogLost  = 0;
+	#endif
+}
+
+extern "C" void STP_EnableLogRing (STP_BRIDGE* bridge, unsigned int ringSize)
+{
+	#if STP_USE_LOG
+		// Pass on whatever text is still in the buffer, to where it would have gone before this call.
+		if (bridge->loggingEnabled && (bridge->binaryLog == NULL) && (bridge->logBufferUsedSize > 0))
+			STP_FlushLog (bridge);
+
+		if (bridge->logRing != NULL)
+		{
+			bridge->callbacks.freeMemory (bridge->logRing);
+			bridge->callbacks.freeMemory (bridge->logRingReadBuffer);
+			bridge->logRing = NULL;
+			bridge->logRingReadBuffer = NULL;
+		}
+
+		if (ringSize > 0)
+		{
+			assert (ringSize > LogRingHeaderSize + 4);
+			assert (bridge->logBufferMaxSize <= LogRingMaxLogBufferSize);
+			bridge->logRing = (unsigned char*) bridge->callbacks.allocAndZeroMemory (ringSize);
+			assert (bridge->logRing != NULL);
+
+			// Room for the longest chunk plus its null terminator, and for the text of a drop marker.
+			bridge->logRingReadBuffer = (char*) bridge->callbacks.allocAndZeroMemory (bridge->logBufferMaxSize + 64);
+			assert (bridge->logRingReadBuffer != NULL);
+		}
+
+		bridge->logRingSize = ringSize;
+		bridge->logRingHead = 0;
+		bridge->logRingTail = 0;
+		bridge->logRingPendingDrops = 0;
+		bridge->logRingDroppedBytes = 0;
+		bridge->logRingDroppedChunks = 0;
+		bridge->logRingLineComplete = true;
+	#endif
+}
+
+extern "C" unsigned int STP_DrainLogRing (STP_BRIDGE* bridge)
+{
+	unsigned int drained = 0;
+
+	#if STP_USE_LOG
+		if (bridge->logRing == NULL)
+			return 0;
+
+		unsigned int head = bridge->logRingHead;
+		STP_MEMORY_BARRIER(); // read the records only after reading the head that covers them
+		unsigned int tail = bridge->logRingTail;
+
+		bool flushed = true;
+		while (tail != head)
+		{
+			unsigned char header [LogRingHeaderSize];
+			tail = LogRingCopyOut (bridge, tail, header, LogRingHeaderSize);
+			unsigned int size = header[0] | (header[1] << 8);
+			int port = (short) (header[2] | (header[3] << 8));
+			int tree = (short) (header[4] | (header[5] << 8));
+			char* text = bridge->logRingReadBuffer;
+
+			if (header[6] & LogRingFlagDropMarker)
 			{
-				size = *format - '0';
-				format++;
+				unsigned char count [4];
+				tail = LogRingCopyOut (bridge, tail, count, 4);
+
+				// The dropped text might have ended in the middle of a line.
+				size = bridge->logRingLineComplete ? 0 : FormatString (text, "\r\n");
+				size += FormatString (&text [size], "(... ");
+				size += FormatDecimal (&text [size], (int) ReadUInt32LE (count), 0);
+				size += FormatString (&text [size], " bytes of log text dropped ...)\r\n");
+				flushed = false;
 			}
 			else
-				size = 0;
+			{
+				tail = LogRingCopyOut (bridge, tail, text, size);
+				flushed = (header[6] & LogRingFlagFlush) != 0;
+			}
 
-			assert (*format == '}');
-			format++;
+			text [size] = 0;
+			bridge->logRingLineComplete = (text [size - 1] == '\n');
+			bridge->callbacks.debugStrOut (bridge, port, tree, text, size, flushed);
+			drained += size;
 
-			int v = va_arg (ap, int);
+			STP_MEMORY_BARRIER(); // finish reading the record before the producer can reuse its space
+			bridge->logRingTail = tail;
+		}
 
-			snprintf (_buffer, sizeof (_buffer), "%0*x", size, v);
+		if (!flushed)
+		{
+			bridge->logRingReadBuffer[0] = 0;
+			bridge->callbacks.debugStrOut (bridge, -1, -1, bridge->logRingReadBuffer, 0, true);
+		}
+	#endif
+
+	return drained;
+}
 
-			for (unsigned int i = 0; i < sizeof (_buffer) && _buffer [i] != 0; i++)
-				WriteChar (bridge, port, tree, _buffer [i]);
+extern "C" void STP_GetLogRingStats (const STP_BRIDGE* bridge, unsigned int* droppedBytesOut, unsigned int* droppedChunksOut)
+{
+	#if STP_USE_LOG
+		*droppedBytesOut = bridge->logRingDroppedBytes;
+		*droppedChunksOut = bridge->logRingDroppedChunks;
+	#else
+		*droppedBytesOut = 0;
+		*droppedChunksOut = 0;
+	#endif
+}
+
+extern "C" unsigned int STP_ExportBinaryLog (STP_BRIDGE* bridge, unsigned char* buffer, unsigned int bufferSize)
+{
+	unsigned int written = 0;
+
+	#if STP_USE_LOG
+		if (bridge->binaryLog == NULL)
+			return 0;
+
+		if (bridge->binaryLogLost > 0)
+		{
+			if (bufferSize < 6)
+				return 0;
+
+			buffer[0] = buffer[1] = 0;
+			WriteUInt32LE (&buffer[2], bridge->binaryLogLost);
+			bridge->binaryLogLost = 0;
+			written = 6;
 		}
-		else if (*format == '{')
+
+		while (bridge->binaryLogUsed > 0)
 		{
-			assert (false); // not implemented
+			unsigned char record [BinaryLogHeaderSize + BinaryLogMaxArgsSize];
+			unsigned int recordSize = RingRecordSize (bridge);
+			RingRead (bridge, bridge->binaryLogStart, record, recordSize);
+
+			const char* format;
+			memcpy (&format, &record[2], sizeof(const char*));
+			unsigned int formatSize = (unsigned int) strlen (format) + 1;
+			unsigned int argsSize = recordSize - BinaryLogHeaderSize;
+
+			if (written + 2 + formatSize + 6 + argsSize > bufferSize)
+				break;
+
+			unsigned char* dest = &buffer[written];
+			dest[0] = (unsigned char) formatSize;
+			dest[1] = (unsigned char) (formatSize >> 8);
+			memcpy (&dest[2], format, formatSize);
+			memcpy (&dest[2 + formatSize], &record[2 + sizeof(const char*)], 4); // port, tree, indent
+			dest[6 + formatSize] = (unsigned char) argsSize;
+			dest[7 + formatSize] = (unsigned char) (argsSize >> 8);
+			memcpy (&dest[8 + formatSize], &record[BinaryLogHeaderSize], argsSize);
+			written += 8 + formatSize + argsSize;
+
+			RingDropOldest (bridge);
 		}
-		else
+	#endif
+
+	return written;
+}
+
+extern "C" unsigned int STP_DecodeBinaryLog (const unsigned char* data, unsigned int size, STP_CALLBACK_DEBUG_STR_OUT debugStrOut, void* applicationContext)
+{
+	unsigned int offset = 0;
+
+	#if STP_USE_LOG
+		// The formatting code writes to a bridge, so we make a dummy one that passes the text to the caller.
+		char lineBuffer [256];
+		STP_BRIDGE decoder = STP_BRIDGE();
+		decoder.callbacks.debugStrOut = debugStrOut;
+		decoder.applicationContext = applicationContext;
+		decoder.logBuffer = lineBuffer;
+		decoder.logBufferMaxSize = sizeof (lineBuffer);
+		decoder.logCurrentPort = -1;
+		decoder.logCurrentTree = -1;
+		decoder.logLineStarting = true;
+		decoder.loggingEnabled = true;
+
+		while (offset + 2 <= size)
 		{
-			WriteChar (bridge, port, tree, *format);
-			format++;
+			const unsigned char* record = &data[offset];
+			unsigned int formatSize = record[0] | (record[1] << 8);
+
+			if (formatSize == 0)
+			{
+				if (offset + 6 > size)
+					break;
+
+				// Records were overwritten here, so the line we were in the middle of won't be completed.
+				if (!decoder.logLineStarting)
+					Format (&decoder, decoder.logCurrentPort, decoder.logCurrentTree, "\r\n");
+				Format (&decoder, -1, -1, "(... {D} log records lost ...)\r\n", (int) ReadUInt32LE (&record[2]));
+				offset += 6;
+				continue;
+			}
+
+			if (offset + 8 + formatSize > size)
+				break;
+			unsigned int argsSize = record[6 + formatSize] | (record[7 + formatSize] << 8);
+			if (offset + 8 + formatSize + argsSize > size)
+				break;
+
+			const char* format = (const char*) &record[2];
+			int port = (short) (record[2 + formatSize] | (record[3 + formatSize] << 8));
+			int tree = (signed char) record[4 + formatSize];
+			decoder.logIndent = record[5 + formatSize];
+
+			LOG_ARG_READER args = { NULL, &record[8 + formatSize] };
+			FormatV (&decoder, port, tree, format, &args);
+
+			offset += 8 + formatSize + argsSize;
 		}
-	}
 
-	va_end (ap);
+		STP_FlushLog (&decoder);
+	#endif
+
+	return offset;
 }
-#endif
@@ -15,12 +15,19 @@
 	void STP_Indent (STP_BRIDGE* bridge);
 	void STP_Unindent (STP_BRIDGE* bridge);
 
-	#define LOG(b,p,t,...)		((void) ( !(b)->loggingEnabled || (STP_Log(b,p,t,__VA_ARGS__), 0)))
+	// Category, port and tree filters are checked before STP_Log is called, so filtered-out lines cost no formatting.
+	// Categories missing from STP_LOG_CATEGORIES make the condition a constant false and the call is compiled out.
+	#define LOG_ENABLED(b,c,p,t)	( (STP_LOG_CATEGORIES & (c)) && (b)->loggingEnabled && ((b)->logCategoryMask & (c)) \
+									&& (((b)->logPortFilter < 0) || ((int)(p) < 0) || ((int)(p) == (b)->logPortFilter)) \
+									&& (((b)->logTreeFilter < 0) || ((int)(t) < 0) || ((int)(t) == (b)->logTreeFilter)) )
+
+	#define LOG(b,c,p,t,...)	((void) ( !LOG_ENABLED(b,c,p,t) || (STP_Log(b,p,t,__VA_ARGS__), 0)))
 	#define FLUSH_LOG(b)		((void) ( !(b)->loggingEnabled || (STP_FlushLog(b), 0)))
 	#define LOG_INDENT(b)		((void) ( !(b)->loggingEnabled || (STP_Indent(b), 0)))
 	#define LOG_UNINDENT(b)		((void) ( !(b)->loggingEnabled || (STP_Unindent(b), 0)))
 #else
-	#define LOG(b,p,t,...)		((void)0)
+	#define LOG_ENABLED(b,c,p,t)	(false)
+	#define LOG(b,c,p,t,...)	((void)0)
 	#define FLUSH_LOG(b)		((void)0)
 	#define LOG_INDENT(b)		((void)0)
 	#define LOG_UNINDENT(b)		((void)0)
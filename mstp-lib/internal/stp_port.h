@@ -82,6 +82,21 @@ struct PORT_TREE
 	// Not in the standard. Used by STP_Get/SetAdminInternalPortPathCost.
 	unsigned int adminInternalPortPathCost;
 
+	// Not in the standard. Set while this port/tree has an entry in STP_BRIDGE::portStateChanges.
+	bool portStateQueued : 1;
+
+	// Not in the standard. The learning/forwarding states last requested from the hardware. With deferred hardware
+	// actions, learning/forwarding follow these only after the application calls STP_OnHardwareActionComplete.
+	bool learningRequested   : 1;
+	bool forwardingRequested : 1;
+
+	// Not in the standard. With deferred hardware actions, the number of FDB flushes requested from the
+	// application and not yet reported complete. fdbFlush is kept set while this is non-zero.
+	unsigned short fdbFlushesOutstanding;
+
+	// Not in the standard. Read with STP_ReadCounters.
+	STP_PORT_TREE_COUNTERS counters;
+
 	PortInformation::State     portInformationState;
 	PortRoleTransitions::State portRoleTransitionsState;
 	PortStateTransition::State portStateTransitionState;
@@ -179,6 +194,9 @@ struct PORT
 	// Not in the standard. Used by STP_Get/SetAdminExternalPortPathCost.
 	unsigned int adminExternalPortPathCost;
 
+	// Not in the standard. Read with STP_ReadCounters.
+	STP_PORT_COUNTERS counters;
+
 	PortTimers::State            portTimersState;
 	PortProtocolMigration::State portProtocolMigrationState;
 	PortReceive::State           portReceiveState;
@@ -8,8 +8,10 @@
 #include "stp_bridge.h"
 #include "stp_conditions_and_params.h"
 #include "stp_log.h"
+#include "stp_trace.h"
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
 
 #ifdef __GNUC__
 	// For GCC older than 8.x: disable the warning for accessing a field of a non-POD NULL object
@@ -56,44 +58,266 @@ void clearReselectTree (STP_BRIDGE* bridge, TreeIndex givenTree)
 		bridge->ports [portIndex]->trees [givenTree]->reselect = false;
 }
 
+// ============================================================================
+// Not in the standard. Used instead of the enableLearning/enableForwarding callbacks when the application
+// supplied the applyPortStates callback. Only remembers that the hardware state of this port/tree must be
+// updated; the state itself is read from learningRequested/forwardingRequested in ApplyPortStateChanges().
+static void QueuePortStateChange (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree)
+{
+	PORT_TREE* tree = bridge->ports [givenPort]->trees [givenTree];
+	if (!tree->portStateQueued)
+	{
+		assert (bridge->portStateChangeCount < bridge->portCount * (1 + bridge->mstiCount));
+		STP_PORT_STATE_CHANGE* change = &bridge->portStateChanges [bridge->portStateChangeCount];
+		change->portIndex = givenPort;
+		change->treeIndex = givenTree;
+		bridge->portStateChangeCount++;
+		tree->portStateQueued = true;
+	}
+}
+
+// Not in the standard. Passes to the applyPortStates callback, in a single call, the learning/forwarding
+// states of all port/trees changed since the last call. RunStateMachines() calls this before executing
+// the PortTransmit state machines, so no BPDU can advertise a state not yet written to the hardware.
+void ApplyPortStateChanges (STP_BRIDGE* bridge, unsigned int timestamp)
+{
+	if (bridge->portStateChangeCount == 0)
+		return;
+
+	for (unsigned int i = 0; i < bridge->portStateChangeCount; i++)
+	{
+		STP_PORT_STATE_CHANGE* change = &bridge->portStateChanges [i];
+		PORT_TREE* tree = bridge->ports [change->portIndex]->trees [change->treeIndex];
+		change->learning   = tree->learningRequested;
+		change->forwarding = tree->forwardingRequested;
+		tree->portStateQueued = false;
+	}
+
+	unsigned int changeCount = bridge->portStateChangeCount;
+	bridge->portStateChangeCount = 0;
+
+	FLUSH_LOG (bridge);
+	TRACE (bridge, STP_TRACE_EVENT_CALLBACK, -1, -1, changeCount, "applyPortStates", NULL);
+	bridge->callbacks.applyPortStates (bridge, bridge->portStateChanges, changeCount, timestamp);
+}
+
+// ============================================================================
+// Not in the standard. Called by the Topology Change state machine where the standard sets fdbFlush.
+// Calls the flushFdb callback right away, or, if the application supplied the flushFdbPorts callback,
+// only marks the port in the mask of the tree, to be passed to the application by DeliverFdbFlushes().
+void FlushFdb (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
+{
+	STP_FLUSH_FDB_TYPE flushType = rstpVersion (bridge) ? STP_FLUSH_FDB_TYPE_IMMEDIATE : STP_FLUSH_FDB_TYPE_RAPID_AGEING;
+
+	PORT_TREE* portTree = bridge->ports [givenPort]->trees [givenTree];
+
+	if (bridge->callbacks.flushFdbPorts == NULL)
+	{
+		if (bridge->deferHardwareActions)
+		{
+			portTree->fdbFlushesOutstanding++;
+			portTree->fdbFlush = true;
+		}
+
+		FLUSH_LOG (bridge);
+		TRACE (bridge, STP_TRACE_EVENT_CALLBACK, givenPort, givenTree, flushType, "flushFdb", NULL);
+		bridge->callbacks.flushFdb (bridge, givenPort, givenTree, flushType, timestamp);
+		return;
+	}
+
+	BRIDGE_TREE* tree = bridge->trees [givenTree];
+	unsigned char* mask = &bridge->fdbFlushPortMasks [givenTree * bridge->fdbFlushPortMaskSize];
+
+	if (tree->fdbFlushPending && (tree->fdbFlushPendingType != flushType))
+	{
+		// Can happen only after a protocol version change. Don't merge flushes of different types.
+		FLUSH_LOG (bridge);
+		TRACE (bridge, STP_TRACE_EVENT_CALLBACK, -1, givenTree, tree->fdbFlushPendingType, "flushFdbPorts", NULL);
+		bridge->callbacks.flushFdbPorts (bridge, givenTree, mask, bridge->fdbFlushPortMaskSize, tree->fdbFlushPendingType, timestamp);
+		memset (mask, 0, bridge->fdbFlushPortMaskSize);
+		tree->fdbFlushDone = true;
+		tree->fdbFlushTimestamp = timestamp;
+	}
+
+	unsigned char bit = (unsigned char) (1 << (givenPort % 8));
+	if (bridge->deferHardwareActions && ((mask [givenPort / 8] & bit) == 0))
+	{
+		// The application reports completion once for each bit set in the mask it receives.
+		portTree->fdbFlushesOutstanding++;
+		portTree->fdbFlush = true;
+	}
+
+	mask [givenPort / 8] |= bit;
+	tree->fdbFlushPending = true;
+	tree->fdbFlushPendingType = flushType;
+}
+
+// Not in the standard. Passes the collected port masks to the flushFdbPorts callback, one call per tree.
+// A tree flushed less than fdbFlushWindow ago keeps its mask (and keeps collecting ports into it)
+// until a later call finds the window expired; ignoreWindow delivers everything right away.
+void DeliverFdbFlushes (STP_BRIDGE* bridge, bool ignoreWindow, unsigned int timestamp)
+{
+	for (unsigned int treeIndex = 0; treeIndex < 1 + bridge->mstiCount; treeIndex++)
+	{
+		BRIDGE_TREE* tree = bridge->trees [treeIndex];
+		if (!tree->fdbFlushPending)
+			continue;
+
+		if (!ignoreWindow && tree->fdbFlushDone && (timestamp - tree->fdbFlushTimestamp < bridge->fdbFlushWindow))
+			continue;
+
+		unsigned char* mask = &bridge->fdbFlushPortMasks [treeIndex * bridge->fdbFlushPortMaskSize];
+		FLUSH_LOG (bridge);
+		TRACE (bridge, STP_TRACE_EVENT_CALLBACK, -1, treeIndex, tree->fdbFlushPendingType, "flushFdbPorts", NULL);
+		bridge->callbacks.flushFdbPorts (bridge, treeIndex, mask, bridge->fdbFlushPortMaskSize, tree->fdbFlushPendingType, timestamp);
+		memset (mask, 0, bridge->fdbFlushPortMaskSize);
+		tree->fdbFlushPending = false;
+		tree->fdbFlushDone = true;
+		tree->fdbFlushTimestamp = timestamp;
+	}
+}
+
+// ============================================================================
+// Not in the standard. Called where a port changes its role or its learning/forwarding state.
+// The first such change after the tree was stable starts a new convergence.
+void RecordTreeActivity (STP_BRIDGE* bridge, TreeIndex givenTree, unsigned int timestamp)
+{
+	STP_CONVERGENCE_INFO* convergence = &bridge->trees [givenTree]->convergence;
+	if (!convergence->converging)
+	{
+		convergence->converging = true;
+		convergence->convergenceStartTimestamp = timestamp;
+	}
+
+	convergence->lastTransitionTimestamp = timestamp;
+}
+
+static bool IsTreeStable (const STP_BRIDGE* bridge, TreeIndex givenTree)
+{
+	for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
+	{
+		const PORT_TREE* tree = bridge->ports [portIndex]->trees [givenTree];
+
+		if (!tree->selected || tree->updtInfo || (tree->role != tree->selectedRole))
+			return false;
+
+		bool forwardingRole = (tree->role == STP_PORT_ROLE_ROOT) || (tree->role == STP_PORT_ROLE_DESIGNATED) || (tree->role == STP_PORT_ROLE_MASTER);
+		if ((tree->learning != forwardingRole) || (tree->forwarding != forwardingRole))
+			return false;
+	}
+
+	return true;
+}
+
+// Not in the standard. Called at the end of each state machine run; ends the convergence of the trees
+// whose ports have all reached a stable state.
+void CheckTreeConvergence (STP_BRIDGE* bridge, unsigned int timestamp)
+{
+	for (unsigned int treeIndex = 0; treeIndex < bridge->treeCount(); treeIndex++)
+	{
+		STP_CONVERGENCE_INFO* convergence = &bridge->trees [treeIndex]->convergence;
+		if (convergence->converging && IsTreeStable (bridge, (TreeIndex) treeIndex))
+		{
+			convergence->converging = false;
+			convergence->convergenceCount++;
+			convergence->convergedTimestamp = timestamp;
+			convergence->lastConvergenceDuration = timestamp - convergence->convergenceStartTimestamp;
+
+			if (bridge->callbacks.onTreeConverged != NULL)
+			{
+				FLUSH_LOG (bridge);
+				bridge->callbacks.onTreeConverged (bridge, treeIndex, convergence->convergenceStartTimestamp, timestamp);
+			}
+		}
+	}
+}
+
 // ============================================================================
 // 13.29.d) - 13.29.4 in 802.1Q-2018
 // An implementation-dependent procedure that causes the Forwarding Process (8.6) to stop forwarding frames
 // through the port. The procedure does not complete until forwarding has stopped.
-void disableForwarding (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
+//
+// Note AG: This procedure and the three below return false when the application asked for deferred hardware
+// actions (STP_EnableDeferredHardwareActions). In that case the action has only been initiated, and the caller
+// must leave the learning/forwarding variable unchanged; STP_OnHardwareActionComplete updates it later.
+bool disableForwarding (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
 {
-	FLUSH_LOG (bridge);
-	bridge->callbacks.enableForwarding (bridge, givenPort, givenTree, false, timestamp);
+	bridge->ports [givenPort]->trees [givenTree]->forwardingRequested = false;
+	RecordTreeActivity (bridge, givenTree, timestamp);
+
+	if (bridge->callbacks.applyPortStates != NULL)
+		QueuePortStateChange (bridge, givenPort, givenTree);
+	else
+	{
+		FLUSH_LOG (bridge);
+		TRACE (bridge, STP_TRACE_EVENT_CALLBACK, givenPort, givenTree, false, "enableForwarding", NULL);
+		bridge->callbacks.enableForwarding (bridge, givenPort, givenTree, false, timestamp);
+	}
+
+	return !bridge->deferHardwareActions;
 }
 
 // ============================================================================
 // 13.29.e) - 13.29.5 in 802.1Q-2018
 // An implementation-dependent procedure that causes the Learning Process (8.7) to stop learning from the
 // source address of frames received on the port. The procedure does not complete until learning has stopped.
-void disableLearning (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
+bool disableLearning (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
 {
-	FLUSH_LOG (bridge);
-	bridge->callbacks.enableLearning (bridge, givenPort, givenTree, false, timestamp);
+	bridge->ports [givenPort]->trees [givenTree]->learningRequested = false;
+	RecordTreeActivity (bridge, givenTree, timestamp);
+
+	if (bridge->callbacks.applyPortStates != NULL)
+		QueuePortStateChange (bridge, givenPort, givenTree);
+	else
+	{
+		FLUSH_LOG (bridge);
+		TRACE (bridge, STP_TRACE_EVENT_CALLBACK, givenPort, givenTree, false, "enableLearning", NULL);
+		bridge->callbacks.enableLearning (bridge, givenPort, givenTree, false, timestamp);
+	}
+
+	return !bridge->deferHardwareActions;
 }
 
 // ============================================================================
 // 13.29.f) - 13.29.6 in 802.1Q-2018
 // An implementation-dependent procedure that causes the Forwarding Process (8.6) to start forwarding
 // frames through the port. The procedure does not complete until forwarding has been enabled.
-void enableForwarding (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
+bool enableForwarding (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
 {
-	FLUSH_LOG (bridge);
-	bridge->callbacks.enableForwarding (bridge, givenPort, givenTree, true, timestamp);
+	bridge->ports [givenPort]->trees [givenTree]->forwardingRequested = true;
+	RecordTreeActivity (bridge, givenTree, timestamp);
+
+	if (bridge->callbacks.applyPortStates != NULL)
+		QueuePortStateChange (bridge, givenPort, givenTree);
+	else
+	{
+		FLUSH_LOG (bridge);
+		TRACE (bridge, STP_TRACE_EVENT_CALLBACK, givenPort, givenTree, true, "enableForwarding", NULL);
+		bridge->callbacks.enableForwarding (bridge, givenPort, givenTree, true, timestamp);
+	}
+
+	return !bridge->deferHardwareActions;
 }
 
 // ============================================================================
 // 13.29.g) - 13.29.7 in 802.1Q-2018
 // An implementation-dependent procedure that causes the Learning Process (8.7) to start learning from frames
 // received on the port. The procedure does not complete until learning has been enabled.
-void enableLearning (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
+bool enableLearning (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, unsigned int timestamp)
 {
-	FLUSH_LOG (bridge);
-	bridge->callbacks.enableLearning (bridge, givenPort, givenTree, true, timestamp);
+	bridge->ports [givenPort]->trees [givenTree]->learningRequested = true;
+	RecordTreeActivity (bridge, givenTree, timestamp);
+
+	if (bridge->callbacks.applyPortStates != NULL)
+		QueuePortStateChange (bridge, givenPort, givenTree);
+	else
+	{
+		FLUSH_LOG (bridge);
+		TRACE (bridge, STP_TRACE_EVENT_CALLBACK, givenPort, givenTree, true, "enableLearning", NULL);
+		bridge->callbacks.enableLearning (bridge, givenPort, givenTree, true, timestamp);
+	}
+
+	return !bridge->deferHardwareActions;
 }
 
 // ============================================================================
@@ -157,19 +381,28 @@ void newTcWhile (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree, u
 	PORT* port = bridge->ports [givenPort];
 	PORT_TREE* portTree = port->trees [givenTree];
 
-	if ((portTree->tcWhile == 0) && port->sendRSTP)
+	// Note AG: See in 802.1Q-2018:
+	//  - 12.8.1.1.3, b) and c);
+	//  - 12.8.1.2.3, c) and d).
+	bool topologyChange = false;
+	if (portTree->tcWhile == 0)
 	{
-		// Note AG: See in 802.1Q-2018:
-		//  - 12.8.1.1.3, b) and c);
-		//  - 12.8.1.2.3, c) and d).
-		if (bridge->callbacks.onTopologyChange)
+		topologyChange = true;
+		for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
+			topologyChange &= (bridge->ports[portIndex]->trees[givenTree]->tcWhile == 0);
+
+		if (topologyChange)
 		{
-			bool allZero = true;
-			for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
-				allZero &= (bridge->ports[portIndex]->trees[givenTree]->tcWhile == 0);
-			if (allZero)
-				bridge->callbacks.onTopologyChange (bridge, (unsigned int) givenTree, timestamp);
+			STP_CONVERGENCE_INFO* convergence = &bridge->trees [givenTree]->convergence;
+			convergence->topologyChangeCount++;
+			convergence->lastTopologyChangeTimestamp = timestamp;
 		}
+	}
+
+	if ((portTree->tcWhile == 0) && port->sendRSTP)
+	{
+		if (topologyChange && bridge->callbacks.onTopologyChange)
+			bridge->callbacks.onTopologyChange (bridge, (unsigned int) givenTree, timestamp);
 
 		portTree->tcWhile = 1 + port->trees [CIST_INDEX]->portTimes.HelloTime;
 
@@ -384,7 +617,7 @@ void rcvMsgs (STP_BRIDGE* bridge, PortIndex givenPort)
 	// the Port Information state machine for that MSTI.
 	if (port->rcvdInternal)
 	{
-		LOG (bridge, -1, -1, "rcvMsgs() -- rcvdInternal==1\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, -1, -1, "rcvMsgs() -- rcvdInternal==1\r\n");
 
 		// these assert conditions should have been checked while validating the received bpdu
 		size_t version3Length = bridge->receivedBpduContent->Version3Length;
@@ -400,7 +633,7 @@ void rcvMsgs (STP_BRIDGE* bridge, PortIndex givenPort)
 		if (mstiMessageCount > bridge->mstiCount)
 		{
 			// The sender sent us too many MSTI messages. Let's ignore the ones we can't handle.
-			LOG (bridge, -1, -1, "rcvMsgs() -- Ignoring MSTI messages {D}..{D}\r\n", (int)bridge->mstiCount, (int)mstiMessageCount - 1);
+			LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, -1, -1, "rcvMsgs() -- Ignoring MSTI messages {D}..{D}\r\n", (int)bridge->mstiCount, (int)mstiMessageCount - 1);
 			mstiMessageCount = bridge->mstiCount;
 		}
 		
@@ -441,7 +674,7 @@ void rcvMsgs (STP_BRIDGE* bridge, PortIndex givenPort)
 	else
 	{
 		// From 13.11 in 802.1Q-2018: An MSTI message priority vector received from a Bridge not in the same MST Region is discarded.
-		LOG (bridge, -1, -1, "rcvMsgs() -- rcvdInternal==0\r\n");
+		LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, -1, -1, "rcvMsgs() -- rcvdInternal==0\r\n");
 	}
 }
 
@@ -607,7 +840,7 @@ void recordMastered (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTre
 			port->mastered = false;
 	}
 
-	LOG (bridge, givenPort, givenTree, "Port {D}: {TN}: recordMastered(): {D}\r\n", 1 + givenPort, givenTree, (int) port->mastered);
+	LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, givenPort, givenTree, "Port {D}: {TN}: recordMastered(): {D}\r\n", 1 + givenPort, givenTree, (int) port->mastered);
 }
 
 // ============================================================================
@@ -623,7 +856,7 @@ void recordPriority (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTre
 
 	portTree->portPriority = portTree->msgPriority;
 
-	LOG (bridge, givenPort, givenTree, "Port {D}: {TN}: recordPriority(): {PVS}\r\n", 1 + givenPort, givenTree, &portTree->portPriority);
+	LOG (bridge, STP_LOG_CATEGORY_BPDU_RX, givenPort, givenTree, "Port {D}: {TN}: recordPriority(): {PVS}\r\n", 1 + givenPort, givenTree, &portTree->portPriority);
 }
 
 // ============================================================================
@@ -756,13 +989,19 @@ void setTcFlags (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree)
 		if ((port->rcvdInternal == false) && cistTree->msgFlagsTc)
 		{
 			for (unsigned int treeIndex = 0; treeIndex < bridge->treeCount(); treeIndex++)
+			{
 				port->trees [treeIndex]->rcvdTc = true;
+				port->trees [treeIndex]->counters.tcReceived++;
+			}
 		}
 
 		if (port->rcvdInternal)
 		{
 			if (cistTree->msgFlagsTc)
+			{
 				cistTree->rcvdTc = true;
+				cistTree->counters.tcReceived++;
+			}
 		}
 	}
 	else
@@ -770,7 +1009,10 @@ void setTcFlags (STP_BRIDGE* bridge, PortIndex givenPort, TreeIndex givenTree)
 		PORT_TREE* portTree = port->trees [givenTree];
 
 		if (portTree->msgFlagsTc)
+		{
 			portTree->rcvdTc = true;
+			portTree->counters.tcReceived++;
+		}
 	}
 }
 
@@ -851,7 +1093,10 @@ void txConfig (STP_BRIDGE* bridge, PortIndex givenPort, unsigned int timestamp)
 		bpdu->cistFlags = 0;
 
 		if (cistTree->tcWhile != 0)
+		{
 			bpdu->cistFlags |= (unsigned char) 1;
+			cistTree->counters.tcSent++;
+		}
 
 		if (port->tcAck)
 			bpdu->cistFlags |= (unsigned char) 0x80;
@@ -861,10 +1106,13 @@ void txConfig (STP_BRIDGE* bridge, PortIndex givenPort, unsigned int timestamp)
 		bpdu->ForwardDelay = cistTree->designatedTimes.ForwardDelay * 256;
 		bpdu->HelloTime    = cistTree->portTimes.HelloTime * 256;
 
+		port->counters.txConfigBpdus++;
+		TRACE (bridge, STP_TRACE_EVENT_BPDU_TX, givenPort, -1, bpduSize, NULL, "Config");
+
 		#if STP_USE_LOG
-			LOG (bridge, givenPort, -1, "TX Config BPDU to port {D}:\r\n", 1 + givenPort);
+			LOG (bridge, STP_LOG_CATEGORY_BPDU_TX, givenPort, -1, "TX Config BPDU to port {D}:\r\n", 1 + givenPort);
 			LOG_INDENT (bridge);
-			DumpConfigBpdu (bridge, givenPort, -1, bpdu);
+			DumpConfigBpdu (bridge, STP_LOG_CATEGORY_BPDU_TX, givenPort, -1, bpdu);
 			LOG_UNINDENT (bridge);
 
 			FLUSH_LOG (bridge);
@@ -907,13 +1155,22 @@ void txRstp (STP_BRIDGE* bridge, PortIndex givenPort, unsigned int timestamp)
 	// octet 5 - 14.4.a) to 14.4.g) in 802.1Q-2018
 	bpdu->cistFlags = GetBpduPortRole(cistTree->role) << 2;
 	if (cistTree->agree)
+	{
 		bpdu->cistFlags |= (unsigned char) 0x40;
+		cistTree->counters.agreementsSent++;
+	}
 
 	if (cistTree->proposing)
+	{
 		bpdu->cistFlags |= (unsigned char) 2;
+		cistTree->counters.proposalsSent++;
+	}
 
 	if (cistTree->tcWhile != 0)
+	{
 		bpdu->cistFlags |= (unsigned char) 1;
+		cistTree->counters.tcSent++;
+	}
 
 	if (cistTree->learning)
 		bpdu->cistFlags |= (unsigned char) 0x10;
@@ -971,19 +1228,28 @@ void txRstp (STP_BRIDGE* bridge, PortIndex givenPort, unsigned int timestamp)
 		// 14.4.1 in 802.1Q-2018
 		for (unsigned int mstiIndex = 0; mstiIndex < bridge->mstiCount; mstiIndex++)
 		{
-			const PORT_TREE* tree = port->trees [1 + mstiIndex];
+			PORT_TREE* tree = port->trees [1 + mstiIndex];
 
 			// a)
 			mstiMessage->flags = GetBpduPortRole (tree->role) << 2;
 
 			if (tree->agree)
+			{
 				mstiMessage->flags |= (unsigned char) 0x40;
+				tree->counters.agreementsSent++;
+			}
 
 			if (tree->proposing)
+			{
 				mstiMessage->flags |= (unsigned char) 2;
+				tree->counters.proposalsSent++;
+			}
 
 			if (tree->tcWhile != 0)
+			{
 				mstiMessage->flags |= (unsigned char) 1;
+				tree->counters.tcSent++;
+			}
 
 			if (port->master)
 				mstiMessage->flags |= (unsigned char) 0x80;
@@ -1006,19 +1272,26 @@ void txRstp (STP_BRIDGE* bridge, PortIndex givenPort, unsigned int timestamp)
 		}
 	}
 
+	if (bridge->ForceProtocolVersion < 3)
+		port->counters.txRstpBpdus++;
+	else
+		port->counters.txMstpBpdus++;
+
+	TRACE (bridge, STP_TRACE_EVENT_BPDU_TX, givenPort, -1, bpduSize, NULL, (bridge->ForceProtocolVersion < 3) ? "RSTP" : "MSTP");
+
 	#if STP_USE_LOG
 		if (bridge->ForceProtocolVersion < 3)
 		{
-			LOG (bridge, givenPort, -1, "TX RSTP BPDU to port {D}:\r\n", 1 + givenPort);
+			LOG (bridge, STP_LOG_CATEGORY_BPDU_TX, givenPort, -1, "TX RSTP BPDU to port {D}:\r\n", 1 + givenPort);
 			LOG_INDENT (bridge);
-			DumpRstpBpdu (bridge, givenPort, -1, bpdu);
+			DumpRstpBpdu (bridge, STP_LOG_CATEGORY_BPDU_TX, givenPort, -1, bpdu);
 			LOG_UNINDENT (bridge);
 		}
 		else if (bridge->ForceProtocolVersion == 3)
 		{
-			LOG (bridge, givenPort, -1, "TX MSTP BPDU to port {D}:\r\n", 1 + givenPort);
+			LOG (bridge, STP_LOG_CATEGORY_BPDU_TX, givenPort, -1, "TX MSTP BPDU to port {D}:\r\n", 1 + givenPort);
 			LOG_INDENT (bridge);
-			DumpMstpBpdu (bridge, givenPort, -1, bpdu);
+			DumpMstpBpdu (bridge, STP_LOG_CATEGORY_BPDU_TX, givenPort, -1, bpdu);
 			LOG_UNINDENT (bridge);
 		}
 		else
@@ -1044,7 +1317,10 @@ void txTcn (STP_BRIDGE* bridge, PortIndex givenPort, unsigned int timestamp)
 	bpdu->protocolVersionId = 0;
 	bpdu->bpduType = 0x80;
 
-	LOG (bridge, givenPort, -1, "TX TCN BPDU to port {D}:\r\n", 1 + givenPort);
+	bridge->ports [givenPort]->counters.txTcnBpdus++;
+	TRACE (bridge, STP_TRACE_EVENT_BPDU_TX, givenPort, -1, sizeof (BPDU_HEADER), NULL, "TCN");
+
+	LOG (bridge, STP_LOG_CATEGORY_BPDU_TX, givenPort, -1, "TX TCN BPDU to port {D}:\r\n", 1 + givenPort);
 
 	FLUSH_LOG (bridge);
 	bridge->callbacks.transmitReleaseBuffer (bridge, bpdu);
@@ -1208,8 +1484,8 @@ void updtRolesTree (STP_BRIDGE* bridge, TreeIndex givenTree)
 
 	BRIDGE_TREE* bridgeTree = bridge->trees [givenTree];
 
-	LOG (bridge, -1, givenTree, "Tree {D}:\r\n", givenTree);
-	LOG (bridge, -1, givenTree, "  BridgeID: {BID}\r\n", &bridgeTree->GetBridgeIdentifier());
+	LOG (bridge, STP_LOG_CATEGORY_ROLE_SELECTION, -1, givenTree, "Tree {D}:\r\n", givenTree);
+	LOG (bridge, STP_LOG_CATEGORY_ROLE_SELECTION, -1, givenTree, "  BridgeID: {BID}\r\n", &bridgeTree->GetBridgeIdentifier());
 
 	BRIDGE_ID previousCistRegionalRootIdentifier = bridgeTree->rootPriority.RegionalRootId;
 	uint32_nbo previousCistExternalRootPathCost   = bridgeTree->rootPriority.ExternalRootPathCost;
@@ -1232,7 +1508,7 @@ void updtRolesTree (STP_BRIDGE* bridge, TreeIndex givenTree)
 			PRIORITY_VECTOR rootPathPriority;
 			CalculateRootPathPriorityForPort (bridge, portIndex, givenTree, &rootPathPriority);
 
-			LOG (bridge, -1, givenTree, "  Port {D} root path priority  : {PVS}\r\n", 1 + portIndex, &rootPathPriority);
+			LOG (bridge, STP_LOG_CATEGORY_ROLE_SELECTION, -1, givenTree, "  Port {D} root path priority  : {PVS}\r\n", 1 + portIndex, &rootPathPriority);
 
 			// c)
 			if ((rootPathPriority.DesignatedBridgeId.GetAddress () != bridgeTree->GetBridgePriority ().DesignatedBridgeId.GetAddress ())
@@ -1260,8 +1536,8 @@ void updtRolesTree (STP_BRIDGE* bridge, TreeIndex givenTree)
 		}
 	}
 
-	LOG (bridge, -1, givenTree, "  bridge root priority : {PVS}\r\n", &bridgeTree->rootPriority);
-	LOG (bridge, -1, givenTree, "  root port = {PID}\r\n", &bridgeTree->rootPortId);
+	LOG (bridge, STP_LOG_CATEGORY_ROLE_SELECTION, -1, givenTree, "  bridge root priority : {PVS}\r\n", &bridgeTree->rootPriority);
+	LOG (bridge, STP_LOG_CATEGORY_ROLE_SELECTION, -1, givenTree, "  root port = {PID}\r\n", &bridgeTree->rootPortId);
 
 	for (unsigned int portIndex = 0; portIndex < bridge->portCount; portIndex++)
 	{
@@ -1274,7 +1550,7 @@ void updtRolesTree (STP_BRIDGE* bridge, TreeIndex givenTree)
 		// f)
 		portTree->designatedTimes = bridgeTree->rootTimes;
 
-		LOG (bridge, -1, givenTree, "  Port {D} designated priority : {PVS}\r\n", 1 + portIndex, &portTree->designatedPriority);
+		LOG (bridge, STP_LOG_CATEGORY_ROLE_SELECTION, -1, givenTree, "  Port {D} designated priority : {PVS}\r\n", 1 + portIndex, &portTree->designatedPriority);
 	}
 
 	// If the root priority vector for the CIST is recalculated, and has a different Regional Root Identifier than that
@@ -1441,7 +1717,7 @@ void updtRolesTree (STP_BRIDGE* bridge, TreeIndex givenTree)
 			}
 		}
 
-		LOG (bridge, -1, givenTree, "Port {D}: {TN}: selectedRole set to {S}\r\n", 1 + portIndex, givenTree, GetPortRoleName (portTree->selectedRole));
+		LOG (bridge, STP_LOG_CATEGORY_ROLE_SELECTION, -1, givenTree, "Port {D}: {TN}: selectedRole set to {S}\r\n", 1 + portIndex, givenTree, GetPortRoleName (portTree->selectedRole));
 	}
 }
 
@@ -10,10 +10,10 @@
 bool betterorsameInfo      (STP_BRIDGE*, PortIndex, TreeIndex, INFO_IS newInfoIs);
 void clearAllRcvdMsgs      (STP_BRIDGE*, PortIndex);
 void clearReselectTree     (STP_BRIDGE*, TreeIndex);
-void disableForwarding     (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
-void disableLearning       (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
-void enableForwarding      (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
-void enableLearning        (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
+bool disableForwarding     (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
+bool disableLearning       (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
+bool enableForwarding      (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
+bool enableLearning        (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
 bool fromSameRegion        (STP_BRIDGE*, PortIndex);
 void newTcDetected         (STP_BRIDGE*, PortIndex, TreeIndex);
 void newTcWhile            (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
@@ -43,4 +43,11 @@ void updtRcvdInfoWhile     (STP_BRIDGE*, PortIndex, TreeIndex);
 void updtRolesTree         (STP_BRIDGE*, TreeIndex);
 void updtRolesDisabledTree (STP_BRIDGE*, TreeIndex);
 
+// Not in the standard.
+void ApplyPortStateChanges (STP_BRIDGE*, unsigned int timestamp);
+void FlushFdb              (STP_BRIDGE*, PortIndex, TreeIndex, unsigned int timestamp);
+void DeliverFdbFlushes     (STP_BRIDGE*, bool ignoreWindow, unsigned int timestamp);
+void RecordTreeActivity    (STP_BRIDGE*, TreeIndex, unsigned int timestamp);
+void CheckTreeConvergence  (STP_BRIDGE*, unsigned int timestamp);
+
 #endif
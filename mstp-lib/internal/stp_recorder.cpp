@@ -0,0 +1,454 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "stp_recorder.h"
+#include "stp_bridge.h"
+#include <assert.h>
+#include <stdarg.h>
+#include <string.h>
+
+// ============================================================================
+// Recording format.
+//
+// The stream written by STP_EnableRecording is a sequence of records, each laid out as:
+//   1 byte  - RECORD_TYPE
+//   2 bytes - payload size, little-endian
+//   payload - the arguments, in the order and with the sizes given by the format string of the record type:
+//             'b' = 1 byte, 'h' = 2 bytes, 'i' = 4 bytes (all little-endian),
+//             'n' = variable-size data taking up the rest of the payload (always the last argument).
+//
+// The first record is RECORD_HEADER. Input records are written when the application calls a library function, before
+// the function does anything else; output records are written when the library calls one of the application's callbacks.
+
+static const unsigned int RecordHeaderSize = 3;
+static const unsigned int RecordFormatVersion = 1;
+
+// Flags in the header record.
+static const unsigned int RecordFlagApplyPortStates = 1;
+static const unsigned int RecordFlagFlushFdbPorts   = 2;
+static const unsigned int RecordFlagOnTreeConverged = 4;
+static const unsigned int RecordFlagOnTopologyChange = 8;
+static const unsigned int RecordFlagOnPortRoleChanged = 16;
+
+static const char* const RecordFormats[] =
+{
+	NULL,
+	"bhbhbn",  // RECORD_HEADER: format version, portCount, mstiCount, maxVlanNumber, flags, bridge address
+	"i",       // RECORD_START_BRIDGE: timestamp
+	"bbi",     // RECORD_STOP_BRIDGE: fallbackLearning, fallbackForwarding, timestamp
+	"b",       // RECORD_ENABLE_DEFERRED_HARDWARE_ACTIONS: enable
+	"bhbbi",   // RECORD_ON_HARDWARE_ACTION_COMPLETE: action, portIndex, treeIndex, enable, timestamp
+	"bi",      // RECORD_SET_STP_VERSION: version, timestamp
+	"hin",     // RECORD_ON_BPDU_RECEIVED: portIndex, timestamp, BPDU
+	"in",      // RECORD_SET_BRIDGE_ADDRESS: timestamp, address
+	"hibi",    // RECORD_ON_PORT_ENABLED: portIndex, speedMegabitsPerSecond, detectedPointToPointMAC, timestamp
+	"hi",      // RECORD_ON_PORT_DISABLED: portIndex, timestamp
+	"i",       // RECORD_ON_ONE_SECOND_TICK: timestamp
+	"bhi",     // RECORD_SET_BRIDGE_PRIORITY: treeIndex, bridgePriority, timestamp
+	"hbbi",    // RECORD_SET_PORT_PRIORITY: portIndex, treeIndex, portPriority, timestamp
+	"hbi",     // RECORD_SET_PORT_ADMIN_EDGE: portIndex, adminEdge, timestamp
+	"hbi",     // RECORD_SET_PORT_AUTO_EDGE: portIndex, autoEdge, timestamp
+	"hbi",     // RECORD_SET_ADMIN_POINT_TO_POINT_MAC: portIndex, adminPointToPointMAC, timestamp
+	"hii",     // RECORD_SET_ADMIN_EXTERNAL_PORT_PATH_COST: portIndex, adminExternalPortPathCost, timestamp
+	"hbii",    // RECORD_SET_ADMIN_INTERNAL_PORT_PATH_COST: portIndex, treeIndex, adminInternalPortPathCost, timestamp
+	"in",      // RECORD_SET_MST_CONFIG_NAME: timestamp, name without the null terminator
+	"hi",      // RECORD_SET_MST_CONFIG_REVISION_LEVEL: revisionLevel, timestamp
+	"in",      // RECORD_SET_MST_CONFIG_TABLE: timestamp, entries
+	"hbi",     // RECORD_SET_MST_CONFIG_TABLE_ENTRY: vlanNumber, treeIndex, timestamp
+	"ii",      // RECORD_SET_BRIDGE_HELLO_TIME: helloTime, timestamp
+	"ii",      // RECORD_SET_BRIDGE_MAX_AGE: maxAge, timestamp
+	"ii",      // RECORD_SET_BRIDGE_FORWARD_DELAY: forwardDelay, timestamp
+	"ii",      // RECORD_SET_TX_HOLD_COUNT: txHoldCount, timestamp
+	"i",       // RECORD_SET_FDB_FLUSH_WINDOW: window
+};
+
+static const char* const OutputRecordFormats[] =
+{
+	"b",       // RECORD_ENABLE_BPDU_TRAPPING: enable
+	"hbb",     // RECORD_ENABLE_LEARNING: portIndex, treeIndex, enable
+	"hbb",     // RECORD_ENABLE_FORWARDING: portIndex, treeIndex, enable
+	"hn",      // RECORD_TRANSMIT: portIndex, BPDU
+	"hh",      // RECORD_TRANSMIT_NO_BUFFER: portIndex, bpduSize
+	"hbb",     // RECORD_FLUSH_FDB: portIndex, treeIndex, flushType
+	"b",       // RECORD_TOPOLOGY_CHANGE: treeIndex
+	"hbb",     // RECORD_PORT_ROLE_CHANGED: portIndex, treeIndex, role
+	"h",       // RECORD_APPLY_PORT_STATES: changeCount
+	"hbb",     // RECORD_PORT_STATE: portIndex, treeIndex, bit 0 = learning, bit 1 = forwarding
+	"bbn",     // RECORD_FLUSH_FDB_PORTS: treeIndex, flushType, portMask
+	"bi",      // RECORD_TREE_CONVERGED: treeIndex, convergenceStartTimestamp
+};
+
+static const char* GetRecordFormat (unsigned int type)
+{
+	if ((type >= RECORD_HEADER) && (type < RECORD_INPUT_END))
+		return RecordFormats[type];
+
+	if ((type >= RECORD_OUTPUT_FIRST) && (type < RECORD_OUTPUT_END))
+		return OutputRecordFormats[type - RECORD_OUTPUT_FIRST];
+
+	return NULL;
+}
+
+static unsigned int GetArgSize (char format)
+{
+	return (format == 'b') ? 1 : ((format == 'h') ? 2 : 4);
+}
+
+// ============================================================================
+
+void RecordApiCall (STP_BRIDGE* bridge, unsigned int type, ...)
+{
+	const char* format = GetRecordFormat (type);
+	assert (format != NULL);
+
+	// Fixed-size arguments are at most 4 bytes each, and no format has more than six of them.
+	unsigned char buffer [RecordHeaderSize + 24];
+	unsigned int size = RecordHeaderSize;
+	const void* blob = NULL;
+	unsigned int blobSize = 0;
+
+	va_list ap;
+	va_start (ap, type);
+	for (const char* f = format; *f != 0; f++)
+	{
+		if (*f == 'n')
+		{
+			blob = va_arg (ap, const void*);
+			blobSize = va_arg (ap, unsigned int);
+			break;
+		}
+
+		unsigned int value = va_arg (ap, unsigned int);
+		unsigned int argSize = GetArgSize (*f);
+		for (unsigned int i = 0; i < argSize; i++)
+			buffer[size++] = (unsigned char) (value >> (8 * i));
+	}
+	va_end (ap);
+
+	unsigned int payloadSize = size - RecordHeaderSize + blobSize;
+	assert (payloadSize <= 0xFFFF);
+	buffer[0] = (unsigned char) type;
+	buffer[1] = (unsigned char) payloadSize;
+	buffer[2] = (unsigned char) (payloadSize >> 8);
+
+	bridge->recordOut (bridge, buffer, size);
+	if (blobSize > 0)
+		bridge->recordOut (bridge, (const unsigned char*) blob, blobSize);
+}
+
+// ============================================================================
+// Callback wrappers installed while recording. They record the call, then make it to the application's callback.
+
+static void RecordEnableBpduTrapping (const STP_BRIDGE* bridge, bool enable, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_ENABLE_BPDU_TRAPPING, enable);
+	bridge->recordedCallbacks.enableBpduTrapping (bridge, enable, timestamp);
+}
+
+static void RecordEnableLearning (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_ENABLE_LEARNING, portIndex, treeIndex, enable);
+	bridge->recordedCallbacks.enableLearning (bridge, portIndex, treeIndex, enable, timestamp);
+}
+
+static void RecordEnableForwarding (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_ENABLE_FORWARDING, portIndex, treeIndex, enable);
+	bridge->recordedCallbacks.enableForwarding (bridge, portIndex, treeIndex, enable, timestamp);
+}
+
+static void* RecordTransmitGetBuffer (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp)
+{
+	void* buffer = bridge->recordedCallbacks.transmitGetBuffer (bridge, portIndex, bpduSize, timestamp);
+	if (buffer == NULL)
+	{
+		RecordApiCall ((STP_BRIDGE*) bridge, RECORD_TRANSMIT_NO_BUFFER, portIndex, bpduSize);
+		return NULL;
+	}
+
+	// The BPDU is recorded when the library is done filling in the buffer.
+	((STP_BRIDGE*) bridge)->recordTxPortIndex = portIndex;
+	((STP_BRIDGE*) bridge)->recordTxSize = bpduSize;
+	return buffer;
+}
+
+static void RecordTransmitReleaseBuffer (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_TRANSMIT, bridge->recordTxPortIndex, bufferReturnedByGetBuffer, bridge->recordTxSize);
+	bridge->recordedCallbacks.transmitReleaseBuffer (bridge, bufferReturnedByGetBuffer);
+}
+
+static void RecordFlushFdb (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_FLUSH_FDB, portIndex, treeIndex, flushType);
+	bridge->recordedCallbacks.flushFdb (bridge, portIndex, treeIndex, flushType, timestamp);
+}
+
+static void RecordOnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_TOPOLOGY_CHANGE, treeIndex);
+	bridge->recordedCallbacks.onTopologyChange (bridge, treeIndex, timestamp);
+}
+
+static void RecordOnPortRoleChanged (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, STP_PORT_ROLE role, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_PORT_ROLE_CHANGED, portIndex, treeIndex, role);
+	bridge->recordedCallbacks.onPortRoleChanged (bridge, portIndex, treeIndex, role, timestamp);
+}
+
+static void RecordApplyPortStates (const STP_BRIDGE* bridge, const STP_PORT_STATE_CHANGE* changes, unsigned int changeCount, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_APPLY_PORT_STATES, changeCount);
+	for (unsigned int i = 0; i < changeCount; i++)
+	{
+		unsigned int flags = (changes[i].learning ? 1 : 0) | (changes[i].forwarding ? 2 : 0);
+		RecordApiCall ((STP_BRIDGE*) bridge, RECORD_PORT_STATE, changes[i].portIndex, changes[i].treeIndex, flags);
+	}
+
+	bridge->recordedCallbacks.applyPortStates (bridge, changes, changeCount, timestamp);
+}
+
+static void RecordFlushFdbPorts (const STP_BRIDGE* bridge, unsigned int treeIndex, const unsigned char* portMask, unsigned int portMaskSize, STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_FLUSH_FDB_PORTS, treeIndex, flushType, portMask, portMaskSize);
+	bridge->recordedCallbacks.flushFdbPorts (bridge, treeIndex, portMask, portMaskSize, flushType, timestamp);
+}
+
+static void RecordOnTreeConverged (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int convergenceStartTimestamp, unsigned int timestamp)
+{
+	RecordApiCall ((STP_BRIDGE*) bridge, RECORD_TREE_CONVERGED, treeIndex, convergenceStartTimestamp);
+	bridge->recordedCallbacks.onTreeConverged (bridge, treeIndex, convergenceStartTimestamp, timestamp);
+}
+
+// ============================================================================
+
+extern "C" void STP_EnableRecording (STP_BRIDGE* bridge, STP_CALLBACK_RECORD_OUT recordOut)
+{
+	// Recording must start from a known state, so that a replay from the same state gives the same outputs.
+	assert (!bridge->started);
+
+	if (bridge->recordOut != NULL)
+	{
+		bridge->callbacks = bridge->recordedCallbacks;
+		bridge->recordOut = NULL;
+	}
+
+	if (recordOut == NULL)
+		return;
+
+	bridge->recordedCallbacks = bridge->callbacks;
+
+	STP_CALLBACKS* c = &bridge->callbacks;
+	c->enableBpduTrapping    = RecordEnableBpduTrapping;
+	c->enableLearning        = RecordEnableLearning;
+	c->enableForwarding      = RecordEnableForwarding;
+	c->transmitGetBuffer     = RecordTransmitGetBuffer;
+	c->transmitReleaseBuffer = RecordTransmitReleaseBuffer;
+	c->flushFdb              = RecordFlushFdb;
+	if (c->onTopologyChange != NULL)
+		c->onTopologyChange = RecordOnTopologyChange;
+	if (c->onPortRoleChanged != NULL)
+		c->onPortRoleChanged = RecordOnPortRoleChanged;
+	if (c->applyPortStates != NULL)
+		c->applyPortStates = RecordApplyPortStates;
+	if (c->flushFdbPorts != NULL)
+		c->flushFdbPorts = RecordFlushFdbPorts;
+	if (c->onTreeConverged != NULL)
+		c->onTreeConverged = RecordOnTreeConverged;
+
+	bridge->recordOut = recordOut;
+
+	unsigned int flags = ((c->applyPortStates != NULL) ? RecordFlagApplyPortStates : 0)
+		| ((c->flushFdbPorts != NULL) ? RecordFlagFlushFdbPorts : 0)
+		| ((c->onTreeConverged != NULL) ? RecordFlagOnTreeConverged : 0)
+		| ((c->onTopologyChange != NULL) ? RecordFlagOnTopologyChange : 0)
+		| ((c->onPortRoleChanged != NULL) ? RecordFlagOnPortRoleChanged : 0);
+
+	RecordApiCall (bridge, RECORD_HEADER, RecordFormatVersion, bridge->portCount, bridge->mstiCount, bridge->maxVlanNumber, flags,
+		STP_GetBridgeAddress (bridge)->bytes, 6u);
+}
+
+extern "C" unsigned int STP_GetRecordSize (const unsigned char* data, unsigned int size)
+{
+	if (size < RecordHeaderSize)
+		return 0;
+
+	unsigned int recordSize = RecordHeaderSize + (data[1] | (data[2] << 8));
+	return (recordSize <= size) ? recordSize : 0;
+}
+
+// Splits the payload of a record into its arguments. Returns false if the record is malformed.
+static bool ParseRecord (const unsigned char* record, unsigned int recordSize, unsigned int args[8], const unsigned char** blobOut, unsigned int* blobSizeOut)
+{
+	const char* format = GetRecordFormat (record[0]);
+	if ((format == NULL) || (STP_GetRecordSize (record, recordSize) != recordSize))
+		return false;
+
+	unsigned int offset = RecordHeaderSize;
+	unsigned int argCount = 0;
+	*blobOut = NULL;
+	*blobSizeOut = 0;
+	for (const char* f = format; *f != 0; f++)
+	{
+		if (*f == 'n')
+		{
+			*blobOut = &record[offset];
+			*blobSizeOut = recordSize - offset;
+			return true;
+		}
+
+		unsigned int argSize = GetArgSize (*f);
+		if (offset + argSize > recordSize)
+			return false;
+
+		unsigned int value = 0;
+		for (unsigned int i = 0; i < argSize; i++)
+			value |= (unsigned int) record[offset + i] << (8 * i);
+		args[argCount++] = value;
+		offset += argSize;
+	}
+
+	return offset == recordSize;
+}
+
+extern "C" STP_BRIDGE* STP_CreateBridgeFromRecording (const unsigned char* header, unsigned int headerSize, const STP_CALLBACKS* callbacks, unsigned int debugLogBufferSize)
+{
+	unsigned int args[8];
+	const unsigned char* address;
+	unsigned int addressSize;
+	if ((headerSize == 0) || (header[0] != RECORD_HEADER) || !ParseRecord (header, headerSize, args, &address, &addressSize))
+		return NULL;
+
+	if ((args[0] != RecordFormatVersion) || (addressSize != 6))
+		return NULL;
+
+	// The callbacks the recorded bridge didn't have are left out, as they change what the library calls.
+	STP_CALLBACKS c = *callbacks;
+	if ((args[4] & RecordFlagApplyPortStates) == 0)
+		c.applyPortStates = NULL;
+	if ((args[4] & RecordFlagFlushFdbPorts) == 0)
+		c.flushFdbPorts = NULL;
+	if ((args[4] & RecordFlagOnTreeConverged) == 0)
+		c.onTreeConverged = NULL;
+	if ((args[4] & RecordFlagOnTopologyChange) == 0)
+		c.onTopologyChange = NULL;
+	if ((args[4] & RecordFlagOnPortRoleChanged) == 0)
+		c.onPortRoleChanged = NULL;
+
+	return STP_CreateBridge (args[1], args[2], args[3], &c, address, debugLogBufferSize);
+}
+
+// The library functions only assert on their indexes, so a damaged recording could make them access memory out of bounds
+// in builds without asserts. Returns false if a port, tree or VLAN index in the arguments of an input record is out of range.
+static bool ArgsInRange (const STP_BRIDGE* bridge, unsigned int type, const unsigned int a[8], const unsigned char* blob, unsigned int blobSize)
+{
+	unsigned int portCount = bridge->portCount;
+	unsigned int treeCount = 1 + bridge->mstiCount;
+
+	switch (type)
+	{
+		case RECORD_ON_HARDWARE_ACTION_COMPLETE:
+			return (a[1] < portCount) && (a[2] < treeCount);
+
+		case RECORD_ON_BPDU_RECEIVED:
+		case RECORD_ON_PORT_ENABLED:
+		case RECORD_ON_PORT_DISABLED:
+		case RECORD_SET_PORT_ADMIN_EDGE:
+		case RECORD_SET_PORT_AUTO_EDGE:
+		case RECORD_SET_ADMIN_POINT_TO_POINT_MAC:
+		case RECORD_SET_ADMIN_EXTERNAL_PORT_PATH_COST:
+			return a[0] < portCount;
+
+		case RECORD_SET_PORT_PRIORITY:
+		case RECORD_SET_ADMIN_INTERNAL_PORT_PATH_COST:
+			return (a[0] < portCount) && (a[1] < treeCount);
+
+		case RECORD_SET_BRIDGE_PRIORITY:
+			return a[0] < treeCount;
+
+		case RECORD_SET_MST_CONFIG_TABLE_ENTRY:
+			return (a[0] <= bridge->maxVlanNumber) && (a[1] < treeCount);
+
+		case RECORD_SET_MST_CONFIG_TABLE:
+		{
+			if (blobSize != (1 + bridge->maxVlanNumber) * sizeof(STP_CONFIG_TABLE_ENTRY))
+				return false;
+			const STP_CONFIG_TABLE_ENTRY* entries = (const STP_CONFIG_TABLE_ENTRY*) blob;
+			for (unsigned int vlan = 0; vlan <= bridge->maxVlanNumber; vlan++)
+			{
+				if (entries[vlan].treeIndex >= treeCount)
+					return false;
+			}
+			return true;
+		}
+
+		default:
+			return true;
+	}
+}
+
+extern "C" bool STP_ReplayRecord (STP_BRIDGE* bridge, const unsigned char* record, unsigned int recordSize)
+{
+	unsigned int a[8];
+	const unsigned char* blob;
+	unsigned int blobSize;
+	if ((recordSize == 0) || (record[0] <= RECORD_HEADER) || (record[0] >= RECORD_INPUT_END) || !ParseRecord (record, recordSize, a, &blob, &blobSize))
+		return false;
+
+	if (!ArgsInRange (bridge, record[0], a, blob, blobSize))
+		return false;
+
+	switch (record[0])
+	{
+		case RECORD_START_BRIDGE:                      STP_StartBridge (bridge, a[0]); break;
+		case RECORD_STOP_BRIDGE:                       STP_StopBridge (bridge, a[2], a[0] != 0, a[1] != 0); break;
+		case RECORD_ENABLE_DEFERRED_HARDWARE_ACTIONS:  STP_EnableDeferredHardwareActions (bridge, a[0] != 0); break;
+		case RECORD_ON_HARDWARE_ACTION_COMPLETE:       STP_OnHardwareActionComplete (bridge, (STP_HARDWARE_ACTION) a[0], a[1], a[2], a[3] != 0, a[4]); break;
+		case RECORD_SET_STP_VERSION:                   STP_SetStpVersion (bridge, (STP_VERSION) a[0], a[1]); break;
+		case RECORD_ON_BPDU_RECEIVED:                  STP_OnBpduReceived (bridge, a[0], blob, blobSize, a[1]); break;
+		case RECORD_ON_PORT_ENABLED:                   STP_OnPortEnabled (bridge, a[0], a[1], a[2] != 0, a[3]); break;
+		case RECORD_ON_PORT_DISABLED:                  STP_OnPortDisabled (bridge, a[0], a[1]); break;
+		case RECORD_ON_ONE_SECOND_TICK:                STP_OnOneSecondTick (bridge, a[0]); break;
+		case RECORD_SET_BRIDGE_PRIORITY:               STP_SetBridgePriority (bridge, a[0], (unsigned short) a[1], a[2]); break;
+		case RECORD_SET_PORT_PRIORITY:                 STP_SetPortPriority (bridge, a[0], a[1], (unsigned char) a[2], a[3]); break;
+		case RECORD_SET_PORT_ADMIN_EDGE:               STP_SetPortAdminEdge (bridge, a[0], a[1] != 0, a[2]); break;
+		case RECORD_SET_PORT_AUTO_EDGE:                STP_SetPortAutoEdge (bridge, a[0], a[1] != 0, a[2]); break;
+		case RECORD_SET_ADMIN_POINT_TO_POINT_MAC:      STP_SetAdminPointToPointMAC (bridge, a[0], (STP_ADMIN_P2P) a[1], a[2]); break;
+		case RECORD_SET_ADMIN_EXTERNAL_PORT_PATH_COST: STP_SetAdminExternalPortPathCost (bridge, a[0], a[1], a[2]); break;
+		case RECORD_SET_ADMIN_INTERNAL_PORT_PATH_COST: STP_SetAdminInternalPortPathCost (bridge, a[0], a[1], a[2], a[3]); break;
+		case RECORD_SET_MST_CONFIG_REVISION_LEVEL:     STP_SetMstConfigRevisionLevel (bridge, (unsigned short) a[0], a[1]); break;
+		case RECORD_SET_MST_CONFIG_TABLE_ENTRY:        STP_SetMstConfigTableEntry (bridge, a[0], a[1], a[2]); break;
+		case RECORD_SET_BRIDGE_HELLO_TIME:             STP_SetBridgeHelloTime (bridge, a[0], a[1]); break;
+		case RECORD_SET_BRIDGE_MAX_AGE:                STP_SetBridgeMaxAge (bridge, a[0], a[1]); break;
+		case RECORD_SET_BRIDGE_FORWARD_DELAY:          STP_SetBridgeForwardDelay (bridge, a[0], a[1]); break;
+		case RECORD_SET_TX_HOLD_COUNT:                 STP_SetTxHoldCount (bridge, a[0], a[1]); break;
+		case RECORD_SET_FDB_FLUSH_WINDOW:              STP_SetFdbFlushWindow (bridge, a[0]); break;
+
+		case RECORD_SET_BRIDGE_ADDRESS:
+			if (blobSize != 6)
+				return false;
+			STP_SetBridgeAddress (bridge, blob, a[0]);
+			break;
+
+		case RECORD_SET_MST_CONFIG_NAME:
+		{
+			char name[33];
+			if (blobSize >= sizeof(name))
+				return false;
+			memcpy (name, blob, blobSize);
+			name[blobSize] = 0;
+			STP_SetMstConfigName (bridge, name, a[0]);
+			break;
+		}
+
+		case RECORD_SET_MST_CONFIG_TABLE:
+			STP_SetMstConfigTable (bridge, (const STP_CONFIG_TABLE_ENTRY*) blob, blobSize / sizeof(STP_CONFIG_TABLE_ENTRY), a[0]);
+			break;
+
+		default:
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,66 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#ifndef MSTP_LIB_RECORDER_H
+#define MSTP_LIB_RECORDER_H
+
+#include "../stp.h"
+
+// Types of the records written by STP_EnableRecording. The argument layout of each type is in RecordFormats in stp_recorder.cpp.
+// Values are part of the recording format: append new types, don't renumber.
+enum RECORD_TYPE
+{
+	// Inputs: calls made by the application into the library.
+	RECORD_HEADER = 1,
+	RECORD_START_BRIDGE,
+	RECORD_STOP_BRIDGE,
+	RECORD_ENABLE_DEFERRED_HARDWARE_ACTIONS,
+	RECORD_ON_HARDWARE_ACTION_COMPLETE,
+	RECORD_SET_STP_VERSION,
+	RECORD_ON_BPDU_RECEIVED,
+	RECORD_SET_BRIDGE_ADDRESS,
+	RECORD_ON_PORT_ENABLED,
+	RECORD_ON_PORT_DISABLED,
+	RECORD_ON_ONE_SECOND_TICK,
+	RECORD_SET_BRIDGE_PRIORITY,
+	RECORD_SET_PORT_PRIORITY,
+	RECORD_SET_PORT_ADMIN_EDGE,
+	RECORD_SET_PORT_AUTO_EDGE,
+	RECORD_SET_ADMIN_POINT_TO_POINT_MAC,
+	RECORD_SET_ADMIN_EXTERNAL_PORT_PATH_COST,
+	RECORD_SET_ADMIN_INTERNAL_PORT_PATH_COST,
+	RECORD_SET_MST_CONFIG_NAME,
+	RECORD_SET_MST_CONFIG_REVISION_LEVEL,
+	RECORD_SET_MST_CONFIG_TABLE,
+	RECORD_SET_MST_CONFIG_TABLE_ENTRY,
+	RECORD_SET_BRIDGE_HELLO_TIME,
+	RECORD_SET_BRIDGE_MAX_AGE,
+	RECORD_SET_BRIDGE_FORWARD_DELAY,
+	RECORD_SET_TX_HOLD_COUNT,
+	RECORD_SET_FDB_FLUSH_WINDOW,
+	RECORD_INPUT_END,
+
+	// Outputs: calls made by the library into the application's callbacks.
+	RECORD_OUTPUT_FIRST = 0x80,
+	RECORD_ENABLE_BPDU_TRAPPING = RECORD_OUTPUT_FIRST,
+	RECORD_ENABLE_LEARNING,
+	RECORD_ENABLE_FORWARDING,
+	RECORD_TRANSMIT,
+	RECORD_TRANSMIT_NO_BUFFER,
+	RECORD_FLUSH_FDB,
+	RECORD_TOPOLOGY_CHANGE,
+	RECORD_PORT_ROLE_CHANGED,
+	RECORD_APPLY_PORT_STATES,  // followed by one RECORD_PORT_STATE for each change
+	RECORD_PORT_STATE,
+	RECORD_FLUSH_FDB_PORTS,
+	RECORD_TREE_CONVERGED,
+	RECORD_OUTPUT_END,
+};
+
+void RecordApiCall (STP_BRIDGE* bridge, unsigned int type, ...);
+
+// While recording is disabled, recording an API call costs one comparison.
+#define RECORD(b,...)	((void) ( ((b)->recordOut == NULL) || (RecordApiCall(b,__VA_ARGS__), 0)))
+
+#endif
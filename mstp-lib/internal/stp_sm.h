@@ -10,6 +10,10 @@ struct StateMachine
 #if STP_USE_LOG
 	const char* smName;
 	const char* (*getStateName) (State state);
+	unsigned int logCategory; // one of the STP_LOG_CATEGORY values
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM profileId;
 #endif
 	State (*checkConditions) (const STP_BRIDGE* bridge, PortTreeArgs portTreeArgs, State state);
 	void (*initState) (STP_BRIDGE* bridge, PortTreeArgs portTreeArgs, State state, unsigned int timestamp);
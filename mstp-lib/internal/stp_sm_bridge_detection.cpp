@@ -141,6 +141,10 @@ const StateMachine<BridgeDetection::State, PortIndex> BridgeDetection::sm =
 #if STP_USE_LOG
 	"BridgeDetection",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_BRIDGE_DETECTION,
 #endif
 	&CheckConditions,
 	&InitState,
@@ -104,6 +104,10 @@ const StateMachine<State, PortIndex> L2GPortReceive::sm =
 #if STP_USE_LOG
 	"L2GPortReceive",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_L2G_PORT_RECEIVE,
 #endif
 	&CheckConditions,
 	&InitState
@@ -239,6 +239,10 @@ const StateMachine<State, PortAndTree> PortInformation::sm =
 #if STP_USE_LOG
 	"PortInformation",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_INFORMATION,
 #endif
 	&CheckConditions,
 	&InitState
@@ -112,6 +112,10 @@ const StateMachine<PortProtocolMigration::State, PortIndex> PortProtocolMigratio
 #if STP_USE_LOG
 	"PortProtocolMigration",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_PROTOCOL_MIGRATION,
 #endif
 	&CheckConditions,
 	&InitState
@@ -98,6 +98,10 @@ const StateMachine<PortReceive::State, PortIndex> PortReceive::sm =
 #if STP_USE_LOG
 	"PortReceive",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_RECEIVE,
 #endif
 	&CheckConditions,
 	&InitState
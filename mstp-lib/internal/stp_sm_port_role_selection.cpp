@@ -85,6 +85,10 @@ const StateMachine<State, TreeIndex> PortRoleSelection::sm =
 #if STP_USE_LOG
 	"PortRoleSelection",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_ROLE_SELECTION,
 #endif
 	&CheckConditions,
 	&InitState
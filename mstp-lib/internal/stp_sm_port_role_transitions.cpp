@@ -378,8 +378,14 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, State state, unsigned
 		tree->fdWhile = MaxAge (bridge, givenPort);
 		tree->rbWhile = 0;
 
-		if ((oldRole != STP_PORT_ROLE_DISABLED) && (bridge->callbacks.onPortRoleChanged != NULL))
-			bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_DISABLED, timestamp);
+		if (oldRole != STP_PORT_ROLE_DISABLED)
+		{
+			tree->counters.roleChanges++;
+			RecordTreeActivity (bridge, givenTree, timestamp);
+
+			if (bridge->callbacks.onPortRoleChanged != NULL)
+				bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_DISABLED, timestamp);
+		}
 	}
 	else if (state == DISABLE_PORT)
 	{
@@ -388,8 +394,14 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, State state, unsigned
 		tree->role = STP_PORT_ROLE_DISABLED;
 		tree->learn = tree->forward = false;
 
-		if ((oldRole != STP_PORT_ROLE_DISABLED) && (bridge->callbacks.onPortRoleChanged != NULL))
-			bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_DISABLED, timestamp);
+		if (oldRole != STP_PORT_ROLE_DISABLED)
+		{
+			tree->counters.roleChanges++;
+			RecordTreeActivity (bridge, givenTree, timestamp);
+
+			if (bridge->callbacks.onPortRoleChanged != NULL)
+				bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_DISABLED, timestamp);
+		}
 	}
 	else if (state == DISABLED_PORT)
 	{
@@ -408,8 +420,14 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, State state, unsigned
 
 		tree->role = STP_PORT_ROLE_MASTER;
 
-		if ((oldRole != STP_PORT_ROLE_MASTER) && (bridge->callbacks.onPortRoleChanged != NULL))
-			bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_MASTER, timestamp);
+		if (oldRole != STP_PORT_ROLE_MASTER)
+		{
+			tree->counters.roleChanges++;
+			RecordTreeActivity (bridge, givenTree, timestamp);
+
+			if (bridge->callbacks.onPortRoleChanged != NULL)
+				bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_MASTER, timestamp);
+		}
 	}
 	else if (state == MASTER_PROPOSED)
 	{
@@ -458,8 +476,14 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, State state, unsigned
 		tree->role = STP_PORT_ROLE_ROOT;
 		tree->rrWhile = FwdDelay (bridge, givenPort);
 
-		if ((oldRole != STP_PORT_ROLE_ROOT) && (bridge->callbacks.onPortRoleChanged != NULL))
-			bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_ROOT, timestamp);
+		if (oldRole != STP_PORT_ROLE_ROOT)
+		{
+			tree->counters.roleChanges++;
+			RecordTreeActivity (bridge, givenTree, timestamp);
+
+			if (bridge->callbacks.onPortRoleChanged != NULL)
+				bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_ROOT, timestamp);
+		}
 	}
 	else if (state == ROOT_PROPOSED)
 	{
@@ -517,8 +541,14 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, State state, unsigned
 		if (cist (bridge, givenTree))
 			tree->proposing = tree->proposing || (!port->AdminEdge && !port->AutoEdge && port->AutoIsolate && port->operPointToPointMAC);
 
-		if ((oldRole != STP_PORT_ROLE_DESIGNATED) && (bridge->callbacks.onPortRoleChanged != NULL))
-			bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_DESIGNATED, timestamp);
+		if (oldRole != STP_PORT_ROLE_DESIGNATED)
+		{
+			tree->counters.roleChanges++;
+			RecordTreeActivity (bridge, givenTree, timestamp);
+
+			if (bridge->callbacks.onPortRoleChanged != NULL)
+				bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, STP_PORT_ROLE_DESIGNATED, timestamp);
+		}
 	}
 	else if (state == DESIGNATED_FORWARD)
 	{
@@ -604,8 +634,14 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, State state, unsigned
 		tree->role = tree->selectedRole;
 		tree->learn = tree->forward = false;
 
-		if ((oldRole != tree->role) && (bridge->callbacks.onPortRoleChanged != NULL))
-			bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, tree->role, timestamp);
+		if (oldRole != tree->role)
+		{
+			tree->counters.roleChanges++;
+			RecordTreeActivity (bridge, givenTree, timestamp);
+
+			if (bridge->callbacks.onPortRoleChanged != NULL)
+				bridge->callbacks.onPortRoleChanged (bridge, givenPort, givenTree, tree->role, timestamp);
+		}
 	}
 	else
 		assert (false);
@@ -616,6 +652,10 @@ const StateMachine<PortRoleTransitions::State, PortAndTree> PortRoleTransitions:
 #if STP_USE_LOG
 	"PortRoleTransitions",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_ROLE_TRANSITIONS,
 #endif
 	&CheckConditions,
 	&InitState
@@ -94,20 +94,20 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, State state, unsigned
 
 	if (state == DISCARDING)
 	{
-		disableLearning (bridge, givenPort, givenTree, timestamp);
-		tree->learning = false;
-		disableForwarding (bridge, givenPort, givenTree, timestamp);
-		tree->forwarding = false;
+		if (disableLearning (bridge, givenPort, givenTree, timestamp))
+			tree->learning = false;
+		if (disableForwarding (bridge, givenPort, givenTree, timestamp))
+			tree->forwarding = false;
 	}
 	else if (state == LEARNING)
 	{
-		enableLearning (bridge, givenPort, givenTree, timestamp);
-		tree->learning = true;
+		if (enableLearning (bridge, givenPort, givenTree, timestamp))
+			tree->learning = true;
 	}
 	else if (state == FORWARDING)
 	{
-		enableForwarding (bridge, givenPort, givenTree, timestamp);
-		tree->forwarding = true;
+		if (enableForwarding (bridge, givenPort, givenTree, timestamp))
+			tree->forwarding = true;
 	}
 	else
 		assert (false);
@@ -118,6 +118,10 @@ const StateMachine<PortStateTransition::State, PortAndTree> PortStateTransition:
 #if STP_USE_LOG
 	"PortStateTransition",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_STATE_TRANSITION,
 #endif
 	&CheckConditions,
 	&InitState
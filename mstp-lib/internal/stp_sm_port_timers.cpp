@@ -98,6 +98,10 @@ const StateMachine<State, PortIndex> PortTimers::sm =
 #if STP_USE_LOG
 	"PortTimers",
 	&GetStateName,
+	STP_LOG_CATEGORY_TIMERS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_TIMERS,
 #endif
 	&CheckConditions,
 	&InitState
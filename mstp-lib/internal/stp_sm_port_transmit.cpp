@@ -99,6 +99,15 @@ static State CheckConditions (const STP_BRIDGE* bridge, PortIndex givenPort, Sta
 
 // ============================================================================
 
+// Not in the standard. Counts the transmissions after which the port is throttled by TxHoldCount.
+static void CountTxHold (const STP_BRIDGE* bridge, PORT* port)
+{
+	if (port->txCount == bridge->TxHoldCount)
+		port->counters.txHoldCountReached++;
+}
+
+// ============================================================================
+
 static void InitState (STP_BRIDGE* bridge, PortIndex givenPort, State state, unsigned int timestamp)
 {
 	PORT* port = bridge->ports[givenPort];
@@ -120,6 +129,7 @@ static void InitState (STP_BRIDGE* bridge, PortIndex givenPort, State state, uns
 		port->newInfo = false;
 		txConfig (bridge, givenPort, timestamp);
 		port->txCount += 1;
+		CountTxHold (bridge, port);
 		port->tcAck = false;
 	}
 	else if (state == TRANSMIT_TCN)
@@ -127,12 +137,14 @@ static void InitState (STP_BRIDGE* bridge, PortIndex givenPort, State state, uns
 		port->newInfo = false;
 		txTcn (bridge, givenPort, timestamp);
 		port->txCount += 1;
+		CountTxHold (bridge, port);
 	}
 	else if (state == TRANSMIT_RSTP)
 	{
 		port->newInfo = port->newInfoMsti = false;
 		txRstp (bridge, givenPort, timestamp);
 		port->txCount += 1;
+		CountTxHold (bridge, port);
 		port->tcAck = false;
 	}
 	else if (state == AGREE_SPT)
@@ -152,6 +164,10 @@ const StateMachine<PortTransmit::State, PortIndex> PortTransmit::sm =
 #if STP_USE_LOG
 	"PortTransmit",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_PORT_TRANSMIT,
 #endif
 	&CheckConditions,
 	&InitState
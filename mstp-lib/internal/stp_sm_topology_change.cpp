@@ -136,7 +136,8 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, TopologyChange::State
 	else if (state == INACTIVE)
 	{
 		//portTree->fdbFlush = true;
-		// We don't set this variable. Instead, we call the flush callback directly from here, require the callback to wait for completion,
+		// We don't set this variable. Instead, we call the flush callback directly from here (or, when the application
+		// supplied the flushFdbPorts callback, at the end of this state machine run), require the callback to wait for completion,
 		// and we keep the variable always clear. This keeps the code simple, but will create problems in case some switch IC takes
 		// a long time to clear its FDB entries.
 		//
@@ -153,11 +154,7 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, TopologyChange::State
 		// removes entries only for those VIDs that have a fixed registration (see 10.7.2) on any port of the bridge that
 		// is not an Edge Port.
 		if (port->operEdge == false)
-		{
-			FLUSH_LOG (bridge);
-
-			bridge->callbacks.flushFdb (bridge, givenPort, givenTree, rstpVersion (bridge) ? STP_FLUSH_FDB_TYPE_IMMEDIATE : STP_FLUSH_FDB_TYPE_RAPID_AGEING, timestamp);
-		}
+			FlushFdb (bridge, givenPort, givenTree, timestamp);
 
 		portTree->tcDetected = 0;
 		portTree->tcWhile = 0;
@@ -201,11 +198,7 @@ static void InitState (STP_BRIDGE* bridge, PortAndTree pt, TopologyChange::State
 		//portTree->fdbFlush = true;
 		// See comments for the INACTIVE state above in this function.
 		if (port->operEdge == false)
-		{
-			FLUSH_LOG (bridge);
-
-			bridge->callbacks.flushFdb (bridge, givenPort, givenTree, rstpVersion (bridge) ? STP_FLUSH_FDB_TYPE_IMMEDIATE : STP_FLUSH_FDB_TYPE_RAPID_AGEING, timestamp);
-		}
+			FlushFdb (bridge, givenPort, givenTree, timestamp);
 
 		portTree->tcProp = false;
 	}
@@ -223,6 +216,10 @@ const StateMachine<TopologyChange::State, PortAndTree> TopologyChange::sm =
 #if STP_USE_LOG
 	"TopologyChange",
 	&GetStateName,
+	STP_LOG_CATEGORY_TRANSITIONS,
+#endif
+#if STP_USE_PROFILE
+	STP_PROFILE_SM_TOPOLOGY_CHANGE,
 #endif
 	&CheckConditions,
 	&InitState
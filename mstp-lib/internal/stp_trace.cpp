@@ -0,0 +1,195 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "stp_trace.h"
+#include "stp_bridge.h"
+#include <assert.h>
+#include <string.h>
+
+// ============================================================================
+// Trace ring.
+//
+// With STP_EnableTracing, each trace point stores a fixed-size record in an overwrite-oldest ring. Names are kept
+// as pointers to constant strings in the library; STP_ExportTrace replaces them with the text itself.
+//
+// Each exported event is laid out as:
+//   1 byte  - STP_TRACE_EVENT_TYPE
+//   4 bytes - time, little-endian
+//   2 bytes - port, little-endian (0xFFFF for none)
+//   2 bytes - tree, little-endian (0xFFFF for none)
+//   4 bytes - arg, little-endian
+//   name, null-terminated
+//   detail, null-terminated
+//
+// When records were overwritten since the last export, the next export starts with an STP_TRACE_EVENT_EVENTS_LOST event.
+
+static const unsigned int TraceEventHeaderSize = 13;
+
+static unsigned int ReadUInt32LE (const unsigned char* src)
+{
+	return src[0] | (src[1] << 8) | (src[2] << 16) | ((unsigned int) src[3] << 24);
+}
+
+#if STP_USE_TRACE
+
+static void WriteUInt16LE (unsigned char* dest, unsigned int value)
+{
+	dest[0] = (unsigned char) value;
+	dest[1] = (unsigned char) (value >> 8);
+}
+
+static void WriteUInt32LE (unsigned char* dest, unsigned int value)
+{
+	dest[0] = (unsigned char) value;
+	dest[1] = (unsigned char) (value >> 8);
+	dest[2] = (unsigned char) (value >> 16);
+	dest[3] = (unsigned char) (value >> 24);
+}
+
+struct TRACE_RECORD
+{
+	unsigned int time;
+	unsigned int arg;
+	const char*  name;
+	const char*  detail;
+	short        port;
+	short        tree;
+	unsigned char type;
+};
+
+void STP_Trace (STP_BRIDGE* bridge, STP_TRACE_EVENT_TYPE type, int port, int tree, unsigned int arg, const char* name, const char* detail)
+{
+	if (bridge->traceRingUsed == bridge->traceRingSize)
+	{
+		bridge->traceRingStart = (bridge->traceRingStart + 1) % bridge->traceRingSize;
+		bridge->traceRingUsed--;
+		bridge->traceLost++;
+	}
+
+	TRACE_RECORD* record = &bridge->traceRing [(bridge->traceRingStart + bridge->traceRingUsed) % bridge->traceRingSize];
+	record->time   = bridge->traceClock (bridge);
+	record->arg    = arg;
+	record->name   = name;
+	record->detail = detail;
+	record->port   = (short) port;
+	record->tree   = (short) tree;
+	record->type   = (unsigned char) type;
+	bridge->traceRingUsed++;
+}
+
+static unsigned int WriteTraceEvent (unsigned char* dest, unsigned int type, unsigned int time, int port, int tree, unsigned int arg, const char* name, const char* detail)
+{
+	dest[0] = (unsigned char) type;
+	WriteUInt32LE (&dest[1], time);
+	WriteUInt16LE (&dest[5], (unsigned int) port);
+	WriteUInt16LE (&dest[7], (unsigned int) tree);
+	WriteUInt32LE (&dest[9], arg);
+
+	unsigned int nameSize = (unsigned int) strlen (name) + 1;
+	unsigned int detailSize = (unsigned int) strlen (detail) + 1;
+	memcpy (&dest[TraceEventHeaderSize], name, nameSize);
+	memcpy (&dest[TraceEventHeaderSize + nameSize], detail, detailSize);
+	return TraceEventHeaderSize + nameSize + detailSize;
+}
+
+#endif
+
+// ============================================================================
+
+extern "C" void STP_EnableTracing (STP_BRIDGE* bridge, unsigned int ringEventCount, STP_CALLBACK_CLOCK clock)
+{
+	#if STP_USE_TRACE
+		if (bridge->traceRing != NULL)
+		{
+			bridge->callbacks.freeMemory (bridge->traceRing);
+			bridge->traceRing = NULL;
+		}
+
+		if (ringEventCount > 0)
+		{
+			assert (clock != NULL);
+			bridge->traceRing = (TRACE_RECORD*) bridge->callbacks.allocAndZeroMemory (ringEventCount * sizeof(TRACE_RECORD));
+			assert (bridge->traceRing != NULL);
+		}
+
+		bridge->traceRingSize  = ringEventCount;
+		bridge->traceRingStart = 0;
+		bridge->traceRingUsed  = 0;
+		bridge->traceLost      = 0;
+		bridge->traceClock     = clock;
+	#endif
+}
+
+extern "C" unsigned int STP_ExportTrace (STP_BRIDGE* bridge, unsigned char* buffer, unsigned int bufferSize)
+{
+	unsigned int written = 0;
+
+	#if STP_USE_TRACE
+		if (bridge->traceRing == NULL)
+			return 0;
+
+		if (bridge->traceLost > 0)
+		{
+			if (bufferSize < TraceEventHeaderSize + 2)
+				return 0;
+
+			unsigned int time = (bridge->traceRingUsed > 0) ? bridge->traceRing[bridge->traceRingStart].time : bridge->traceClock (bridge);
+			written = WriteTraceEvent (buffer, STP_TRACE_EVENT_EVENTS_LOST, time, -1, -1, bridge->traceLost, "", "");
+			bridge->traceLost = 0;
+		}
+
+		while (bridge->traceRingUsed > 0)
+		{
+			const TRACE_RECORD* record = &bridge->traceRing [bridge->traceRingStart];
+			const char* name   = (record->name   != NULL) ? record->name   : "";
+			const char* detail = (record->detail != NULL) ? record->detail : "";
+
+			if (written + TraceEventHeaderSize + strlen (name) + 1 + strlen (detail) + 1 > bufferSize)
+				break;
+
+			written += WriteTraceEvent (&buffer[written], record->type, record->time, record->port, record->tree, record->arg, name, detail);
+
+			bridge->traceRingStart = (bridge->traceRingStart + 1) % bridge->traceRingSize;
+			bridge->traceRingUsed--;
+		}
+	#endif
+
+	return written;
+}
+
+// Available also when the library is built without STP_USE_TRACE, so that host tools can decode traces exported by devices.
+extern "C" unsigned int STP_DecodeTrace (const unsigned char* data, unsigned int size, STP_CALLBACK_TRACE_EVENT callback, void* applicationContext)
+{
+	unsigned int offset = 0;
+	while (offset + TraceEventHeaderSize + 2 <= size)
+	{
+		const unsigned char* src = &data[offset];
+
+		const char* name = (const char*) &src[TraceEventHeaderSize];
+		const void* nameEnd = memchr (name, 0, size - offset - TraceEventHeaderSize);
+		if (nameEnd == NULL)
+			break;
+
+		const char* detail = (const char*) nameEnd + 1;
+		if (detail >= (const char*) &data[size])
+			break;
+		const void* detailEnd = memchr (detail, 0, (const char*) &data[size] - detail);
+		if (detailEnd == NULL)
+			break;
+
+		STP_TRACE_EVENT event;
+		event.type   = (STP_TRACE_EVENT_TYPE) src[0];
+		event.time   = ReadUInt32LE (&src[1]);
+		event.port   = (short) (src[5] | (src[6] << 8));
+		event.tree   = (short) (src[7] | (src[8] << 8));
+		event.arg    = ReadUInt32LE (&src[9]);
+		event.name   = name;
+		event.detail = detail;
+		callback (&event, applicationContext);
+
+		offset = (unsigned int) ((const unsigned char*) detailEnd + 1 - data);
+	}
+
+	return offset;
+}
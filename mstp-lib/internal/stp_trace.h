@@ -0,0 +1,23 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#ifndef MSTP_LIB_TRACE_H
+#define MSTP_LIB_TRACE_H
+
+#include "../stp.h"
+
+#if STP_USE_TRACE
+	struct STP_BRIDGE;
+
+	void STP_Trace (STP_BRIDGE* bridge, STP_TRACE_EVENT_TYPE type, int port, int tree, unsigned int arg, const char* name, const char* detail);
+
+	// While tracing is disabled at runtime, a trace point costs one comparison.
+	#define TRACE_ENABLED(b)			((b)->traceRing != NULL)
+	#define TRACE(b,type,p,t,arg,n,d)	((void) ( !TRACE_ENABLED(b) || (STP_Trace(b,type,p,t,arg,n,d), 0)))
+#else
+	#define TRACE_ENABLED(b)			(false)
+	#define TRACE(b,type,p,t,arg,n,d)	((void)0)
+#endif
+
+#endif
@@ -16,6 +16,33 @@
 	#define STP_USE_LOG 1
 #endif
 
+// Log categories, for STP_SetLogFilter. Log lines of categories missing from the STP_LOG_CATEGORIES
+// mask are compiled out of the library (for example, define it as STP_LOG_CATEGORY_API | STP_LOG_CATEGORY_TRANSITIONS).
+enum STP_LOG_CATEGORY
+{
+	STP_LOG_CATEGORY_API            = 0x01, // calls into the library, warnings, separators
+	STP_LOG_CATEGORY_TRANSITIONS    = 0x02, // state machine transitions, except the Port Timers state machine
+	STP_LOG_CATEGORY_BPDU_RX        = 0x04, // dumps of received BPDUs and of the information recorded from them
+	STP_LOG_CATEGORY_BPDU_TX        = 0x08, // dumps of transmitted BPDUs
+	STP_LOG_CATEGORY_ROLE_SELECTION = 0x10, // priority vector calculations in updtRolesTree
+	STP_LOG_CATEGORY_TIMERS         = 0x20, // Port Timers state machine transitions (one per port per second)
+	STP_LOG_CATEGORY_ALL            = 0x3F,
+};
+
+#ifndef STP_LOG_CATEGORIES
+	#define STP_LOG_CATEGORIES STP_LOG_CATEGORY_ALL
+#endif
+
+// Define as 1 to build the state machine profiler (STP_GetProfile).
+#ifndef STP_USE_PROFILE
+	#define STP_USE_PROFILE 0
+#endif
+
+// Define as 1 to build the event tracing hooks (STP_EnableTracing).
+#ifndef STP_USE_TRACE
+	#define STP_USE_TRACE 0
+#endif
+
 struct STP_BRIDGE;
 
 enum STP_FLUSH_FDB_TYPE
@@ -35,6 +62,171 @@ enum STP_PORT_ROLE
 	STP_PORT_ROLE_MASTER,
 };
 
+// Hardware actions reported with STP_OnHardwareActionComplete.
+enum STP_HARDWARE_ACTION
+{
+	STP_HARDWARE_ACTION_LEARNING,
+	STP_HARDWARE_ACTION_FORWARDING,
+	STP_HARDWARE_ACTION_FLUSH_FDB,
+};
+
+// Entry in the list passed to the applyPortStates callback.
+struct STP_PORT_STATE_CHANGE
+{
+	unsigned int portIndex;
+	unsigned int treeIndex;
+	bool learning;
+	bool forwarding;
+};
+
+// Returns a free-running time value (CPU cycles, nanoseconds etc.), used to measure durations; it may wrap around.
+typedef unsigned int (*STP_CALLBACK_CLOCK) (const struct STP_BRIDGE* bridge);
+
+// Library functions whose latency is measured, as indexes for STP_GetLatencyHistogram.
+enum STP_LATENCY_ENTRY_POINT
+{
+	STP_LATENCY_ON_BPDU_RECEIVED,
+	STP_LATENCY_ON_ONE_SECOND_TICK,
+	STP_LATENCY_ON_PORT_ENABLED,
+	STP_LATENCY_ON_PORT_DISABLED,
+	STP_LATENCY_START_STOP_BRIDGE,
+	STP_LATENCY_ADMIN_SETTERS,      // the STP_Set... functions that may run the state machines
+	STP_LATENCY_ENTRY_POINT_COUNT,
+};
+
+// Log-linear latency histogram: values below 2^STP_LATENCY_SUB_BUCKET_BITS have one bucket each; each higher power
+// of two is divided into 2^STP_LATENCY_SUB_BUCKET_BITS buckets of equal width (a relative error of at most 1/16).
+#define STP_LATENCY_SUB_BUCKET_BITS 4
+#define STP_LATENCY_BUCKET_COUNT ((33 - STP_LATENCY_SUB_BUCKET_BITS) << STP_LATENCY_SUB_BUCKET_BITS)
+
+struct STP_LATENCY_HISTOGRAM
+{
+	unsigned int count;
+	unsigned int min; // valid only if count is non-zero
+	unsigned int max;
+	unsigned int buckets [STP_LATENCY_BUCKET_COUNT];
+};
+
+// Types of the events in the data exported by STP_ExportTrace.
+enum STP_TRACE_EVENT_TYPE
+{
+	STP_TRACE_EVENT_API_BEGIN,   // name: the library function
+	STP_TRACE_EVENT_API_END,     // name: the library function
+	STP_TRACE_EVENT_PASS_BEGIN,  // one pass through all state machines; arg: pass number within the call, starting from 1
+	STP_TRACE_EVENT_PASS_END,    // arg: pass number
+	STP_TRACE_EVENT_TRANSITION,  // name: state machine; detail: new state (both empty if built without STP_USE_LOG); arg: new state as a number
+	STP_TRACE_EVENT_BPDU_RX,     // arg: BPDU size
+	STP_TRACE_EVENT_BPDU_TX,     // detail: BPDU type ("Config", "TCN", "RSTP" or "MSTP"); arg: BPDU size
+	STP_TRACE_EVENT_CALLBACK,    // name: the hardware callback; arg: its enable parameter, flush type or number of changes
+	STP_TRACE_EVENT_EVENTS_LOST, // arg: number of events overwritten in the ring before the next one
+};
+
+// Event passed to the callback of STP_DecodeTrace.
+struct STP_TRACE_EVENT
+{
+	enum STP_TRACE_EVENT_TYPE type;
+	unsigned int time;    // value of the clock passed to STP_EnableTracing
+	int          port;    // -1 if not specific to a port
+	int          tree;    // -1 if not specific to a tree
+	unsigned int arg;
+	const char*  name;    // never NULL
+	const char*  detail;  // never NULL
+};
+
+typedef void (*STP_CALLBACK_TRACE_EVENT) (const struct STP_TRACE_EVENT* event, void* applicationContext);
+
+// Receives the data written by the recorder (see STP_EnableRecording). A record may be passed in more than one call.
+typedef void (*STP_CALLBACK_RECORD_OUT) (const struct STP_BRIDGE* bridge, const unsigned char* data, unsigned int size);
+
+#if STP_USE_PROFILE
+// State machine types, as indexes into STP_PROFILE_STATS::stateMachines.
+enum STP_PROFILE_SM
+{
+	STP_PROFILE_SM_PORT_TIMERS,
+	STP_PROFILE_SM_PORT_PROTOCOL_MIGRATION,
+	STP_PROFILE_SM_PORT_RECEIVE,
+	STP_PROFILE_SM_BRIDGE_DETECTION,
+	STP_PROFILE_SM_PORT_INFORMATION,
+	STP_PROFILE_SM_PORT_ROLE_TRANSITIONS,
+	STP_PROFILE_SM_PORT_STATE_TRANSITION,
+	STP_PROFILE_SM_TOPOLOGY_CHANGE,
+	STP_PROFILE_SM_PORT_ROLE_SELECTION,
+	STP_PROFILE_SM_PORT_TRANSMIT,
+	STP_PROFILE_SM_L2G_PORT_RECEIVE,
+	STP_PROFILE_SM_COUNT,
+};
+
+// Events with 1, 2, 3-4, 5-8, 9-16, 17-32, 33-64 and more than 64 passes.
+#define STP_PROFILE_PASS_HISTOGRAM_SIZE 8
+
+struct STP_PROFILE_SM_STATS
+{
+	unsigned int checks;      // evaluations of the exit conditions, summed over all instances
+	unsigned int transitions;
+	unsigned int time;        // in units of the profile clock; zero if no clock was set
+};
+
+// Totals since the creation of the bridge or the last STP_ResetProfile. An event is one run of the state machines,
+// done by a library function such as STP_OnBpduReceived; a pass is one iteration over all state machine instances.
+struct STP_PROFILE_STATS
+{
+	unsigned int events;
+	unsigned int passes;
+	unsigned int passHistogram [STP_PROFILE_PASS_HISTOGRAM_SIZE];
+	unsigned int maxPasses;
+	unsigned int maxEventTime;
+	unsigned int longEvents;        // events with more passes than the limit set with STP_SetProfilePassLimit
+	unsigned int oscillatingEvents; // events in which a pass repeated exactly the transitions of one of the two passes before it
+
+	// The event that ran last.
+	unsigned int lastEventPasses;
+	unsigned int lastEventTransitions;
+	unsigned int lastEventTime;
+
+	struct STP_PROFILE_SM_STATS stateMachines [STP_PROFILE_SM_COUNT];
+};
+#endif
+
+// Convergence timing of a tree, read with STP_GetConvergenceInfo. All timestamps are values passed by the
+// application to the library function that was executing when the event occurred.
+struct STP_CONVERGENCE_INFO
+{
+	bool         converging;                  // a port changed role or port state, and not all ports have reached a stable state yet
+	unsigned int convergenceCount;            // number of times the tree became stable
+	unsigned int convergenceStartTimestamp;   // first role or port state change after the tree was last stable
+	unsigned int lastTransitionTimestamp;     // last role or port state change
+	unsigned int convergedTimestamp;          // when the tree last became stable; valid if convergenceCount is non-zero
+	unsigned int lastConvergenceDuration;     // convergedTimestamp minus the start of that convergence
+	unsigned int topologyChangeCount;
+	unsigned int lastTopologyChangeTimestamp; // valid if topologyChangeCount is non-zero
+};
+
+// Per-port protocol counters, read with STP_ReadCounters. All counters wrap around at 2^32.
+struct STP_PORT_COUNTERS
+{
+	unsigned int rxConfigBpdus;
+	unsigned int rxTcnBpdus;
+	unsigned int rxRstpBpdus;
+	unsigned int rxMstpBpdus;  // MST and SPT BPDUs
+	unsigned int rxInvalidBpdus;
+	unsigned int rxDiscardedPortDisabled;
+	unsigned int txConfigBpdus;
+	unsigned int txTcnBpdus;
+	unsigned int txRstpBpdus;
+	unsigned int txMstpBpdus;
+	unsigned int txHoldCountReached; // times txCount reached TxHoldCount, after which transmission is throttled
+};
+
+// Per-port per-tree protocol counters, read with STP_ReadCounters.
+struct STP_PORT_TREE_COUNTERS
+{
+	unsigned int tcSent;          // transmitted BPDUs (or MSTI messages) with the TC flag set for the tree
+	unsigned int tcReceived;      // received TC flags that set rcvdTc for the tree
+	unsigned int proposalsSent;
+	unsigned int agreementsSent;
+	unsigned int roleChanges;
+};
+
 typedef void  (*STP_CALLBACK_ENABLE_BPDU_TRAPPING)          (const struct STP_BRIDGE* bridge, bool enable, unsigned int timestamp);
 typedef void  (*STP_CALLBACK_ENABLE_LEARNING)               (const struct STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp);
 typedef void  (*STP_CALLBACK_ENABLE_FORWARDING)             (const struct STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp);
@@ -46,6 +238,9 @@ typedef void  (*STP_CALLBACK_ON_TOPOLOGY_CHANGE)            (const struct STP_BR
 typedef void  (*STP_CALLBACK_PORT_ROLE_CHANGED)             (const struct STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_PORT_ROLE role, unsigned int timestamp);
 typedef void* (*STP_CALLBACK_ALLOC_AND_ZERO_MEMORY) (unsigned int size);
 typedef void  (*STP_CALLBACK_FREE_MEMORY) (void* p);
+typedef void  (*STP_CALLBACK_APPLY_PORT_STATES)             (const struct STP_BRIDGE* bridge, const struct STP_PORT_STATE_CHANGE* changes, unsigned int changeCount, unsigned int timestamp);
+typedef void  (*STP_CALLBACK_FLUSH_FDB_PORTS)               (const struct STP_BRIDGE* bridge, unsigned int treeIndex, const unsigned char* portMask, unsigned int portMaskSize, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp);
+typedef void  (*STP_CALLBACK_TREE_CONVERGED)                (const struct STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int convergenceStartTimestamp, unsigned int timestamp);
 
 struct STP_CALLBACKS
 {
@@ -60,6 +255,15 @@ struct STP_CALLBACKS
 	STP_CALLBACK_PORT_ROLE_CHANGED           onPortRoleChanged;
 	STP_CALLBACK_ALLOC_AND_ZERO_MEMORY       allocAndZeroMemory;
 	STP_CALLBACK_FREE_MEMORY                 freeMemory;
+
+	// Optional; set to NULL if not used. When set, the library no longer calls enableLearning and enableForwarding.
+	STP_CALLBACK_APPLY_PORT_STATES           applyPortStates;
+
+	// Optional; set to NULL if not used. When set, the library no longer calls flushFdb.
+	STP_CALLBACK_FLUSH_FDB_PORTS             flushFdbPorts;
+
+	// Optional; set to NULL if not used. Called when all ports of a tree have reached a stable state after a change.
+	STP_CALLBACK_TREE_CONVERGED              onTreeConverged;
 };
 
 // 11.3 Point-to-point parameters in 802.1AC-2016 (values correspond to ieee8021BridgeBasePortAdminPointToPoint)
@@ -89,7 +293,7 @@ struct STP_MST_CONFIG_ID
 	#ifdef __cplusplus
 	bool operator== (const STP_MST_CONFIG_ID& rhs) const;
 	bool operator< (const STP_MST_CONFIG_ID& rhs) const;
-	void Dump (STP_BRIDGE* bridge, int port, int tree) const;
+	void Dump (STP_BRIDGE* bridge, unsigned int category, int port, int tree) const;
 	#endif
 };
 
@@ -115,13 +319,49 @@ struct STP_BRIDGE* STP_CreateBridge (unsigned int portCount,
                                      unsigned int debugLogBufferSize);
 void STP_DestroyBridge (struct STP_BRIDGE* bridge);
 
+// Deep copy of a bridge and of all its protocol state, into memory allocated with the given callbacks, which the clone
+// then uses, together with the given application context. Nothing is sent to the callbacks of either bridge; the clone
+// is started if the original is, and from then on each runs independently (useful for forked simulations, and for
+// trying a management change on a copy before making it on the live bridge). Logging settings are carried over, but
+// not the contents of the logs, the binary log, the log ring, tracing or recording.
+struct STP_BRIDGE* STP_CloneBridge (const struct STP_BRIDGE* bridge, const struct STP_CALLBACKS* callbacks, void* applicationContext);
+
 void STP_StartBridge (struct STP_BRIDGE* bridge, unsigned int timestamp);
 void STP_StopBridge (struct STP_BRIDGE* bridge, unsigned int timestamp, bool fallbackLearning, bool fallbackForwarding);
 bool STP_IsBridgeStarted (const struct STP_BRIDGE* bridge);
 
+// When enabled, the enableLearning, enableForwarding, flushFdb, applyPortStates and flushFdbPorts callbacks
+// only initiate the hardware action and return; the application must then call STP_OnHardwareActionComplete.
+// May be changed only while the bridge is stopped.
+void STP_EnableDeferredHardwareActions (struct STP_BRIDGE* bridge, bool enable);
+bool STP_AreHardwareActionsDeferred (const struct STP_BRIDGE* bridge);
+void STP_OnHardwareActionComplete (struct STP_BRIDGE* bridge, enum STP_HARDWARE_ACTION action, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp);
+
 void STP_EnableLogging (struct STP_BRIDGE* bridge, bool enable);
 bool STP_IsLoggingEnabled (const struct STP_BRIDGE* bridge);
 
+// Restricts logging to the categories in categoryMask (a combination of STP_LOG_CATEGORY values), to one port
+// and to one tree. Pass -1 for portIndex or treeIndex to log all ports or all trees. Lines not specific to
+// a port or tree always pass the port or tree filter. The filter is checked before any formatting takes place.
+void STP_SetLogFilter (struct STP_BRIDGE* bridge, unsigned int categoryMask, int portIndex, int treeIndex);
+void STP_GetLogFilter (const struct STP_BRIDGE* bridge, unsigned int* categoryMaskOut, int* portIndexOut, int* treeIndexOut);
+
+// Binary logging: with a non-zero ring buffer size, enabled logging no longer formats any text. It saves instead
+// the format string and the raw arguments of each log call in a ring buffer, overwriting the oldest records.
+// STP_ExportBinaryLog moves records out of the ring into a self-contained form that STP_DecodeBinaryLog turns
+// into the exact text that debugStrOut would have received (possibly on another machine; see tools/binary_log_decoder).
+void STP_EnableBinaryLogging (struct STP_BRIDGE* bridge, unsigned int ringBufferSize);
+unsigned int STP_ExportBinaryLog (struct STP_BRIDGE* bridge, unsigned char* buffer, unsigned int bufferSize);
+unsigned int STP_DecodeBinaryLog (const unsigned char* data, unsigned int size, STP_CALLBACK_DEBUG_STR_OUT debugStrOut, void* applicationContext);
+
+// Log ring: with a non-zero ring size, the text that would be passed to debugStrOut is copied to a lock-free
+// single-producer/single-consumer ring instead. Another thread (or an idle loop) calls STP_DrainLogRing, which calls
+// debugStrOut with the text. When the ring is full, new text is dropped and counted; logging never blocks the protocol.
+// Requires a debugLogBufferSize (see STP_CreateBridge) of at most 65535 bytes.
+void STP_EnableLogRing (struct STP_BRIDGE* bridge, unsigned int ringSize);
+unsigned int STP_DrainLogRing (struct STP_BRIDGE* bridge);
+void STP_GetLogRingStats (const struct STP_BRIDGE* bridge, unsigned int* droppedBytesOut, unsigned int* droppedChunksOut);
+
 unsigned int STP_GetPortCount (const struct STP_BRIDGE* bridge);
 unsigned int STP_GetMstiCount (const struct STP_BRIDGE* bridge);
 
@@ -258,6 +498,59 @@ void STP_SetTxHoldCount (struct STP_BRIDGE* bridge, unsigned int txHoldCound, un
 unsigned int STP_GetTxHoldCount (const struct STP_BRIDGE* bridge);
 unsigned int STP_GetTxCount (const struct STP_BRIDGE* bridge, unsigned int portIndex);
 
+// Used only when the application supplied the flushFdbPorts callback. After flushing a tree, the library holds back
+// further flushes for that tree for this long (in the units of the timestamps passed to the library), merging them into one.
+void STP_SetFdbFlushWindow (struct STP_BRIDGE* bridge, unsigned int window);
+unsigned int STP_GetFdbFlushWindow (const struct STP_BRIDGE* bridge);
+
+// A tree is stable when every port has the role selected for it, and is learning and forwarding if it is a Root,
+// Designated or Master port, or neither learning nor forwarding otherwise.
+void STP_GetConvergenceInfo (const struct STP_BRIDGE* bridge, unsigned int treeIndex, struct STP_CONVERGENCE_INFO* infoOut);
+
+// Copies the counters of all ports to portCountersOut (STP_GetPortCount entries) and of all ports and trees to
+// portTreeCountersOut (STP_GetPortCount * (1 + STP_GetMstiCount) entries, at index portIndex * (1 + mstiCount) + treeIndex).
+// Either pointer may be NULL.
+void STP_ReadCounters (const struct STP_BRIDGE* bridge, struct STP_PORT_COUNTERS* portCountersOut, struct STP_PORT_TREE_COUNTERS* portTreeCountersOut);
+void STP_ResetCounters (struct STP_BRIDGE* bridge);
+
+// Latency histograms: with a clock set, the library measures the duration of each call to the functions listed
+// in STP_LATENCY_ENTRY_POINT and counts it in a histogram. NULL frees the histograms and stops measuring.
+void STP_EnableLatencyHistograms (struct STP_BRIDGE* bridge, STP_CALLBACK_CLOCK clock);
+void STP_GetLatencyHistogram (const struct STP_BRIDGE* bridge, enum STP_LATENCY_ENTRY_POINT entryPoint, struct STP_LATENCY_HISTOGRAM* histogramOut);
+void STP_ResetLatencyHistograms (struct STP_BRIDGE* bridge);
+void STP_MergeLatencyHistogram (struct STP_LATENCY_HISTOGRAM* destination, const struct STP_LATENCY_HISTOGRAM* source);
+unsigned int STP_GetLatencyPercentile (const struct STP_LATENCY_HISTOGRAM* histogram, unsigned int hundredthsOfPercent);
+
+// Event tracing, built only with STP_USE_TRACE defined as 1: begin/end events for the library functions that run the state
+// machines and for each pass through them, and instant events for transitions, BPDUs and hardware callbacks, all timestamped
+// with the given clock. They go to an overwrite-oldest ring of ringEventCount events; zero frees it and stops tracing.
+// STP_ExportTrace moves the oldest events to a buffer in a compact format, which STP_DecodeTrace parses on the host
+// (see tools/trace_to_json). Both return the number of bytes written or parsed.
+void STP_EnableTracing (struct STP_BRIDGE* bridge, unsigned int ringEventCount, STP_CALLBACK_CLOCK clock);
+unsigned int STP_ExportTrace (struct STP_BRIDGE* bridge, unsigned char* buffer, unsigned int bufferSize);
+unsigned int STP_DecodeTrace (const unsigned char* data, unsigned int size, STP_CALLBACK_TRACE_EVENT callback, void* applicationContext);
+
+// Recording: while recordOut is set, each library function that changes the bridge writes a record with its arguments
+// (including timestamps), and each call the library makes to the hardware and notification callbacks writes a record with
+// the callback's arguments. Must be called while the bridge is stopped, normally right after STP_CreateBridge, so that
+// a replay starts from the same state; NULL stops recording. STP_GetRecordSize returns the size of the complete record
+// at the start of data, or zero if data doesn't hold one yet. STP_CreateBridgeFromRecording creates a bridge like the
+// recorded one from the first record of a recording, and STP_ReplayRecord makes the call described by an input record;
+// it returns false for the header and the output records (see tools/replay).
+void STP_EnableRecording (struct STP_BRIDGE* bridge, STP_CALLBACK_RECORD_OUT recordOut);
+unsigned int STP_GetRecordSize (const unsigned char* data, unsigned int size);
+struct STP_BRIDGE* STP_CreateBridgeFromRecording (const unsigned char* header, unsigned int headerSize, const struct STP_CALLBACKS* callbacks, unsigned int debugLogBufferSize);
+bool STP_ReplayRecord (struct STP_BRIDGE* bridge, const unsigned char* record, unsigned int recordSize);
+
+#if STP_USE_PROFILE
+// Profiling of the state machines. With a clock set, the time spent in each state machine type and in each event
+// is measured too. Events with more passes than passLimit (default 16) are counted as long and logged as a warning.
+void STP_SetProfileClock (struct STP_BRIDGE* bridge, STP_CALLBACK_CLOCK clock);
+void STP_SetProfilePassLimit (struct STP_BRIDGE* bridge, unsigned int passLimit);
+void STP_GetProfile (const struct STP_BRIDGE* bridge, struct STP_PROFILE_STATS* statsOut);
+void STP_ResetProfile (struct STP_BRIDGE* bridge);
+#endif
+
 void  STP_SetApplicationContext (struct STP_BRIDGE* bridge, void* applicationContext);
 void* STP_GetApplicationContext (const struct STP_BRIDGE* bridge);
 
@@ -236,7 +236,8 @@ void bridge::ProcessReceivedPackets()
 		}
 		else if (std::holds_alternative<frame_t>(sd))
 		{
-			auto fsd = std::get<frame_t>(sd);
+			auto& fsd = std::get<frame_t>(sd);
+			const std::vector<uint8_t>& data = *fsd.data;
 
 			if (!port->mac_operational())
 			{
@@ -245,38 +246,32 @@ void bridge::ProcessReceivedPackets()
 			}
 			else
 			{
-				if ((fsd.data.size() >= 6) && (memcmp (&fsd.data[0], BpduDestAddress, 6) == 0))
+				if ((data.size() >= 6) && (memcmp (&data[0], BpduDestAddress, 6) == 0))
 				{
 					// It's a BPDU.
 					if (_bpdu_trapping_enabled)
 					{
-						STP_OnBpduReceived (_stpBridge, (unsigned int) rxPortIndex, &fsd.data[21], (unsigned int) (fsd.data.size() - 21), fsd.timestamp);
+						STP_OnBpduReceived (_stpBridge, (unsigned int) rxPortIndex, &data[21], (unsigned int) (data.size() - 21), fsd.timestamp);
 					}
 					else
 					{
 						// broadcast it to the other ports.
+						std::vector<bool>& flooded_ports = GetFloodedPorts(fsd.data);
 						for (size_t txPortIndex = 0; txPortIndex < _ports.size(); txPortIndex++)
 						{
 							if (txPortIndex == rxPortIndex)
 								continue;
 
-							auto txPortAddress = GetPortAddress(txPortIndex);
-
-							// If it already went through this port, we have a loop that would hang our UI.
-							if (std::find (fsd.tx_path_taken.begin(), fsd.tx_path_taken.end(), txPortAddress) != fsd.tx_path_taken.end())
+							// If it already went out of this port, we have a loop that would hang our UI.
+							if (flooded_ports[txPortIndex])
 							{
 								// We don't do anything here; we have code in wire.cpp that shows loops to the user - as thick red wires.
 								//volatile int a = 0;
 							}
 							else
 							{
-								frame_t f;
-								f.timestamp = fsd.timestamp;
-								f.data = fsd.data;
-								f.tx_path_taken = fsd.tx_path_taken;
-								f.tx_path_taken.push_back (txPortAddress);
-
-								this->event_invoker<packet_transmit_e>()(this, txPortIndex, std::move(f));
+								flooded_ports[txPortIndex] = true;
+								this->event_invoker<packet_transmit_e>()(this, txPortIndex, frame_t { fsd.timestamp, fsd.data });
 							}
 						}
 					}
@@ -293,6 +288,23 @@ void bridge::ProcessReceivedPackets()
 		this->event_invoker<invalidate_e>()(this);
 }
 
+std::vector<bool>& bridge::GetFloodedPorts (const std::shared_ptr<const std::vector<uint8_t>>& data)
+{
+	auto it = _floods.find(data.get());
+	if (it != _floods.end())
+		return it->second.tx_ports;
+
+	// Forget the floods with no copies left anywhere, that is, whose payload is held only by our entry.
+	if (_floods.size() >= _floods_sweep_size)
+	{
+		for (auto i = _floods.begin(); i != _floods.end(); )
+			i = (i->second.data.use_count() == 1) ? _floods.erase(i) : std::next(i);
+		_floods_sweep_size = std::max ((size_t) 16, 2 * _floods.size());
+	}
+
+	return _floods.insert ({ data.get(), flood { data, std::vector<bool>(_ports.size()) } }).first->second.tx_ports;
+}
+
 void bridge::set_location(float x, float y)
 {
 	if ((_x != x) || (_y != y))
@@ -870,7 +882,7 @@ void bridge::StpCallback_TransmitReleaseBuffer (const STP_BRIDGE* bridge, void*
 	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
 
 	frame_t info;
-	info.data = std::move(b->_txPacketData);
+	info.data = std::make_shared<const std::vector<uint8_t>>(std::move(b->_txPacketData));
 	info.timestamp = b->_txTimestamp;
 	b->event_invoker<packet_transmit_e>()(b, b->_txTransmittingPort->port_index(), std::move(info));
 }
@@ -903,37 +915,41 @@ void bridge::StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, i
 {
 	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
 
-	if (stringLength > 0)
+	auto complete_line = [b]
+	{
+		b->_logLines.push_back(std::make_unique<BridgeLogLine>(std::move(b->_currentLogLine)));
+		b->_currentLogLine.text.clear();
+		b->event_invoker<log_line_generated_e>()(b, b->_logLines.back().get());
+	};
+
+	// The library passes text in chunks that may contain several lines, all for the same port and tree.
+	const char* text = nullTerminatedString;
+	const char* end = nullTerminatedString + stringLength;
+	while (text < end)
 	{
+		if (!b->_currentLogLine.text.empty()
+			&& ((b->_currentLogLine.portIndex != portIndex) || (b->_currentLogLine.treeIndex != treeIndex)))
+			complete_line();
+
 		if (b->_currentLogLine.text.empty())
 		{
-			b->_currentLogLine.text.assign (nullTerminatedString, (size_t) stringLength);
 			b->_currentLogLine.portIndex = portIndex;
 			b->_currentLogLine.treeIndex = treeIndex;
 		}
-		else
-		{
-			if ((b->_currentLogLine.portIndex != portIndex) || (b->_currentLogLine.treeIndex != treeIndex))
-			{
-				b->_logLines.push_back(std::make_unique<BridgeLogLine>(std::move(b->_currentLogLine)));
-				b->event_invoker<log_line_generated_e>()(b, b->_logLines.back().get());
-			}
 
-			b->_currentLogLine.text.append (nullTerminatedString, (size_t) stringLength);
-		}
+		const char* line_end = std::find (text, end, '\n');
+		if (line_end != end)
+			line_end++;
 
-		if (!b->_currentLogLine.text.empty() && (b->_currentLogLine.text.back() == L'\n'))
-		{
-			b->_logLines.push_back(std::make_unique<BridgeLogLine>(std::move(b->_currentLogLine)));
-			b->event_invoker<log_line_generated_e>()(b, b->_logLines.back().get());
-		}
+		b->_currentLogLine.text.append (text, line_end - text);
+		text = line_end;
+
+		if (b->_currentLogLine.text.back() == '\n')
+			complete_line();
 	}
 
 	if (flush && !b->_currentLogLine.text.empty())
-	{
-		b->_logLines.push_back(std::make_unique<BridgeLogLine>(std::move(b->_currentLogLine)));
-		b->event_invoker<log_line_generated_e>()(b, b->_logLines.back().get());
-	}
+		complete_line();
 }
 
 void bridge::StpCallback_OnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp)
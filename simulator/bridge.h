@@ -72,6 +72,16 @@ class bridge : public project_child, public edge::deserialize_i
 	std::vector<std::unique_ptr<BridgeLogLine>> _logLines;
 	BridgeLogLine _currentLogLine;
 	std::queue<std::pair<size_t, packet_t>> _rxQueue;
+	// The ports each frame being flooded already went out of, keyed by its payload, which all its copies share.
+	// Sending a flood out of each port at most once stops it when it's caught in a loop, and bounds its copies
+	// by the number of ports in the network, however many paths the loop has.
+	struct flood
+	{
+		std::shared_ptr<const std::vector<uint8_t>> data; // keeps the key from being reused while the entry exists
+		std::vector<bool> tx_ports;
+	};
+	std::unordered_map<const std::vector<uint8_t>*, flood> _floods;
+	size_t _floods_sweep_size = 16;
 	std::vector<std::unique_ptr<bridge_tree>> _trees;
 	bool _deserializing = false;
 	bool _enable_stp_after_deserialize;
@@ -160,6 +170,7 @@ private:
 	static void OnPortInvalidate (void* callbackArg, renderable_object* object);
 	void OnLinkPulseTick();
 	void ProcessReceivedPackets();
+	std::vector<bool>& GetFloodedPorts (const std::shared_ptr<const std::vector<uint8_t>>& data);
 
 	static void* StpCallback_AllocAndZeroMemory (unsigned int size);
 	static void  StpCallback_FreeMemory (void* p);
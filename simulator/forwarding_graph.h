@@ -0,0 +1,151 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// The forwarding graph of a VLAN: the bridges are the nodes, and the wires whose two ports forward the VLAN are
+// the edges. find_loops tells, for every edge, whether it lies on a cycle, that is, whether frames can go around.
+//
+// It builds a spanning forest, then each edge left out of it closes a cycle with the forest path between its ends,
+// and all edges on that path get marked. Union-find (_jump) lets the marking skip the parts of paths already marked,
+// so all edges are done in one pass of O((nodes + edges) * alpha), rather than one search of the network per edge.
+//
+// It only uses the standard library, so that both the GUI simulator and the headless one can use it.
+class forwarding_graph
+{
+	struct edge_t
+	{
+		uint32_t a;
+		uint32_t b;
+	};
+
+	size_t _node_count = 0;
+	std::vector<edge_t> _edges;
+	std::vector<bool> _on_loop;
+	size_t _loop_edge_count = 0;
+
+	// spanning forest, indexed by node
+	std::vector<uint32_t> _parent;
+	std::vector<uint32_t> _parent_edge;
+	std::vector<uint32_t> _depth;
+	std::vector<uint32_t> _jump;
+
+	static constexpr uint32_t none = UINT32_MAX;
+
+	uint32_t find (uint32_t node)
+	{
+		while (_jump[node] != node)
+		{
+			_jump[node] = _jump[_jump[node]];
+			node = _jump[node];
+		}
+
+		return node;
+	}
+
+public:
+	void clear (size_t node_count)
+	{
+		_node_count = node_count;
+		_edges.clear();
+		_on_loop.clear();
+		_loop_edge_count = 0;
+	}
+
+	// Returns the index of the edge, for on_loop.
+	size_t add_edge (uint32_t node_a, uint32_t node_b)
+	{
+		_edges.push_back ({ node_a, node_b });
+		return _edges.size() - 1;
+	}
+
+	size_t edge_count() const { return _edges.size(); }
+	bool on_loop (size_t edge_index) const { return _on_loop[edge_index]; }
+	size_t loop_edge_count() const { return _loop_edge_count; }
+
+	void find_loops()
+	{
+		// Adjacency lists in a single array: the edges of node n are at adjacent[first[n]] .. adjacent[first[n + 1] - 1].
+		std::vector<uint32_t> first (_node_count + 1, 0);
+		for (const edge_t& e : _edges)
+		{
+			first[e.a + 1]++;
+			first[e.b + 1]++;
+		}
+		for (size_t n = 0; n < _node_count; n++)
+			first[n + 1] += first[n];
+		std::vector<uint32_t> adjacent (first[_node_count]);
+		std::vector<uint32_t> fill (first.begin(), first.end() - 1);
+		for (uint32_t ei = 0; ei < (uint32_t) _edges.size(); ei++)
+		{
+			adjacent[fill[_edges[ei].a]++] = ei;
+			adjacent[fill[_edges[ei].b]++] = ei;
+		}
+
+		// Breadth-first spanning forest.
+		_parent.assign (_node_count, none);
+		_parent_edge.assign (_node_count, none);
+		_depth.assign (_node_count, 0);
+		std::vector<bool> tree_edge (_edges.size(), false);
+		std::vector<bool> visited (_node_count, false);
+		std::vector<uint32_t> queue;
+		for (uint32_t root = 0; root < (uint32_t) _node_count; root++)
+		{
+			if (visited[root])
+				continue;
+
+			visited[root] = true;
+			queue.assign (1, root);
+			for (size_t qi = 0; qi < queue.size(); qi++)
+			{
+				uint32_t node = queue[qi];
+				for (uint32_t ai = first[node]; ai < first[node + 1]; ai++)
+				{
+					uint32_t ei = adjacent[ai];
+					uint32_t other = (_edges[ei].a == node) ? _edges[ei].b : _edges[ei].a;
+					if (!visited[other])
+					{
+						visited[other] = true;
+						tree_edge[ei] = true;
+						_parent[other] = node;
+						_parent_edge[other] = ei;
+						_depth[other] = _depth[node] + 1;
+						queue.push_back (other);
+					}
+				}
+			}
+		}
+
+		// Each edge outside the forest (self-loops and parallel edges included) closes a cycle.
+		_on_loop.assign (_edges.size(), false);
+		_jump.resize (_node_count);
+		for (uint32_t n = 0; n < (uint32_t) _node_count; n++)
+			_jump[n] = n;
+		for (uint32_t ei = 0; ei < (uint32_t) _edges.size(); ei++)
+		{
+			if (tree_edge[ei])
+				continue;
+
+			_on_loop[ei] = true;
+			uint32_t a = find(_edges[ei].a);
+			uint32_t b = find(_edges[ei].b);
+			while (a != b)
+			{
+				if (_depth[a] < _depth[b])
+					std::swap (a, b);
+				_on_loop[_parent_edge[a]] = true;
+				_jump[a] = _parent[a];
+				a = find(a);
+			}
+		}
+
+		_loop_edge_count = 0;
+		for (bool l : _on_loop)
+			_loop_edge_count += l ? 1 : 0;
+	}
+};
@@ -12,8 +12,7 @@ using mac_address = std::array<uint8_t, 6>;
 struct frame_t
 {
 	uint32_t timestamp;
-	std::vector<uint8_t> data;;
-	std::vector<mac_address> tx_path_taken;
+	std::shared_ptr<const std::vector<uint8_t>> data; // never changed once sent, so shared by all copies of a flooded frame
 };
 
 struct link_pulse_t
@@ -7,6 +7,7 @@
 #include "wire.h"
 #include "bridge.h"
 #include "port.h"
+#include "forwarding_graph.h"
 #include "win32/xml_serializer.h"
 
 static const _bstr_t NextMacAddressString = "NextMacAddress";
@@ -22,6 +23,15 @@ class project : public edge::object, public project_i
 	bool _simulationPaused = false;
 	bool _changedFlag = false;
 
+	// Forwarding state of the wires, computed for a VLAN when first asked about it, and thrown away when any bridge,
+	// port or wire changes (these all invalidate themselves when something changes that affects forwarding).
+	struct vlan_forwarding
+	{
+		std::unordered_map<const wire*, size_t> edges; // the forwarding wires, and their edges in the graph
+		forwarding_graph graph;
+	};
+	mutable std::unordered_map<unsigned int, vlan_forwarding> _forwarding;
+
 public:
 	virtual const std::vector<std::unique_ptr<bridge>>& bridges() const override final { return _bridges; }
 
@@ -39,6 +49,7 @@ public:
 
 		b->invalidated().add_handler (&on_project_child_invalidated, this);
 		b->packet_transmit().add_handler (&on_packet_transmit, this);
+		_forwarding.clear();
 		this->event_invoker<invalidate_e>()(this);
 	}
 
@@ -65,6 +76,7 @@ public:
 		_bridges.erase (_bridges.begin() + index);
 		this->on_property_changed(args);
 
+		_forwarding.clear();
 		this->event_invoker<invalidate_e>()(this);
 		return result;
 	}
@@ -84,6 +96,7 @@ public:
 		this->on_property_changed(args);
 
 		w->invalidated().add_handler (&on_project_child_invalidated, this);
+		_forwarding.clear();
 		this->event_invoker<invalidate_e>()(this);
 	}
 
@@ -102,6 +115,7 @@ public:
 		_wires.erase (_wires.begin() + index);
 		this->on_property_changed (args);
 
+		_forwarding.clear();
 		this->event_invoker<invalidate_e>()(this);
 		return result;
 	}
@@ -118,6 +132,7 @@ public:
 	static void on_project_child_invalidated (void* callbackArg, renderable_object* object)
 	{
 		auto project = static_cast<class project*>(callbackArg);
+		project->_forwarding.clear();
 		project->event_invoker<invalidate_e>()(project);
 	}
 
@@ -125,55 +140,43 @@ public:
 
 	virtual loaded_e::subscriber GetLoadedEvent() override final { return loaded_e::subscriber(this); }
 
-	virtual bool IsWireForwarding (wire* wire, unsigned int vlanNumber, _Out_opt_ bool* hasLoop) const override final
+	const vlan_forwarding& get_forwarding (unsigned int vlanNumber) const
 	{
-		if (!std::holds_alternative<connected_wire_end>(wire->p0()) || !std::holds_alternative<connected_wire_end>(wire->p1()))
-			return false;
+		auto it = _forwarding.find(vlanNumber);
+		if (it != _forwarding.end())
+			return it->second;
 
-		auto portA = std::get<connected_wire_end>(wire->p0());
-		auto portB = std::get<connected_wire_end>(wire->p1());
-		bool portAFw = portA->IsForwarding(vlanNumber);
-		bool portBFw = portB->IsForwarding(vlanNumber);
-		if (!portAFw || !portBFw)
-			return false;
+		std::unordered_map<const bridge*, uint32_t> bridge_indexes;
+		for (size_t i = 0; i < _bridges.size(); i++)
+			bridge_indexes.insert ({ _bridges[i].get(), (uint32_t) i });
 
-		if (hasLoop != nullptr)
+		vlan_forwarding& f = _forwarding[vlanNumber];
+		f.graph.clear (_bridges.size());
+		for (auto& w : _wires)
 		{
-			std::unordered_set<port*> txPorts;
-
-			std::function<bool(port* txPort)> transmitsTo = [this, vlanNumber, &txPorts, &transmitsTo, targetPort=portA](port* txPort) -> bool
-			{
-				if (txPort->IsForwarding(vlanNumber))
-				{
-					auto rx = find_connected_port(txPort);
-					if ((rx != nullptr) && rx->IsForwarding(vlanNumber))
-					{
-						txPorts.insert(txPort);
-
-						for (unsigned int i = 0; i < (unsigned int) rx->bridge()->ports().size(); i++)
-						{
-							if ((i != rx->port_index()) && rx->IsForwarding(vlanNumber))
-							{
-								port* otherTxPort = rx->bridge()->ports()[i].get();
-								if (otherTxPort == targetPort)
-									return true;
-
-								if (txPorts.find(otherTxPort) != txPorts.end())
-									return false;
-
-								if (transmitsTo(otherTxPort))
-									return true;
-							}
-						}
-					}
-				}
-
-				return false;
-			};
-
-			*hasLoop = transmitsTo(portA);
+			if (!std::holds_alternative<connected_wire_end>(w->p0()) || !std::holds_alternative<connected_wire_end>(w->p1()))
+				continue;
+
+			auto portA = std::get<connected_wire_end>(w->p0());
+			auto portB = std::get<connected_wire_end>(w->p1());
+			if (portA->IsForwarding(vlanNumber) && portB->IsForwarding(vlanNumber))
+				f.edges.insert ({ w.get(), f.graph.add_edge (bridge_indexes.at(portA->bridge()), bridge_indexes.at(portB->bridge())) });
 		}
 
+		f.graph.find_loops();
+		return f;
+	}
+
+	virtual bool IsWireForwarding (wire* wire, unsigned int vlanNumber, _Out_opt_ bool* hasLoop) const override final
+	{
+		const vlan_forwarding& f = get_forwarding(vlanNumber);
+		auto it = f.edges.find(wire);
+		if (it == f.edges.end())
+			return false;
+
+		if (hasLoop != nullptr)
+			*hasLoop = f.graph.on_loop(it->second);
+
 		return true;
 	}
 
@@ -87,4 +87,365 @@ TEST_CLASS(bridge_tests)
 		memcpy (&root_id, rpv, 8);
 		Assert::AreEqual (0ull, root_id);
 	}
+
+	TEST_METHOD(deferred_forwarding_test)
+	{
+		test_bridge bridge (4, 0, 0, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableDeferredHardwareActions (bridge, true);
+		STP_SetPortAdminEdge (bridge, 0, true, 0);
+		STP_StartBridge (bridge, 0);
+		STP_OnPortEnabled (bridge, 0, 100, true, 0);
+
+		// The edge port was told to forward, but the hardware hasn't confirmed it yet.
+		Assert::IsFalse (STP_GetPortForwarding (bridge, 0, 0));
+
+		// A stale completion (the last request for learning was "enable") must be ignored.
+		STP_OnHardwareActionComplete (bridge, STP_HARDWARE_ACTION_LEARNING, 0, 0, false, 0);
+		Assert::IsFalse (STP_GetPortLearning (bridge, 0, 0));
+
+		STP_OnHardwareActionComplete (bridge, STP_HARDWARE_ACTION_LEARNING, 0, 0, true, 0);
+		STP_OnHardwareActionComplete (bridge, STP_HARDWARE_ACTION_FORWARDING, 0, 0, true, 0);
+		Assert::IsTrue (STP_GetPortLearning (bridge, 0, 0));
+		Assert::IsTrue (STP_GetPortForwarding (bridge, 0, 0));
+	}
+
+	TEST_METHOD(applied_port_states_match_getters)
+	{
+		test_bridge one (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 }, test_bridge::batched_callbacks);
+		test_bridge two (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x70 }, test_bridge::batched_callbacks);
+		for (test_bridge* b : { &one, &two })
+		{
+			STP_SetStpVersion (*b, STP_VERSION_MSTP, 0);
+			STP_SetPortAdminEdge (*b, 1, true, 0);
+			STP_StartBridge (*b, 0);
+			STP_OnPortEnabled (*b, 0, 100, true, 0);
+			STP_OnPortEnabled (*b, 1, 100, true, 0);
+		}
+		exchange_bpdus (one, 0, two, 0);
+
+		// The handshake on the point-to-point link has brought it to forwarding.
+		Assert::IsTrue (STP_GetPortForwarding (one, 0, 0));
+		Assert::IsTrue (STP_GetPortForwarding (two, 0, 0));
+
+		// The last state applied for each port and tree (none: discarding) is what the getters return.
+		for (test_bridge* b : { &one, &two })
+		{
+			for (unsigned int portIndex = 0; portIndex < 4; portIndex++)
+			{
+				for (unsigned int treeIndex = 0; treeIndex < 2; treeIndex++)
+				{
+					bool learning = false;
+					bool forwarding = false;
+					for (const STP_PORT_STATE_CHANGE& change : b->applied_port_states)
+					{
+						if ((change.portIndex == portIndex) && (change.treeIndex == treeIndex))
+						{
+							learning = change.learning;
+							forwarding = change.forwarding;
+						}
+					}
+
+					Assert::AreEqual (STP_GetPortLearning (*b, portIndex, treeIndex), learning);
+					Assert::AreEqual (STP_GetPortForwarding (*b, portIndex, treeIndex), forwarding);
+				}
+			}
+		}
+	}
+
+	TEST_METHOD(fdb_flushes_merged_within_window)
+	{
+		test_bridge bridge (4, 0, 0, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 }, test_bridge::batched_callbacks);
+		test_bridge peer0 (4, 0, 0, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x70 });
+		test_bridge peer1 (4, 0, 0, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x71 });
+		test_bridge peer2 (4, 0, 0, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x72 });
+		test_bridge* peers[] = { &peer0, &peer1, &peer2 };
+		STP_SetFdbFlushWindow (bridge, 5000);
+		STP_StartBridge (bridge, 0);
+		for (unsigned int portIndex = 0; portIndex < 3; portIndex++)
+		{
+			STP_StartBridge (*peers[portIndex], 0);
+			STP_OnPortEnabled (bridge, portIndex, 100, true, 0);
+			STP_OnPortEnabled (*peers[portIndex], 0, 100, true, 0);
+			exchange_bpdus (bridge, portIndex, *peers[portIndex], 0);
+			Assert::IsTrue (STP_GetPortForwarding (bridge, portIndex, 0));
+		}
+
+		// Deliver what the ports coming up have flushed; the window then starts over with the first flush below.
+		STP_OnOneSecondTick (bridge, 5000);
+		bridge.fdb_flushes.clear();
+
+		STP_OnPortDisabled (bridge, 0, 10000);
+		Assert::AreEqual ((size_t) 1, bridge.fdb_flushes.size());
+		Assert::AreEqual ((uint8_t) 0x01, bridge.fdb_flushes[0].port_mask[0]);
+
+		// Flushes less than the window later are collected, not delivered.
+		STP_OnPortDisabled (bridge, 1, 11000);
+		STP_OnPortDisabled (bridge, 2, 12000);
+		STP_OnOneSecondTick (bridge, 14000);
+		Assert::AreEqual ((size_t) 1, bridge.fdb_flushes.size());
+
+		// Once the window has elapsed, they are delivered in a single call, with one mask.
+		STP_OnOneSecondTick (bridge, 15000);
+		Assert::AreEqual ((size_t) 2, bridge.fdb_flushes.size());
+		Assert::AreEqual (0u, bridge.fdb_flushes[1].tree_index);
+		Assert::AreEqual ((uint8_t) 0x06, bridge.fdb_flushes[1].port_mask[0]);
+		Assert::AreEqual (15000u, bridge.fdb_flushes[1].timestamp);
+	}
+
+	TEST_METHOD(binary_log_decodes_to_same_text)
+	{
+		auto run = [](test_bridge& bridge)
+		{
+			STP_SetStpVersion (bridge, STP_VERSION_MSTP, 0);
+			STP_StartBridge (bridge, 0);
+			STP_OnPortEnabled (bridge, 0, 100, true, 1000);
+			STP_SetBridgePriority (bridge, 1, 0x4000, 2000);
+			STP_OnOneSecondTick (bridge, 3000);
+		};
+
+		test_bridge text_bridge (4, 2, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableLogging (text_bridge, true);
+		run (text_bridge);
+
+		test_bridge binary_bridge (4, 2, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableLogging (binary_bridge, true);
+		STP_EnableBinaryLogging (binary_bridge, 100000);
+		run (binary_bridge);
+		Assert::IsTrue (binary_bridge.log_text.empty());
+
+		std::vector<uint8_t> exported (200000);
+		unsigned int size = STP_ExportBinaryLog (binary_bridge, exported.data(), (unsigned int) exported.size());
+		std::string decoded;
+		auto append = [](const STP_BRIDGE* bridge, int port, int tree, const char* str, unsigned int len, unsigned int flush)
+		{
+			static_cast<std::string*>(STP_GetApplicationContext(bridge))->append (str, len);
+		};
+		Assert::AreEqual (size, STP_DecodeBinaryLog (exported.data(), size, append, &decoded));
+		Assert::IsTrue (decoded == text_bridge.log_text);
+	}
+
+	TEST_METHOD(log_ring_drains_same_text)
+	{
+		auto run = [](test_bridge& bridge)
+		{
+			STP_SetStpVersion (bridge, STP_VERSION_MSTP, 0);
+			STP_StartBridge (bridge, 0);
+			STP_OnPortEnabled (bridge, 0, 100, true, 1000);
+			STP_OnOneSecondTick (bridge, 2000);
+		};
+
+		test_bridge direct_bridge (4, 2, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableLogging (direct_bridge, true);
+		run (direct_bridge);
+
+		test_bridge ring_bridge (4, 2, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableLogging (ring_bridge, true);
+		STP_EnableLogRing (ring_bridge, 1000000);
+		run (ring_bridge);
+		Assert::IsTrue (ring_bridge.log_text.empty());
+
+		Assert::AreEqual ((unsigned int) direct_bridge.log_text.size(), STP_DrainLogRing (ring_bridge));
+		Assert::IsTrue (ring_bridge.log_text == direct_bridge.log_text);
+
+		// A ring too small for the text drops the newest chunks and reports how much was lost.
+		test_bridge small_ring_bridge (4, 2, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableLogging (small_ring_bridge, true);
+		STP_EnableLogRing (small_ring_bridge, 1000);
+		run (small_ring_bridge);
+		STP_DrainLogRing (small_ring_bridge);
+		STP_OnOneSecondTick (small_ring_bridge, 3000);
+		STP_DrainLogRing (small_ring_bridge);
+		unsigned int dropped_bytes, dropped_chunks;
+		STP_GetLogRingStats (small_ring_bridge, &dropped_bytes, &dropped_chunks);
+		Assert::IsTrue (dropped_chunks > 0);
+		Assert::IsTrue (small_ring_bridge.log_text.find ("bytes of log text dropped") != std::string::npos);
+	}
+
+	TEST_METHOD(log_filter_by_category_and_port)
+	{
+		test_bridge bridge (4, 0, 0, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableLogging (bridge, true);
+		STP_SetLogFilter (bridge, STP_LOG_CATEGORY_TRANSITIONS, 1, -1);
+		STP_StartBridge (bridge, 0);
+		STP_OnPortEnabled (bridge, 0, 100, true, 1000);
+		STP_OnPortEnabled (bridge, 1, 100, true, 1000);
+		STP_OnOneSecondTick (bridge, 2000);
+
+		Assert::IsTrue (bridge.log_text.find ("Port 2: ") != std::string::npos);
+		Assert::IsTrue (bridge.log_text.find ("Port 1: ") == std::string::npos);
+		Assert::IsTrue (bridge.log_text.find ("PortTimers") == std::string::npos);
+		Assert::IsTrue (bridge.log_text.find ("Starting the bridge") == std::string::npos);
+	}
+
+	TEST_METHOD(protocol_counters)
+	{
+		test_bridge one (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		test_bridge two (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x70 });
+		for (test_bridge* b : { &one, &two })
+		{
+			STP_SetStpVersion (*b, STP_VERSION_MSTP, 0);
+			STP_StartBridge (*b, 0);
+			STP_OnPortEnabled (*b, 0, 100, true, 0);
+		}
+
+		exchange_bpdus (one, 0, two, 0);
+
+		const uint8_t invalid_bpdu[3] = { 0, 0, 0 };
+		STP_OnBpduReceived (two, 0, invalid_bpdu, sizeof(invalid_bpdu), 0);
+		STP_OnBpduReceived (two, 1, invalid_bpdu, sizeof(invalid_bpdu), 0);
+
+		STP_PORT_COUNTERS one_ports[4], two_ports[4];
+		STP_PORT_TREE_COUNTERS one_trees[8];
+		STP_ReadCounters (one, one_ports, one_trees);
+		STP_ReadCounters (two, two_ports, nullptr);
+		Assert::IsTrue (one_ports[0].txMstpBpdus > 0);
+		Assert::AreEqual (one_ports[0].txMstpBpdus, two_ports[0].rxMstpBpdus);
+		Assert::AreEqual (two_ports[0].txMstpBpdus, one_ports[0].rxMstpBpdus);
+		Assert::AreEqual (1u, two_ports[0].rxInvalidBpdus);
+		Assert::AreEqual (1u, two_ports[1].rxDiscardedPortDisabled);
+		Assert::IsTrue (one_trees[0].roleChanges > 0);
+		Assert::IsTrue (one_trees[1].roleChanges > 0);
+
+		STP_ResetCounters (two);
+		STP_ReadCounters (two, two_ports, nullptr);
+		Assert::AreEqual (0u, two_ports[0].rxMstpBpdus);
+		Assert::AreEqual (0u, two_ports[0].rxInvalidBpdus);
+	}
+
+	TEST_METHOD(convergence_info)
+	{
+		test_bridge one (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		test_bridge two (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x70 });
+		for (test_bridge* b : { &one, &two })
+		{
+			STP_SetStpVersion (*b, STP_VERSION_MSTP, 0);
+			STP_StartBridge (*b, 0);
+			STP_OnPortEnabled (*b, 0, 100, true, 0);
+		}
+
+		exchange_bpdus (one, 0, two, 0);
+
+		for (unsigned int treeIndex = 0; treeIndex < 2; treeIndex++)
+		{
+			STP_CONVERGENCE_INFO info;
+			STP_GetConvergenceInfo (one, treeIndex, &info);
+			Assert::IsFalse (info.converging);
+			Assert::IsTrue (info.convergenceCount > 0);
+			Assert::IsTrue (info.topologyChangeCount > 0);
+		}
+	}
+
+	TEST_METHOD(latency_histograms)
+	{
+		static unsigned int now;
+		test_bridge bridge (4, 0, 0, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		STP_EnableLatencyHistograms (bridge, [](const STP_BRIDGE*) { return now += 100; });
+		STP_StartBridge (bridge, 0);
+		for (unsigned int i = 0; i < 10; i++)
+			STP_OnOneSecondTick (bridge, i * 1000);
+
+		STP_LATENCY_HISTOGRAM tick_histogram;
+		STP_GetLatencyHistogram (bridge, STP_LATENCY_ON_ONE_SECOND_TICK, &tick_histogram);
+		Assert::AreEqual (10u, tick_histogram.count);
+		Assert::AreEqual (100u, tick_histogram.min);
+		Assert::AreEqual (100u, tick_histogram.max);
+		Assert::AreEqual (100u, STP_GetLatencyPercentile (&tick_histogram, 9900));
+
+		STP_LATENCY_HISTOGRAM merged = { };
+		STP_MergeLatencyHistogram (&merged, &tick_histogram);
+		STP_MergeLatencyHistogram (&merged, &tick_histogram);
+		Assert::AreEqual (20u, merged.count);
+
+		STP_ResetLatencyHistograms (bridge);
+		STP_GetLatencyHistogram (bridge, STP_LATENCY_ON_ONE_SECOND_TICK, &tick_histogram);
+		Assert::AreEqual (0u, tick_histogram.count);
+	}
+
+	TEST_METHOD(clone_bridge_test)
+	{
+		test_bridge one (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 });
+		test_bridge two (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x70 });
+		for (test_bridge* b : { &one, &two })
+		{
+			STP_SetStpVersion (*b, STP_VERSION_MSTP, 0);
+			STP_StartBridge (*b, 0);
+			STP_OnPortEnabled (*b, 0, 100, true, 0);
+		}
+		exchange_bpdus (one, 0, two, 0);
+
+		test_bridge clone (static_cast<STP_BRIDGE*>(two));
+		Assert::IsTrue (STP_IsBridgeStarted (clone));
+		Assert::IsTrue (STP_GetApplicationContext (clone) == &clone);
+		Assert::AreEqual (STP_PORT_ROLE_ROOT, STP_GetPortRole (clone, 0, 0));
+		for (unsigned int portIndex = 0; portIndex < 4; portIndex++)
+		{
+			for (unsigned int treeIndex = 0; treeIndex < 2; treeIndex++)
+				Assert::AreEqual (STP_GetPortRole (two, portIndex, treeIndex), STP_GetPortRole (clone, portIndex, treeIndex));
+		}
+
+		// The same calls give the same BPDUs (the bridges transmit every Hello Time, 2 seconds).
+		for (unsigned int timestamp = 1000; timestamp <= 2000; timestamp += 1000)
+		{
+			STP_OnOneSecondTick (two, timestamp);
+			STP_OnOneSecondTick (clone, timestamp);
+		}
+		Assert::IsFalse (clone.tx_queues[0].empty());
+		Assert::IsTrue (clone.tx_queues[0].back() == two.tx_queues[0].back());
+
+		// A change on the clone doesn't affect the original.
+		STP_SetBridgePriority (clone, 0, 0x1000, 2000);
+		Assert::AreEqual (STP_PORT_ROLE_DESIGNATED, STP_GetPortRole (clone, 0, 0));
+		Assert::AreEqual (STP_PORT_ROLE_ROOT, STP_GetPortRole (two, 0, 0));
+	}
+
+	TEST_METHOD(replay_gives_same_outputs)
+	{
+		static std::unordered_map<const STP_BRIDGE*, std::vector<uint8_t>> recordings;
+		auto record_out = [](const STP_BRIDGE* bridge, const unsigned char* data, unsigned int size)
+		{
+			auto& recording = recordings[bridge];
+			recording.insert (recording.end(), data, data + size);
+		};
+
+		// The second time without onTopologyChange and onPortRoleChanged: the bridge created from the recording
+		// must leave them out too, even though it's given them, or it records calls to them that the original didn't make.
+		for (bool notifications : { true, false })
+		{
+			recordings.clear();
+			STP_CALLBACKS callbacks = test_bridge::default_callbacks;
+			if (!notifications)
+			{
+				callbacks.onTopologyChange = nullptr;
+				callbacks.onPortRoleChanged = nullptr;
+			}
+
+			test_bridge one (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 }, callbacks);
+			test_bridge two (4, 1, 16, { 0x10, 0x20, 0x30, 0x40, 0x50, 0x70 });
+			STP_EnableRecording (one, record_out);
+			for (test_bridge* b : { &one, &two })
+			{
+				STP_SetStpVersion (*b, STP_VERSION_MSTP, 0);
+				STP_StartBridge (*b, 0);
+				STP_OnPortEnabled (*b, 0, 100, true, 0);
+			}
+			exchange_bpdus (one, 0, two, 0);
+			STP_OnOneSecondTick (one, 1000);
+			const auto& recorded = recordings[one];
+
+			test_bridge replay (recorded);
+			STP_EnableRecording (replay, record_out);
+			unsigned int input_count = 0;
+			for (size_t offset = 0; offset < recorded.size(); )
+			{
+				unsigned int size = STP_GetRecordSize (&recorded[offset], (unsigned int) (recorded.size() - offset));
+				Assert::AreNotEqual (0u, size);
+				if (STP_ReplayRecord (replay, &recorded[offset], size))
+					input_count++;
+				offset += size;
+			}
+
+			Assert::IsTrue (input_count > 4);
+			Assert::IsTrue (recordings[replay] == recorded);
+		}
+	}
 };
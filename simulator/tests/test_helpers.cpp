@@ -47,8 +47,10 @@ static void StpCallback_FlushFdb (const STP_BRIDGE* bridge, unsigned int portInd
 {
 }
 
-static void StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush)
+void test_bridge::StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush)
 {
+	test_bridge* tb = static_cast<test_bridge*>(STP_GetApplicationContext(bridge));
+	tb->log_text.append (nullTerminatedString, stringLength);
 }
 
 static void StpCallback_OnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp)
@@ -62,7 +64,34 @@ void test_bridge::StpCallback_OnPortRoleChanged (const STP_BRIDGE* bridge, unsig
 		tb->port_role_changed (portIndex, treeIndex, role);
 }
 
-const STP_CALLBACKS test_bridge::callbacks =
+const STP_CALLBACKS test_bridge::default_callbacks =
+{
+	&StpCallback_EnableBpduTrapping,
+	&StpCallback_EnableLearning,
+	&StpCallback_EnableForwarding,
+	&StpCallback_TransmitGetBuffer,
+	&StpCallback_TransmitReleaseBuffer,
+	&StpCallback_FlushFdb,
+	&StpCallback_DebugStrOut,
+	&StpCallback_OnTopologyChange,
+	&StpCallback_OnPortRoleChanged,
+	&StpCallback_AllocAndZeroMemory,
+	&StpCallback_FreeMemory,
+};
+
+void test_bridge::StpCallback_ApplyPortStates (const STP_BRIDGE* bridge, const STP_PORT_STATE_CHANGE* changes, unsigned int changeCount, unsigned int timestamp)
+{
+	test_bridge* tb = static_cast<test_bridge*>(STP_GetApplicationContext(bridge));
+	tb->applied_port_states.insert (tb->applied_port_states.end(), changes, changes + changeCount);
+}
+
+void test_bridge::StpCallback_FlushFdbPorts (const STP_BRIDGE* bridge, unsigned int treeIndex, const unsigned char* portMask, unsigned int portMaskSize, STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp)
+{
+	test_bridge* tb = static_cast<test_bridge*>(STP_GetApplicationContext(bridge));
+	tb->fdb_flushes.push_back ({ treeIndex, std::vector<uint8_t>(portMask, portMask + portMaskSize), flushType, timestamp });
+}
+
+const STP_CALLBACKS test_bridge::batched_callbacks =
 {
 	&StpCallback_EnableBpduTrapping,
 	&StpCallback_EnableLearning,
@@ -75,14 +104,29 @@ const STP_CALLBACKS test_bridge::callbacks =
 	&StpCallback_OnPortRoleChanged,
 	&StpCallback_AllocAndZeroMemory,
 	&StpCallback_FreeMemory,
+	&StpCallback_ApplyPortStates,
+	&StpCallback_FlushFdbPorts,
 };
 
-test_bridge::test_bridge (size_t port_count, size_t msti_count, uint16_t max_vlan_number, const std::array<uint8_t, 6>& bridge_address)
+test_bridge::test_bridge (size_t port_count, size_t msti_count, uint16_t max_vlan_number, const std::array<uint8_t, 6>& bridge_address,
+	const STP_CALLBACKS& callbacks)
 {
 	stp_bridge = STP_CreateBridge ((unsigned int)port_count, (unsigned int)msti_count, max_vlan_number, &callbacks, bridge_address.data(), 256);
 	STP_SetApplicationContext (stp_bridge, this);
 }
 
+test_bridge::test_bridge (const STP_BRIDGE* original)
+{
+	stp_bridge = STP_CloneBridge (original, &default_callbacks, this);
+}
+
+test_bridge::test_bridge (const std::vector<uint8_t>& recording)
+{
+	unsigned int header_size = STP_GetRecordSize (recording.data(), (unsigned int) recording.size());
+	stp_bridge = STP_CreateBridgeFromRecording (recording.data(), header_size, &default_callbacks, 256);
+	STP_SetApplicationContext (stp_bridge, this);
+}
+
 test_bridge::~test_bridge()
 {
 	STP_DestroyBridge (stp_bridge);
@@ -96,14 +140,14 @@ bool exchange_bpdus (test_bridge& one, size_t one_port, test_bridge& other, size
 	{
 		if (!one.tx_queues[one_port].empty())
 		{
-			auto bpdu = std::move(one.tx_queues[one_port].back());
+			auto bpdu = std::move(one.tx_queues[one_port].front());
 			one.tx_queues[one_port].pop();
 			STP_OnBpduReceived (other, (unsigned int)other_port, bpdu.data(), (unsigned int) bpdu.size(), 0);
 			exchanged = true;
 		}
 		else if (!other.tx_queues[other_port].empty())
 		{
-			auto bpdu = std::move(other.tx_queues[other_port].back());
+			auto bpdu = std::move(other.tx_queues[other_port].front());
 			other.tx_queues[other_port].pop();
 			STP_OnBpduReceived (one, (unsigned int)one_port, bpdu.data(), (unsigned int) bpdu.size(), 0);
 			exchanged = true;
@@ -34,13 +34,22 @@ class test_bridge
 	static void* StpCallback_TransmitGetBuffer (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp);
 	static void  StpCallback_TransmitReleaseBuffer (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer);
 	static void  StpCallback_OnPortRoleChanged (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, STP_PORT_ROLE role, unsigned int timestamp);
-	static const STP_CALLBACKS callbacks;
+	static void  StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush);
+	static void  StpCallback_ApplyPortStates (const STP_BRIDGE* bridge, const STP_PORT_STATE_CHANGE* changes, unsigned int changeCount, unsigned int timestamp);
+	static void  StpCallback_FlushFdbPorts (const STP_BRIDGE* bridge, unsigned int treeIndex, const unsigned char* portMask, unsigned int portMaskSize, STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp);
 
 	std::vector<uint8_t> tx_buffer;
 	size_t tx_buffer_port_index;
 
 public:
-	test_bridge (size_t port_count, size_t msti_count, uint16_t max_vlan_number, const std::array<uint8_t, 6>& bridge_address);
+	// Without the optional callbacks. Tests can copy these and change some of them.
+	static const STP_CALLBACKS default_callbacks;
+	static const STP_CALLBACKS batched_callbacks; // default_callbacks plus applyPortStates and flushFdbPorts
+
+	test_bridge (size_t port_count, size_t msti_count, uint16_t max_vlan_number, const std::array<uint8_t, 6>& bridge_address,
+		const STP_CALLBACKS& callbacks = default_callbacks);
+	explicit test_bridge (const STP_BRIDGE* original); // with STP_CloneBridge
+	explicit test_bridge (const std::vector<uint8_t>& recording); // with STP_CreateBridgeFromRecording, from the first record
 	test_bridge (const test_bridge&) = delete;
 	test_bridge& operator= (const test_bridge&) = delete;
 	~test_bridge();
@@ -50,6 +59,17 @@ public:
 	using tx_queue = std::queue<std::vector<uint8_t>>;
 	std::unordered_map<size_t, tx_queue> tx_queues;
 	std::function<void(size_t portIndex, size_t treeIndex, STP_PORT_ROLE role)> port_role_changed;
+	std::string log_text;
+	std::vector<STP_PORT_STATE_CHANGE> applied_port_states; // every change passed to applyPortStates, in order
+
+	struct fdb_flush
+	{
+		unsigned int tree_index;
+		std::vector<uint8_t> port_mask;
+		STP_FLUSH_FDB_TYPE type;
+		unsigned int timestamp;
+	};
+	std::vector<fdb_flush> fdb_flushes; // every call to flushFdbPorts, in order
 };
 
 bool exchange_bpdus (test_bridge& one, size_t one_port, test_bridge& other, size_t other_port);
@@ -0,0 +1,486 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Benchmark suite for the library core, over a matrix of port counts and MSTI counts.
+// Usage: benchmark [-q] [-p portCounts] [-m mstiCounts] [-t minSecondsPerCase] > results.csv
+//   -q  quick matrix (4, 64 and 1024 ports; 0 and 8 MSTIs) instead of the full one
+//   -p  comma-separated port counts (1 to 4095), for example -p 4,48
+//   -m  comma-separated MSTI counts (0 to 64)
+// Each case runs its operation repeatedly until at least minSecondsPerCase (default 0.2) of measured time has accumulated,
+// and at least once; with thousands of ports and many MSTIs a single operation can take seconds, so the full matrix is slow.
+// The output is CSV, one line per case: scenario, portCount, mstiCount, number of operations measured,
+// nanoseconds per operation, and the bytes of memory the library allocated for the bridge under test.
+//
+// The bridge under test runs MSTP and is linked to a peer bridge (the root) through its first four ports ("uplinks");
+// its other ports are enabled edge ports with nothing attached, as on an access switch. All VLANs up to 4094 are
+// mapped to the trees in turn. The scenarios are:
+//   create       - STP_CreateBridge
+//   start        - STP_StartBridge on a bridge with all ports enabled
+//   hello        - STP_OnBpduReceived of a steady-state hello from the root on an uplink
+//   tick         - STP_OnOneSecondTick in steady state
+//   root_change  - the bridge under test changes its bridge priority, becoming the root or giving that up, and both
+//                  bridges exchange BPDUs until there are no more (this includes the peer's processing)
+//   link_flap    - an uplink goes down and comes back up, with the BPDU exchanges after each event
+//   mst_config   - one VLAN moves to another tree (which changes the MST region) and the BPDUs are exchanged;
+//                  not run with zero MSTIs
+
+#include "../../mstp-lib/stp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+static const unsigned int MaxVlanNumber = 4094;
+static const unsigned int MaxUplinkCount = 4;
+
+// ============================================================================
+
+static double GetSeconds()
+{
+	#ifdef _WIN32
+		LARGE_INTEGER frequency, counter;
+		QueryPerformanceFrequency (&frequency);
+		QueryPerformanceCounter (&counter);
+		return (double) counter.QuadPart / frequency.QuadPart;
+	#else
+		timespec ts;
+		clock_gettime (CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+	#endif
+}
+
+// Accumulates the measured time of a case.
+struct STOPWATCH
+{
+	double total;
+	double startTime;
+	unsigned long long ops;
+
+	STOPWATCH() : total(0), startTime(0), ops(0) { }
+	void Start() { startTime = GetSeconds(); }
+	void Stop (unsigned int opCount) { total += GetSeconds() - startTime; ops += opCount; }
+};
+
+// ============================================================================
+
+// Allocations are prefixed with their size, so that we can count the bytes the library holds.
+static unsigned long long allocatedBytes;
+
+static void* StpCallback_AllocAndZeroMemory (unsigned int size)
+{
+	unsigned long long* p = (unsigned long long*) calloc (1, sizeof(unsigned long long) + size);
+	p[0] = size;
+	allocatedBytes += size;
+	return &p[1];
+}
+
+static void StpCallback_FreeMemory (void* p)
+{
+	unsigned long long* block = (unsigned long long*) p - 1;
+	allocatedBytes -= block[0];
+	free (block);
+}
+
+struct PENDING_BPDU
+{
+	unsigned int portIndex;
+	std::vector<unsigned char> data;
+};
+
+struct NODE
+{
+	STP_BRIDGE* bridge;
+	unsigned int uplinkCount;
+	unsigned int txPortIndex;
+	std::vector<unsigned char> txBuffer;
+	std::deque<PENDING_BPDU> txQueue;
+	unsigned long long txCount;
+};
+
+static void* StpCallback_TransmitGetBuffer (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp)
+{
+	NODE* node = (NODE*) STP_GetApplicationContext (bridge);
+	node->txPortIndex = portIndex;
+	node->txBuffer.resize (bpduSize);
+	return &node->txBuffer[0];
+}
+
+static void StpCallback_TransmitReleaseBuffer (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer)
+{
+	NODE* node = (NODE*) STP_GetApplicationContext (bridge);
+	node->txCount++;
+
+	// Nothing is attached to the ports other than the uplinks.
+	if (node->txPortIndex < node->uplinkCount)
+	{
+		node->txQueue.push_back (PENDING_BPDU());
+		node->txQueue.back().portIndex = node->txPortIndex;
+		node->txQueue.back().data.swap (node->txBuffer);
+	}
+}
+
+static void StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush) { }
+static void StpCallback_EnableBpduTrapping (const STP_BRIDGE* bridge, bool enable, unsigned int timestamp) { }
+static void StpCallback_EnablePortState (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp) { }
+static void StpCallback_FlushFdb (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp) { }
+static void StpCallback_OnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp) { }
+static void StpCallback_OnPortRoleChanged (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_PORT_ROLE role, unsigned int timestamp) { }
+
+static const STP_CALLBACKS callbacks =
+{
+	&StpCallback_EnableBpduTrapping,
+	&StpCallback_EnablePortState,
+	&StpCallback_EnablePortState,
+	&StpCallback_TransmitGetBuffer,
+	&StpCallback_TransmitReleaseBuffer,
+	&StpCallback_FlushFdb,
+	&StpCallback_DebugStrOut,
+	&StpCallback_OnTopologyChange,
+	&StpCallback_OnPortRoleChanged,
+	&StpCallback_AllocAndZeroMemory,
+	&StpCallback_FreeMemory,
+	NULL,
+	NULL,
+	NULL,
+};
+
+// ============================================================================
+
+// Creates an MSTP bridge with all VLANs mapped to the trees in turn. Returns the bytes allocated for it.
+static unsigned long long CreateNode (NODE* node, unsigned int portCount, unsigned int mstiCount, unsigned int uplinkCount, unsigned char addressLastByte)
+{
+	unsigned long long before = allocatedBytes;
+	unsigned char address[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, addressLastByte };
+	node->bridge = STP_CreateBridge (portCount, mstiCount, MaxVlanNumber, &callbacks, address, 256);
+	unsigned long long bytes = allocatedBytes - before;
+
+	STP_SetApplicationContext (node->bridge, node);
+	node->uplinkCount = uplinkCount;
+	node->txCount = 0;
+	STP_SetStpVersion (node->bridge, STP_VERSION_MSTP, 0);
+	STP_SetTxHoldCount (node->bridge, 10, 0); // the maximum, so that reconvergence isn't held back waiting for ticks
+	STP_SetMstConfigName (node->bridge, "benchmark", 0);
+
+	std::vector<STP_CONFIG_TABLE_ENTRY> table (1 + MaxVlanNumber);
+	for (unsigned int vlan = 1; vlan <= MaxVlanNumber; vlan++)
+	{
+		table[vlan].unused = 0;
+		table[vlan].treeIndex = (unsigned char) (vlan % (1 + mstiCount));
+	}
+	STP_SetMstConfigTable (node->bridge, &table[0], (unsigned int) table.size(), 0);
+
+	for (unsigned int portIndex = uplinkCount; portIndex < portCount; portIndex++)
+		STP_SetPortAdminEdge (node->bridge, portIndex, true, 0);
+
+	return bytes;
+}
+
+static void EnablePorts (NODE* node, unsigned int portCount, unsigned int timestamp)
+{
+	for (unsigned int portIndex = 0; portIndex < portCount; portIndex++)
+		STP_OnPortEnabled (node->bridge, portIndex, 1000, true, timestamp);
+}
+
+// Delivers BPDUs between the uplinks of the two bridges until neither has anything more to send.
+static void Exchange (NODE* a, NODE* b, unsigned int timestamp)
+{
+	while (!a->txQueue.empty() || !b->txQueue.empty())
+	{
+		NODE* from = !a->txQueue.empty() ? a : b;
+		NODE* to = (from == a) ? b : a;
+		PENDING_BPDU bpdu;
+		bpdu.portIndex = from->txQueue.front().portIndex;
+		bpdu.data.swap (from->txQueue.front().data);
+		from->txQueue.pop_front();
+		STP_OnBpduReceived (to->bridge, bpdu.portIndex, &bpdu.data[0], (unsigned int) bpdu.data.size(), timestamp);
+	}
+}
+
+static void Tick (NODE* a, NODE* b, unsigned int timestamp)
+{
+	STP_OnOneSecondTick (a->bridge, timestamp);
+	STP_OnOneSecondTick (b->bridge, timestamp);
+	Exchange (a, b, timestamp);
+}
+
+// The bridge under test and its peer, started, linked and converged.
+struct TOPOLOGY
+{
+	NODE node;
+	NODE peer;
+	unsigned long long bytes;
+	unsigned int timestamp;
+
+	TOPOLOGY (unsigned int portCount, unsigned int mstiCount)
+	{
+		unsigned int uplinkCount = (portCount < MaxUplinkCount) ? portCount : MaxUplinkCount;
+		bytes = CreateNode (&node, portCount, mstiCount, uplinkCount, 0x01);
+		CreateNode (&peer, uplinkCount, mstiCount, uplinkCount, 0x02);
+		for (unsigned int treeIndex = 0; treeIndex <= mstiCount; treeIndex++)
+			STP_SetBridgePriority (peer.bridge, treeIndex, 0x4000, 0);
+
+		timestamp = 0;
+		STP_StartBridge (node.bridge, timestamp);
+		STP_StartBridge (peer.bridge, timestamp);
+		EnablePorts (&node, portCount, timestamp);
+		EnablePorts (&peer, uplinkCount, timestamp);
+		Exchange (&node, &peer, timestamp);
+		for (unsigned int i = 0; i < 5; i++)
+			Tick (&node, &peer, timestamp += 1000);
+	}
+
+	~TOPOLOGY()
+	{
+		STP_DestroyBridge (node.bridge);
+		STP_DestroyBridge (peer.bridge);
+	}
+
+	// Runs both bridges for a while without measuring it, so that each measured operation starts from the same state:
+	// long enough for txCount to go back to zero on all ports (13.27.33 in 802.1Q-2018), or the next operation
+	// would find BPDU transmission throttled by TxHoldCount.
+	void Settle()
+	{
+		for (unsigned int i = 0; i < 10; i++)
+			Tick (&node, &peer, timestamp += 1000);
+	}
+};
+
+// ============================================================================
+
+static double minSeconds = 0.2;
+
+static bool Done (const STOPWATCH& sw)
+{
+	return (sw.ops > 0) && (sw.total >= minSeconds);
+}
+
+static void Report (const char* scenario, unsigned int portCount, unsigned int mstiCount, const STOPWATCH& sw, unsigned long long bytes)
+{
+	printf ("%s,%u,%u,%llu,%.1f,%llu\n", scenario, portCount, mstiCount, sw.ops, sw.total * 1e9 / sw.ops, bytes);
+	fflush (stdout);
+}
+
+static unsigned long long RunCreate (unsigned int portCount, unsigned int mstiCount)
+{
+	STOPWATCH sw;
+	unsigned long long bytes = 0;
+	unsigned char address[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	while (!Done (sw))
+	{
+		unsigned long long before = allocatedBytes;
+		sw.Start();
+		STP_BRIDGE* bridge = STP_CreateBridge (portCount, mstiCount, MaxVlanNumber, &callbacks, address, 256);
+		sw.Stop (1);
+		bytes = allocatedBytes - before;
+		STP_DestroyBridge (bridge);
+	}
+
+	Report ("create", portCount, mstiCount, sw, bytes);
+	return bytes;
+}
+
+static void RunStart (unsigned int portCount, unsigned int mstiCount, unsigned long long bytes)
+{
+	STOPWATCH sw;
+	while (!Done (sw))
+	{
+		NODE node;
+		CreateNode (&node, portCount, mstiCount, 0, 0x01);
+		EnablePorts (&node, portCount, 0);
+		sw.Start();
+		STP_StartBridge (node.bridge, 0);
+		sw.Stop (1);
+		STP_DestroyBridge (node.bridge);
+	}
+
+	Report ("start", portCount, mstiCount, sw, bytes);
+}
+
+static void RunHello (unsigned int portCount, unsigned int mstiCount)
+{
+	TOPOLOGY t (portCount, mstiCount);
+
+	// Capture the hellos the root sends on each uplink.
+	std::vector<std::vector<unsigned char> > hellos (t.peer.uplinkCount);
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		t.timestamp += 1000;
+		STP_OnOneSecondTick (t.node.bridge, t.timestamp);
+		STP_OnOneSecondTick (t.peer.bridge, t.timestamp);
+		for (size_t j = 0; j < t.peer.txQueue.size(); j++)
+			hellos[t.peer.txQueue[j].portIndex] = t.peer.txQueue[j].data;
+		Exchange (&t.node, &t.peer, t.timestamp);
+	}
+
+	STOPWATCH sw;
+	while (!Done (sw))
+	{
+		for (unsigned int portIndex = 0; portIndex < hellos.size(); portIndex++)
+		{
+			if (hellos[portIndex].empty())
+				continue;
+			sw.Start();
+			STP_OnBpduReceived (t.node.bridge, portIndex, &hellos[portIndex][0], (unsigned int) hellos[portIndex].size(), t.timestamp);
+			sw.Stop (1);
+		}
+
+		t.node.txQueue.clear();
+	}
+
+	Report ("hello", portCount, mstiCount, sw, t.bytes);
+}
+
+static void RunTick (unsigned int portCount, unsigned int mstiCount)
+{
+	TOPOLOGY t (portCount, mstiCount);
+	STOPWATCH sw;
+	while (!Done (sw))
+	{
+		t.timestamp += 1000;
+		sw.Start();
+		STP_OnOneSecondTick (t.node.bridge, t.timestamp);
+		sw.Stop (1);
+		STP_OnOneSecondTick (t.peer.bridge, t.timestamp);
+		Exchange (&t.node, &t.peer, t.timestamp);
+	}
+
+	Report ("tick", portCount, mstiCount, sw, t.bytes);
+}
+
+static void RunRootChange (unsigned int portCount, unsigned int mstiCount)
+{
+	TOPOLOGY t (portCount, mstiCount);
+	STOPWATCH sw;
+	bool root = false;
+	while (!Done (sw))
+	{
+		root = !root;
+		sw.Start();
+		STP_SetBridgePriority (t.node.bridge, 0, root ? 0x1000 : 0x8000, t.timestamp);
+		Exchange (&t.node, &t.peer, t.timestamp);
+		sw.Stop (1);
+		t.Settle();
+	}
+
+	Report ("root_change", portCount, mstiCount, sw, t.bytes);
+}
+
+static void RunLinkFlap (unsigned int portCount, unsigned int mstiCount)
+{
+	TOPOLOGY t (portCount, mstiCount);
+	STOPWATCH sw;
+	while (!Done (sw))
+	{
+		sw.Start();
+		STP_OnPortDisabled (t.node.bridge, 0, t.timestamp);
+		STP_OnPortDisabled (t.peer.bridge, 0, t.timestamp);
+		Exchange (&t.node, &t.peer, t.timestamp);
+		STP_OnPortEnabled (t.node.bridge, 0, 1000, true, t.timestamp);
+		STP_OnPortEnabled (t.peer.bridge, 0, 1000, true, t.timestamp);
+		Exchange (&t.node, &t.peer, t.timestamp);
+		sw.Stop (1);
+		t.Settle();
+	}
+
+	Report ("link_flap", portCount, mstiCount, sw, t.bytes);
+}
+
+static void RunMstConfig (unsigned int portCount, unsigned int mstiCount)
+{
+	TOPOLOGY t (portCount, mstiCount);
+	STOPWATCH sw;
+	bool moved = false;
+	while (!Done (sw))
+	{
+		moved = !moved;
+		sw.Start();
+		STP_SetMstConfigTableEntry (t.node.bridge, 1, moved ? 0 : 1, t.timestamp);
+		Exchange (&t.node, &t.peer, t.timestamp);
+		sw.Stop (1);
+		t.Settle();
+	}
+
+	Report ("mst_config", portCount, mstiCount, sw, t.bytes);
+}
+
+// ============================================================================
+
+static bool ParseList (const char* str, unsigned int maxValue, unsigned int minValue, std::vector<unsigned int>* values)
+{
+	values->clear();
+	while (*str != 0)
+	{
+		char* end;
+		unsigned long value = strtoul (str, &end, 10);
+		if ((end == str) || (value < minValue) || (value > maxValue) || ((*end != 0) && (*end != ',')))
+			return false;
+		values->push_back ((unsigned int) value);
+		str = (*end == ',') ? end + 1 : end;
+	}
+
+	return !values->empty();
+}
+
+int main (int argc, char* argv[])
+{
+	static const unsigned int FullPortCounts[] = { 4, 16, 64, 256, 1024, 4095 };
+	static const unsigned int FullMstiCounts[] = { 0, 1, 8, 64 };
+	static const unsigned int QuickPortCounts[] = { 4, 64, 1024 };
+	static const unsigned int QuickMstiCounts[] = { 0, 8 };
+
+	std::vector<unsigned int> portCounts (FullPortCounts, FullPortCounts + sizeof(FullPortCounts) / sizeof(FullPortCounts[0]));
+	std::vector<unsigned int> mstiCounts (FullMstiCounts, FullMstiCounts + sizeof(FullMstiCounts) / sizeof(FullMstiCounts[0]));
+
+	bool ok = true;
+	for (int argi = 1; ok && (argi < argc); argi++)
+	{
+		if (strcmp (argv[argi], "-q") == 0)
+		{
+			portCounts.assign (QuickPortCounts, QuickPortCounts + sizeof(QuickPortCounts) / sizeof(QuickPortCounts[0]));
+			mstiCounts.assign (QuickMstiCounts, QuickMstiCounts + sizeof(QuickMstiCounts) / sizeof(QuickMstiCounts[0]));
+		}
+		else if ((strcmp (argv[argi], "-p") == 0) && (argi + 1 < argc))
+			ok = ParseList (argv[++argi], 4095, 1, &portCounts);
+		else if ((strcmp (argv[argi], "-m") == 0) && (argi + 1 < argc))
+			ok = ParseList (argv[++argi], 64, 0, &mstiCounts);
+		else if ((strcmp (argv[argi], "-t") == 0) && (argi + 1 < argc))
+			ok = ((minSeconds = atof (argv[++argi])) >= 0);
+		else
+			ok = false;
+	}
+
+	if (!ok)
+	{
+		fprintf (stderr, "usage: benchmark [-q] [-p portCounts] [-m mstiCounts] [-t minSecondsPerCase] > results.csv\n");
+		return 1;
+	}
+
+	printf ("scenario,ports,mstis,ops,ns_per_op,bridge_bytes\n");
+	for (size_t pi = 0; pi < portCounts.size(); pi++)
+	{
+		for (size_t mi = 0; mi < mstiCounts.size(); mi++)
+		{
+			unsigned int portCount = portCounts[pi];
+			unsigned int mstiCount = mstiCounts[mi];
+			unsigned long long bytes = RunCreate (portCount, mstiCount);
+			RunStart (portCount, mstiCount, bytes);
+			RunHello (portCount, mstiCount);
+			RunTick (portCount, mstiCount);
+			RunRootChange (portCount, mstiCount);
+			RunLinkFlap (portCount, mstiCount);
+			if (mstiCount > 0)
+				RunMstConfig (portCount, mstiCount);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Host-side decoder for the data produced by STP_ExportBinaryLog.
+// Usage: binary_log_decoder [file...]   (reads stdin when no file is given)
+// The files may contain any number of exported chunks, one after the other.
+// The decoded text is written to stdout exactly as the library would have passed it to debugStrOut.
+
+#include "../../mstp-lib/stp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush)
+{
+	fwrite (nullTerminatedString, 1, stringLength, stdout);
+}
+
+static bool DecodeFile (FILE* file, const char* name)
+{
+	unsigned char* data = NULL;
+	size_t size = 0;
+	size_t capacity = 0;
+	while (true)
+	{
+		if (size == capacity)
+		{
+			capacity = (capacity == 0) ? 65536 : capacity * 2;
+			data = (unsigned char*) realloc (data, capacity);
+			if (data == NULL)
+			{
+				fprintf (stderr, "%s: out of memory\n", name);
+				return false;
+			}
+		}
+
+		size_t read = fread (&data[size], 1, capacity - size, file);
+		if (read == 0)
+			break;
+		size += read;
+	}
+
+	unsigned int decoded = STP_DecodeBinaryLog (data, (unsigned int) size, DebugStrOut, NULL);
+	free (data);
+
+	if (decoded != size)
+	{
+		fprintf (stderr, "%s: %u trailing bytes don't make up a complete record\n", name, (unsigned int) (size - decoded));
+		return false;
+	}
+
+	return true;
+}
+
+int main (int argc, char* argv[])
+{
+	if (argc < 2)
+		return DecodeFile (stdin, "stdin") ? 0 : 1;
+
+	int result = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		FILE* file = fopen (argv[i], "rb");
+		if (file == NULL)
+		{
+			fprintf (stderr, "%s: cannot open\n", argv[i]);
+			result = 1;
+			continue;
+		}
+
+		if (!DecodeFile (file, argv[i]))
+			result = 1;
+
+		fclose (file);
+	}
+
+	return result;
+}
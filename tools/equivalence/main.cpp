@@ -0,0 +1,530 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Equivalence harness: checks that two builds of the library (for example before and after an optimization, or with
+// different compile-time options) behave the same, by running the same randomized multi-bridge scenarios through both.
+// Usage: equivalence run seed output.bin
+//        equivalence compare a.bin b.bin
+// "run" builds a random network from the seed (bridges of random port counts and, without MSTIs, STP versions, linked in a random,
+// usually looped, topology), then for a few simulated minutes takes links down and up and changes priorities, path costs
+// and edge settings at random, exchanging BPDUs after every event. All bridges are recorded with STP_EnableRecording,
+// and the records of all bridges are written to the output file in the order they were made, each one preceded by
+// the index of the bridge (2 bytes, little-endian). The scenario depends only on the seed, so two builds running the
+// same seed give the same file for as long as they behave the same; since the BPDUs a bridge transmits are what the
+// others receive, the first difference is where the two builds start to behave differently.
+// "compare" reports that first difference, with the records that led to it. See the Makefile for running many seeds
+// through two builds; both library trees must have STP_EnableRecording.
+
+#include "stp.h"                    // from the library tree given to the compiler with -I (see the Makefile)
+#include "internal/stp_recorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <queue>
+#include <vector>
+
+static const unsigned int MaxBridgeCount = 8;
+static const unsigned int MaxPortCount = 8;
+static const unsigned int MaxVlanNumber = 16;
+static const unsigned int SimulatedSeconds = 240;
+
+// ============================================================================
+// Random numbers. We don't use rand() because the sequence must be the same with all compilers and runtime libraries.
+
+static unsigned int randomState;
+
+static unsigned int Random (unsigned int count)
+{
+	// xorshift32
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState % count;
+}
+
+// ============================================================================
+// Bridges, as test_bridge and exchange_bpdus in simulator/tests, without the dependencies on Windows and C++17.
+
+struct TEST_BRIDGE
+{
+	STP_BRIDGE* bridge;
+	unsigned int index;
+	unsigned int portCount;
+	std::vector<unsigned char> txBuffer;
+	unsigned int txBufferPortIndex;
+	std::queue<std::vector<unsigned char> > txQueues [MaxPortCount];
+	std::vector<unsigned char> pendingRecord; // a record passed to recordOut in more than one call
+};
+
+struct LINK
+{
+	unsigned int bridge[2];
+	unsigned int port[2];
+	bool up;
+};
+
+static FILE* output;
+
+static void* StpCallback_AllocAndZeroMemory (unsigned int size)
+{
+	return calloc (1, size);
+}
+
+static void StpCallback_FreeMemory (void* p)
+{
+	free (p);
+}
+
+static void* StpCallback_TransmitGetBuffer (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp)
+{
+	TEST_BRIDGE* tb = (TEST_BRIDGE*) STP_GetApplicationContext (bridge);
+	tb->txBufferPortIndex = portIndex;
+	tb->txBuffer.resize (bpduSize);
+	return &tb->txBuffer[0];
+}
+
+static void StpCallback_TransmitReleaseBuffer (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer)
+{
+	TEST_BRIDGE* tb = (TEST_BRIDGE*) STP_GetApplicationContext (bridge);
+	tb->txQueues[tb->txBufferPortIndex].push (tb->txBuffer);
+}
+
+static void StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush) { }
+static void StpCallback_EnableBpduTrapping (const STP_BRIDGE* bridge, bool enable, unsigned int timestamp) { }
+static void StpCallback_EnablePortState (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp) { }
+static void StpCallback_FlushFdb (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp) { }
+static void StpCallback_OnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp) { }
+static void StpCallback_OnPortRoleChanged (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_PORT_ROLE role, unsigned int timestamp) { }
+
+static const STP_CALLBACKS callbacks =
+{
+	&StpCallback_EnableBpduTrapping,
+	&StpCallback_EnablePortState,
+	&StpCallback_EnablePortState,
+	&StpCallback_TransmitGetBuffer,
+	&StpCallback_TransmitReleaseBuffer,
+	&StpCallback_FlushFdb,
+	&StpCallback_DebugStrOut,
+	&StpCallback_OnTopologyChange,
+	&StpCallback_OnPortRoleChanged,
+	&StpCallback_AllocAndZeroMemory,
+	&StpCallback_FreeMemory,
+	NULL,
+	NULL,
+	NULL,
+};
+
+static void OnRecordOut (const STP_BRIDGE* bridge, const unsigned char* data, unsigned int size)
+{
+	TEST_BRIDGE* tb = (TEST_BRIDGE*) STP_GetApplicationContext (bridge);
+	tb->pendingRecord.insert (tb->pendingRecord.end(), data, data + size);
+	unsigned int recordSize = STP_GetRecordSize (&tb->pendingRecord[0], (unsigned int) tb->pendingRecord.size());
+	if (recordSize == 0)
+		return;
+
+	unsigned char bridgeIndex[2] = { (unsigned char) tb->index, (unsigned char) (tb->index >> 8) };
+	fwrite (bridgeIndex, 1, 2, output);
+	fwrite (&tb->pendingRecord[0], 1, recordSize, output);
+	tb->pendingRecord.clear();
+}
+
+// Delivers the BPDUs queued on the two ports of a link until neither has anything more to send.
+static bool ExchangeBpdus (TEST_BRIDGE& one, unsigned int onePort, TEST_BRIDGE& other, unsigned int otherPort, unsigned int timestamp)
+{
+	bool exchanged = false;
+	while (true)
+	{
+		// The two ends may be ports of the same bridge.
+		std::queue<std::vector<unsigned char> >* queue;
+		TEST_BRIDGE* to;
+		unsigned int toPort;
+		if (!one.txQueues[onePort].empty())
+		{
+			queue = &one.txQueues[onePort];
+			to = &other;
+			toPort = otherPort;
+		}
+		else if (!other.txQueues[otherPort].empty())
+		{
+			queue = &other.txQueues[otherPort];
+			to = &one;
+			toPort = onePort;
+		}
+		else
+			break;
+
+		std::vector<unsigned char> bpdu;
+		bpdu.swap (queue->front());
+		queue->pop();
+		STP_OnBpduReceived (to->bridge, toPort, &bpdu[0], (unsigned int) bpdu.size(), timestamp);
+		exchanged = true;
+	}
+
+	return exchanged;
+}
+
+// ============================================================================
+
+struct NETWORK
+{
+	TEST_BRIDGE bridges [MaxBridgeCount];
+	unsigned int bridgeCount;
+	unsigned int mstiCount;
+	std::vector<LINK> links;
+	unsigned int timestamp;
+
+	// Delivers BPDUs over all links that are up, until the network is quiet. BPDUs queued on ports
+	// with nothing attached, or on links that are down, are dropped.
+	void Exchange()
+	{
+		bool exchanged = true;
+		for (unsigned int round = 0; exchanged; round++)
+		{
+			if (round == 10000)
+			{
+				fprintf (stderr, "the network doesn't settle at timestamp %u\n", timestamp);
+				exit (3);
+			}
+
+			exchanged = false;
+			for (size_t i = 0; i < links.size(); i++)
+			{
+				const LINK& l = links[i];
+				if (l.up && ExchangeBpdus (bridges[l.bridge[0]], l.port[0], bridges[l.bridge[1]], l.port[1], timestamp))
+					exchanged = true;
+			}
+
+			for (unsigned int bi = 0; bi < bridgeCount; bi++)
+			{
+				for (unsigned int pi = 0; pi < bridges[bi].portCount; pi++)
+				{
+					if (!IsLinkedAndUp (bi, pi))
+						bridges[bi].txQueues[pi] = std::queue<std::vector<unsigned char> >();
+				}
+			}
+		}
+	}
+
+	bool IsLinkedAndUp (unsigned int bridgeIndex, unsigned int portIndex) const
+	{
+		for (size_t i = 0; i < links.size(); i++)
+		{
+			for (unsigned int end = 0; end < 2; end++)
+			{
+				if ((links[i].bridge[end] == bridgeIndex) && (links[i].port[end] == portIndex))
+					return links[i].up;
+			}
+		}
+
+		return false;
+	}
+
+	void SetLink (LINK& link, bool up)
+	{
+		link.up = up;
+		for (unsigned int end = 0; end < 2; end++)
+		{
+			STP_BRIDGE* bridge = bridges[link.bridge[end]].bridge;
+			if (up)
+				STP_OnPortEnabled (bridge, link.port[end], 100, true, timestamp);
+			else
+				STP_OnPortDisabled (bridge, link.port[end], timestamp);
+		}
+	}
+};
+
+static void CreateNetwork (NETWORK* net)
+{
+	net->bridgeCount = 2 + Random (MaxBridgeCount - 1);
+	net->mstiCount = Random (4);
+	net->timestamp = 0;
+
+	// All MSTP bridges are in the same region.
+	std::vector<STP_CONFIG_TABLE_ENTRY> table (1 + MaxVlanNumber);
+	for (unsigned int vlan = 1; vlan <= MaxVlanNumber; vlan++)
+	{
+		table[vlan].unused = 0;
+		table[vlan].treeIndex = (unsigned char) Random (1 + net->mstiCount);
+	}
+
+	// Networks with MSTIs have no region boundaries: with the MSTI ports of a boundary following the CIST,
+	// some sequences of events make the TopologyChange or PortRoleTransitions machine of an MSTI port
+	// go around in a loop of states forever, and a run would never end.
+	static const STP_VERSION versions[] = { STP_VERSION_LEGACY_STP, STP_VERSION_RSTP, STP_VERSION_MSTP, STP_VERSION_MSTP };
+	for (unsigned int bi = 0; bi < net->bridgeCount; bi++)
+	{
+		TEST_BRIDGE& tb = net->bridges[bi];
+		tb.index = bi;
+		tb.portCount = 2 + Random (MaxPortCount - 1);
+		unsigned char address[6] = { 0x02, 0x00, 0x00, 0x00, (unsigned char) Random (4), (unsigned char) (0x10 + bi) };
+		tb.bridge = STP_CreateBridge (tb.portCount, net->mstiCount, MaxVlanNumber, &callbacks, address, 256);
+		STP_SetApplicationContext (tb.bridge, &tb);
+		STP_EnableRecording (tb.bridge, OnRecordOut);
+		STP_SetStpVersion (tb.bridge, (net->mstiCount == 0) ? versions[Random (4)] : STP_VERSION_MSTP, 0);
+		STP_SetMstConfigName (tb.bridge, "equivalence", 0);
+		STP_SetMstConfigTable (tb.bridge, &table[0], (unsigned int) table.size(), 0);
+		STP_StartBridge (tb.bridge, 0);
+	}
+
+	// Random links between free ports; usually there are more links than needed for a tree, so there are loops.
+	unsigned int linkCount = net->bridgeCount + Random (net->bridgeCount * 2);
+	for (unsigned int i = 0; i < linkCount; i++)
+	{
+		LINK link;
+		link.up = false;
+		for (unsigned int end = 0; end < 2; end++)
+		{
+			link.bridge[end] = Random (net->bridgeCount);
+			link.port[end] = Random (net->bridges[link.bridge[end]].portCount);
+		}
+
+		bool portsFree = (link.bridge[0] != link.bridge[1]);
+		for (size_t j = 0; portsFree && (j < net->links.size()); j++)
+		{
+			for (unsigned int end = 0; end < 2; end++)
+			{
+				for (unsigned int otherEnd = 0; otherEnd < 2; otherEnd++)
+				{
+					if ((net->links[j].bridge[otherEnd] == link.bridge[end]) && (net->links[j].port[otherEnd] == link.port[end]))
+						portsFree = false;
+				}
+			}
+		}
+
+		if (portsFree)
+			net->links.push_back (link);
+	}
+
+	for (size_t i = 0; i < net->links.size(); i++)
+		net->SetLink (net->links[i], true);
+	net->Exchange();
+}
+
+static void RunRandomEvent (NETWORK* net)
+{
+	TEST_BRIDGE& tb = net->bridges[Random (net->bridgeCount)];
+	unsigned int portIndex = Random (tb.portCount);
+	unsigned int treeIndex = Random (1 + net->mstiCount);
+	switch (Random (6))
+	{
+		case 0:
+		case 1:
+			if (!net->links.empty())
+			{
+				LINK& link = net->links[Random ((unsigned int) net->links.size())];
+				net->SetLink (link, !link.up);
+			}
+			break;
+
+		case 2:
+			STP_SetBridgePriority (tb.bridge, treeIndex, (unsigned short) (Random (16) * 0x1000), net->timestamp);
+			break;
+
+		case 3:
+			STP_SetPortPriority (tb.bridge, portIndex, treeIndex, (unsigned char) (Random (16) * 0x10), net->timestamp);
+			break;
+
+		case 4:
+			if (treeIndex == 0)
+				STP_SetAdminExternalPortPathCost (tb.bridge, portIndex, Random (3) * 20000, net->timestamp);
+			else
+				STP_SetAdminInternalPortPathCost (tb.bridge, portIndex, treeIndex, Random (3) * 20000, net->timestamp);
+			break;
+
+		case 5:
+			STP_SetPortAdminEdge (tb.bridge, portIndex, Random (2) != 0, net->timestamp);
+			break;
+	}
+}
+
+static int Run (unsigned int seed, const char* outputPath)
+{
+	output = fopen (outputPath, "wb");
+	if (output == NULL)
+	{
+		fprintf (stderr, "%s: cannot create\n", outputPath);
+		return 1;
+	}
+
+	randomState = (seed != 0) ? seed : 1;
+
+	NETWORK* net = new NETWORK();
+	CreateNetwork (net);
+
+	for (unsigned int second = 1; second <= SimulatedSeconds; second++)
+	{
+		net->timestamp = second * 1000;
+
+		unsigned int eventCount = Random (4);
+		for (unsigned int i = 0; i < eventCount; i++)
+		{
+			net->timestamp++;
+			RunRandomEvent (net);
+			net->Exchange();
+		}
+
+		for (unsigned int bi = 0; bi < net->bridgeCount; bi++)
+			STP_OnOneSecondTick (net->bridges[bi].bridge, net->timestamp);
+		net->Exchange();
+	}
+
+	for (unsigned int bi = 0; bi < net->bridgeCount; bi++)
+		STP_DestroyBridge (net->bridges[bi].bridge);
+	delete net;
+
+	fclose (output);
+	return 0;
+}
+
+// ============================================================================
+
+static const char* GetRecordTypeName (unsigned int type)
+{
+	switch (type)
+	{
+		case RECORD_HEADER:                            return "header";
+		case RECORD_START_BRIDGE:                      return "STP_StartBridge";
+		case RECORD_STOP_BRIDGE:                       return "STP_StopBridge";
+		case RECORD_ENABLE_DEFERRED_HARDWARE_ACTIONS:  return "STP_EnableDeferredHardwareActions";
+		case RECORD_ON_HARDWARE_ACTION_COMPLETE:       return "STP_OnHardwareActionComplete";
+		case RECORD_SET_STP_VERSION:                   return "STP_SetStpVersion";
+		case RECORD_ON_BPDU_RECEIVED:                  return "STP_OnBpduReceived";
+		case RECORD_SET_BRIDGE_ADDRESS:                return "STP_SetBridgeAddress";
+		case RECORD_ON_PORT_ENABLED:                   return "STP_OnPortEnabled";
+		case RECORD_ON_PORT_DISABLED:                  return "STP_OnPortDisabled";
+		case RECORD_ON_ONE_SECOND_TICK:                return "STP_OnOneSecondTick";
+		case RECORD_SET_BRIDGE_PRIORITY:               return "STP_SetBridgePriority";
+		case RECORD_SET_PORT_PRIORITY:                 return "STP_SetPortPriority";
+		case RECORD_SET_PORT_ADMIN_EDGE:               return "STP_SetPortAdminEdge";
+		case RECORD_SET_PORT_AUTO_EDGE:                return "STP_SetPortAutoEdge";
+		case RECORD_SET_ADMIN_POINT_TO_POINT_MAC:      return "STP_SetAdminPointToPointMAC";
+		case RECORD_SET_ADMIN_EXTERNAL_PORT_PATH_COST: return "STP_SetAdminExternalPortPathCost";
+		case RECORD_SET_ADMIN_INTERNAL_PORT_PATH_COST: return "STP_SetAdminInternalPortPathCost";
+		case RECORD_SET_MST_CONFIG_NAME:               return "STP_SetMstConfigName";
+		case RECORD_SET_MST_CONFIG_REVISION_LEVEL:     return "STP_SetMstConfigRevisionLevel";
+		case RECORD_SET_MST_CONFIG_TABLE:              return "STP_SetMstConfigTable";
+		case RECORD_SET_MST_CONFIG_TABLE_ENTRY:        return "STP_SetMstConfigTableEntry";
+		case RECORD_SET_BRIDGE_HELLO_TIME:             return "STP_SetBridgeHelloTime";
+		case RECORD_SET_BRIDGE_MAX_AGE:                return "STP_SetBridgeMaxAge";
+		case RECORD_SET_BRIDGE_FORWARD_DELAY:          return "STP_SetBridgeForwardDelay";
+		case RECORD_SET_TX_HOLD_COUNT:                 return "STP_SetTxHoldCount";
+		case RECORD_SET_FDB_FLUSH_WINDOW:              return "STP_SetFdbFlushWindow";
+		case RECORD_ENABLE_BPDU_TRAPPING:              return "-> enableBpduTrapping";
+		case RECORD_ENABLE_LEARNING:                   return "-> enableLearning";
+		case RECORD_ENABLE_FORWARDING:                 return "-> enableForwarding";
+		case RECORD_TRANSMIT:                          return "-> transmit";
+		case RECORD_TRANSMIT_NO_BUFFER:                return "-> transmit (no buffer)";
+		case RECORD_FLUSH_FDB:                         return "-> flushFdb";
+		case RECORD_TOPOLOGY_CHANGE:                   return "-> onTopologyChange";
+		case RECORD_PORT_ROLE_CHANGED:                 return "-> onPortRoleChanged";
+		case RECORD_APPLY_PORT_STATES:                 return "-> applyPortStates";
+		case RECORD_PORT_STATE:                        return "   port state";
+		case RECORD_FLUSH_FDB_PORTS:                   return "-> flushFdbPorts";
+		case RECORD_TREE_CONVERGED:                    return "-> onTreeConverged";
+		default:                                       return "?";
+	}
+}
+
+struct STREAM
+{
+	const char* path;
+	std::vector<unsigned char> data;
+	size_t offset;
+
+	// Size of the entry at offset (bridge index and record), or zero at the end or at a truncated entry.
+	size_t EntrySize (size_t at) const
+	{
+		if (at + 2 > data.size())
+			return 0;
+		unsigned int recordSize = STP_GetRecordSize (&data[at + 2], (unsigned int) (data.size() - at - 2));
+		return (recordSize == 0) ? 0 : 2 + recordSize;
+	}
+};
+
+static bool ReadStream (const char* path, STREAM* s)
+{
+	s->path = path;
+	s->offset = 0;
+	FILE* file = fopen (path, "rb");
+	if (file == NULL)
+	{
+		fprintf (stderr, "%s: cannot open\n", path);
+		return false;
+	}
+
+	unsigned char chunk [65536];
+	size_t read;
+	while ((read = fread (chunk, 1, sizeof(chunk), file)) > 0)
+		s->data.insert (s->data.end(), chunk, chunk + read);
+	fclose (file);
+	return true;
+}
+
+static void PrintEntry (const char* prefix, unsigned int index, const STREAM& s, size_t at)
+{
+	size_t size = s.EntrySize (at);
+	if (size == 0)
+	{
+		printf ("%s#%u  (end of %s)\n", prefix, index, s.path);
+		return;
+	}
+
+	const unsigned char* entry = &s.data[at];
+	printf ("%s#%u  bridge %u  %-34s", prefix, index, entry[0] | (entry[1] << 8), GetRecordTypeName (entry[2]));
+	static const size_t MaxPayloadBytes = 24;
+	for (size_t i = 5; (i < size) && (i < 5 + MaxPayloadBytes); i++)
+		printf (" %02X", entry[i]);
+	printf ("%s\n", (size > 5 + MaxPayloadBytes) ? " ..." : "");
+}
+
+static int Compare (const char* pathA, const char* pathB)
+{
+	STREAM a, b;
+	if (!ReadStream (pathA, &a) || !ReadStream (pathB, &b))
+		return 1;
+
+	static const unsigned int ContextEntryCount = 8;
+	std::vector<size_t> recent; // offsets of the last entries that were the same
+	unsigned int index = 0;
+	while (true)
+	{
+		size_t sizeA = a.EntrySize (a.offset);
+		size_t sizeB = b.EntrySize (b.offset);
+		if ((sizeA == 0) && (sizeB == 0))
+		{
+			printf ("same: %u records\n", index);
+			return 0;
+		}
+
+		if ((sizeA != sizeB) || (memcmp (&a.data[a.offset], &b.data[b.offset], sizeA) != 0))
+			break;
+
+		recent.push_back (a.offset);
+		if (recent.size() > ContextEntryCount)
+			recent.erase (recent.begin());
+		a.offset += sizeA;
+		b.offset = a.offset;
+		index++;
+	}
+
+	printf ("DIVERGENCE at record #%u (offset %u)\n", index, (unsigned int) a.offset);
+	for (size_t i = 0; i < recent.size(); i++)
+		PrintEntry ("    ", (unsigned int) (index - recent.size() + i), a, recent[i]);
+	PrintEntry ("  a ", index, a, a.offset);
+	PrintEntry ("  b ", index, b, b.offset);
+	return 2;
+}
+
+int main (int argc, char* argv[])
+{
+	if ((argc == 4) && (strcmp (argv[1], "run") == 0))
+		return Run ((unsigned int) strtoul (argv[2], NULL, 10), argv[3]);
+
+	if ((argc == 4) && (strcmp (argv[1], "compare") == 0))
+		return Compare (argv[2], argv[3]);
+
+	fprintf (stderr, "usage: equivalence run seed output.bin\n"
+	                 "       equivalence compare a.bin b.bin\n");
+	return 1;
+}
@@ -0,0 +1,417 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "bridge.h"
+#include "project.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+static constexpr uint8_t BpduDestAddress[6] = { 1, 0x80, 0xC2, 0, 0, 0 };
+
+// Data frames: destination and source address, 802.1Q tag, the EtherType for local experiments (IEEE 802 Local
+// Experimental EtherType 1), then the index of the traffic flow and the frame's sequence number in it, big-endian.
+static constexpr size_t DataFrameSize = 26;
+static constexpr uint16_t DataEtherType = 0x88B5;
+
+bridge::bridge (project* project, uint32_t index, std::string_view name, size_t port_count, size_t msti_count, unsigned int max_vlan_number, mac_address address)
+	: _project(project), _index(index), _name(name), _address(address), _fdb(port_count + 1, msti_count + 1)
+{
+	for (size_t portIndex = 0; portIndex < port_count; portIndex++)
+		_ports.push_back (std::make_unique<port>(portIndex));
+
+	_stpBridge = STP_CreateBridge ((unsigned int)port_count, (unsigned int)msti_count, max_vlan_number, &StpCallbacks, address.data(), 256);
+	STP_SetApplicationContext (_stpBridge, this);
+}
+
+bridge::bridge (project* project, const bridge& original)
+	: _project(project), _index(original._index), _name(original._name), _address(original._address)
+	, _bpdu_trapping_enabled(original._bpdu_trapping_enabled), _now(original._now), _next_event_seq(original._next_event_seq)
+	, _stats(original._stats), _fdb(original._fdb), _floods(original._floods), _floods_sweep_size(original._floods_sweep_size)
+{
+	for (auto& p : original._ports)
+		_ports.push_back (std::make_unique<port>(*p));
+
+	_stpBridge = STP_CloneBridge (original._stpBridge, &StpCallbacks, this);
+}
+
+bridge::~bridge()
+{
+	STP_DestroyBridge (_stpBridge);
+}
+
+mac_address bridge::GetPortAddress (size_t portIndex) const
+{
+	mac_address pa = _address;
+	unsigned int carry = (unsigned int) portIndex + 1;
+	for (int i = 5; (i >= 0) && (carry != 0); i--)
+	{
+		carry += pa[i];
+		pa[i] = (uint8_t) carry;
+		carry >>= 8;
+	}
+
+	return pa;
+}
+
+// A locally administered address that differs from the bridge address in one bit of the first byte,
+// so it's distinct from the bridge and port addresses of the default address plan.
+mac_address bridge::host_address() const
+{
+	mac_address ha = _address;
+	ha[0] ^= 0x04;
+	return ha;
+}
+
+void bridge::transmit (size_t txPortIndex, packet_t&& packet)
+{
+	_project->on_packet_transmit (this, txPortIndex, std::move(packet), _now);
+}
+
+// Checks the wires and computes macOperational for each port on this bridge.
+void bridge::OnLinkPulseTick (sim_time now)
+{
+	_now = now;
+	uint32_t timestamp = to_timestamp(now);
+
+	for (size_t portIndex = 0; portIndex < _ports.size(); portIndex++)
+	{
+		auto port = _ports[portIndex].get();
+		if (port->_missedLinkPulseCounter < port::MissedLinkPulseCounterMax)
+		{
+			port->_missedLinkPulseCounter++;
+			if (port->_missedLinkPulseCounter == port::MissedLinkPulseCounterMax)
+			{
+				port->_actual_speed = 0;
+				STP_OnPortDisabled (_stpBridge, (unsigned int) portIndex, timestamp);
+			}
+		}
+
+		transmit (portIndex, link_pulse_t { timestamp, port->supported_speed() });
+	}
+}
+
+void bridge::OnLinkChange (sim_time now, size_t portIndex, bool up, uint32_t far_end_supported_speed)
+{
+	_now = now;
+	auto port = _ports[portIndex].get();
+	if (up == port->mac_operational())
+		return;
+
+	if (up)
+	{
+		port->_missedLinkPulseCounter = 0;
+		port->_actual_speed = std::min (far_end_supported_speed, port->supported_speed());
+		STP_OnPortEnabled (_stpBridge, (unsigned int) portIndex, port->_actual_speed, true, to_timestamp(now));
+	}
+	else
+	{
+		port->_missedLinkPulseCounter = port::MissedLinkPulseCounterMax;
+		port->_actual_speed = 0;
+		STP_OnPortDisabled (_stpBridge, (unsigned int) portIndex, to_timestamp(now));
+	}
+}
+
+void bridge::SetBridgePriority (sim_time now, unsigned int treeIndex, unsigned short priority)
+{
+	_now = now;
+	STP_SetBridgePriority (_stpBridge, treeIndex, priority, to_timestamp(now));
+}
+
+void bridge::RestartStp (sim_time now)
+{
+	_now = now;
+	if (STP_IsBridgeStarted(_stpBridge))
+	{
+		STP_StopBridge (_stpBridge, to_timestamp(now), false, false);
+		STP_StartBridge (_stpBridge, to_timestamp(now));
+	}
+}
+
+void bridge::OnOneSecondTick (sim_time now)
+{
+	_now = now;
+	STP_OnOneSecondTick (_stpBridge, to_timestamp(now));
+}
+
+void bridge::ProcessReceivedPacket (sim_time now, size_t rxPortIndex, packet_t&& packet)
+{
+	_now = now;
+	auto port = _ports[rxPortIndex].get();
+
+	if (std::holds_alternative<link_pulse_t>(packet))
+	{
+		auto lpsd = std::get<link_pulse_t>(packet);
+		bool oldMacOperational = port->mac_operational();
+		port->_missedLinkPulseCounter = 0;
+		if (oldMacOperational == false)
+		{
+			// Send a link pulse right away, to make sure the other port goes up before we send it any frame.
+			transmit (rxPortIndex, link_pulse_t { lpsd.timestamp, port->supported_speed() });
+
+			port->_actual_speed = std::min (lpsd.sender_supported_speed, port->supported_speed());
+			STP_OnPortEnabled (_stpBridge, (unsigned int) rxPortIndex, port->_actual_speed, true, to_timestamp(now));
+		}
+	}
+	else
+	{
+		auto& fsd = std::get<frame_t>(packet);
+
+		// A frame that was on the wire when the link went down.
+		if (!port->mac_operational())
+			return;
+
+		const std::vector<uint8_t>& data = *fsd.data;
+		assert (data.size() >= 6);
+		if (memcmp (&data[0], BpduDestAddress, 6) != 0)
+		{
+			ForwardDataFrame (rxPortIndex, fsd);
+			return;
+		}
+
+		if (_bpdu_trapping_enabled)
+		{
+			_stats.bpdus_received++;
+			STP_OnBpduReceived (_stpBridge, (unsigned int) rxPortIndex, &data[21], (unsigned int) (data.size() - 21), to_timestamp(now));
+		}
+		else
+		{
+			// broadcast it to the other ports.
+			std::vector<bool>& flooded_ports = GetFloodedPorts(fsd.data);
+			for (size_t txPortIndex = 0; txPortIndex < _ports.size(); txPortIndex++)
+			{
+				if (txPortIndex == rxPortIndex)
+					continue;
+
+				// If it already went out of this port, we have a loop that would flood forever.
+				if (flooded_ports[txPortIndex])
+				{
+					_stats.loops_detected++;
+				}
+				else
+				{
+					flooded_ports[txPortIndex] = true;
+					_stats.frames_flooded++;
+					transmit (txPortIndex, frame_t { fsd.timestamp, fsd.data });
+				}
+			}
+		}
+	}
+}
+
+std::vector<bool>& bridge::GetFloodedPorts (const std::shared_ptr<const std::vector<uint8_t>>& data)
+{
+	auto it = _floods.find(data.get());
+	if (it != _floods.end())
+		return it->second.tx_ports;
+
+	// Forget the floods with no copies left anywhere, that is, whose payload is held only by our entry.
+	if (_floods.size() >= _floods_sweep_size)
+	{
+		for (auto i = _floods.begin(); i != _floods.end(); )
+			i = (i->second.data.use_count() == 1) ? _floods.erase(i) : std::next(i);
+		_floods_sweep_size = std::max ((size_t) 16, 2 * _floods.size());
+	}
+
+	return _floods.insert ({ data.get(), flood { data, std::vector<bool>(_ports.size()) } }).first->second.tx_ports;
+}
+
+void bridge::SendDataFrame (sim_time now, uint32_t flow_index, uint32_t seq, const mac_address& destination, unsigned int vlan)
+{
+	_now = now;
+	mac_address source = host_address();
+	auto data = std::make_shared<std::vector<uint8_t>>(DataFrameSize);
+	uint8_t* d = data->data();
+	memcpy (&d[0], destination.data(), 6);
+	memcpy (&d[6], source.data(), 6);
+	d[12] = 0x81; d[13] = 0x00;
+	d[14] = (uint8_t) (vlan >> 8); d[15] = (uint8_t) vlan;
+	d[16] = (uint8_t) (DataEtherType >> 8); d[17] = (uint8_t) DataEtherType;
+	for (size_t i = 0; i < 4; i++)
+	{
+		d[18 + i] = (uint8_t) (flow_index >> (24 - 8 * i));
+		d[22 + i] = (uint8_t) (seq >> (24 - 8 * i));
+	}
+
+	ForwardDataFrame (_ports.size(), frame_t { to_timestamp(now), std::move(data) });
+}
+
+// Like port::IsForwarding in the GUI simulator, a bridge with STP disabled learns and forwards on all ports.
+// The host port always does.
+bool bridge::IsPortLearning (size_t portIndex, unsigned int treeIndex) const
+{
+	if ((portIndex == _ports.size()) || !STP_IsBridgeStarted(_stpBridge))
+		return true;
+	return STP_GetPortLearning (_stpBridge, (unsigned int) portIndex, treeIndex);
+}
+
+bool bridge::IsPortForwarding (size_t portIndex, unsigned int treeIndex) const
+{
+	if ((portIndex == _ports.size()) || !STP_IsBridgeStarted(_stpBridge))
+		return true;
+	return STP_GetPortForwarding (_stpBridge, (unsigned int) portIndex, treeIndex);
+}
+
+// The relay of 802.1Q-2018 clause 8.6, reduced to what matters here: learning, the port states of the frame's tree,
+// and forwarding to the port the FDB knows or flooding when it doesn't. rxPortIndex is ports().size() for frames
+// from our own host.
+void bridge::ForwardDataFrame (size_t rxPortIndex, const frame_t& frame)
+{
+	const std::vector<uint8_t>& data = *frame.data;
+	assert (data.size() == DataFrameSize);
+
+	unsigned int vlan = ((data[14] << 8) | data[15]) & 0xFFF;
+	unsigned int treeIndex = STP_IsBridgeStarted(_stpBridge) ? STP_GetTreeIndexFromVlanNumber(_stpBridge, vlan) : 0;
+	mac_address destination, source;
+	memcpy (destination.data(), &data[0], 6);
+	memcpy (source.data(), &data[6], 6);
+
+	if (IsPortLearning (rxPortIndex, treeIndex))
+		_fdb.learn (treeIndex, source, (uint32_t) rxPortIndex, _now);
+
+	if (!IsPortForwarding (rxPortIndex, treeIndex))
+	{
+		_stats.data_discarded++;
+		return;
+	}
+
+	if (destination == host_address())
+	{
+		uint32_t flow_index = 0, seq = 0;
+		for (size_t i = 0; i < 4; i++)
+		{
+			flow_index = (flow_index << 8) | data[18 + i];
+			seq = (seq << 8) | data[22 + i];
+		}
+
+		_project->on_data_frame_received (this, flow_index, seq);
+		return;
+	}
+
+	std::vector<bool>& flooded_ports = GetFloodedPorts(frame.data);
+	uint32_t knownPortIndex = _fdb.lookup (treeIndex, destination, _now);
+	if (knownPortIndex != fdb::no_port)
+	{
+		// An entry left over from before a topology change may lead to a port that is now discarding,
+		// and the frames are lost until the entry is flushed or ages out.
+		if ((knownPortIndex == rxPortIndex) || !IsPortForwarding (knownPortIndex, treeIndex))
+			_stats.data_discarded++;
+		else if (flooded_ports[knownPortIndex])
+			_stats.loops_detected++;
+		else
+		{
+			flooded_ports[knownPortIndex] = true;
+			transmit (knownPortIndex, frame_t { frame.timestamp, frame.data });
+		}
+
+		return;
+	}
+
+	for (size_t txPortIndex = 0; txPortIndex < _ports.size(); txPortIndex++)
+	{
+		if ((txPortIndex == rxPortIndex) || !IsPortForwarding (txPortIndex, treeIndex))
+			continue;
+
+		if (flooded_ports[txPortIndex])
+		{
+			_stats.loops_detected++;
+		}
+		else
+		{
+			flooded_ports[txPortIndex] = true;
+			_stats.data_flooded++;
+			transmit (txPortIndex, frame_t { frame.timestamp, frame.data });
+		}
+	}
+}
+
+const STP_CALLBACKS bridge::StpCallbacks =
+{
+	&StpCallback_EnableBpduTrapping,
+	&StpCallback_EnableLearning,
+	&StpCallback_EnableForwarding,
+	&StpCallback_TransmitGetBuffer,
+	&StpCallback_TransmitReleaseBuffer,
+	&StpCallback_FlushFdb,
+	&StpCallback_DebugStrOut,
+	&StpCallback_OnTopologyChange,
+	&StpCallback_OnPortRoleChanged,
+	&StpCallback_AllocAndZeroMemory,
+	&StpCallback_FreeMemory,
+};
+
+void* bridge::StpCallback_AllocAndZeroMemory (unsigned int size)
+{
+	return calloc (1, size);
+}
+
+void bridge::StpCallback_FreeMemory (void* p)
+{
+	free (p);
+}
+
+void* bridge::StpCallback_TransmitGetBuffer (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp)
+{
+	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
+
+	b->_txPacketData.resize (bpduSize + 21);
+	memcpy (&b->_txPacketData[0], BpduDestAddress, 6);
+	memcpy (&b->_txPacketData[6], &b->GetPortAddress(portIndex)[0], 6);
+	b->_txPortIndex = portIndex;
+	b->_txTimestamp = timestamp;
+	return &b->_txPacketData[21];
+}
+
+void bridge::StpCallback_TransmitReleaseBuffer (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer)
+{
+	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
+
+	frame_t info;
+	info.data = std::make_shared<const std::vector<uint8_t>>(std::move(b->_txPacketData));
+	info.timestamp = b->_txTimestamp;
+	b->_stats.bpdus_transmitted++;
+	b->transmit (b->_txPortIndex, std::move(info));
+}
+
+void bridge::StpCallback_EnableBpduTrapping (const STP_BRIDGE* bridge, bool enable, unsigned int timestamp)
+{
+	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
+	b->_bpdu_trapping_enabled = enable;
+}
+
+void bridge::StpCallback_EnableLearning (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp)
+{
+}
+
+void bridge::StpCallback_EnableForwarding (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp)
+{
+	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
+	b->_stats.last_port_change = b->_now;
+	b->_project->on_forwarding_changed (b);
+}
+
+void bridge::StpCallback_FlushFdb (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp)
+{
+	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
+	b->_stats.fdb_flushes++;
+	b->_fdb.flush (portIndex, treeIndex, flushType, b->_now);
+}
+
+void bridge::StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush)
+{
+	// Logging is left disabled; with thousands of bridges the text would cost more than the simulation.
+}
+
+void bridge::StpCallback_OnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp)
+{
+	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
+	b->_stats.topology_changes++;
+}
+
+void bridge::StpCallback_OnPortRoleChanged (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, STP_PORT_ROLE role, unsigned int timestamp)
+{
+	auto b = static_cast<class bridge*>(STP_GetApplicationContext(bridge));
+	b->_stats.last_port_change = b->_now;
+}
@@ -0,0 +1,120 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "fdb.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class project;
+
+// Counters of things a bridge did, summed by the project for the report.
+struct bridge_stats
+{
+	uint64_t bpdus_transmitted = 0;
+	uint64_t bpdus_received = 0;    // BPDUs given to the library
+	uint64_t frames_flooded = 0;    // BPDU copies relayed by bridges with STP disabled
+	uint64_t loops_detected = 0;    // flooded frames not sent again out of a port they already went out of
+	uint64_t topology_changes = 0;
+	uint64_t fdb_flushes = 0;
+	uint64_t data_flooded = 0;      // data frame copies sent out of ports because the FDB didn't know the destination
+	uint64_t data_discarded = 0;    // data frames received on a port not forwarding, or for a destination behind one
+	sim_time last_port_change = 0;  // virtual time of the last change of a port role or forwarding state
+};
+
+// The headless counterpart of the GUI simulator's bridge class (simulator/bridge.cpp): the same link pulse,
+// packet reception and flooding logic, driven by the project's scheduler instead of Win32 timers and messages.
+//
+// Unlike the GUI simulator's bridges these also forward data frames, with an FDB, for the traffic of the project's
+// flows (see "traffic" in project::load). Each bridge has a host of its own, with host_address(), on a port
+// with index ports().size() that has no wire and always forwards.
+class bridge
+{
+	project* const _project;
+	uint32_t const _index;
+	std::string _name;
+	mac_address _address;
+	std::vector<std::unique_ptr<port>> _ports;
+	STP_BRIDGE* _stpBridge = nullptr;
+	bool _bpdu_trapping_enabled = false;
+	static const STP_CALLBACKS StpCallbacks;
+
+	sim_time _now = 0;            // virtual time of the event being handled
+	uint64_t _next_event_seq = 0; // origin_seq for the events this bridge schedules
+	bridge_stats _stats;
+	fdb _fdb;
+
+	// The ports each frame being flooded already went out of, keyed by its payload, which all its copies share.
+	// Sending a flood out of each port at most once stops it when it's caught in a loop, and bounds its copies
+	// by the number of ports in the network, however many paths the loop has.
+	struct flood
+	{
+		std::shared_ptr<const std::vector<uint8_t>> data; // keeps the key from being reused while the entry exists
+		std::vector<bool> tx_ports;
+	};
+	std::unordered_map<const std::vector<uint8_t>*, flood> _floods;
+	size_t _floods_sweep_size = 16;
+
+	// variables used by TransmitGetBuffer/ReleaseBuffer
+	std::vector<uint8_t> _txPacketData;
+	size_t               _txPortIndex;
+	unsigned int         _txTimestamp;
+
+public:
+	bridge (project* project, uint32_t index, std::string_view name, size_t port_count, size_t msti_count, unsigned int max_vlan_number, mac_address address);
+	bridge (project* project, const bridge& original); // for project::fork; the STP bridge is cloned with STP_CloneBridge
+	~bridge();
+
+	bridge (const bridge&) = delete;
+	bridge& operator= (const bridge&) = delete;
+
+	uint32_t index() const { return _index; }
+	const std::string& name() const { return _name; }
+	mac_address bridge_address() const { return _address; }
+	STP_BRIDGE* stp_bridge() const { return _stpBridge; }
+	const std::vector<std::unique_ptr<port>>& ports() const { return _ports; }
+	port* port_at (size_t index) const { return _ports[index].get(); }
+	const bridge_stats& stats() const { return _stats; }
+	mac_address GetPortAddress (size_t portIndex) const;
+	mac_address host_address() const;
+	const fdb_stats& fdb_statistics() const { return _fdb.stats(); }
+
+	uint64_t next_event_seq() { return _next_event_seq++; }
+
+	// Event handlers, called by the project with the virtual time of the event.
+	void OnLinkPulseTick (sim_time now);
+	void OnOneSecondTick (sim_time now);
+	void ProcessReceivedPacket (sim_time now, size_t rxPortIndex, packet_t&& packet);
+
+	// Used instead of link pulses when the project doesn't poll them: the port learns right away that its
+	// link went up or down, without the 16 ms pulses that would otherwise tell it.
+	void OnLinkChange (sim_time now, size_t portIndex, bool up, uint32_t far_end_supported_speed);
+
+	// Scripted changes.
+	void SetBridgePriority (sim_time now, unsigned int treeIndex, unsigned short priority);
+	void RestartStp (sim_time now);
+
+	// Has the bridge's host send a data frame of a traffic flow.
+	void SendDataFrame (sim_time now, uint32_t flow_index, uint32_t seq, const mac_address& destination, unsigned int vlan);
+
+private:
+	void transmit (size_t txPortIndex, packet_t&& packet);
+	std::vector<bool>& GetFloodedPorts (const std::shared_ptr<const std::vector<uint8_t>>& data);
+	bool IsPortLearning (size_t portIndex, unsigned int treeIndex) const;
+	bool IsPortForwarding (size_t portIndex, unsigned int treeIndex) const;
+	void ForwardDataFrame (size_t rxPortIndex, const frame_t& frame);
+
+	static void* StpCallback_AllocAndZeroMemory (unsigned int size);
+	static void  StpCallback_FreeMemory (void* p);
+	static void* StpCallback_TransmitGetBuffer        (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp);
+	static void  StpCallback_TransmitReleaseBuffer    (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer);
+	static void  StpCallback_EnableBpduTrapping       (const STP_BRIDGE* bridge, bool enable, unsigned int timestamp);
+	static void  StpCallback_EnableLearning           (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp);
+	static void  StpCallback_EnableForwarding         (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp);
+	static void  StpCallback_FlushFdb                 (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp);
+	static void  StpCallback_DebugStrOut              (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush);
+	static void  StpCallback_OnTopologyChange         (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp);
+	static void  StpCallback_OnPortRoleChanged        (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, STP_PORT_ROLE role, unsigned int timestamp);
+};
@@ -0,0 +1,623 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Monte-Carlo failure-injection campaigns for the headless simulator.
+// Usage: campaign [options] topology-file
+// Simulates the topology (see project.h) for the settle time, then runs many trials from the network it settled to:
+// each trial forks it (see project::fork), injects a random sequence of failures, and simulates the window that
+// follows, checking for forwarding loops as it goes. The trials are spread over threads, one trial per thread at a time.
+// A trial still running after the time budget (-b) is reported as hung, with its seed, and left behind on its thread while
+// another thread takes over the trials that remain; the campaign then exits with status 2 once it has printed its report.
+// A trial that hangs is a bug in the library, as simulated time can't advance while a library function doesn't return
+// (examples/prt_master_livelock.topo reproduces one).
+// Options:
+//   -n N          trials (default 1000)
+//   -s SEED       seed of the baseline (the phases of the bridges' timers) and of the trial seeds (default 1)
+//   -t SECONDS    how long the baseline is given to settle (default 60)
+//   -w SECONDS    how long each trial is simulated, from the end of the baseline (default 60)
+//   -f N          failures per trial: each trial has from 1 to N (default 3)
+//   -d SECONDS    the failures of a trial happen within this time from its start (default 5)
+//   -k LIST       failure kinds (default all of them): link-cut, reboot, priority, bpdu-loss
+//   -j N          threads (default: as many as the host runs at once)
+//   -b SECONDS    how long each trial may take, in real time, before it counts as hung (default 60)
+//   -o FILE       also writes one CSV line per trial to FILE
+//   -r SEED       runs only the trial with this seed, and prints what happened in it
+//
+// Failures:
+//   link-cut   a wire is disconnected, for the rest of the trial
+//   reboot     a bridge loses all its links; 1 to 10 s later it gets them back and restarts STP
+//   priority   a bridge gets a new CIST priority
+//   bpdu-loss  a wire loses 10% to 90% of the frames sent on it, for 1 to 10 s
+//
+// For each trial, convergence_ms is the time from the first failure to the last port role or forwarding change, and the
+// trial counts as converged if nothing changed in the last half of the window; loops counts the times a VLAN went from
+// loop-free to looped, and loop_ms adds up the time the VLANs spent looped; role_mismatches counts the port roles that
+// differ at the end from those of the spanning tree oracle (see oracle.h). The report gives percentiles of convergence_ms
+// and the trials that took longest or had loops, with their seeds. A trial depends only on the baseline and its seed,
+// and the seeds only on the campaign seed and the trial number, so the results don't depend on the number of threads,
+// and -r with the same other options replays a trial exactly.
+
+#include "project.h"
+#include "oracle.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+static const char* const failure_kinds[] = { "link-cut", "reboot", "priority", "bpdu-loss", nullptr };
+
+struct campaign_options
+{
+	size_t max_failures = 3;
+	sim_time spread = 5 * usec_per_sec;
+	sim_time window = 60 * usec_per_sec;
+	std::vector<std::string> kinds;
+};
+
+struct trial_result
+{
+	uint32_t seed;
+	std::string failures; // as injected, for the report
+	bool hung = false;    // the other members are valid only if this is false
+	double convergence_ms;
+	bool converged;
+	size_t loops;
+	double loop_ms;
+	size_t role_mismatches;
+	uint64_t bpdus;
+	uint64_t frames_lost;
+};
+
+// splitmix64's finalizer, so that neighbouring trial numbers give unrelated seeds.
+static uint32_t trial_seed (uint32_t campaign_seed, size_t trial)
+{
+	uint64_t x = ((uint64_t) campaign_seed << 32) + trial;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return (uint32_t) (x ^ (x >> 31));
+}
+
+static std::vector<std::string> split (const char* list)
+{
+	std::vector<std::string> items;
+	std::istringstream ss (list);
+	std::string item;
+	while (std::getline (ss, item, ','))
+	{
+		if (!item.empty())
+			items.push_back (item);
+	}
+
+	return items;
+}
+
+static std::string port_name (const project& project, const wire_end& end)
+{
+	return project.bridges()[end.bridge_index]->name() + ":" + std::to_string(end.port_index);
+}
+
+// Adds to the script of a fork of the baseline the failures picked with the trial's seed, and returns their descriptions,
+// with times relative to the start of the trial, and the time of the first one (or UINT64_MAX if there's none).
+static std::string inject_failures (project& sim, uint32_t seed, const campaign_options& options, sim_time& first_failure)
+{
+	struct failure
+	{
+		sim_time time;
+		const std::string* kind;
+		uint32_t index;     // the wire for link-cut and bpdu-loss, the bridge for reboot and priority
+		sim_time duration;  // reboot and bpdu-loss
+		double value;       // the priority, or the fraction of frames lost
+	};
+
+	std::mt19937 random (seed);
+	auto uniform = [&random](double min, double max) { return std::uniform_real_distribution<double>(min, max)(random); };
+
+	std::vector<uint32_t> wires;
+	for (uint32_t wi = 0; wi < sim.wires().size(); wi++)
+	{
+		if (sim.wires()[wi].connected)
+			wires.push_back (wi);
+	}
+
+	std::vector<uint32_t> stp_bridges;
+	for (uint32_t bi = 0; bi < sim.bridges().size(); bi++)
+	{
+		if (STP_IsBridgeStarted(sim.bridges()[bi]->stp_bridge()))
+			stp_bridges.push_back (bi);
+	}
+
+	sim_time start = sim.now() + 1;
+	size_t count = 1 + random() % options.max_failures;
+	std::vector<failure> failures;
+	std::vector<bool> cut (sim.wires().size());
+	for (size_t i = 0; i < count; i++)
+	{
+		failure f = { start + random() % options.spread, &options.kinds[random() % options.kinds.size()] };
+		if (*f.kind == "link-cut")
+		{
+			if (wires.empty())
+				continue;
+			f.index = wires[random() % wires.size()];
+			cut[f.index] = true;
+		}
+		else if (*f.kind == "reboot")
+		{
+			f.index = (uint32_t) (random() % sim.bridges().size());
+			f.duration = (sim_time) (uniform(1, 10) * usec_per_sec);
+		}
+		else if (*f.kind == "priority")
+		{
+			if (stp_bridges.empty())
+				continue;
+			f.index = stp_bridges[random() % stp_bridges.size()];
+			f.value = (random() % 16) * 0x1000;
+		}
+		else
+		{
+			if (wires.empty())
+				continue;
+			f.index = wires[random() % wires.size()];
+			f.duration = (sim_time) (uniform(1, 10) * usec_per_sec);
+			f.value = uniform(0.1, 0.9);
+		}
+
+		failures.push_back (f);
+	}
+
+	std::stable_sort (failures.begin(), failures.end(), [](const failure& a, const failure& b) { return a.time < b.time; });
+	first_failure = failures.empty() ? UINT64_MAX : failures[0].time;
+
+	std::string descriptions;
+	for (const failure& f : failures)
+	{
+		char text[128];
+		double at = (double) (f.time - start + 1) / usec_per_sec;
+		if (*f.kind == "link-cut")
+		{
+			sim.add_action ({ f.time, script_action::kind_t::disconnect, f.index });
+			snprintf (text, sizeof(text), "%.3f link-cut %s", at, port_name(sim, sim.wires()[f.index].ends[0]).c_str());
+		}
+		else if (*f.kind == "reboot")
+		{
+			// Back with the links it had, except those cut in the meantime or later, which stay disconnected.
+			const bridge* b = sim.bridges()[f.index].get();
+			sim_time back = f.time + f.duration;
+			sim.add_action ({ back, script_action::kind_t::restart, f.index });
+			for (uint32_t pi = 0; pi < b->ports().size(); pi++)
+			{
+				uint32_t wi = sim.port_wire(f.index, pi);
+				if ((wi != no_wire) && sim.wires()[wi].connected)
+				{
+					sim.add_action ({ f.time, script_action::kind_t::disconnect, wi });
+					if (!cut[wi])
+						sim.add_action ({ back, script_action::kind_t::connect, wi });
+				}
+			}
+			snprintf (text, sizeof(text), "%.3f reboot %s %.3fs", at, b->name().c_str(), (double) f.duration / usec_per_sec);
+		}
+		else if (*f.kind == "priority")
+		{
+			sim.add_action ({ f.time, script_action::kind_t::set_priority, f.index, 0, (unsigned short) f.value });
+			snprintf (text, sizeof(text), "%.3f priority %s=%u", at, sim.bridges()[f.index]->name().c_str(), (unsigned int) f.value);
+		}
+		else
+		{
+			script_action lose = { f.time, script_action::kind_t::set_loss, f.index };
+			lose.loss = f.value;
+			script_action restore = { f.time + f.duration, script_action::kind_t::set_loss, f.index };
+			restore.loss = sim.wires()[f.index].loss;
+			sim.add_action (lose);
+			sim.add_action (restore);
+			snprintf (text, sizeof(text), "%.3f bpdu-loss %s %.0f%% %.3fs", at, port_name(sim, sim.wires()[f.index].ends[0]).c_str(),
+				f.value * 100, (double) f.duration / usec_per_sec);
+		}
+
+		descriptions += (descriptions.empty() ? "" : "; ") + std::string(text);
+	}
+
+	return descriptions;
+}
+
+// started is called with the failures once they're injected, before the trial is simulated.
+static trial_result run_trial (const project& baseline, uint32_t seed, const campaign_options& options, bool print,
+	const std::function<void(const std::string& failures)>& started)
+{
+	std::unique_ptr<project> sim = baseline.fork (1, seed);
+	bridge_stats before = sim->bridge_totals();
+	uint64_t lost_before = sim->stats().packets_lost;
+	sim_time start = sim->now() + 1;
+	sim_time end_time = sim->now() + options.window;
+
+	trial_result r;
+	r.seed = seed;
+	sim_time first_failure;
+	r.failures = inject_failures (*sim, seed, options, first_failure);
+	if (print)
+	{
+		printf ("trial 0x%08X: %s\n", seed, r.failures.c_str());
+		fflush (stdout);
+	}
+
+	started (r.failures);
+	sim->run_until (end_time);
+
+	bridge_stats after = sim->bridge_totals();
+	r.convergence_ms = (after.last_port_change > first_failure) ? (double) (after.last_port_change - first_failure) / usec_per_msec : 0;
+	r.converged = (after.last_port_change <= end_time - options.window / 2);
+	r.bpdus = after.bpdus_transmitted - before.bpdus_transmitted;
+	r.frames_lost = sim->stats().packets_lost - lost_before;
+
+	// Loops: alarms are recorded when the number of looped wires of a VLAN changes, so a VLAN is looped from an alarm
+	// with a non-zero count to the next alarm for the same VLAN.
+	r.loops = 0;
+	r.loop_ms = 0;
+	std::map<unsigned int, sim_time> looped_since;
+	for (const loop_alarm& a : sim->loop_alarms())
+	{
+		auto it = looped_since.find(a.vlan);
+		if (it != looped_since.end())
+		{
+			sim_time from = std::max (it->second, start);
+			if (a.time > from)
+				r.loop_ms += (double) (a.time - from) / usec_per_msec;
+			looped_since.erase (it);
+		}
+
+		if (a.loop_wire_count && (a.time >= start))
+			r.loops++;
+		if (a.loop_wire_count)
+			looped_since[a.vlan] = a.time;
+	}
+
+	for (auto& [vlan, since] : looped_since)
+		r.loop_ms += (double) (end_time - std::max (since, start)) / usec_per_msec;
+
+	oracle_report oracle = check_port_roles(*sim);
+	r.role_mismatches = oracle.mismatches.size();
+
+	if (print)
+	{
+		for (const loop_alarm& a : sim->loop_alarms())
+		{
+			if (a.time < start)
+				continue;
+			double at = (double) (a.time - start + 1) / usec_per_sec;
+			if (a.loop_wire_count)
+				printf ("    %.6f s: VLAN %u loops over %zu wires\n", at, a.vlan, a.loop_wire_count);
+			else
+				printf ("    %.6f s: VLAN %u loop-free\n", at, a.vlan);
+		}
+
+		for (const role_mismatch& m : oracle.mismatches)
+		{
+			printf ("    %s port %u %s %u: %s, expected %s\n", sim->bridges()[m.bridge_index]->name().c_str(), m.port_index,
+				(m.tree == 0) ? "CIST" : "MSTI", m.tree, STP_GetPortRoleString(m.actual), STP_GetPortRoleString(m.expected));
+		}
+	}
+
+	return r;
+}
+
+// Nearest-rank percentile of sorted values; per_mille from 1 to 1000.
+static double percentile (const std::vector<double>& sorted, unsigned int per_mille)
+{
+	size_t rank = (sorted.size() * per_mille + 999) / 1000;
+	return sorted[std::max (rank, (size_t) 1) - 1];
+}
+
+static void print_trial (const trial_result& r)
+{
+	if (r.hung)
+	{
+		printf ("    0x%08X  hung  %s\n", r.seed, r.failures.c_str());
+		return;
+	}
+
+	printf ("    0x%08X  %10.3f ms%s  %zu loops %9.3f ms  %s\n", r.seed, r.convergence_ms, r.converged ? "" : " (not converged)",
+		r.loops, r.loop_ms, r.failures.c_str());
+}
+
+int main (int argc, char* argv[])
+{
+	size_t trial_count = 1000;
+	uint32_t seed = 1;
+	double settle_seconds = 60;
+	double window_seconds = 60;
+	double spread_seconds = 5;
+	size_t thread_count = std::max (1u, std::thread::hardware_concurrency());
+	double budget_seconds = 60;
+	const char* csv_path = nullptr;
+	bool replay = false;
+	uint32_t replay_seed = 0;
+	campaign_options options;
+	for (auto k = failure_kinds; *k; k++)
+		options.kinds.push_back (*k);
+
+	int argi = 1;
+	for (; argi + 1 < argc; argi += 2)
+	{
+		const char* option = argv[argi];
+		const char* value = argv[argi + 1];
+		if (strcmp (option, "-n") == 0)
+			trial_count = (size_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-s") == 0)
+			seed = (uint32_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-t") == 0)
+			settle_seconds = atof (value);
+		else if (strcmp (option, "-w") == 0)
+			window_seconds = atof (value);
+		else if (strcmp (option, "-f") == 0)
+			options.max_failures = (size_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-d") == 0)
+			spread_seconds = atof (value);
+		else if (strcmp (option, "-k") == 0)
+			options.kinds = split(value);
+		else if (strcmp (option, "-j") == 0)
+			thread_count = (size_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-b") == 0)
+			budget_seconds = atof (value);
+		else if (strcmp (option, "-o") == 0)
+			csv_path = value;
+		else if (strcmp (option, "-r") == 0)
+		{
+			replay = true;
+			replay_seed = (uint32_t) strtoul (value, nullptr, 0);
+		}
+		else
+			break;
+	}
+
+	if ((argi != argc - 1) || (trial_count == 0) || !(settle_seconds > 0) || !(spread_seconds > 0) || !(window_seconds > spread_seconds)
+		|| (options.max_failures == 0) || options.kinds.empty() || (thread_count == 0) || !(budget_seconds > 0))
+	{
+		fprintf (stderr, "usage: campaign [-n trials] [-s seed] [-t seconds] [-w seconds] [-f failures] [-d seconds] [-k kind,...]\n"
+		                 "                [-j threads] [-b seconds] [-o file.csv] [-r trial-seed] topology-file\n"
+		                 "the window (-w) must be longer than the time the failures are spread over (-d); the kinds are:");
+		for (auto k = failure_kinds; *k; k++)
+			fprintf (stderr, " %s", *k);
+		fprintf (stderr, "\n");
+		return 1;
+	}
+
+	for (auto& k : options.kinds)
+	{
+		if (std::none_of (failure_kinds, failure_kinds + 4, [&k](const char* n) { return k == n; }))
+		{
+			fprintf (stderr, "unknown failure kind '%s'\n", k.c_str());
+			return 1;
+		}
+	}
+
+	options.spread = (sim_time) (spread_seconds * usec_per_sec);
+	options.window = (sim_time) (window_seconds * usec_per_sec);
+
+	auto start = std::chrono::steady_clock::now();
+	project baseline;
+	try
+	{
+		baseline.load (argv[argi]);
+	}
+	catch (const std::exception& ex)
+	{
+		fprintf (stderr, "%s\n", ex.what());
+		return 1;
+	}
+
+	auto settle = (sim_time) (settle_seconds * usec_per_sec);
+	baseline.start (seed, false, thread_count, true);
+	baseline.run_until (settle);
+	sim_time last_change = baseline.bridge_totals().last_port_change;
+	printf ("baseline: %zu bridges, %zu wires, settled for %.3f s (last change at %.3f s) in %.3f s\n",
+		baseline.bridges().size(), baseline.wires().size(), settle_seconds, (double) last_change / usec_per_sec,
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	if (last_change > settle / 2)
+		printf ("warning: the baseline was still changing in the last half of the settle time\n");
+
+	auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget_seconds));
+
+	if (replay)
+	{
+		// On a thread of its own, so that a hang can be reported.
+		trial_result r;
+		std::atomic<bool> done { false };
+		std::thread ([&] { r = run_trial (baseline, replay_seed, options, true, [](const std::string&) { }); done = true; }).detach();
+		auto deadline = std::chrono::steady_clock::now() + budget;
+		while (!done && (std::chrono::steady_clock::now() < deadline))
+			std::this_thread::sleep_for (std::chrono::milliseconds(10));
+		if (!done)
+		{
+			printf ("hung: still running after %g s\n", budget_seconds);
+			fflush (stdout);
+			std::_Exit (2);
+		}
+
+		printf ("convergence %.3f ms%s, %zu loops over %.3f ms, %zu role mismatches, %llu BPDUs, %llu frames lost\n",
+			r.convergence_ms, r.converged ? "" : " (not converged)", r.loops, r.loop_ms, r.role_mismatches,
+			(unsigned long long) r.bpdus, (unsigned long long) r.frames_lost);
+		return 0;
+	}
+
+	// The trial each worker is simulating, and since when; the main thread watches them for trials over the budget.
+	// Whichever of the worker (when the trial ends) and the main thread (when it hangs) changes trial first
+	// decides the outcome; a worker whose trial hung stops taking trials, and another one replaces it.
+	static constexpr size_t idle = SIZE_MAX;
+	static constexpr size_t abandoned = SIZE_MAX - 1;
+	struct worker_slot
+	{
+		std::atomic<size_t> trial { idle };
+		std::atomic<std::chrono::steady_clock::rep> since { 0 };
+		std::thread thread;
+	};
+
+	start = std::chrono::steady_clock::now();
+	std::vector<trial_result> results (trial_count);
+	std::atomic<size_t> next_trial { 0 };
+	std::atomic<size_t> finished { 0 };
+	size_t hung = 0;
+	auto worker = [&](worker_slot* slot)
+	{
+		for (size_t i; (i = next_trial.fetch_add(1)) < trial_count; )
+		{
+			uint32_t ts = trial_seed(seed, i);
+			trial_result r = run_trial (baseline, ts, options, false, [&](const std::string& failures)
+			{
+				results[i].seed = ts;
+				results[i].failures = failures;
+				slot->since = std::chrono::steady_clock::now().time_since_epoch().count();
+				slot->trial = i;
+			});
+
+			size_t expected = i;
+			if (!slot->trial.compare_exchange_strong (expected, idle))
+				return; // reported as hung
+			results[i] = std::move(r);
+			finished++;
+		}
+	};
+
+	std::vector<std::unique_ptr<worker_slot>> slots;
+	auto add_worker = [&]
+	{
+		slots.push_back (std::make_unique<worker_slot>());
+		slots.back()->thread = std::thread (worker, slots.back().get());
+	};
+
+	for (size_t t = 0; t < std::min (thread_count, trial_count); t++)
+		add_worker();
+
+	while (finished + hung < trial_count)
+	{
+		std::this_thread::sleep_for (std::chrono::milliseconds(10));
+		auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+		for (size_t si = 0, count = slots.size(); si < count; si++)
+		{
+			size_t i = slots[si]->trial;
+			if ((i >= trial_count) || (now - slots[si]->since < budget.count()))
+				continue;
+
+			if (slots[si]->trial.compare_exchange_strong (i, abandoned))
+			{
+				results[i].hung = true;
+				hung++;
+				printf ("trial 0x%08X hung (still running after %g s): %s\n", results[i].seed, budget_seconds, results[i].failures.c_str());
+				fflush (stdout);
+				add_worker();
+			}
+		}
+	}
+
+	for (auto& slot : slots)
+	{
+		if (slot->trial == abandoned)
+			slot->thread.detach();
+		else
+			slot->thread.join();
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (csv_path != nullptr)
+	{
+		FILE* csv = fopen (csv_path, "w");
+		if (csv == nullptr)
+		{
+			fprintf (stderr, "%s: cannot open\n", csv_path);
+			return 1;
+		}
+
+		fprintf (csv, "trial,seed,hung,convergence_ms,converged,loops,loop_ms,role_mismatches,bpdus,frames_lost,failures\n");
+		for (size_t i = 0; i < trial_count; i++)
+		{
+			const trial_result& r = results[i];
+			if (r.hung)
+				fprintf (csv, "%zu,0x%08X,1,,,,,,,,\"%s\"\n", i, r.seed, r.failures.c_str());
+			else
+				fprintf (csv, "%zu,0x%08X,0,%.3f,%d,%zu,%.3f,%zu,%llu,%llu,\"%s\"\n", i, r.seed, r.convergence_ms, r.converged ? 1 : 0,
+					r.loops, r.loop_ms, r.role_mismatches, (unsigned long long) r.bpdus, (unsigned long long) r.frames_lost, r.failures.c_str());
+		}
+
+		fclose (csv);
+	}
+
+	std::string kinds;
+	for (auto& k : options.kinds)
+		kinds += (kinds.empty() ? "" : ",") + k;
+	printf ("%zu trials of 1 to %zu failures (%s) within %.3f s, each simulated for %.3f s, in %.3f s on %zu threads\n",
+		trial_count, options.max_failures, kinds.c_str(), spread_seconds, window_seconds, elapsed, std::min (thread_count, trial_count));
+
+	std::vector<double> convergence;
+	size_t converged = 0, with_mismatches = 0, with_loops = 0, loops = 0;
+	double longest_loop_ms = 0;
+	for (const trial_result& r : results)
+	{
+		if (r.hung)
+			continue;
+		convergence.push_back (r.convergence_ms);
+		converged += r.converged;
+		with_mismatches += (r.role_mismatches > 0);
+		with_loops += (r.loops > 0);
+		loops += r.loops;
+		longest_loop_ms = std::max (longest_loop_ms, r.loop_ms);
+	}
+
+	std::sort (convergence.begin(), convergence.end());
+	printf ("converged: %zu (%.1f%%); with port roles other than the oracle's at the end: %zu\n",
+		converged, 100.0 * converged / trial_count, with_mismatches);
+	if (!convergence.empty())
+	{
+		printf ("convergence ms: p50 %.3f, p90 %.3f, p99 %.3f, p99.9 %.3f, max %.3f\n", percentile(convergence, 500),
+			percentile(convergence, 900), percentile(convergence, 990), percentile(convergence, 999), convergence.back());
+	}
+	printf ("transient loops: %zu trials (%.1f%%), %zu loops, longest %.3f ms in a trial\n",
+		with_loops, 100.0 * with_loops / trial_count, loops, longest_loop_ms);
+
+	// The outliers, slowest first, then those with loops.
+	std::vector<const trial_result*> sorted;
+	for (const trial_result& r : results)
+	{
+		if (!r.hung)
+			sorted.push_back (&r);
+	}
+	std::stable_sort (sorted.begin(), sorted.end(), [](const trial_result* a, const trial_result* b) { return a->convergence_ms > b->convergence_ms; });
+	printf ("slowest trials (seed, convergence, loops, failures at seconds from the start of the trial):\n");
+	for (size_t i = 0; i < std::min ((size_t) 5, sorted.size()); i++)
+		print_trial (*sorted[i]);
+
+	std::stable_sort (sorted.begin(), sorted.end(), [](const trial_result* a, const trial_result* b) { return a->loop_ms > b->loop_ms; });
+	if (with_loops)
+	{
+		printf ("trials with the longest loops:\n");
+		for (size_t i = 0; (i < 5) && (sorted[i]->loops > 0); i++)
+			print_trial (*sorted[i]);
+	}
+
+	if (hung)
+	{
+		printf ("hung trials (still running after %g s):\n", budget_seconds);
+		for (const trial_result& r : results)
+		{
+			if (r.hung)
+				print_trial (r);
+		}
+	}
+
+	printf ("replay a trial with: campaign -s %u -t %g -w %g -f %zu -d %g -k %s -r SEED %s\n",
+		seed, settle_seconds, window_seconds, options.max_failures, spread_seconds, kinds.c_str(), argv[argi]);
+
+	if (hung)
+	{
+		// The threads of the hung trials are still running, so no destructors.
+		fflush (stdout);
+		std::_Exit (2);
+	}
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "fdb.h"
+#include <algorithm>
+#include <cassert>
+
+fdb::fdb (size_t port_count, size_t tree_count)
+	: _port_count(port_count), _tree_count(tree_count), _port_trees(port_count * tree_count)
+{ }
+
+uint64_t fdb::key (unsigned int tree, const mac_address& address)
+{
+	uint64_t k = tree;
+	for (uint8_t b : address)
+		k = (k << 8) | b;
+	return k;
+}
+
+bool fdb::expired (const entry& e, unsigned int tree, sim_time now) const
+{
+	const port_tree_state& pt = _port_trees[e.port_index * _tree_count + tree];
+	if (e.generation != pt.generation)
+		return true;
+	if (pt.rapid_ageing && (e.last_seen <= pt.rapid_ageing_request) && (now - e.last_seen > _rapid_ageing_time))
+		return true;
+	return now - e.last_seen > _ageing_time;
+}
+
+void fdb::count_removed (const entry& e, unsigned int tree)
+{
+	if (e.generation != port_tree(e.port_index, tree).generation)
+		_stats.flushed++;
+	else
+		_stats.aged++;
+}
+
+void fdb::sweep (sim_time now)
+{
+	for (auto it = _entries.begin(); it != _entries.end(); )
+	{
+		auto tree = (unsigned int) (it->first >> 48);
+		if (expired (it->second, tree, now))
+		{
+			count_removed (it->second, tree);
+			it = _entries.erase(it);
+		}
+		else
+			++it;
+	}
+
+	_sweep_size = std::max ((size_t) 64, 2 * _entries.size());
+}
+
+void fdb::learn (unsigned int tree, const mac_address& address, uint32_t port_index, sim_time now)
+{
+	assert ((tree < _tree_count) && (port_index < _port_count));
+	uint32_t generation = port_tree(port_index, tree).generation;
+	auto [it, inserted] = _entries.try_emplace (key(tree, address), entry { port_index, generation, now });
+	if (inserted)
+	{
+		_stats.learned++;
+		if (_entries.size() >= _sweep_size)
+			sweep (now);
+		return;
+	}
+
+	entry& e = it->second;
+	if (expired (e, tree, now))
+	{
+		count_removed (e, tree);
+		_stats.learned++;
+	}
+	else if (e.port_index != port_index)
+		_stats.moved++;
+	e = { port_index, generation, now };
+}
+
+uint32_t fdb::lookup (unsigned int tree, const mac_address& address, sim_time now)
+{
+	auto it = _entries.find (key(tree, address));
+	if (it == _entries.end())
+		return no_port;
+
+	if (expired (it->second, tree, now))
+	{
+		count_removed (it->second, tree);
+		_entries.erase (it);
+		return no_port;
+	}
+
+	return it->second.port_index;
+}
+
+void fdb::flush (uint32_t port_index, unsigned int tree, STP_FLUSH_FDB_TYPE type, sim_time now)
+{
+	port_tree_state& pt = port_tree(port_index, tree);
+	if (type == STP_FLUSH_FDB_TYPE_IMMEDIATE)
+		pt.generation++;
+	else
+	{
+		pt.rapid_ageing = true;
+		pt.rapid_ageing_request = now;
+	}
+}
@@ -0,0 +1,79 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "scheduler.h"
+#include "stp.h"
+#include <unordered_map>
+
+// Counters of an FDB. Entries removed by ageing or flushing are counted when the FDB finds them, either looking up
+// their address or sweeping the table, rather than when they expire.
+struct fdb_stats
+{
+	uint64_t learned = 0; // new entries
+	uint64_t moved = 0;   // entries that changed port, as a station appeared behind another port
+	uint64_t aged = 0;
+	uint64_t flushed = 0;
+};
+
+// Filtering database of a bridge: which port leads to each MAC address, learned from the source addresses of the
+// frames received, separately in each spanning tree (one FID per tree, as MSTP bridges commonly allocate them).
+//
+// A hash table keyed by tree and address. Flushing works like in switch hardware, in constant time whatever the size of
+// the table: each port and tree has a generation number, which an immediate flush increments, and a rapid ageing time,
+// which STP_FLUSH_FDB_TYPE_RAPID_AGEING sets; entries older than their port's generation, or not seen since before
+// a rapid ageing request and for longer than rapid_ageing_time, are treated as absent, and removed when found.
+class fdb
+{
+public:
+	static constexpr sim_time default_ageing_time = 300 * usec_per_sec;       // 802.1Q-2018 Table 8-6
+	static constexpr sim_time default_rapid_ageing_time = 15 * usec_per_sec; // Forward Delay, as legacy STP ages with it during topology changes
+	static constexpr uint32_t no_port = UINT32_MAX;
+
+private:
+	struct entry
+	{
+		uint32_t port_index;
+		uint32_t generation; // of the port and tree when learned
+		sim_time last_seen;
+	};
+
+	struct port_tree_state
+	{
+		uint32_t generation = 0;
+		sim_time rapid_ageing_request = 0; // entries last seen up to this time age with rapid_ageing_time
+		bool rapid_ageing = false;
+	};
+
+	size_t const _port_count;
+	size_t const _tree_count;
+	sim_time _ageing_time = default_ageing_time;
+	sim_time _rapid_ageing_time = default_rapid_ageing_time;
+	std::unordered_map<uint64_t, entry> _entries; // key: tree << 48 | address
+	std::vector<port_tree_state> _port_trees;     // [port * tree_count + tree]; the last port is the bridge's own, for its host
+	size_t _sweep_size = 64;
+	fdb_stats _stats;
+
+	static uint64_t key (unsigned int tree, const mac_address& address);
+	port_tree_state& port_tree (uint32_t port_index, unsigned int tree) { return _port_trees[port_index * _tree_count + tree]; }
+	bool expired (const entry& e, unsigned int tree, sim_time now) const;
+	void count_removed (const entry& e, unsigned int tree); // as aged or flushed
+	void sweep (sim_time now);
+
+public:
+	// port_count includes the bridge's own port.
+	fdb (size_t port_count, size_t tree_count);
+
+	const fdb_stats& stats() const { return _stats; }
+	size_t size() const { return _entries.size(); } // including entries expired but not found yet
+
+	// Records that address is reachable through port_index in tree, as a frame from it was received there.
+	void learn (unsigned int tree, const mac_address& address, uint32_t port_index, sim_time now);
+
+	// Returns the port that leads to address in tree, or no_port if it's not known.
+	uint32_t lookup (unsigned int tree, const mac_address& address, sim_time now);
+
+	// What StpCallback_FlushFdb asks for.
+	void flush (uint32_t port_index, unsigned int tree, STP_FLUSH_FDB_TYPE type, sim_time now);
+};
@@ -0,0 +1,216 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "generators.h"
+#include <algorithm>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+const char* const topology_kinds[] = { "ring", "ladder", "fat-tree", "mesh", "regions", nullptr };
+
+namespace
+{
+	// Hands out the ports of each bridge in order, and writes the wires.
+	class wiring
+	{
+		std::vector<size_t> _next_port;
+		size_t const _port_count;
+		uint32_t const _delay;
+		std::set<std::pair<size_t, size_t>> _wired_pairs;
+
+	public:
+		std::ostringstream wires;
+
+		wiring (size_t bridge_count, size_t port_count, uint32_t delay)
+			: _next_port(bridge_count, 0), _port_count(port_count), _delay(delay)
+		{ }
+
+		size_t free_ports (size_t b) const { return _port_count - _next_port[b]; }
+
+		bool wired (size_t a, size_t b) const { return _wired_pairs.count({ std::min(a, b), std::max(a, b) }) != 0; }
+
+		void wire (size_t a, size_t b)
+		{
+			if ((free_ports(a) == 0) || (free_ports(b) == 0))
+				throw std::invalid_argument("not enough ports per bridge for this topology");
+
+			wires << "wire B" << a << ':' << _next_port[a]++ << " B" << b << ':' << _next_port[b]++;
+			if (_delay != 10)
+				wires << " delay=" << _delay;
+			wires << '\n';
+			_wired_pairs.insert ({ std::min(a, b), std::max(a, b) });
+		}
+	};
+
+	void ring (wiring& w, size_t first, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			w.wire (first + i, first + (i + 1) % count);
+	}
+
+	void ladder (wiring& w, size_t bridge_count)
+	{
+		if ((bridge_count < 4) || (bridge_count % 2))
+			throw std::invalid_argument("a ladder needs an even number of bridges, at least 4");
+
+		size_t length = bridge_count / 2;
+		for (size_t i = 0; i < length; i++)
+		{
+			if (i + 1 < length)
+			{
+				w.wire (i, i + 1);
+				w.wire (length + i, length + i + 1);
+			}
+			w.wire (i, length + i);
+		}
+	}
+
+	// Returns the number of bridges, which is the largest that fits in bridge_count.
+	size_t fat_tree (wiring& w, size_t bridge_count, size_t port_count)
+	{
+		size_t k = port_count & ~(size_t) 1;
+		size_t half = k / 2;
+		size_t core_count = half * half;
+		if ((k < 4) || (bridge_count < core_count + k))
+			throw std::invalid_argument("a fat-tree needs at least 4 ports per bridge, and at least (k/2)^2 + k bridges");
+
+		size_t pod_count = std::min (k, (bridge_count - core_count) / k);
+		for (size_t pod = 0; pod < pod_count; pod++)
+		{
+			size_t first_aggregation = core_count + pod * k;
+			size_t first_edge = first_aggregation + half;
+			for (size_t a = 0; a < half; a++)
+			{
+				// Aggregation bridge a of every pod goes up to cores a * k/2 ... a * k/2 + k/2 - 1.
+				for (size_t c = 0; c < half; c++)
+					w.wire (a * half + c, first_aggregation + a);
+
+				for (size_t e = 0; e < half; e++)
+					w.wire (first_aggregation + a, first_edge + e);
+			}
+		}
+
+		return core_count + pod_count * k;
+	}
+
+	void mesh (wiring& w, size_t bridge_count, uint32_t seed)
+	{
+		std::mt19937 random (seed);
+
+		// A spanning tree first, so that the network is connected: each bridge to an earlier one with a free port.
+		for (size_t b = 1; b < bridge_count; b++)
+		{
+			size_t other = random() % b;
+			for (size_t tries = 0; (w.free_ports(other) == 0) && (tries < b); tries++)
+				other = (other + 1) % b;
+			w.wire (b, other);
+		}
+
+		// Then wires between random pairs of bridges until there are no free ports left, or hardly any.
+		for (size_t misses = 0; misses < 16 * bridge_count; )
+		{
+			size_t a = random() % bridge_count;
+			size_t b = random() % bridge_count;
+			if ((a == b) || (w.free_ports(a) == 0) || (w.free_ports(b) == 0) || w.wired(a, b))
+			{
+				misses++;
+				continue;
+			}
+
+			w.wire (a, b);
+		}
+	}
+}
+
+std::string generate_topology (const topology_params& params)
+{
+	size_t bridge_count = params.bridge_count;
+	if (bridge_count < 2)
+		throw std::invalid_argument("a topology needs at least 2 bridges");
+	if ((params.version != "stp") && (params.version != "rstp") && (params.version != "mstp"))
+		throw std::invalid_argument("the version must be stp, rstp or mstp");
+	if ((params.msti_count > 64) || ((params.msti_count > 0) && (params.version != "mstp")))
+		throw std::invalid_argument("MSTIs need version mstp, and there can be up to 64");
+
+	wiring w (bridge_count, params.port_count, params.wire_delay);
+	std::vector<std::string> regions (bridge_count);
+	if (params.kind == "ring")
+		ring (w, 0, bridge_count);
+	else if (params.kind == "ladder")
+		ladder (w, bridge_count);
+	else if (params.kind == "fat-tree")
+		bridge_count = fat_tree (w, bridge_count, params.port_count);
+	else if (params.kind == "mesh")
+		mesh (w, bridge_count, params.seed);
+	else if (params.kind == "regions")
+	{
+		size_t region_count = params.region_count;
+		if ((region_count == 0) || (bridge_count / region_count < 3))
+			throw std::invalid_argument("each region needs at least 3 bridges");
+
+		// Each region a ring, and the first bridge of each region wired to the middle one of the next region.
+		size_t size = bridge_count / region_count;
+		bridge_count = size * region_count;
+		for (size_t r = 0; r < region_count; r++)
+		{
+			ring (w, r * size, size);
+			for (size_t i = 0; i < size; i++)
+				regions[r * size + i] = "r" + std::to_string(r);
+		}
+
+		for (size_t r = 0; (region_count > 1) && (r < region_count); r++)
+			w.wire (r * size, ((r + 1) % region_count) * size + size / 2);
+	}
+	else
+		throw std::invalid_argument("unknown topology '" + params.kind + "'");
+
+	std::ostringstream out;
+	out << "# " << params.kind << ", " << bridge_count << " bridges with " << params.port_count << " ports, "
+		<< params.msti_count << " MSTIs, " << params.version;
+	if (params.kind == "regions")
+		out << ", " << params.region_count << " regions";
+	if (params.kind == "mesh")
+		out << ", seed " << params.seed;
+	out << "\n\n";
+
+	for (size_t tree = 1; tree <= params.msti_count; tree++)
+		out << "vlan " << tree + 1 << ' ' << tree << '\n';
+	if (params.msti_count)
+		out << '\n';
+
+	for (size_t b = 0; b < bridge_count; b++)
+	{
+		out << "bridge B" << b << ' ' << params.port_count << ' ' << params.msti_count << " version=" << params.version;
+		if (!regions[b].empty())
+			out << " region=" << regions[b];
+
+		if (b < 2)
+		{
+			const char* priority = (b == 0) ? "0x1000" : "0x2000";
+			out << " priority=" << priority;
+			for (size_t tree = 1; tree <= params.msti_count; tree++)
+				out << " priority" << tree << '=' << priority;
+		}
+
+		out << '\n';
+	}
+
+	out << '\n' << w.wires.str();
+
+	// Its own random sequence, so a mesh is the same with or without traffic.
+	std::mt19937 random (params.seed ^ 0x9E3779B9);
+	if (params.traffic_count)
+		out << '\n';
+	for (size_t i = 0; i < params.traffic_count; i++)
+	{
+		size_t a = random() % bridge_count;
+		size_t b = (a + 1 + random() % (bridge_count - 1)) % bridge_count;
+		out << "traffic B" << a << " B" << b << " rate=" << params.traffic_rate << " vlan=" << 1 + i % (params.msti_count + 1) << '\n';
+	}
+
+	return out.str();
+}
@@ -0,0 +1,36 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct topology_params
+{
+	std::string kind;             // one of topology_kinds
+	size_t   bridge_count = 16;
+	size_t   port_count = 4;      // ports per bridge
+	size_t   msti_count = 0;
+	size_t   region_count = 4;    // for "regions" only
+	std::string version = "mstp"; // stp, rstp or mstp
+	uint32_t wire_delay = 10;     // microseconds
+	uint32_t seed = 1;            // for "mesh", and for the traffic
+	size_t   traffic_count = 0;   // "traffic" statements, between random pairs of bridges, spread over the trees
+	uint32_t traffic_rate = 100;  // frames per second each way
+};
+
+// ring:     the bridges in a ring
+// ladder:   two rows of bridges, each wired as a line, with a rung between the two bridges at every position
+// fat-tree: k-ary fat-tree (k = port count): (k/2)^2 core bridges, then as many pods of k/2 aggregation and k/2 edge
+//           bridges as fit in the bridge count, up to k
+// mesh:     a random spanning tree, then random wires between bridges with free ports, until none are left
+// regions:  region_count MST regions, each a ring, with the regions in a ring too
+extern const char* const topology_kinds[];
+
+// Returns a topology file for the headless simulator (see project::load). Bridges are named B0, B1... B0 is the root
+// of the CIST and of the MSTIs of its region, B1 the backup root, and port 0 of B0 always has a wire, so scripted
+// failures can aim at them.
+// Throws std::invalid_argument when the parameters don't fit the kind of topology.
+std::string generate_topology (const topology_params& params);
@@ -0,0 +1,208 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Headless discrete-event network simulator: the bridge, port and wire model of the GUI simulator,
+// without the GUI, driven by a priority queue of events in virtual time rather than Win32 timers.
+// Usage: headless [-t seconds] [-s seed] [-j threads] [-p] [-l] [-v] topology-file
+// Loads the topology (see project.h for the file format), simulates it for the given number of seconds
+// of virtual time (default 60), as fast as the host allows, and prints what happened and the final
+// spanning trees; -v also prints the role of every port. The seed (default 1) sets the phases of the
+// bridges' timers; the same topology and seed always give the same results.
+// The virtual clock jumps from one event to the next, so idle periods cost nothing: a 24-hour soak of
+// a small network takes seconds. -p makes the bridges poll their links with 16 ms link pulses, like the
+// GUI simulator does, at the cost of an event every 16 ms per bridge (see project::start).
+// -j spreads the bridges over that many threads (default 1); the results don't depend on it (see project::run_until).
+// -l checks for forwarding loops as the simulation goes, and prints when they appear and go away.
+// With "traffic" statements, the data frames sent, delivered and lost, the copies flooded for unknown destinations
+// and what the FDBs learned and flushed are printed too.
+// At the end the port roles are checked against the ones worked out by the spanning tree oracle (see oracle.h),
+// and those that differ are printed; -v prints all of them, rather than the first 20.
+
+#include "project.h"
+#include "oracle.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+static std::string bridge_id_to_string (const unsigned char* id)
+{
+	char str[20];
+	snprintf (str, sizeof(str), "%02X%02X.%02X%02X%02X%02X%02X%02X", id[0], id[1], id[2], id[3], id[4], id[5], id[6], id[7]);
+	return str;
+}
+
+static void print_trees (const project& project, bool verbose)
+{
+	const auto& bridges = project.bridges();
+	size_t tree_count = 1;
+	for (auto& b : bridges)
+		tree_count = std::max (tree_count, 1 + (size_t) STP_GetMstiCount(b->stp_bridge()));
+
+	for (unsigned int tree = 0; tree < tree_count; tree++)
+	{
+		// For the CIST the root bridge; for MSTIs the regional root (a network may have several regions).
+		std::map<std::string, size_t> roots;
+		std::map<STP_PORT_ROLE, size_t> roles;
+		for (auto& b : bridges)
+		{
+			STP_BRIDGE* stp_bridge = b->stp_bridge();
+			if (!STP_IsBridgeStarted(stp_bridge) || (tree > STP_GetMstiCount(stp_bridge)))
+				continue;
+
+			unsigned char vector[36];
+			STP_GetRootPriorityVector (stp_bridge, tree, vector);
+			roots[bridge_id_to_string((tree == 0) ? &vector[0] : &vector[12])]++;
+
+			for (unsigned int pi = 0; pi < STP_GetPortCount(stp_bridge); pi++)
+				roles[STP_GetPortRole(stp_bridge, pi, tree)]++;
+		}
+
+		printf ("%s %u:", (tree == 0) ? "CIST" : "MSTI", tree);
+		for (auto& [root, count] : roots)
+			printf (" %s %s (%zu bridges)", (tree == 0) ? "root" : "regional root", root.c_str(), count);
+		printf ("\n   ");
+		for (auto& [role, count] : roles)
+			printf (" %s %zu", STP_GetPortRoleString(role), count);
+		printf ("\n");
+	}
+
+	if (!verbose)
+		return;
+
+	for (auto& b : bridges)
+	{
+		STP_BRIDGE* stp_bridge = b->stp_bridge();
+		printf ("%s:", b->name().c_str());
+		if (!STP_IsBridgeStarted(stp_bridge))
+		{
+			printf (" STP disabled\n");
+			continue;
+		}
+
+		for (unsigned int pi = 0; pi < STP_GetPortCount(stp_bridge); pi++)
+		{
+			printf (" %u=", pi);
+			for (unsigned int tree = 0; tree <= STP_GetMstiCount(stp_bridge); tree++)
+			{
+				const char* role = STP_GetPortRoleString(STP_GetPortRole(stp_bridge, pi, tree));
+				printf ("%s%s", (tree == 0) ? "" : "/", role);
+			}
+		}
+		printf ("\n");
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	double seconds = 60;
+	uint32_t seed = 1;
+	bool verbose = false;
+	bool poll_link_pulses = false;
+	size_t thread_count = 1;
+	bool check_loops = false;
+	int argi = 1;
+	for (; argi < argc - 1; argi++)
+	{
+		if ((strcmp (argv[argi], "-t") == 0) && (argi + 2 < argc))
+			seconds = atof (argv[++argi]);
+		else if ((strcmp (argv[argi], "-s") == 0) && (argi + 2 < argc))
+			seed = (uint32_t) strtoul (argv[++argi], nullptr, 0);
+		else if ((strcmp (argv[argi], "-j") == 0) && (argi + 2 < argc))
+			thread_count = (size_t) strtoul (argv[++argi], nullptr, 0);
+		else if (strcmp (argv[argi], "-v") == 0)
+			verbose = true;
+		else if (strcmp (argv[argi], "-l") == 0)
+			check_loops = true;
+		else if (strcmp (argv[argi], "-p") == 0)
+			poll_link_pulses = true;
+		else
+			break;
+	}
+
+	if ((argi != argc - 1) || !(seconds > 0) || (thread_count == 0))
+	{
+		fprintf (stderr, "usage: headless [-t seconds] [-s seed] [-j threads] [-p] [-l] [-v] topology-file\n");
+		return 1;
+	}
+
+	project project;
+	try
+	{
+		project.load (argv[argi]);
+	}
+	catch (const std::exception& ex)
+	{
+		fprintf (stderr, "%s\n", ex.what());
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	project.start (seed, poll_link_pulses, thread_count, check_loops);
+	project.run_until ((sim_time) (seconds * usec_per_sec));
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	bridge_stats totals = project.bridge_totals();
+
+	project_stats ps = project.stats();
+	printf ("%zu bridges, %zu wires, %.3f s simulated in %.3f s", project.bridges().size(), project.wires().size(), seconds, elapsed);
+	if (elapsed > 0)
+		printf (" (%.1fx real time, %.0f events/s)", seconds / elapsed, ps.events / elapsed);
+	printf ("\n");
+	printf ("events %llu: link pulse ticks %llu, one-second ticks %llu, link changes %llu, packets delivered %llu, sent on unwired ports %llu, lost %llu\n",
+		(unsigned long long) ps.events, (unsigned long long) ps.link_pulse_ticks, (unsigned long long) ps.one_second_ticks,
+		(unsigned long long) ps.link_changes, (unsigned long long) ps.packets_delivered, (unsigned long long) ps.packets_unwired,
+		(unsigned long long) ps.packets_lost);
+	printf ("BPDUs transmitted %llu, received %llu, flooded %llu, looped %llu; topology changes %llu, FDB flushes %llu\n",
+		(unsigned long long) totals.bpdus_transmitted, (unsigned long long) totals.bpdus_received,
+		(unsigned long long) totals.frames_flooded, (unsigned long long) totals.loops_detected,
+		(unsigned long long) totals.topology_changes, (unsigned long long) totals.fdb_flushes);
+
+	if (!project.flows().empty())
+	{
+		traffic_stats ts = project.traffic_totals();
+		fdb_stats fs = project.fdb_totals();
+		printf ("data frames sent %llu, delivered %llu, lost %llu, duplicated %llu; copies flooded %llu, discarded %llu\n",
+			(unsigned long long) ts.sent, (unsigned long long) ts.delivered, (unsigned long long) ts.lost(),
+			(unsigned long long) ts.duplicates, (unsigned long long) totals.data_flooded, (unsigned long long) totals.data_discarded);
+		printf ("FDB entries learned %llu, moved %llu, aged %llu, flushed %llu\n",
+			(unsigned long long) fs.learned, (unsigned long long) fs.moved, (unsigned long long) fs.aged, (unsigned long long) fs.flushed);
+	}
+
+	if (check_loops)
+	{
+		printf ("loop alarms %zu\n", project.loop_alarms().size());
+		for (const loop_alarm& a : project.loop_alarms())
+		{
+			if (a.loop_wire_count)
+				printf ("    %.6f s: VLAN %u loops over %zu wires\n", (double) a.time / usec_per_sec, a.vlan, a.loop_wire_count);
+			else
+				printf ("    %.6f s: VLAN %u loop-free\n", (double) a.time / usec_per_sec, a.vlan);
+		}
+	}
+
+	oracle_report oracle = check_port_roles (project);
+	printf ("spanning tree oracle: %zu port roles checked, %zu as expected", oracle.ports_checked, oracle.ports_checked - oracle.mismatches.size());
+	if (oracle.bridges_out_of_reach)
+		printf ("; %zu bridges too far from the root for Max Age or Max Hops not checked", oracle.bridges_out_of_reach);
+	if (oracle.ports_on_looped_lans)
+		printf ("; %zu port roles on LANs looped through bridges with STP disabled not checked", oracle.ports_on_looped_lans);
+	printf ("\n");
+	for (size_t i = 0; i < oracle.mismatches.size(); i++)
+	{
+		if ((i == 20) && !verbose)
+		{
+			printf ("    ...\n");
+			break;
+		}
+
+		const role_mismatch& m = oracle.mismatches[i];
+		printf ("    %s port %u %s %u: %s, expected %s\n", project.bridges()[m.bridge_index]->name().c_str(), m.port_index,
+			(m.tree == 0) ? "CIST" : "MSTI", m.tree, STP_GetPortRoleString(m.actual), STP_GetPortRoleString(m.expected));
+	}
+
+	print_trees (project, verbose);
+	return 0;
+}
@@ -0,0 +1,463 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "oracle.h"
+#include <cstring>
+#include <queue>
+#include <set>
+#include <tuple>
+
+namespace
+{
+	static constexpr unsigned int max_hops = 20; // the library's MaxHops, which can't be configured
+	static constexpr uint32_t none = UINT32_MAX;
+
+	// Bridge identifiers are held as numbers, the priority above the address, so they compare like in the BPDUs.
+	struct priority_vector
+	{
+		uint64_t root_id;
+		uint32_t external_root_path_cost;
+		uint64_t regional_root_id;
+		uint32_t internal_root_path_cost;
+		uint64_t designated_bridge_id;
+		uint16_t designated_port_id;
+		uint16_t rcv_port_id;
+
+		bool operator< (const priority_vector& other) const
+		{
+			return std::tie (root_id, external_root_path_cost, regional_root_id, internal_root_path_cost, designated_bridge_id, designated_port_id, rcv_port_id)
+				< std::tie (other.root_id, other.external_root_path_cost, other.regional_root_id, other.internal_root_path_cost,
+				            other.designated_bridge_id, other.designated_port_id, other.rcv_port_id);
+		}
+	};
+
+	uint64_t address_of (uint64_t bridge_id) { return bridge_id & 0xFFFF'FFFF'FFFF; }
+
+	// Table 13-4 in 802.1Q-2018, as used by the library when no path cost is configured.
+	uint32_t default_port_path_cost (uint32_t speed_mbps)
+	{
+		if (speed_mbps == 0)
+			return 200000000;
+		uint32_t cost = 20000000;
+		for (uint32_t s = 1; (s < speed_mbps) && (cost > 2); s *= 10)
+			cost /= 10;
+		return cost;
+	}
+
+	struct lan_member
+	{
+		uint32_t bridge_index;
+		uint32_t port_index;
+	};
+
+	// The ports of the bridges with STP enabled that hear each other's BPDUs: the two ends of a wire, or all the
+	// ports reached through bridges with STP disabled, which relay BPDUs like hubs.
+	struct lan
+	{
+		std::vector<lan_member> members;
+		bool legacy = false; // an STP bridge is on it, so all ports on it talk STP
+		bool looped = false; // the bridges with STP disabled form a loop, so BPDUs also come back to their senders
+	};
+
+	struct bridge_state
+	{
+		priority_vector root_priority;
+		uint32_t root_port = none;
+		bool out_of_reach = false;
+		bool done = false;
+	};
+
+	struct candidate
+	{
+		priority_vector root_priority;
+		uint32_t bridge_index;
+		uint32_t root_port;
+		uint32_t root_bridge_index;
+		unsigned int message_age;
+		unsigned int remaining_hops;
+		bool out_of_reach;
+
+		bool operator> (const candidate& other) const
+		{
+			if (other.root_priority < root_priority)
+				return true;
+			if (root_priority < other.root_priority)
+				return false;
+			return bridge_index > other.bridge_index;
+		}
+	};
+
+	class oracle
+	{
+		const project& _project;
+		size_t const _bridge_count;
+		std::vector<STP_BRIDGE*> _stp_bridges;       // [bridge], null when STP isn't started on it
+		std::vector<std::vector<uint32_t>> _port_lans; // [bridge][port] -> index in _lans, or none when the port has no link
+		std::vector<std::vector<uint32_t>> _port_speeds; // [bridge][port] -> speed of the link
+		std::vector<lan> _lans;
+
+		// STP and RSTP bridges only take part in the CIST, whatever MSTIs they're created with.
+		bool in_tree (uint32_t b, unsigned int tree) const
+		{
+			if (_stp_bridges[b] == nullptr)
+				return false;
+			return (tree == 0) || ((STP_GetStpVersion(_stp_bridges[b]) == STP_VERSION_MSTP) && (tree <= STP_GetMstiCount(_stp_bridges[b])));
+		}
+
+		uint64_t bridge_id (uint32_t b, unsigned int tree) const
+		{
+			uint64_t id = STP_GetBridgePriority (_stp_bridges[b], tree);
+			for (unsigned char byte : STP_GetBridgeAddress(_stp_bridges[b])->bytes)
+				id = (id << 8) | byte;
+			return id;
+		}
+
+		uint16_t port_id (uint32_t b, uint32_t p, unsigned int tree) const
+		{
+			return STP_GetPortIdentifier (_stp_bridges[b], p, tree);
+		}
+
+		// Whether b and other exchange MST BPDUs with the same MST configuration, that is, are in the same region.
+		bool internal (uint32_t b, uint32_t other, const lan& l) const
+		{
+			if (l.legacy || (STP_GetStpVersion(_stp_bridges[b]) != STP_VERSION_MSTP) || (STP_GetStpVersion(_stp_bridges[other]) != STP_VERSION_MSTP))
+				return false;
+			return memcmp (STP_GetMstConfigId(_stp_bridges[b]), STP_GetMstConfigId(_stp_bridges[other]), sizeof(STP_MST_CONFIG_ID)) == 0;
+		}
+
+		uint32_t external_port_path_cost (uint32_t b, uint32_t p) const
+		{
+			uint32_t admin = STP_GetAdminExternalPortPathCost (_stp_bridges[b], p);
+			return (admin != 0) ? admin : default_port_path_cost (_port_speeds[b][p]);
+		}
+
+		uint32_t internal_port_path_cost (uint32_t b, uint32_t p, unsigned int tree) const
+		{
+			uint32_t admin = STP_GetAdminInternalPortPathCost (_stp_bridges[b], p, tree);
+			return (admin != 0) ? admin : default_port_path_cost (_port_speeds[b][p]);
+		}
+
+		// 13.27.20 in 802.1Q-2018
+		priority_vector designated_priority (const std::vector<bridge_state>& states, lan_member m, unsigned int tree, const lan& l) const
+		{
+			priority_vector v = states[m.bridge_index].root_priority;
+			v.designated_bridge_id = bridge_id (m.bridge_index, tree);
+			v.designated_port_id = port_id (m.bridge_index, m.port_index, tree);
+			v.rcv_port_id = 0;
+			if ((tree == 0) && l.legacy)
+				v.regional_root_id = v.designated_bridge_id;
+			return v;
+		}
+
+		void build_lans();
+		std::vector<bridge_state> find_root_priorities (unsigned int tree) const;
+
+	public:
+		explicit oracle (const project& project);
+		oracle_report check();
+	};
+
+	oracle::oracle (const project& project)
+		: _project(project), _bridge_count(project.bridges().size())
+	{
+		for (auto& b : project.bridges())
+			_stp_bridges.push_back (STP_IsBridgeStarted(b->stp_bridge()) ? b->stp_bridge() : nullptr);
+
+		build_lans();
+	}
+
+	void oracle::build_lans()
+	{
+		// Union-find over all ports of all bridges.
+		std::vector<uint32_t> first_port (_bridge_count + 1, 0);
+		for (uint32_t b = 0; b < _bridge_count; b++)
+			first_port[b + 1] = first_port[b] + (uint32_t) _project.bridges()[b]->ports().size();
+		std::vector<uint32_t> parent (first_port[_bridge_count]);
+		for (uint32_t n = 0; n < parent.size(); n++)
+			parent[n] = n;
+		auto find = [&parent](uint32_t n)
+		{
+			while (parent[n] != n)
+				n = parent[n] = parent[parent[n]];
+			return n;
+		};
+
+		// A bridge with STP disabled relays frames between all its ports, so they all count as one node.
+		for (uint32_t b = 0; b < _bridge_count; b++)
+		{
+			if (_stp_bridges[b] == nullptr)
+			{
+				for (uint32_t n = first_port[b] + 1; n < first_port[b + 1]; n++)
+					parent[find(n)] = find(first_port[b]);
+			}
+		}
+
+		std::vector<bool> has_link (parent.size(), false);
+		std::vector<bool> looped (parent.size(), false); // [node] -> whether a wire closed a loop in its set
+		_port_speeds.resize (_bridge_count);
+		for (uint32_t b = 0; b < _bridge_count; b++)
+			_port_speeds[b].resize (_project.bridges()[b]->ports().size(), 0);
+
+		for (const wire& w : _project.wires())
+		{
+			if (!w.connected)
+				continue;
+
+			const port* p0 = _project.bridges()[w.ends[0].bridge_index]->port_at(w.ends[0].port_index);
+			const port* p1 = _project.bridges()[w.ends[1].bridge_index]->port_at(w.ends[1].port_index);
+			uint32_t speed = std::min (p0->supported_speed(), p1->supported_speed());
+			for (const wire_end& end : w.ends)
+			{
+				has_link[first_port[end.bridge_index] + end.port_index] = true;
+				_port_speeds[end.bridge_index][end.port_index] = speed;
+			}
+
+			uint32_t r0 = find(first_port[w.ends[0].bridge_index] + w.ends[0].port_index);
+			uint32_t r1 = find(first_port[w.ends[1].bridge_index] + w.ends[1].port_index);
+			if (r0 == r1)
+				looped[r0] = true;
+			else
+			{
+				parent[r0] = r1;
+				looped[r1] = looped[r1] || looped[r0];
+			}
+		}
+
+		std::vector<uint32_t> root_lans (parent.size(), none);
+		_port_lans.resize (_bridge_count);
+		for (uint32_t b = 0; b < _bridge_count; b++)
+		{
+			_port_lans[b].assign (first_port[b + 1] - first_port[b], none);
+			if (_stp_bridges[b] == nullptr)
+				continue;
+
+			for (uint32_t p = 0; p < _port_lans[b].size(); p++)
+			{
+				if (!has_link[first_port[b] + p])
+					continue;
+
+				uint32_t& li = root_lans[find(first_port[b] + p)];
+				if (li == none)
+				{
+					li = (uint32_t) _lans.size();
+					_lans.emplace_back();
+				}
+
+				_port_lans[b][p] = li;
+				_lans[li].members.push_back ({ b, p });
+				_lans[li].looped = looped[find(first_port[b] + p)];
+				if (STP_GetStpVersion(_stp_bridges[b]) == STP_VERSION_LEGACY_STP)
+					_lans[li].legacy = true;
+			}
+		}
+	}
+
+	// The root priority vector and root port of each bridge in the tree, as the protocol converges to them.
+	std::vector<bridge_state> oracle::find_root_priorities (unsigned int tree) const
+	{
+		std::vector<bridge_state> states (_bridge_count);
+		std::priority_queue<candidate, std::vector<candidate>, std::greater<candidate>> queue;
+
+		// Each bridge starts as the root of its own tree.
+		for (uint32_t b = 0; b < _bridge_count; b++)
+		{
+			if (!in_tree(b, tree))
+				continue;
+
+			uint64_t id = bridge_id(b, tree);
+			priority_vector v = { (tree == 0) ? id : 0, 0, id, 0, id, 0, 0 };
+			queue.push ({ v, b, none, b, 0, max_hops, false });
+		}
+
+		while (!queue.empty())
+		{
+			candidate c = queue.top();
+			queue.pop();
+			bridge_state& state = states[c.bridge_index];
+			if (state.done)
+				continue;
+
+			state.done = true;
+			state.root_priority = c.root_priority;
+			state.root_port = c.root_port;
+			state.out_of_reach = c.out_of_reach;
+			unsigned int max_age = STP_GetBridgeMaxAge (_stp_bridges[c.root_bridge_index]);
+
+			// What this bridge sends out of each port reaches the other ports of its LAN: 13.10 and 13.11 in 802.1Q-2018.
+			for (uint32_t p = 0; p < _port_lans[c.bridge_index].size(); p++)
+			{
+				uint32_t li = _port_lans[c.bridge_index][p];
+				if (li == none)
+					continue;
+
+				const lan& l = _lans[li];
+				priority_vector designated = designated_priority (states, { c.bridge_index, p }, tree, l);
+				for (lan_member m : l.members)
+				{
+					if ((m.bridge_index == c.bridge_index) || !in_tree(m.bridge_index, tree) || states[m.bridge_index].done)
+						continue;
+
+					bool is_internal = internal (c.bridge_index, m.bridge_index, l);
+					if ((tree != 0) && !is_internal)
+						continue;
+
+					candidate next = { designated, m.bridge_index, m.port_index, c.root_bridge_index, c.message_age, c.remaining_hops, c.out_of_reach };
+					next.root_priority.rcv_port_id = port_id (m.bridge_index, m.port_index, tree);
+					if (is_internal)
+					{
+						next.root_priority.internal_root_path_cost += internal_port_path_cost (m.bridge_index, m.port_index, tree);
+						next.remaining_hops--;
+						if (next.remaining_hops == 0)
+							next.out_of_reach = true;
+					}
+					else
+					{
+						// From another region: the Designated Bridge Identifier is decoded from the BPDU field that
+						// carries the sender's Regional Root Identifier, and the receiver becomes the regional root.
+						next.root_priority.designated_bridge_id = designated.regional_root_id;
+						next.root_priority.external_root_path_cost += external_port_path_cost (m.bridge_index, m.port_index);
+						next.root_priority.regional_root_id = bridge_id (m.bridge_index, tree);
+						next.root_priority.internal_root_path_cost = 0;
+						next.message_age++;
+						next.remaining_hops = max_hops;
+						if (next.message_age > max_age)
+							next.out_of_reach = true;
+					}
+
+					// Information about itself is ignored by a bridge (13.29.33 c).
+					if (address_of(next.root_priority.designated_bridge_id) == address_of(bridge_id(m.bridge_index, tree)))
+						continue;
+
+					queue.push (next);
+				}
+			}
+		}
+
+		return states;
+	}
+
+	oracle_report oracle::check()
+	{
+		oracle_report report;
+		std::set<uint32_t> out_of_reach;
+
+		unsigned int tree_count = 1;
+		for (uint32_t b = 0; b < _bridge_count; b++)
+		{
+			if (_stp_bridges[b] != nullptr)
+				tree_count = std::max (tree_count, 1 + STP_GetMstiCount(_stp_bridges[b]));
+		}
+
+		std::vector<bridge_state> cist_states;
+		std::vector<std::vector<STP_PORT_ROLE>> cist_roles (_bridge_count); // [bridge][port], as expected
+		for (unsigned int tree = 0; tree < tree_count; tree++)
+		{
+			std::vector<bridge_state> states = find_root_priorities(tree);
+			if (tree == 0)
+				cist_states = states;
+
+			// A bridge the protocol can't reach in the CIST doesn't converge in the MSTIs either.
+			for (uint32_t b = 0; b < _bridge_count; b++)
+			{
+				if (in_tree(b, tree) && (states[b].out_of_reach || cist_states[b].out_of_reach))
+				{
+					states[b].out_of_reach = true;
+					out_of_reach.insert (b);
+				}
+			}
+
+			for (uint32_t b = 0; b < _bridge_count; b++)
+			{
+				if (!in_tree(b, tree))
+					continue;
+
+				if (tree == 0)
+					cist_roles[b].assign (_port_lans[b].size(), STP_PORT_ROLE_UNDEFINED);
+
+				for (uint32_t p = 0; p < _port_lans[b].size(); p++)
+				{
+					STP_PORT_ROLE expected;
+					uint32_t li = _port_lans[b][p];
+					if (li == none)
+						expected = STP_PORT_ROLE_DISABLED;
+					else
+					{
+						const lan& l = _lans[li];
+						bool reachable = true;
+						for (lan_member m : l.members)
+							reachable &= !(in_tree(m.bridge_index, tree) && states[m.bridge_index].out_of_reach);
+						if (!reachable)
+							continue;
+
+						if (l.looped)
+						{
+							report.ports_on_looped_lans++;
+							continue;
+						}
+
+						// The port with the best designated priority vector is the LAN's designated port (13.10 and
+						// 13.11); in an MSTI, among the ports of this bridge's region only.
+						auto designated_of = [&](unsigned int t, const std::vector<bridge_state>& s)
+						{
+							const lan_member* best = nullptr;
+							priority_vector best_priority = { };
+							for (const lan_member& m : l.members)
+							{
+								if (!in_tree(m.bridge_index, t) || ((t != 0) && (m.bridge_index != b) && !internal(m.bridge_index, b, l)))
+									continue;
+
+								priority_vector v = designated_priority (s, m, t, l);
+								if ((best == nullptr) || (v < best_priority))
+								{
+									best = &m;
+									best_priority = v;
+								}
+							}
+
+							return best;
+						};
+
+						const lan_member* cist_designated = designated_of (0, cist_states);
+						bool boundary = (cist_designated->bridge_index != b) && !internal (cist_designated->bridge_index, b, l);
+						if ((tree != 0) && boundary && (cist_roles[b][p] == STP_PORT_ROLE_ROOT))
+							expected = STP_PORT_ROLE_MASTER; // 13.29.33 g)
+						else if ((tree != 0) && boundary && (cist_roles[b][p] == STP_PORT_ROLE_ALTERNATE))
+							expected = STP_PORT_ROLE_ALTERNATE; // 13.29.33 h)
+						else
+						{
+							const lan_member* designated = (tree == 0) ? cist_designated : designated_of (tree, states);
+							if ((designated->bridge_index == b) && (designated->port_index == p))
+								expected = STP_PORT_ROLE_DESIGNATED;
+							else if (states[b].root_port == p)
+								expected = STP_PORT_ROLE_ROOT;
+							else if (address_of(bridge_id(designated->bridge_index, tree)) == address_of(bridge_id(b, tree)))
+								expected = STP_PORT_ROLE_BACKUP;
+							else
+								expected = STP_PORT_ROLE_ALTERNATE;
+						}
+					}
+
+					if (tree == 0)
+						cist_roles[b][p] = expected;
+
+					if (states[b].out_of_reach)
+						continue;
+
+					report.ports_checked++;
+					STP_PORT_ROLE actual = STP_GetPortRole (_stp_bridges[b], p, tree);
+					if (actual != expected)
+						report.mismatches.push_back ({ b, p, tree, expected, actual });
+				}
+			}
+		}
+
+		report.bridges_out_of_reach = out_of_reach.size();
+		return report;
+	}
+}
+
+oracle_report check_port_roles (const project& project)
+{
+	return oracle(project).check();
+}
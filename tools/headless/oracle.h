@@ -0,0 +1,40 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "project.h"
+
+// A port whose role in the simulation isn't the one the oracle expects.
+struct role_mismatch
+{
+	uint32_t bridge_index;
+	uint32_t port_index;
+	unsigned int tree;
+	STP_PORT_ROLE expected;
+	STP_PORT_ROLE actual;
+};
+
+struct oracle_report
+{
+	size_t ports_checked = 0;        // port roles compared, counted once per tree
+	size_t bridges_out_of_reach = 0; // bridges further from their root than Max Age or Max Hops allow; not checked
+	size_t ports_on_looped_lans = 0; // not checked either, counted once per tree
+	std::vector<role_mismatch> mismatches;
+};
+
+// Spanning tree oracle: works out, from the configuration alone (bridge and port priorities, path costs, MST regions)
+// and the wires that are connected, the port roles a converged network must have, and compares them with the roles
+// the library reports (STP_GetPortRole).
+//
+// The expected roles come from a shortest-path computation over the priority vectors of 802.1Q-2018 13.10 and 13.11:
+// a Dijkstra search from every bridge at once, with the vectors in place of distances, as the root path priority
+// vector of a bridge is always worse than the designated priority vector it was calculated from. The bridges with
+// STP disabled relay BPDUs, so the ports they connect form one shared LAN.
+//
+// Information that is too old (Message Age above Max Age) or has gone too many hops inside a region (Max Hops) is
+// discarded by the protocol, and the network then doesn't converge to the shortest-path trees; the bridges it
+// happens to, and the LANs they're on, are counted in bridges_out_of_reach and left out of the check. So are the LANs
+// whose bridges with STP disabled are wired in a loop: BPDUs come back to the ports that sent them, which then keep
+// going between the Designated and Backup roles.
+oracle_report check_port_roles (const project& project);
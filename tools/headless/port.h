@@ -0,0 +1,49 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <variant>
+#include <vector>
+
+using mac_address = std::array<uint8_t, 6>;
+
+// Same packet model as the GUI simulator (simulator/port.h).
+struct frame_t
+{
+	uint32_t timestamp;
+	std::shared_ptr<const std::vector<uint8_t>> data; // never changed once sent, so shared by all copies of a flooded frame
+};
+
+struct link_pulse_t
+{
+	uint32_t timestamp;
+	uint32_t sender_supported_speed;
+};
+
+using packet_t = std::variant<link_pulse_t, frame_t>;
+
+class port
+{
+	friend class bridge;
+
+	size_t const _port_index;
+	uint32_t _supported_speed = 100;
+	uint32_t _actual_speed = 0;
+
+	static constexpr uint32_t MissedLinkPulseCounterMax = 3;
+	uint32_t _missedLinkPulseCounter = MissedLinkPulseCounterMax;
+
+public:
+	explicit port (size_t port_index) : _port_index(port_index) { }
+
+	size_t port_index() const { return _port_index; }
+	uint32_t supported_speed() const { return _supported_speed; }
+	void set_supported_speed (uint32_t speed) { _supported_speed = speed; }
+	uint32_t actual_speed() const { return _actual_speed; }
+	bool mac_operational() const { return _missedLinkPulseCounter < MissedLinkPulseCounterMax; }
+};
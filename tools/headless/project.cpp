@@ -0,0 +1,988 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "project.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	struct statement
+	{
+		unsigned int line_number;
+		std::vector<std::string> tokens;
+	};
+
+	class parser
+	{
+		const char* const _path;
+		unsigned int _line_number = 0;
+
+	public:
+		explicit parser (const char* path) : _path(path) { }
+
+		void set_line (unsigned int line_number) { _line_number = line_number; }
+
+		[[noreturn]] void error (const std::string& message) const
+		{
+			std::stringstream ss;
+			ss << _path << ':' << _line_number << ": " << message;
+			throw std::runtime_error(ss.str());
+		}
+
+		unsigned long number (const std::string& str, unsigned long max) const
+		{
+			size_t end;
+			unsigned long value;
+			try
+			{
+				value = std::stoul (str, &end, 0);
+			}
+			catch (const std::exception&)
+			{
+				error ("'" + str + "' is not a number");
+			}
+
+			if ((end != str.size()) || (value > max))
+				error ("'" + str + "' is not a number between 0 and " + std::to_string(max));
+
+			return value;
+		}
+
+		double percent (const std::string& str) const
+		{
+			char* end;
+			double value = strtod (str.c_str(), &end);
+			if ((*end != 0) || !(value >= 0) || (value > 100))
+				error ("'" + str + "' is not a percentage between 0 and 100");
+			return value / 100;
+		}
+
+		bool boolean (const std::string& str) const
+		{
+			if ((str == "1") || (str == "on") || (str == "true"))
+				return true;
+			if ((str == "0") || (str == "off") || (str == "false"))
+				return false;
+			error ("'" + str + "' is not a boolean");
+		}
+
+		std::pair<std::string, std::string> key_value (const std::string& token) const
+		{
+			auto eq = token.find('=');
+			if ((eq == std::string::npos) || (eq == 0))
+				error ("expected key=value instead of '" + token + "'");
+			return { token.substr(0, eq), token.substr(eq + 1) };
+		}
+
+		mac_address address (const std::string& str) const
+		{
+			std::string hex;
+			for (char c : str)
+			{
+				if (c != ':')
+					hex.push_back(c);
+			}
+
+			if ((hex.size() != 12) || (hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos))
+				error ("invalid address '" + str + "'. The address must have the format XX:XX:XX:XX:XX:XX or XXXXXXXXXXXX (6 hex bytes).");
+
+			mac_address address;
+			for (size_t i = 0; i < 6; i++)
+				address[i] = (uint8_t) std::stoul (hex.substr(i * 2, 2), nullptr, 16);
+			return address;
+		}
+	};
+
+	std::vector<statement> read_statements (std::istream& in)
+	{
+		std::vector<statement> statements;
+		std::string line;
+		for (unsigned int line_number = 1; std::getline(in, line); line_number++)
+		{
+			auto comment = line.find('#');
+			if (comment != std::string::npos)
+				line.resize(comment);
+
+			std::istringstream ss (line);
+			statement s = { line_number };
+			std::string token;
+			while (ss >> token)
+				s.tokens.push_back (std::move(token));
+
+			if (!s.tokens.empty())
+				statements.push_back (std::move(s));
+		}
+
+		return statements;
+	}
+}
+
+void project::load (const char* path)
+{
+	std::ifstream file (path);
+	if (!file)
+		throw std::runtime_error(std::string(path) + ": cannot open");
+
+	load (file, path);
+}
+
+void project::load (std::istream& in, const char* name)
+{
+	assert (_bridges.empty());
+
+	std::vector<statement> statements = read_statements(in);
+	parser p (name);
+
+	// The MST configuration table goes to every bridge, so collect it first.
+	unsigned int max_vlan_number = 16;
+	std::map<unsigned int, unsigned int> vlan_trees;
+	for (const statement& s : statements)
+	{
+		if (s.tokens[0] != "vlan")
+			continue;
+
+		p.set_line (s.line_number);
+		if (s.tokens.size() != 3)
+			p.error ("expected: vlan FIRST[-LAST] TREE");
+
+		const std::string& range = s.tokens[1];
+		auto dash = range.find('-');
+		unsigned int first = (unsigned int) p.number (range.substr(0, dash), 4094);
+		unsigned int last = (dash == std::string::npos) ? first : (unsigned int) p.number (range.substr(dash + 1), 4094);
+		unsigned int tree = (unsigned int) p.number (s.tokens[2], 64);
+		if ((first == 0) || (first > last))
+			p.error ("invalid VLAN range '" + range + "'");
+
+		for (unsigned int vlan = first; vlan <= last; vlan++)
+			vlan_trees[vlan] = tree;
+		max_vlan_number = std::max (max_vlan_number, last);
+	}
+
+	std::vector<STP_CONFIG_TABLE_ENTRY> config_table (1 + max_vlan_number);
+	unsigned int max_table_tree = 0;
+	for (auto& [vlan, tree] : vlan_trees)
+	{
+		config_table[vlan].treeIndex = (unsigned char) tree;
+		max_table_tree = std::max (max_table_tree, tree);
+	}
+
+	std::map<unsigned int, unsigned int> tree_vlans;
+	for (unsigned int vlan = max_vlan_number; vlan >= 1; vlan--)
+		tree_vlans[config_table[vlan].treeIndex] = vlan;
+	for (auto& [tree, vlan] : tree_vlans)
+		_loop_check_vlans.push_back (vlan);
+
+	std::map<std::string, uint32_t> bridge_indexes;
+	std::vector<bool> start_stp;
+
+	auto port_ref = [&](const std::string& token) -> wire_end
+	{
+		auto colon = token.find(':');
+		if (colon == std::string::npos)
+			p.error ("expected BRIDGE:PORT instead of '" + token + "'");
+		auto it = bridge_indexes.find(token.substr(0, colon));
+		if (it == bridge_indexes.end())
+			p.error ("no bridge named '" + token.substr(0, colon) + "' above this line");
+		size_t port_count = _bridges[it->second]->ports().size();
+		auto port_index = (uint32_t) p.number (token.substr(colon + 1), port_count - 1);
+		return { it->second, port_index };
+	};
+
+	// priority=N or priorityK=N
+	auto bridge_priority = [&p](const std::string& key, const std::string& value, size_t msti_count) -> std::pair<unsigned int, unsigned short>
+	{
+		unsigned int tree = (key.size() == 8) ? 0 : (unsigned int) p.number (key.substr(8), msti_count);
+		auto priority = (unsigned short) p.number (value, 0xF000);
+		if (priority % 0x1000)
+			p.error ("a bridge priority must be a multiple of 4096");
+		return { tree, priority };
+	};
+
+	for (const statement& s : statements)
+	{
+		p.set_line (s.line_number);
+		const std::string& keyword = s.tokens[0];
+		if (keyword == "vlan")
+			continue;
+
+		if (keyword == "bridge")
+		{
+			if (s.tokens.size() < 3)
+				p.error ("expected: bridge NAME PORT_COUNT [MSTI_COUNT] [key=value...]");
+
+			const std::string& name = s.tokens[1];
+			if (name.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-") != std::string::npos)
+				p.error ("invalid bridge name '" + name + "'");
+			if (bridge_indexes.find(name) != bridge_indexes.end())
+				p.error ("there is already a bridge named '" + name + "'");
+
+			auto port_count = (size_t) p.number (s.tokens[2], 4095);
+			if (port_count == 0)
+				p.error ("a bridge must have at least one port");
+
+			size_t next = 3;
+			size_t msti_count = 0;
+			if ((s.tokens.size() > 3) && (s.tokens[3].find('=') == std::string::npos))
+				msti_count = (size_t) p.number (s.tokens[next++], 64);
+
+			if (!vlan_trees.empty() && (max_table_tree > msti_count))
+				p.error ("the vlan statements use tree " + std::to_string(max_table_tree) + ", but this bridge has " + std::to_string(msti_count) + " MSTIs");
+
+			// Leave room for the port addresses (bridge address + 1, + 2 ...) of up to 4095 ports.
+			auto index = (uint32_t) _bridges.size();
+			mac_address address = { 0x02, 0x00, (uint8_t) (index >> 12), (uint8_t) (index >> 4), (uint8_t) (index << 4), 0x00 };
+			bool stp = true;
+			STP_VERSION version = STP_VERSION_MSTP;
+			std::string region = "default";
+			std::vector<std::pair<unsigned int, unsigned short>> priorities;
+			for (; next < s.tokens.size(); next++)
+			{
+				auto [key, value] = p.key_value(s.tokens[next]);
+				if (key == "address")
+					address = p.address(value);
+				else if (key == "version")
+				{
+					if (value == "stp")
+						version = STP_VERSION_LEGACY_STP;
+					else if (value == "rstp")
+						version = STP_VERSION_RSTP;
+					else if (value == "mstp")
+						version = STP_VERSION_MSTP;
+					else
+						p.error ("version must be stp, rstp or mstp");
+				}
+				else if (key == "region")
+					region = value;
+				else if (key == "stp")
+					stp = p.boolean(value);
+				else if (key.compare(0, 8, "priority") == 0)
+					priorities.push_back (bridge_priority (key, value, msti_count));
+				else
+					p.error ("unknown bridge setting '" + key + "'");
+			}
+
+			if (region.size() > 32)
+				p.error ("the region name must have at most 32 characters");
+
+			auto b = std::make_unique<bridge>(this, index, name, port_count, msti_count, max_vlan_number, address);
+			STP_SetStpVersion (b->stp_bridge(), version, 0);
+			STP_SetMstConfigName (b->stp_bridge(), region.c_str(), 0);
+			if (!vlan_trees.empty())
+				STP_SetMstConfigTable (b->stp_bridge(), config_table.data(), (unsigned int) config_table.size(), 0);
+			for (auto [tree, priority] : priorities)
+				STP_SetBridgePriority (b->stp_bridge(), tree, priority, 0);
+
+			bridge_indexes.insert ({ name, index });
+			_bridges.push_back (std::move(b));
+			_port_wires.push_back (std::vector<uint32_t>(port_count, no_wire));
+			start_stp.push_back (stp);
+		}
+		else if (keyword == "port")
+		{
+			if (s.tokens.size() < 2)
+				p.error ("expected: port BRIDGE:PORT [key=value...]");
+
+			wire_end ref = port_ref(s.tokens[1]);
+			bridge* b = _bridges[ref.bridge_index].get();
+			for (size_t i = 2; i < s.tokens.size(); i++)
+			{
+				auto [key, value] = p.key_value(s.tokens[i]);
+				if (key == "speed")
+					b->port_at(ref.port_index)->set_supported_speed ((uint32_t) p.number (value, 10000000));
+				else if (key == "cost")
+					STP_SetAdminExternalPortPathCost (b->stp_bridge(), ref.port_index, (unsigned int) p.number (value, 200000000), 0);
+				else if (key == "priority")
+				{
+					auto priority = (unsigned char) p.number (value, 240);
+					if (priority % 16)
+						p.error ("a port priority must be a multiple of 16");
+					STP_SetPortPriority (b->stp_bridge(), ref.port_index, 0, priority, 0);
+				}
+				else if (key == "edge")
+					STP_SetPortAdminEdge (b->stp_bridge(), ref.port_index, p.boolean(value), 0);
+				else if (key == "auto_edge")
+					STP_SetPortAutoEdge (b->stp_bridge(), ref.port_index, p.boolean(value), 0);
+				else
+					p.error ("unknown port setting '" + key + "'");
+			}
+		}
+		else if (keyword == "wire")
+		{
+			if (s.tokens.size() < 3)
+				p.error ("expected: wire BRIDGE:PORT BRIDGE:PORT [delay=MICROSECONDS] [connected=0|1] [loss=PERCENT]");
+
+			wire w = { { port_ref(s.tokens[1]), port_ref(s.tokens[2]) }, default_wire_delay, true };
+			for (size_t i = 3; i < s.tokens.size(); i++)
+			{
+				auto [key, value] = p.key_value(s.tokens[i]);
+				if (key == "delay")
+				{
+					w.delay = p.number (value, 10 * usec_per_sec);
+					if (w.delay == 0)
+						p.error ("the delay of a wire must be at least 1 microsecond");
+				}
+				else if (key == "connected")
+					w.connected = p.boolean(value);
+				else if (key == "loss")
+					w.loss = p.percent(value);
+				else
+					p.error ("unknown wire setting '" + key + "'");
+			}
+
+			for (const wire_end& end : w.ends)
+			{
+				if (_port_wires[end.bridge_index][end.port_index] != no_wire)
+					p.error ("port " + _bridges[end.bridge_index]->name() + ":" + std::to_string(end.port_index) + " already has a wire");
+				_port_wires[end.bridge_index][end.port_index] = (uint32_t) _wires.size();
+			}
+
+			_wires.push_back (w);
+		}
+		else if (keyword == "traffic")
+		{
+			if (s.tokens.size() < 3)
+				p.error ("expected: traffic BRIDGE BRIDGE [rate=FRAMES_PER_SECOND] [vlan=N]");
+
+			uint32_t ends[2];
+			for (size_t i = 0; i < 2; i++)
+			{
+				auto it = bridge_indexes.find(s.tokens[1 + i]);
+				if (it == bridge_indexes.end())
+					p.error ("no bridge named '" + s.tokens[1 + i] + "' above this line");
+				ends[i] = it->second;
+			}
+
+			if (ends[0] == ends[1])
+				p.error ("the traffic must be between two different bridges");
+
+			unsigned long rate = 100;
+			unsigned int vlan = 1;
+			for (size_t i = 3; i < s.tokens.size(); i++)
+			{
+				auto [key, value] = p.key_value(s.tokens[i]);
+				if (key == "rate")
+				{
+					rate = p.number (value, usec_per_sec);
+					if (rate == 0)
+						p.error ("the rate must be at least 1 frame per second");
+				}
+				else if (key == "vlan")
+				{
+					vlan = (unsigned int) p.number (value, max_vlan_number);
+					if (vlan == 0)
+						p.error ("VLAN numbers start at 1");
+				}
+				else
+					p.error ("unknown traffic setting '" + key + "'");
+			}
+
+			_flows.push_back ({ ends[0], ends[1], vlan, usec_per_sec / rate });
+			_flows.push_back ({ ends[1], ends[0], vlan, usec_per_sec / rate });
+		}
+		else if (keyword == "at")
+		{
+			const char* usage = "expected: at SECONDS connect|disconnect BRIDGE:PORT, at SECONDS fail|restart BRIDGE, "
+				"at SECONDS set BRIDGE priority[K]=N or at SECONDS loss BRIDGE:PORT PERCENT";
+			if (s.tokens.size() < 4)
+				p.error (usage);
+
+			char* end;
+			double seconds = strtod (s.tokens[1].c_str(), &end);
+			if ((*end != 0) || !(seconds >= 0))
+				p.error ("'" + s.tokens[1] + "' is not a time in seconds");
+			auto time = (sim_time) (seconds * usec_per_sec);
+
+			const std::string& action = s.tokens[2];
+			if ((action == "connect") || (action == "disconnect"))
+			{
+				if (s.tokens.size() != 4)
+					p.error (usage);
+
+				wire_end ref = port_ref(s.tokens[3]);
+				uint32_t wire_index = _port_wires[ref.bridge_index][ref.port_index];
+				if (wire_index == no_wire)
+					p.error ("there's no wire at " + s.tokens[3] + " above this line");
+
+				auto kind = (action == "connect") ? script_action::kind_t::connect : script_action::kind_t::disconnect;
+				_script.push_back ({ time, kind, wire_index });
+			}
+			else if (action == "loss")
+			{
+				if (s.tokens.size() != 5)
+					p.error (usage);
+
+				wire_end ref = port_ref(s.tokens[3]);
+				uint32_t wire_index = _port_wires[ref.bridge_index][ref.port_index];
+				if (wire_index == no_wire)
+					p.error ("there's no wire at " + s.tokens[3] + " above this line");
+
+				script_action a = { time, script_action::kind_t::set_loss, wire_index };
+				a.loss = p.percent(s.tokens[4]);
+				_script.push_back (a);
+			}
+			else if ((action == "fail") || (action == "set") || (action == "restart"))
+			{
+				auto it = bridge_indexes.find(s.tokens[3]);
+				if (it == bridge_indexes.end())
+					p.error ("no bridge named '" + s.tokens[3] + "' above this line");
+
+				if (action == "restart")
+				{
+					if (s.tokens.size() != 4)
+						p.error (usage);
+
+					_script.push_back ({ time, script_action::kind_t::restart, it->second });
+				}
+				else if (action == "fail")
+				{
+					if (s.tokens.size() != 4)
+						p.error (usage);
+
+					for (uint32_t wire_index : _port_wires[it->second])
+					{
+						if (wire_index != no_wire)
+							_script.push_back ({ time, script_action::kind_t::disconnect, wire_index });
+					}
+				}
+				else
+				{
+					if (s.tokens.size() != 5)
+						p.error (usage);
+
+					auto [key, value] = p.key_value(s.tokens[4]);
+					if (key.compare(0, 8, "priority") != 0)
+						p.error ("unknown bridge setting '" + key + "'");
+
+					auto [tree, priority] = bridge_priority (key, value, STP_GetMstiCount(_bridges[it->second]->stp_bridge()));
+					_script.push_back ({ time, script_action::kind_t::set_priority, it->second, tree, priority });
+				}
+			}
+			else
+				p.error (usage);
+		}
+		else
+			p.error ("unknown statement '" + keyword + "'");
+	}
+
+	for (size_t i = 0; i < _bridges.size(); i++)
+	{
+		if (start_stp[i])
+			STP_StartBridge (_bridges[i]->stp_bridge(), 0);
+	}
+}
+
+// Barrier for the threads of a parallel run. Windows are often short (a few events per partition),
+// so the threads spin rather than sleep, yielding only if a barrier takes long.
+class spin_barrier
+{
+	unsigned int const _count;
+	std::atomic<unsigned int> _waiting { 0 };
+	std::atomic<unsigned int> _generation { 0 };
+
+public:
+	explicit spin_barrier (unsigned int count) : _count(count) { }
+
+	void wait()
+	{
+		unsigned int generation = _generation.load (std::memory_order_acquire);
+		if (_waiting.fetch_add (1, std::memory_order_acq_rel) + 1 == _count)
+		{
+			_waiting.store (0, std::memory_order_relaxed);
+			_generation.fetch_add (1, std::memory_order_release);
+			return;
+		}
+
+		for (unsigned int spins = 0; _generation.load (std::memory_order_acquire) == generation; spins++)
+		{
+			if (spins >= 1000)
+				std::this_thread::yield();
+		}
+	}
+};
+
+void project::schedule (sim_time time, uint32_t target, uint32_t origin, event_type type, uint32_t port_index, packet_t&& packet)
+{
+	uint64_t seq = (origin < _bridges.size()) ? _bridges[origin]->next_event_seq() : _next_event_seq++;
+	event e = { time, target, origin, seq, type, port_index, std::move(packet) };
+
+	uint32_t to = _bridge_partitions[target];
+	if (origin < _bridges.size())
+	{
+		uint32_t from = _bridge_partitions[origin];
+		if (from != to)
+		{
+			assert (time >= _window_end);
+			_partitions[from].outboxes[to].push_back (std::move(e));
+			return;
+		}
+	}
+
+	_partitions[to].sched.schedule (std::move(e));
+}
+
+void project::make_partitions (size_t thread_count)
+{
+	// Contiguous ranges of bridges, as topology files tend to list neighbours close together.
+	size_t partition_count = std::max ((size_t) 1, std::min (thread_count, _bridges.size()));
+	_partitions.resize (partition_count);
+	for (partition& p : _partitions)
+		p.outboxes.resize (partition_count);
+	_bridge_partitions.resize (_bridges.size());
+	for (size_t bi = 0; bi < _bridges.size(); bi++)
+		_bridge_partitions[bi] = (uint32_t) (bi * partition_count / _bridges.size());
+
+	_lookahead = UINT64_MAX;
+	for (const wire& w : _wires)
+	{
+		if (_check_loops || (_bridge_partitions[w.ends[0].bridge_index] != _bridge_partitions[w.ends[1].bridge_index]))
+			_lookahead = std::min (_lookahead, w.delay);
+	}
+}
+
+void project::start (uint32_t seed, bool poll_link_pulses, size_t thread_count, bool check_loops)
+{
+	_seed = seed;
+	_poll_link_pulses = poll_link_pulses;
+	_check_loops = check_loops;
+	_loop_wire_counts.assign (_loop_check_vlans.size(), 0);
+	_wires_changed = true;
+	make_partitions (thread_count);
+
+	std::mt19937 random (seed);
+	auto project_origin = (uint32_t) _bridges.size();
+	for (uint32_t bi = 0; bi < _bridges.size(); bi++)
+	{
+		sim_time link_pulse_phase = random() % link_pulse_period;
+		sim_time tick_phase = random() % usec_per_sec;
+
+		if (_poll_link_pulses)
+			schedule (link_pulse_phase, bi, project_origin, event_type::link_pulse_tick);
+
+		// The one-second ticks of a bridge with STP disabled would do nothing.
+		if (STP_IsBridgeStarted(_bridges[bi]->stp_bridge()))
+			schedule (tick_phase, bi, project_origin, event_type::one_second_tick);
+	}
+
+	for (uint32_t fi = 0; fi < _flows.size(); fi++)
+		schedule (random() % _flows[fi].period, _flows[fi].source, project_origin, event_type::traffic_tick, fi);
+
+	if (!_poll_link_pulses)
+	{
+		for (const wire& w : _wires)
+		{
+			if (w.connected)
+				schedule_link_change (w, w.delay, true);
+		}
+	}
+
+	std::stable_sort (_script.begin(), _script.end(), [](const script_action& a, const script_action& b) { return a.time < b.time; });
+}
+
+std::unique_ptr<project> project::fork (size_t thread_count, uint32_t seed) const
+{
+	auto f = std::make_unique<project>();
+	for (auto& b : _bridges)
+		f->_bridges.push_back (std::make_unique<bridge>(f.get(), *b));
+	f->_wires = _wires;
+	f->_port_wires = _port_wires;
+	f->_script = _script;
+	f->_flows = _flows;
+	f->_next_action = _next_action;
+	f->_now = _now;
+	f->_window_end = _window_end;
+	f->_next_event_seq = _next_event_seq;
+	f->_poll_link_pulses = _poll_link_pulses;
+	f->_seed = seed;
+	f->_check_loops = _check_loops;
+	f->_wires_changed = _wires_changed;
+	f->_loop_check_vlans = _loop_check_vlans;
+	f->_loop_wire_counts = _loop_wire_counts;
+	f->_loop_alarms = _loop_alarms;
+	f->make_partitions (thread_count);
+
+	// Between two calls to run_until the outboxes are empty, and the pending events all in the schedulers.
+	for (const partition& p : _partitions)
+	{
+		f->_partitions[0].stats.events            += p.stats.events;
+		f->_partitions[0].stats.link_pulse_ticks  += p.stats.link_pulse_ticks;
+		f->_partitions[0].stats.one_second_ticks  += p.stats.one_second_ticks;
+		f->_partitions[0].stats.packets_delivered += p.stats.packets_delivered;
+		f->_partitions[0].stats.packets_unwired   += p.stats.packets_unwired;
+		f->_partitions[0].stats.packets_lost      += p.stats.packets_lost;
+		f->_partitions[0].stats.link_changes      += p.stats.link_changes;
+		assert (std::all_of (p.outboxes.begin(), p.outboxes.end(), [](const std::vector<event>& outbox) { return outbox.empty(); }));
+		for (const event& e : p.sched.events())
+			f->_partitions[f->_bridge_partitions[e.target]].sched.schedule (event(e));
+	}
+
+	return f;
+}
+
+void project::add_action (const script_action& a)
+{
+	assert (!_partitions.empty() && (a.time > _now));
+	auto later = std::upper_bound (_script.begin() + _next_action, _script.end(), a.time,
+								   [](sim_time time, const script_action& b) { return time < b.time; });
+	_script.insert (later, a);
+}
+
+void project::schedule_link_change (const wire& w, sim_time time, bool up)
+{
+	auto project_origin = (uint32_t) _bridges.size();
+	for (size_t i = 0; i < 2; i++)
+	{
+		const wire_end& end = w.ends[i];
+		if (up)
+		{
+			uint32_t far_end_speed = _bridges[w.ends[1 - i].bridge_index]->port_at(w.ends[1 - i].port_index)->supported_speed();
+			schedule (time, end.bridge_index, project_origin, event_type::link_up, end.port_index, link_pulse_t { to_timestamp(time), far_end_speed });
+		}
+		else
+			schedule (time, end.bridge_index, project_origin, event_type::link_down, end.port_index);
+	}
+}
+
+void project::apply (const script_action& a)
+{
+	if (a.kind == script_action::kind_t::set_priority)
+	{
+		_bridges[a.index]->SetBridgePriority (a.time, a.tree, a.priority);
+		return;
+	}
+
+	if (a.kind == script_action::kind_t::restart)
+	{
+		_bridges[a.index]->RestartStp (a.time);
+		return;
+	}
+
+	if (a.kind == script_action::kind_t::set_loss)
+	{
+		_wires[a.index].loss = a.loss;
+		return;
+	}
+
+	wire& w = _wires[a.index];
+	bool connect = (a.kind == script_action::kind_t::connect);
+	if (w.connected != connect)
+	{
+		w.connected = connect;
+		_wires_changed = true;
+		if (!_poll_link_pulses)
+			schedule_link_change (w, a.time + (connect ? w.delay : link_down_delay), connect);
+	}
+}
+
+// Only called between windows: a bridge that sends a BPDU while a script action is applied puts it in an outbox,
+// and the BPDU could be due in the next window, before the outboxes are emptied at its end.
+void project::deliver_outboxes()
+{
+	for (partition& from : _partitions)
+	{
+		for (size_t to = 0; to < _partitions.size(); to++)
+		{
+			for (event& e : from.outboxes[to])
+				_partitions[to].sched.schedule (std::move(e));
+			from.outboxes[to].clear();
+		}
+	}
+}
+
+// A number in [0, 1) picked by hashing the arguments (splitmix64's finalizer).
+static double draw (uint32_t seed, uint32_t bridge_index, uint64_t seq)
+{
+	uint64_t x = (((uint64_t) seed << 32) | bridge_index) ^ (seq * 0x9E3779B97F4A7C15ull);
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	x ^= x >> 31;
+	return (double) (x >> 11) / (double) (1ull << 53);
+}
+
+void project::on_packet_transmit (bridge* bridge, size_t txPortIndex, packet_t&& packet, sim_time now)
+{
+	uint32_t wire_index = _port_wires[bridge->index()][txPortIndex];
+	if ((wire_index == no_wire) || !_wires[wire_index].connected)
+	{
+		_partitions[_bridge_partitions[bridge->index()]].stats.packets_unwired++;
+		return;
+	}
+
+	const wire& w = _wires[wire_index];
+	if ((w.loss > 0) && std::holds_alternative<frame_t>(packet) && (draw (_seed, bridge->index(), bridge->next_event_seq()) < w.loss))
+	{
+		_partitions[_bridge_partitions[bridge->index()]].stats.packets_lost++;
+		return;
+	}
+
+	const wire_end& rx = ((w.ends[0].bridge_index == bridge->index()) && (w.ends[0].port_index == txPortIndex)) ? w.ends[1] : w.ends[0];
+	schedule (now + w.delay, rx.bridge_index, bridge->index(), event_type::packet_arrival, rx.port_index, std::move(packet));
+}
+
+void project::on_forwarding_changed (bridge* bridge)
+{
+	// Changes while loading come before the partitions exist; start checks for loops anyway.
+	if (!_partitions.empty())
+		_partitions[_bridge_partitions[bridge->index()]].forwarding_changed = true;
+}
+
+void project::on_data_frame_received (bridge* bridge, uint32_t flow_index, uint32_t seq)
+{
+	traffic_flow& f = _flows[flow_index];
+	assert (f.destination == bridge->index());
+	if (seq >= f.received.size())
+		f.received.resize (seq + 1);
+
+	if (f.received[seq])
+		f.duplicates++;
+	else
+	{
+		f.received[seq] = true;
+		f.delivered++;
+	}
+}
+
+bool project::port_forwarding (const wire_end& end, unsigned int vlan) const
+{
+	// Like port::IsForwarding in the GUI simulator: a bridge with STP disabled forwards on all ports.
+	STP_BRIDGE* b = _bridges[end.bridge_index]->stp_bridge();
+	if (!STP_IsBridgeStarted(b))
+		return true;
+	return STP_GetPortForwarding (b, end.port_index, STP_GetTreeIndexFromVlanNumber(b, vlan));
+}
+
+void project::check_loops()
+{
+	for (size_t i = 0; i < _loop_check_vlans.size(); i++)
+	{
+		unsigned int vlan = _loop_check_vlans[i];
+		_forwarding_graph.clear (_bridges.size());
+		for (const wire& w : _wires)
+		{
+			if (w.connected && port_forwarding(w.ends[0], vlan) && port_forwarding(w.ends[1], vlan))
+				_forwarding_graph.add_edge (w.ends[0].bridge_index, w.ends[1].bridge_index);
+		}
+
+		_forwarding_graph.find_loops();
+		if (_forwarding_graph.loop_edge_count() != _loop_wire_counts[i])
+		{
+			_loop_wire_counts[i] = _forwarding_graph.loop_edge_count();
+			_loop_alarms.push_back ({ _now, vlan, _loop_wire_counts[i] });
+		}
+	}
+}
+
+void project::handle (event&& e)
+{
+	bridge* b = _bridges[e.target].get();
+	project_stats& stats = _partitions[_bridge_partitions[e.target]].stats;
+	stats.events++;
+	switch (e.type)
+	{
+		case event_type::link_pulse_tick:
+			stats.link_pulse_ticks++;
+			b->OnLinkPulseTick (e.time);
+			schedule (e.time + link_pulse_period, e.target, e.target, event_type::link_pulse_tick);
+			break;
+
+		case event_type::one_second_tick:
+			stats.one_second_ticks++;
+			b->OnOneSecondTick (e.time);
+			schedule (e.time + usec_per_sec, e.target, e.target, event_type::one_second_tick);
+			break;
+
+		case event_type::packet_arrival:
+			stats.packets_delivered++;
+			b->ProcessReceivedPacket (e.time, e.port_index, std::move(e.packet));
+			break;
+
+		case event_type::traffic_tick:
+		{
+			traffic_flow& f = _flows[e.port_index];
+			b->SendDataFrame (e.time, e.port_index, f.sent++, _bridges[f.destination]->host_address(), f.vlan);
+			schedule (e.time + f.period, e.target, e.target, event_type::traffic_tick, e.port_index);
+			break;
+		}
+
+		case event_type::link_up:
+		case event_type::link_down:
+		{
+			// Skip a change undone by a later one before the ports saw it, as happens with the GUI simulator's
+			// link pulses when a wire is disconnected and reconnected in less time than it takes to miss three.
+			bool up = (e.type == event_type::link_up);
+			if (_wires[_port_wires[e.target][e.port_index]].connected == up)
+			{
+				stats.link_changes++;
+				uint32_t far_end_speed = up ? std::get<link_pulse_t>(e.packet).sender_supported_speed : 0;
+				b->OnLinkChange (e.time, e.port_index, up, far_end_speed);
+			}
+			break;
+		}
+	}
+}
+
+// Runs on one thread while the others wait. Checks for loops after the last window if asked to, applies the wire
+// changes due before the next event, and sets the next window: up to the lookahead past the next event, but not past
+// the next wire change or end_time.
+// Returns false when there's nothing left to do up to end_time.
+bool project::plan_window (sim_time end_time)
+{
+	if (_check_loops)
+	{
+		bool changed = _wires_changed;
+		for (partition& p : _partitions)
+		{
+			changed |= p.forwarding_changed;
+			p.forwarding_changed = false;
+		}
+
+		if (changed)
+			check_loops();
+		_wires_changed = false;
+	}
+
+	sim_time next;
+	while (true)
+	{
+		next = UINT64_MAX;
+		for (const partition& p : _partitions)
+		{
+			if (!p.sched.empty())
+				next = std::min (next, p.sched.next_time());
+		}
+
+		if ((_next_action == _script.size()) || (_script[_next_action].time > std::min (next, end_time)))
+			break;
+
+		// Applying it may schedule events earlier than "next", so look again.
+		_now = _script[_next_action].time;
+		apply (_script[_next_action++]);
+		deliver_outboxes();
+	}
+
+	if (next > end_time)
+	{
+		_now = end_time;
+		return false;
+	}
+
+	_now = next;
+	_window_end = (next > UINT64_MAX - _lookahead) ? UINT64_MAX : next + _lookahead;
+	_window_end = std::min (_window_end, end_time + 1);
+	if (_next_action < _script.size())
+		_window_end = std::min (_window_end, _script[_next_action].time);
+	return true;
+}
+
+void project::run_partition (uint32_t partition_index, sim_time end_time, spin_barrier& barrier)
+{
+	partition& me = _partitions[partition_index];
+	while (true)
+	{
+		// Take the events other partitions sent this one during the last window. The scheduler orders them
+		// by time, target, origin and origin_seq, so the order in which they're taken doesn't matter.
+		for (partition& from : _partitions)
+		{
+			for (event& e : from.outboxes[partition_index])
+				me.sched.schedule (std::move(e));
+			from.outboxes[partition_index].clear();
+		}
+
+		barrier.wait();
+		if (partition_index == 0)
+			_partitions_done = !plan_window (end_time);
+		barrier.wait();
+		if (_partitions_done)
+			break;
+
+		while (!me.sched.empty() && (me.sched.next_time() < _window_end))
+			handle (me.sched.pop());
+
+		barrier.wait();
+	}
+}
+
+void project::run_until (sim_time end_time)
+{
+	spin_barrier barrier ((unsigned int) _partitions.size());
+	std::vector<std::thread> threads;
+	for (uint32_t pi = 1; pi < _partitions.size(); pi++)
+		threads.emplace_back ([this, pi, end_time, &barrier] { run_partition (pi, end_time, barrier); });
+	run_partition (0, end_time, barrier);
+	for (std::thread& t : threads)
+		t.join();
+}
+
+bridge_stats project::bridge_totals() const
+{
+	bridge_stats totals;
+	for (auto& b : _bridges)
+	{
+		const bridge_stats& s = b->stats();
+		totals.bpdus_transmitted += s.bpdus_transmitted;
+		totals.bpdus_received    += s.bpdus_received;
+		totals.frames_flooded    += s.frames_flooded;
+		totals.loops_detected    += s.loops_detected;
+		totals.topology_changes  += s.topology_changes;
+		totals.fdb_flushes       += s.fdb_flushes;
+		totals.data_flooded      += s.data_flooded;
+		totals.data_discarded    += s.data_discarded;
+		totals.last_port_change   = std::max (totals.last_port_change, s.last_port_change);
+	}
+
+	return totals;
+}
+
+project_stats project::stats() const
+{
+	project_stats total;
+	for (const partition& p : _partitions)
+	{
+		total.events            += p.stats.events;
+		total.link_pulse_ticks  += p.stats.link_pulse_ticks;
+		total.one_second_ticks  += p.stats.one_second_ticks;
+		total.packets_delivered += p.stats.packets_delivered;
+		total.packets_unwired   += p.stats.packets_unwired;
+		total.packets_lost      += p.stats.packets_lost;
+		total.link_changes      += p.stats.link_changes;
+	}
+
+	return total;
+}
+
+fdb_stats project::fdb_totals() const
+{
+	fdb_stats totals;
+	for (auto& b : _bridges)
+	{
+		const fdb_stats& s = b->fdb_statistics();
+		totals.learned += s.learned;
+		totals.moved   += s.moved;
+		totals.aged    += s.aged;
+		totals.flushed += s.flushed;
+	}
+
+	return totals;
+}
+
+traffic_stats project::traffic_totals() const
+{
+	traffic_stats totals;
+	for (const traffic_flow& f : _flows)
+	{
+		totals.sent       += f.sent;
+		totals.delivered  += f.delivered;
+		totals.duplicates += f.duplicates;
+	}
+
+	return totals;
+}
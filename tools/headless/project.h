@@ -0,0 +1,236 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "bridge.h"
+#include "forwarding_graph.h"
+#include <istream>
+
+class spin_barrier;
+
+struct wire_end
+{
+	uint32_t bridge_index;
+	uint32_t port_index;
+};
+
+struct wire
+{
+	std::array<wire_end, 2> ends;
+	sim_time delay; // propagation delay, in microseconds of virtual time
+	bool connected;
+	double loss = 0; // fraction of the frames sent on the wire that are dropped; link pulses always get through
+};
+
+// A scripted change ("at" statement).
+struct script_action
+{
+	enum class kind_t : uint8_t { connect, disconnect, set_priority, restart, set_loss };
+
+	sim_time time;
+	kind_t kind;
+	uint32_t index;              // the wire for connect, disconnect and set_loss, the bridge for set_priority and restart
+	unsigned int tree = 0;       // set_priority only
+	unsigned short priority = 0; // set_priority only
+	double loss = 0;             // set_loss only
+};
+
+static constexpr sim_time default_wire_delay = 10;
+static constexpr uint32_t no_wire = UINT32_MAX;
+static constexpr sim_time link_pulse_period = 16 * usec_per_msec;
+
+// When link pulses aren't polled, how long after a wire is disconnected its ports see the link go down:
+// as long as the GUI simulator's ports take at most to count their missed link pulses.
+static constexpr sim_time link_down_delay = 3 * link_pulse_period;
+
+// Unicast traffic between the hosts of two bridges, in one direction ("traffic" statement).
+struct traffic_flow
+{
+	uint32_t source;      // bridge index
+	uint32_t destination; // bridge index
+	unsigned int vlan;
+	sim_time period;      // between two frames
+
+	// Changed only by the thread of the source bridge's partition.
+	uint32_t sent = 0;
+
+	// Changed only by the thread of the destination bridge's partition.
+	uint64_t delivered = 0;     // frames that reached the destination's host, each counted once
+	uint64_t duplicates = 0;    // further copies of them, as loops make
+	std::vector<bool> received; // [seq]
+};
+
+// The traffic flows summed.
+struct traffic_stats
+{
+	uint64_t sent = 0;
+	uint64_t delivered = 0;
+	uint64_t duplicates = 0;
+	uint64_t lost() const { return sent - delivered; } // including frames still on their way
+};
+
+// A change in the forwarding loops of a VLAN, found by the loop check (see project::start).
+struct loop_alarm
+{
+	sim_time time;          // start of the window of virtual time in which the change happened
+	unsigned int vlan;
+	size_t loop_wire_count; // wires on loops after the change; 0 when the loops are gone
+};
+
+// Counters of the events handled; summed over the partitions.
+struct project_stats
+{
+	uint64_t events = 0;
+	uint64_t link_pulse_ticks = 0;
+	uint64_t one_second_ticks = 0;
+	uint64_t packets_delivered = 0;
+	uint64_t packets_unwired = 0; // transmitted on a port with no wire or a disconnected one, and so dropped
+	uint64_t packets_lost = 0;    // dropped by a wire with loss
+	uint64_t link_changes = 0;    // link_up and link_down events
+};
+
+// The bridges and wires of a simulation, and the schedulers that drive them. Plays the role of the GUI simulator's
+// project class; in particular on_packet_transmit does what project::on_packet_transmit does there, except that the
+// packet reaches the other end of the wire after the wire's delay, as a scheduled event, instead of immediately.
+class project
+{
+	// A range of bridges whose events are handled by one thread, in time order, with their own scheduler.
+	struct partition
+	{
+		scheduler sched;
+		project_stats stats;
+
+		// [destination partition] events scheduled during the current window for bridges of other partitions.
+		// Only this partition's thread appends to them, and only the destination's thread empties them,
+		// on the other side of a barrier, so they need no locks.
+		std::vector<std::vector<event>> outboxes;
+
+		bool forwarding_changed = false; // a port of a bridge of this partition changed forwarding state in the window
+	};
+
+	std::vector<std::unique_ptr<bridge>> _bridges;
+	std::vector<wire> _wires;
+	std::vector<std::vector<uint32_t>> _port_wires; // [bridge][port] -> index in _wires, or no_wire
+	std::vector<script_action> _script;             // sorted by time when the simulation starts
+	std::vector<traffic_flow> _flows;
+	size_t _next_action = 0;
+	std::vector<partition> _partitions;
+	std::vector<uint32_t> _bridge_partitions;       // [bridge] -> index in _partitions
+	sim_time _lookahead;      // smallest delay of the wires between partitions
+	sim_time _now = 0;        // all events before this time were handled
+	sim_time _window_end = 0; // end (exclusive) of the window of virtual time the partitions are working on
+	bool _partitions_done = false;
+	uint64_t _next_event_seq = 0; // origin_seq for the events the project itself schedules
+	bool _poll_link_pulses = false;
+	uint32_t _seed = 0;
+
+	// loop check
+	bool _check_loops = false;
+	bool _wires_changed = false;
+	std::vector<unsigned int> _loop_check_vlans;   // the lowest VLAN of each tree in the MST configuration table
+	std::vector<size_t> _loop_wire_counts;         // [index in _loop_check_vlans]
+	std::vector<loop_alarm> _loop_alarms;
+	forwarding_graph _forwarding_graph;
+
+public:
+	// Loads a topology from a text file; throws std::runtime_error with the file name and line number on errors.
+	// One statement per line; '#' starts a comment. Names are made of letters, digits, '_' and '-'.
+	//
+	//   bridge NAME PORT_COUNT [MSTI_COUNT] [key=value...]
+	//       address=XXXXXXXXXXXX  bridge address (default: 02:00:00:00:00:00 + 0x1000 * the bridge's position in the file)
+	//       version=stp|rstp|mstp (default mstp)
+	//       priority=N            bridge priority in the CIST; priorityK=N for MSTI K
+	//       region=NAME           MST configuration name (default "default")
+	//       stp=on|off            whether STP is started (default on)
+	//   port BRIDGE:PORT [key=value...]
+	//       speed=N (Mbps, default 100), cost=N (admin external path cost), priority=N (CIST port priority),
+	//       edge=0|1 (admin edge), auto_edge=0|1
+	//   wire BRIDGE:PORT BRIDGE:PORT [delay=MICROSECONDS] [connected=0|1] [loss=PERCENT]
+	//   vlan FIRST[-LAST] TREE     MST configuration table entries, the same in all bridges
+	//   traffic BRIDGE BRIDGE [rate=FRAMES_PER_SECOND] [vlan=N]
+	//                              unicast frames between the hosts of two bridges, both ways (default 100 frames
+	//                              per second each way, VLAN 1); the bridges learn and forward them with their FDBs,
+	//                              which StpCallback_FlushFdb flushes
+	//   at SECONDS connect|disconnect BRIDGE:PORT
+	//                              connects or disconnects, at that virtual time, the wire of that port
+	//   at SECONDS fail BRIDGE     disconnects all wires of the bridge, as if it lost power
+	//   at SECONDS set BRIDGE priority=N|priorityK=N
+	//                              changes a bridge priority, like in the bridge statement
+	//   at SECONDS restart BRIDGE  stops and starts STP on the bridge, as when it reboots
+	//   at SECONDS loss BRIDGE:PORT PERCENT
+	//                              changes the frame loss of the wire of that port, like loss= in the wire statement
+	//
+	// Frames lost on a wire are picked pseudo-randomly from the seed given to start, the bridge sending them and the
+	// number of events the bridge scheduled before, so they too are the same whatever the number of threads.
+	//
+	// Port indexes start at 0.
+	void load (const char* path);
+
+	// Same, from a stream; name is used in error messages, in place of the file path.
+	void load (std::istream& in, const char* name);
+
+	const std::vector<std::unique_ptr<bridge>>& bridges() const { return _bridges; }
+	const std::vector<wire>& wires() const { return _wires; }
+	project_stats stats() const;
+	bridge_stats bridge_totals() const; // the bridges' counters summed, and the latest last_port_change
+	fdb_stats fdb_totals() const;
+	const std::vector<traffic_flow>& flows() const { return _flows; }
+	traffic_stats traffic_totals() const;
+	const std::vector<loop_alarm>& loop_alarms() const { return _loop_alarms; }
+	sim_time now() const { return _now; }
+
+	// Schedules the first one-second tick of every bridge and the first frame of every traffic flow, at phases picked
+	// pseudo-randomly from the seed, the way the bridges of a real network aren't synchronized, and the scripted wire changes.
+	//
+	// With poll_link_pulses, bridges find out about their links like in the GUI simulator: every bridge sends link pulses
+	// on all ports every 16 ms and a port goes down after missing three of them. This keeps the virtual clock stepping
+	// through every 16 ms of the simulation, even when nothing else happens. Otherwise link state is event-driven:
+	// the ports of a wire go up one wire delay after it's connected, and down link_down_delay after it's disconnected,
+	// so the clock jumps straight from one BPDU, tick or wire change to the next, and idle time costs nothing.
+	//
+	// The bridges are split, by index, into up to thread_count partitions, each simulated by its own thread.
+	//
+	// With check_loops, after each window of virtual time in which a port changed forwarding state or a wire was
+	// connected or disconnected, the forwarding graph of each tree of the MST configuration table is checked for loops,
+	// and a loop_alarm recorded when the number of wires on loops changes. The windows are then kept no longer than
+	// the shortest wire delay, so the checks happen at the same virtual times whatever the number of threads.
+	void start (uint32_t seed, bool poll_link_pulses, size_t thread_count = 1, bool check_loops = false);
+
+	// Handles events in time order until there are none left with a time up to and including end_time.
+	//
+	// With more than one partition this is a conservative parallel simulation: a packet sent by a bridge at time t
+	// reaches a bridge of another partition no sooner than t + _lookahead, so the partitions can work independently
+	// on the window of virtual time [T, T + _lookahead), T being the earliest pending event, and exchange what they
+	// sent each other at the end of the window. Wire changes are applied between windows. Every bridge handles the
+	// same events in the same order whatever the number of threads, so the results are the same too.
+	void run_until (sim_time end_time);
+
+	// A copy of a started simulation, as it is between two calls to run_until, that then runs on its own: the bridges
+	// are copied with STP_CloneBridge, together with the pending events, the wires and what's left of the script.
+	// The copy is split into thread_count partitions, and uses seed for the frames lost from now on; it's otherwise
+	// the same as this project, and goes on the same way if given the same seed. Only reads this project, so several
+	// threads can fork it at once, for instance to try different failures from the same converged network.
+	std::unique_ptr<project> fork (size_t thread_count, uint32_t seed) const;
+
+	// Adds a scripted change to a started simulation. It must be due after now().
+	void add_action (const script_action& a);
+
+	uint32_t port_wire (uint32_t bridge_index, uint32_t port_index) const { return _port_wires[bridge_index][port_index]; } // or no_wire
+
+	void on_packet_transmit (bridge* bridge, size_t txPortIndex, packet_t&& packet, sim_time now);
+	void on_forwarding_changed (bridge* bridge);
+	void on_data_frame_received (bridge* bridge, uint32_t flow_index, uint32_t seq);
+
+private:
+	void make_partitions (size_t thread_count);
+	void schedule (sim_time time, uint32_t target, uint32_t origin, event_type type, uint32_t port_index = 0, packet_t&& packet = packet_t());
+	void handle (event&& e);
+	void schedule_link_change (const wire& w, sim_time time, bool up);
+	void apply (const script_action& a);
+	void deliver_outboxes();
+	void run_partition (uint32_t partition_index, sim_time end_time, spin_barrier& barrier);
+	bool plan_window (sim_time end_time);
+	bool port_forwarding (const wire_end& end, unsigned int vlan) const;
+	void check_loops();
+};
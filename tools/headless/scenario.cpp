@@ -0,0 +1,330 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Topology generators and convergence scenarios for the headless simulator.
+// Usage:
+//   scenario generate [options] KIND          writes a generated topology file to stdout (see generators.h for the kinds)
+//   scenario run [options] KIND[,KIND...]     runs the failure scenarios on each generated topology, and writes one
+//                                             line of results per topology and scenario to stdout
+// Options:
+//   -n N[,N...]      bridge counts (default 16)
+//   -p N             ports per bridge (default 4)
+//   -m N             MSTIs (default 0)
+//   -r N             regions, for the "regions" topology (default 4)
+//   -V VERSION       stp, rstp or mstp (default mstp)
+//   -d MICROSECONDS  wire delay (default 10)
+//   -s SEED          seed for random meshes, traffic and the phases of the bridges' timers (default 1)
+//   -T N             traffic flows between random pairs of bridges, both ways, spread over the trees (default 0)
+//   -R N             frames per second of each flow, each way (default 100)
+//   -t SECONDS       how long the network is given to settle, before the failure and after it (default 60)
+//   -c LIST          scenarios (default all of them): cold-start, link-cut, root-loss, priority
+//   -j N             threads per simulation (default 1)
+//   -f csv|json      output format (default csv)
+//
+// Scenarios, each a separate simulation:
+//   cold-start  all bridges start at once; measured from time 0
+//   link-cut    the wire at port 0 of the root bridge B0 is cut after the settle time
+//   root-loss   B0 loses all its links after the settle time
+//   priority    the last bridge gets CIST priority 0 after the settle time, and so becomes the root
+// convergence_ms is the time from the failure (or start) to the last port role or forwarding change. A network
+// counts as converged if nothing changed in the last half of the settle time; role_mismatches counts the port roles that
+// differ at the end from those of the spanning tree oracle (see oracle.h). The BPDU, topology change and FDB flush
+// counts are those after the failure. So are the data plane's: the frames the flows sent, those delivered, lost
+// (not delivered by the end, flushed FDB entries still pointing at blocked ports, or sent on a link just cut)
+// and duplicated, the copies flooded because the destination wasn't in an FDB, and those discarded. Comparing runs of the same topology and seed across library builds or protocol
+// settings shows what they change.
+
+#include "project.h"
+#include "generators.h"
+#include "oracle.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+static const char* const scenario_names[] = { "cold-start", "link-cut", "root-loss", "priority", nullptr };
+
+struct scenario_result
+{
+	std::string topology;
+	size_t bridges;
+	size_t wires;
+	std::string scenario;
+	double convergence_ms;
+	bool converged;
+	size_t role_mismatches; // port roles that differ from the oracle's at the end
+	bridge_stats counts; // after the failure
+	traffic_stats traffic; // frames sent after the failure, and copies of them delivered
+	uint64_t events;
+	double wall_ms;
+};
+
+static std::vector<std::string> split (const char* list)
+{
+	std::vector<std::string> items;
+	std::istringstream ss (list);
+	std::string item;
+	while (std::getline (ss, item, ','))
+	{
+		if (!item.empty())
+			items.push_back (item);
+	}
+
+	return items;
+}
+
+// The frames the flows sent from first_seq[flow] on, how many of them reached their destination, and the duplicates
+// delivered since duplicates.
+static traffic_stats traffic_since (const project& project, const std::vector<uint32_t>& first_seq, uint64_t duplicates)
+{
+	traffic_stats ts;
+	const std::vector<traffic_flow>& flows = project.flows();
+	for (size_t fi = 0; fi < flows.size(); fi++)
+	{
+		const traffic_flow& f = flows[fi];
+		ts.sent += f.sent - first_seq[fi];
+		for (size_t seq = first_seq[fi]; seq < std::min ((size_t) f.sent, f.received.size()); seq++)
+			ts.delivered += f.received[seq];
+	}
+
+	ts.duplicates = project.traffic_totals().duplicates - duplicates;
+	return ts;
+}
+
+static std::unique_ptr<project> load_topology (const topology_params& params, const std::string& topology, size_t thread_count)
+{
+	auto p = std::make_unique<project>();
+	std::istringstream in (topology);
+	p->load (in, (params.kind + " topology").c_str());
+	p->start (params.seed, false, thread_count);
+	return p;
+}
+
+// baseline: the topology simulated up to just before the failure time; not used by cold-start.
+static scenario_result run_scenario (const topology_params& params, const std::string& topology, const std::string& scenario,
+									 sim_time settle, size_t thread_count, const project* baseline)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::unique_ptr<project> sim;
+	sim_time failure_time = 0;
+	bridge_stats before;
+	traffic_stats traffic_before;
+	std::vector<uint32_t> first_seq;
+	if (scenario == "cold-start")
+	{
+		sim = load_topology (params, topology, thread_count);
+		first_seq.resize (sim->flows().size());
+	}
+	else
+	{
+		failure_time = settle;
+		assert (baseline->now() == failure_time - 1);
+		sim = baseline->fork (thread_count, params.seed);
+		before = sim->bridge_totals();
+		traffic_before = sim->traffic_totals();
+		for (const traffic_flow& f : sim->flows())
+			first_seq.push_back (f.sent);
+		if (scenario == "link-cut")
+			sim->add_action ({ failure_time, script_action::kind_t::disconnect, sim->port_wire(0, 0) });
+		else if (scenario == "root-loss")
+		{
+			for (uint32_t pi = 0; pi < sim->bridges()[0]->ports().size(); pi++)
+			{
+				if (sim->port_wire(0, pi) != no_wire)
+					sim->add_action ({ failure_time, script_action::kind_t::disconnect, sim->port_wire(0, pi) });
+			}
+		}
+		else
+			sim->add_action ({ failure_time, script_action::kind_t::set_priority, (uint32_t) sim->bridges().size() - 1, 0, 0 });
+	}
+
+	project& project = *sim;
+	sim_time end_time = failure_time + settle;
+	project.run_until (end_time);
+	bridge_stats after = project.bridge_totals();
+
+	scenario_result r;
+	r.topology = params.kind;
+	r.bridges = project.bridges().size();
+	r.wires = project.wires().size();
+	r.scenario = scenario;
+	r.convergence_ms = (after.last_port_change > failure_time) ? (double) (after.last_port_change - failure_time) / usec_per_msec : 0;
+	r.converged = (after.last_port_change <= end_time - settle / 2);
+	r.role_mismatches = check_port_roles(project).mismatches.size();
+	r.counts.bpdus_transmitted = after.bpdus_transmitted - before.bpdus_transmitted;
+	r.counts.topology_changes  = after.topology_changes - before.topology_changes;
+	r.counts.fdb_flushes       = after.fdb_flushes - before.fdb_flushes;
+	r.counts.data_flooded      = after.data_flooded - before.data_flooded;
+	r.counts.data_discarded    = after.data_discarded - before.data_discarded;
+	r.traffic = traffic_since (project, first_seq, traffic_before.duplicates);
+	r.events = project.stats().events;
+	r.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return r;
+}
+
+int main (int argc, char* argv[])
+{
+	auto usage = []
+	{
+		fprintf (stderr, "usage: scenario generate [-n bridges] [-p ports] [-m mstis] [-r regions] [-V version] [-d delay] [-s seed] [-T flows] [-R rate] KIND\n"
+		                 "       scenario run [-n N,N...] [-p ports] [-m mstis] [-r regions] [-V version] [-d delay] [-s seed] [-T flows] [-R rate]\n"
+		                 "                    [-t seconds] [-c scenario,...] [-j threads] [-f csv|json] KIND,KIND...\n"
+		                 "KIND is one of:");
+		for (auto k = topology_kinds; *k; k++)
+			fprintf (stderr, " %s", *k);
+		fprintf (stderr, "\n");
+		return 1;
+	};
+
+	if ((argc < 3) || ((strcmp (argv[1], "generate") != 0) && (strcmp (argv[1], "run") != 0)))
+		return usage();
+	bool generate = (strcmp (argv[1], "generate") == 0);
+
+	topology_params params;
+	std::vector<size_t> bridge_counts = { params.bridge_count };
+	double settle_seconds = 60;
+	std::vector<std::string> scenarios;
+	for (auto s = scenario_names; *s; s++)
+		scenarios.push_back (*s);
+	size_t thread_count = 1;
+	bool json = false;
+
+	int argi = 2;
+	for (; argi + 1 < argc; argi += 2)
+	{
+		const char* option = argv[argi];
+		const char* value = argv[argi + 1];
+		if (strcmp (option, "-n") == 0)
+		{
+			bridge_counts.clear();
+			for (auto& n : split(value))
+				bridge_counts.push_back ((size_t) strtoul (n.c_str(), nullptr, 0));
+		}
+		else if (strcmp (option, "-p") == 0)
+			params.port_count = (size_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-m") == 0)
+			params.msti_count = (size_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-r") == 0)
+			params.region_count = (size_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-V") == 0)
+			params.version = value;
+		else if (strcmp (option, "-d") == 0)
+			params.wire_delay = (uint32_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-s") == 0)
+			params.seed = (uint32_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-T") == 0)
+			params.traffic_count = (size_t) strtoul (value, nullptr, 0);
+		else if (strcmp (option, "-R") == 0)
+			params.traffic_rate = (uint32_t) strtoul (value, nullptr, 0);
+		else if (!generate && (strcmp (option, "-t") == 0))
+			settle_seconds = atof (value);
+		else if (!generate && (strcmp (option, "-c") == 0))
+			scenarios = split(value);
+		else if (!generate && (strcmp (option, "-j") == 0))
+			thread_count = (size_t) strtoul (value, nullptr, 0);
+		else if (!generate && (strcmp (option, "-f") == 0) && ((strcmp (value, "csv") == 0) || (strcmp (value, "json") == 0)))
+			json = (strcmp (value, "json") == 0);
+		else
+			break;
+	}
+
+	if ((argi != argc - 1) || bridge_counts.empty() || (settle_seconds <= 0) || (thread_count == 0)
+		|| (params.traffic_rate == 0) || (params.traffic_rate > usec_per_sec))
+		return usage();
+
+	for (auto& s : scenarios)
+	{
+		if (std::none_of (scenario_names, scenario_names + 4, [&s](const char* n) { return s == n; }))
+		{
+			fprintf (stderr, "unknown scenario '%s'\n", s.c_str());
+			return 1;
+		}
+	}
+
+	std::vector<std::string> kinds = split(argv[argi]);
+	if (generate && ((kinds.size() != 1) || (bridge_counts.size() != 1)))
+		return usage();
+
+	if (!generate && json)
+		printf ("[\n");
+	else if (!generate)
+		printf ("topology,bridges,wires,mstis,version,seed,scenario,convergence_ms,converged,role_mismatches,bpdus,topology_changes,fdb_flushes,"
+			"data_sent,data_delivered,data_lost,data_duplicates,data_flooded,data_discarded,events,wall_ms\n");
+
+	bool first = true;
+	for (auto& kind : kinds)
+	{
+		for (size_t bridge_count : bridge_counts)
+		{
+			params.kind = kind;
+			params.bridge_count = bridge_count;
+
+			std::string topology;
+			try
+			{
+				topology = generate_topology (params);
+			}
+			catch (const std::exception& ex)
+			{
+				fprintf (stderr, "%s, %zu bridges: %s\n", kind.c_str(), bridge_count, ex.what());
+				if (generate)
+					return 1;
+				continue;
+			}
+
+			if (generate)
+			{
+				fputs (topology.c_str(), stdout);
+				return 0;
+			}
+
+			auto settle = (sim_time) (settle_seconds * usec_per_sec);
+			std::unique_ptr<project> baseline;
+			if (std::any_of (scenarios.begin(), scenarios.end(), [](const std::string& s) { return s != "cold-start"; }))
+			{
+				baseline = load_topology (params, topology, thread_count);
+				baseline->run_until (settle - 1);
+			}
+
+			for (auto& scenario : scenarios)
+			{
+				scenario_result r = run_scenario (params, topology, scenario, settle, thread_count, baseline.get());
+				if (json)
+				{
+					printf ("%s  { \"topology\": \"%s\", \"bridges\": %zu, \"wires\": %zu, \"mstis\": %zu, \"version\": \"%s\", \"seed\": %u, "
+						"\"scenario\": \"%s\", \"convergence_ms\": %.3f, \"converged\": %s, \"role_mismatches\": %zu, \"bpdus\": %llu, \"topology_changes\": %llu, "
+						"\"fdb_flushes\": %llu, \"data_sent\": %llu, \"data_delivered\": %llu, \"data_lost\": %llu, \"data_duplicates\": %llu, "
+						"\"data_flooded\": %llu, \"data_discarded\": %llu, \"events\": %llu, \"wall_ms\": %.1f }",
+						first ? "" : ",\n", r.topology.c_str(), r.bridges, r.wires, params.msti_count, params.version.c_str(), params.seed,
+						r.scenario.c_str(), r.convergence_ms, r.converged ? "true" : "false", r.role_mismatches, (unsigned long long) r.counts.bpdus_transmitted,
+						(unsigned long long) r.counts.topology_changes, (unsigned long long) r.counts.fdb_flushes,
+						(unsigned long long) r.traffic.sent, (unsigned long long) r.traffic.delivered, (unsigned long long) r.traffic.lost(),
+						(unsigned long long) r.traffic.duplicates, (unsigned long long) r.counts.data_flooded, (unsigned long long) r.counts.data_discarded,
+						(unsigned long long) r.events, r.wall_ms);
+				}
+				else
+				{
+					printf ("%s,%zu,%zu,%zu,%s,%u,%s,%.3f,%d,%zu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.1f\n",
+						r.topology.c_str(), r.bridges, r.wires, params.msti_count, params.version.c_str(), params.seed,
+						r.scenario.c_str(), r.convergence_ms, r.converged ? 1 : 0, r.role_mismatches, (unsigned long long) r.counts.bpdus_transmitted,
+						(unsigned long long) r.counts.topology_changes, (unsigned long long) r.counts.fdb_flushes,
+						(unsigned long long) r.traffic.sent, (unsigned long long) r.traffic.delivered, (unsigned long long) r.traffic.lost(),
+						(unsigned long long) r.traffic.duplicates, (unsigned long long) r.counts.data_flooded, (unsigned long long) r.counts.data_discarded,
+						(unsigned long long) r.events, r.wall_ms);
+				}
+
+				fflush (stdout);
+				first = false;
+			}
+		}
+	}
+
+	if (json)
+		printf ("\n]\n");
+	return 0;
+}
@@ -0,0 +1,36 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "scheduler.h"
+#include <algorithm>
+#include <cassert>
+
+// std::push_heap builds a max-heap, so "less" here means "happens later".
+bool scheduler::later (const event& a, const event& b)
+{
+	if (a.time != b.time)
+		return a.time > b.time;
+	if (a.target != b.target)
+		return a.target > b.target;
+	if (a.origin != b.origin)
+		return a.origin > b.origin;
+	return a.origin_seq > b.origin_seq;
+}
+
+void scheduler::schedule (event&& e)
+{
+	assert (e.time >= _now);
+	_heap.push_back (std::move(e));
+	std::push_heap (_heap.begin(), _heap.end(), &later);
+}
+
+event scheduler::pop()
+{
+	assert (!_heap.empty());
+	std::pop_heap (_heap.begin(), _heap.end(), &later);
+	event e = std::move(_heap.back());
+	_heap.pop_back();
+	_now = e.time;
+	return e;
+}
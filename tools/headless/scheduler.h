@@ -0,0 +1,58 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "port.h"
+
+// Virtual time, in microseconds since the start of the simulation.
+using sim_time = uint64_t;
+static constexpr sim_time usec_per_msec = 1000;
+static constexpr sim_time usec_per_sec = 1000000;
+
+// The library takes timestamps in milliseconds.
+inline uint32_t to_timestamp (sim_time t) { return (uint32_t) (t / usec_per_msec); }
+
+enum class event_type : uint8_t
+{
+	link_pulse_tick,  // the 16 ms timer of the GUI simulator, for one bridge (only when polling link pulses)
+	one_second_tick,  // STP_OnOneSecondTick for one bridge
+	packet_arrival,   // a packet reaches the far end of a wire
+	link_up,          // a port sees its link come up; the packet is a link_pulse_t with the speed of the far end
+	link_down,        // a port sees its link go down
+	traffic_tick,     // the host of a bridge sends the next frame of a traffic flow
+};
+
+struct event
+{
+	sim_time   time;
+	uint32_t   target;     // index of the bridge that handles the event
+	uint32_t   origin;     // index of the bridge that scheduled it; the bridge count for the project itself
+	uint64_t   origin_seq; // counts the events scheduled by the origin
+	event_type type;
+	uint32_t   port_index; // for packet_arrival, link_up and link_down: the port of the target bridge; for traffic_tick: the flow
+	packet_t   packet;
+};
+
+// Priority queue of events in virtual time. Events are ordered by time, then by target, origin and origin_seq,
+// so the order doesn't depend on the order in which they were scheduled, only on who scheduled them: this keeps
+// the simulation deterministic, and independent of how the bridges are distributed over threads.
+class scheduler
+{
+	std::vector<event> _heap;
+	sim_time _now = 0;
+
+	static bool later (const event& a, const event& b);
+
+public:
+	sim_time now() const { return _now; }
+	bool empty() const { return _heap.empty(); }
+	size_t size() const { return _heap.size(); }
+	sim_time next_time() const { return _heap.front().time; }
+	const std::vector<event>& events() const { return _heap; } // in no particular order
+
+	void schedule (event&& e);
+
+	// Removes the earliest event and advances the virtual clock to its time.
+	event pop();
+};
@@ -0,0 +1,196 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Throughput benchmark for text logging on BPDU-dump-heavy traffic.
+// Usage: log_benchmark [seconds [debugLogBufferSize]]
+// Two MSTP bridges with several MSTIs are connected back to back on all their ports and run for the given
+// number of simulated seconds, with one link flapping every few seconds. Every received and transmitted BPDU
+// is dumped to the log. The log goes to the null device, with one fflush per debugStrOut call to mimic a sink
+// that pays a system call for each call. The program prints the time spent, the amount of text and the number of calls.
+
+#include "../../mstp-lib/stp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+#include <vector>
+
+#ifdef _WIN32
+	static const char NullDevice[] = "NUL";
+#else
+	static const char NullDevice[] = "/dev/null";
+#endif
+
+static const unsigned int PortCount = 4;
+static const unsigned int MstiCount = 8;
+
+struct PENDING_BPDU
+{
+	unsigned int bridgeIndex;
+	unsigned int portIndex;
+	std::vector<unsigned char> data;
+};
+
+static STP_BRIDGE* bridges [2];
+static std::vector<unsigned char> txBuffers [2];
+static unsigned int txPorts [2];
+static std::deque<PENDING_BPDU> pendingBpdus;
+static bool linkUp [PortCount];
+
+static FILE* sink;
+static unsigned long long sinkBytes;
+static unsigned long long sinkLines;
+static unsigned long long sinkCalls;
+
+static unsigned int BridgeIndex (const STP_BRIDGE* bridge)
+{
+	return (bridge == bridges[0]) ? 0 : 1;
+}
+
+static void* StpCallback_AllocAndZeroMemory (unsigned int size)
+{
+	return calloc (1, size);
+}
+
+static void StpCallback_FreeMemory (void* p)
+{
+	free (p);
+}
+
+static void* StpCallback_TransmitGetBuffer (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp)
+{
+	unsigned int bi = BridgeIndex (bridge);
+	txBuffers[bi].assign (bpduSize, 0);
+	txPorts[bi] = portIndex;
+	return &txBuffers[bi][0];
+}
+
+static void StpCallback_TransmitReleaseBuffer (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer)
+{
+	unsigned int bi = BridgeIndex (bridge);
+	if (!linkUp [txPorts[bi]])
+		return;
+
+	PENDING_BPDU bpdu;
+	bpdu.bridgeIndex = 1 - bi;
+	bpdu.portIndex = txPorts[bi];
+	bpdu.data = txBuffers[bi];
+	pendingBpdus.push_back (bpdu);
+}
+
+static void StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush)
+{
+	if (stringLength == 0)
+		return;
+
+	fwrite (nullTerminatedString, 1, stringLength, sink);
+	fflush (sink);
+	sinkBytes += stringLength;
+	sinkCalls++;
+	for (const char* p = nullTerminatedString; (p = strchr (p, '\n')) != NULL; p++)
+		sinkLines++;
+}
+
+static void StpCallback_EnableBpduTrapping (const STP_BRIDGE* bridge, bool enable, unsigned int timestamp) { }
+static void StpCallback_EnablePortState (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp) { }
+static void StpCallback_FlushFdb (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp) { }
+static void StpCallback_OnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp) { }
+static void StpCallback_OnPortRoleChanged (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_PORT_ROLE role, unsigned int timestamp) { }
+
+static const STP_CALLBACKS callbacks =
+{
+	&StpCallback_EnableBpduTrapping,
+	&StpCallback_EnablePortState,
+	&StpCallback_EnablePortState,
+	&StpCallback_TransmitGetBuffer,
+	&StpCallback_TransmitReleaseBuffer,
+	&StpCallback_FlushFdb,
+	&StpCallback_DebugStrOut,
+	&StpCallback_OnTopologyChange,
+	&StpCallback_OnPortRoleChanged,
+	&StpCallback_AllocAndZeroMemory,
+	&StpCallback_FreeMemory,
+	NULL,
+	NULL,
+};
+
+static void DeliverBpdus (unsigned int timestamp)
+{
+	while (!pendingBpdus.empty())
+	{
+		PENDING_BPDU bpdu = pendingBpdus.front();
+		pendingBpdus.pop_front();
+		if (linkUp [bpdu.portIndex])
+			STP_OnBpduReceived (bridges [bpdu.bridgeIndex], bpdu.portIndex, &bpdu.data[0], (unsigned int) bpdu.data.size(), timestamp);
+	}
+}
+
+static void SetLink (unsigned int portIndex, bool up, unsigned int timestamp)
+{
+	linkUp [portIndex] = up;
+	for (unsigned int bi = 0; bi < 2; bi++)
+	{
+		if (up)
+			STP_OnPortEnabled (bridges[bi], portIndex, 1000, true, timestamp);
+		else
+			STP_OnPortDisabled (bridges[bi], portIndex, timestamp);
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	unsigned int seconds = (argc > 1) ? (unsigned int) atoi (argv[1]) : 2000;
+	unsigned int bufferSize = (argc > 2) ? (unsigned int) atoi (argv[2]) : 4096;
+	if (bufferSize < 2)
+	{
+		fprintf (stderr, "debugLogBufferSize must be >= 2\n");
+		return 1;
+	}
+
+	sink = fopen (NullDevice, "wb");
+	if (sink == NULL)
+	{
+		fprintf (stderr, "cannot open %s\n", NullDevice);
+		return 1;
+	}
+
+	for (unsigned int bi = 0; bi < 2; bi++)
+	{
+		unsigned char address[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, (unsigned char) (0x10 + bi) };
+		bridges[bi] = STP_CreateBridge (PortCount, MstiCount, 4094, &callbacks, address, bufferSize);
+		STP_SetStpVersion (bridges[bi], STP_VERSION_MSTP, 0);
+		STP_EnableLogging (bridges[bi], true);
+		STP_StartBridge (bridges[bi], 0);
+	}
+
+	clock_t start = clock();
+
+	for (unsigned int pi = 0; pi < PortCount; pi++)
+		SetLink (pi, true, 0);
+	DeliverBpdus (0);
+
+	for (unsigned int s = 1; s <= seconds; s++)
+	{
+		unsigned int timestamp = s * 1000;
+		if ((s % 7) == 0)
+			SetLink ((s / 7) % PortCount, !linkUp [(s / 7) % PortCount], timestamp);
+
+		for (unsigned int bi = 0; bi < 2; bi++)
+			STP_OnOneSecondTick (bridges[bi], timestamp);
+		DeliverBpdus (timestamp);
+	}
+
+	double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	for (unsigned int bi = 0; bi < 2; bi++)
+		STP_DestroyBridge (bridges[bi]);
+	fclose (sink);
+
+	printf ("%u simulated seconds, debugLogBufferSize=%u\n", seconds, bufferSize);
+	printf ("%.3f s, %llu bytes, %llu lines, %llu debugStrOut calls\n", elapsed, sinkBytes, sinkLines, sinkCalls);
+	if (elapsed > 0)
+		printf ("%.1f MB/s, %.0f lines/s\n", sinkBytes / elapsed / 1e6, sinkLines / elapsed);
+	return 0;
+}
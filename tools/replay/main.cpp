@@ -0,0 +1,204 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Replays a recording made with STP_EnableRecording, for benchmarking and regression testing.
+// Usage: replay [-n] [-r repeatCount] file
+// The input records are fed to a bridge created from the recording's header, as fast as possible, repeatCount times;
+// the program prints the time spent and the throughput. Then, unless -n is given, the recording is replayed once more
+// with recording enabled on the replay bridge, and the records it produces are compared with the original ones:
+// any difference in the calls the library made to the callbacks (hardware actions, BPDUs transmitted etc.) is reported.
+// During replay transmit buffers are always available, so a recording in which the application's transmitGetBuffer
+// returned NULL will show up as different.
+
+#include "../../mstp-lib/stp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+static unsigned char txBuffer [4096];
+static std::vector<unsigned char> replayed;
+
+static void* StpCallback_AllocAndZeroMemory (unsigned int size)
+{
+	return calloc (1, size);
+}
+
+static void StpCallback_FreeMemory (void* p)
+{
+	free (p);
+}
+
+static void* StpCallback_TransmitGetBuffer (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int bpduSize, unsigned int timestamp)
+{
+	return (bpduSize <= sizeof(txBuffer)) ? txBuffer : NULL;
+}
+
+static void StpCallback_TransmitReleaseBuffer (const STP_BRIDGE* bridge, void* bufferReturnedByGetBuffer) { }
+static void StpCallback_DebugStrOut (const STP_BRIDGE* bridge, int portIndex, int treeIndex, const char* nullTerminatedString, unsigned int stringLength, unsigned int flush) { }
+static void StpCallback_EnableBpduTrapping (const STP_BRIDGE* bridge, bool enable, unsigned int timestamp) { }
+static void StpCallback_EnablePortState (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, bool enable, unsigned int timestamp) { }
+static void StpCallback_FlushFdb (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp) { }
+static void StpCallback_OnTopologyChange (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int timestamp) { }
+static void StpCallback_OnPortRoleChanged (const STP_BRIDGE* bridge, unsigned int portIndex, unsigned int treeIndex, enum STP_PORT_ROLE role, unsigned int timestamp) { }
+static void StpCallback_ApplyPortStates (const STP_BRIDGE* bridge, const struct STP_PORT_STATE_CHANGE* changes, unsigned int changeCount, unsigned int timestamp) { }
+static void StpCallback_FlushFdbPorts (const STP_BRIDGE* bridge, unsigned int treeIndex, const unsigned char* portMask, unsigned int portMaskSize, enum STP_FLUSH_FDB_TYPE flushType, unsigned int timestamp) { }
+static void StpCallback_OnTreeConverged (const STP_BRIDGE* bridge, unsigned int treeIndex, unsigned int convergenceStartTimestamp, unsigned int timestamp) { }
+
+// STP_CreateBridgeFromRecording removes the optional callbacks the recorded bridge didn't have.
+static const STP_CALLBACKS callbacks =
+{
+	&StpCallback_EnableBpduTrapping,
+	&StpCallback_EnablePortState,
+	&StpCallback_EnablePortState,
+	&StpCallback_TransmitGetBuffer,
+	&StpCallback_TransmitReleaseBuffer,
+	&StpCallback_FlushFdb,
+	&StpCallback_DebugStrOut,
+	&StpCallback_OnTopologyChange,
+	&StpCallback_OnPortRoleChanged,
+	&StpCallback_AllocAndZeroMemory,
+	&StpCallback_FreeMemory,
+	&StpCallback_ApplyPortStates,
+	&StpCallback_FlushFdbPorts,
+	&StpCallback_OnTreeConverged,
+};
+
+static void OnRecordOut (const STP_BRIDGE* bridge, const unsigned char* data, unsigned int size)
+{
+	replayed.insert (replayed.end(), data, data + size);
+}
+
+// Replays all records after the header. Returns the number of input records.
+static unsigned int Replay (STP_BRIDGE* bridge, const std::vector<unsigned char>& recording, unsigned int headerSize)
+{
+	unsigned int inputCount = 0;
+	for (unsigned int offset = headerSize; offset < recording.size(); )
+	{
+		unsigned int recordSize = STP_GetRecordSize (&recording[offset], (unsigned int) recording.size() - offset);
+		if (STP_ReplayRecord (bridge, &recording[offset], recordSize))
+			inputCount++;
+		offset += recordSize;
+	}
+
+	return inputCount;
+}
+
+// Compares the two recordings record by record. Returns true if they are the same.
+static bool Compare (const std::vector<unsigned char>& recording, const std::vector<unsigned char>& replayed)
+{
+	unsigned int offset = 0;
+	unsigned int recordIndex = 0;
+	while ((offset < recording.size()) && (offset < replayed.size()))
+	{
+		unsigned int size = STP_GetRecordSize (&recording[offset], (unsigned int) recording.size() - offset);
+		unsigned int replayedSize = STP_GetRecordSize (&replayed[offset], (unsigned int) replayed.size() - offset);
+		if ((size != replayedSize) || (memcmp (&recording[offset], &replayed[offset], size) != 0))
+		{
+			printf ("MISMATCH at record %u (offset %u): recorded type 0x%02X, replayed type 0x%02X\n",
+				recordIndex, offset, recording[offset], replayed[offset]);
+			return false;
+		}
+
+		offset += size;
+		recordIndex++;
+	}
+
+	if ((offset < recording.size()) || (offset < replayed.size()))
+	{
+		printf ("MISMATCH at record %u (offset %u): %s\n", recordIndex, offset,
+			(offset < recording.size()) ? "the replay produced fewer records" : "the replay produced more records");
+		return false;
+	}
+
+	printf ("replay matches the recording (%u records)\n", recordIndex);
+	return true;
+}
+
+int main (int argc, char* argv[])
+{
+	bool verify = true;
+	unsigned int repeatCount = 1;
+	int argi = 1;
+	for (; argi < argc - 1; argi++)
+	{
+		if (strcmp (argv[argi], "-n") == 0)
+			verify = false;
+		else if ((strcmp (argv[argi], "-r") == 0) && (argi + 2 < argc))
+			repeatCount = (unsigned int) atoi (argv[++argi]);
+		else
+			break;
+	}
+
+	if ((argi != argc - 1) || (repeatCount == 0))
+	{
+		fprintf (stderr, "usage: replay [-n] [-r repeatCount] file\n");
+		return 1;
+	}
+
+	FILE* file = fopen (argv[argi], "rb");
+	if (file == NULL)
+	{
+		fprintf (stderr, "%s: cannot open\n", argv[argi]);
+		return 1;
+	}
+
+	std::vector<unsigned char> recording;
+	unsigned char chunk [65536];
+	size_t read;
+	while ((read = fread (chunk, 1, sizeof(chunk), file)) > 0)
+		recording.insert (recording.end(), chunk, chunk + read);
+	fclose (file);
+
+	// Drop an incomplete record at the end, as left by a device that was reset while recording.
+	unsigned int size = 0;
+	unsigned int recordCount = 0;
+	unsigned int recordSize;
+	while ((size < recording.size()) && ((recordSize = STP_GetRecordSize (&recording[size], (unsigned int) recording.size() - size)) > 0))
+	{
+		size += recordSize;
+		recordCount++;
+	}
+	if (size < recording.size())
+	{
+		fprintf (stderr, "%s: ignoring %u trailing bytes that don't make up a complete record\n", argv[argi], (unsigned int) (recording.size() - size));
+		recording.resize (size);
+	}
+
+	unsigned int headerSize = (recordCount > 0) ? STP_GetRecordSize (&recording[0], size) : 0;
+	STP_BRIDGE* bridge = (headerSize > 0) ? STP_CreateBridgeFromRecording (&recording[0], headerSize, &callbacks, 256) : NULL;
+	if (bridge == NULL)
+	{
+		fprintf (stderr, "%s: not a recording made with STP_EnableRecording, or made with an incompatible library version\n", argv[argi]);
+		return 1;
+	}
+	STP_DestroyBridge (bridge);
+
+	unsigned int inputCount = 0;
+	clock_t start = clock();
+	for (unsigned int i = 0; i < repeatCount; i++)
+	{
+		bridge = STP_CreateBridgeFromRecording (&recording[0], headerSize, &callbacks, 256);
+		inputCount = Replay (bridge, recording, headerSize);
+		STP_DestroyBridge (bridge);
+	}
+	double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	printf ("%u records, %u inputs, replayed %u times\n", recordCount, inputCount, repeatCount);
+	printf ("%.3f s", elapsed);
+	if (elapsed > 0)
+		printf (", %.0f inputs/s, %.3f us per input", (double) inputCount * repeatCount / elapsed, elapsed * 1e6 / ((double) inputCount * repeatCount));
+	printf ("\n");
+
+	if (!verify)
+		return 0;
+
+	bridge = STP_CreateBridgeFromRecording (&recording[0], headerSize, &callbacks, 256);
+	STP_EnableRecording (bridge, OnRecordOut);
+	Replay (bridge, recording, headerSize);
+	STP_DestroyBridge (bridge);
+
+	return Compare (recording, replayed) ? 0 : 2;
+}
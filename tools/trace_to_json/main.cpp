@@ -0,0 +1,234 @@
+
+// This file is part of the mstp-lib library, available at https://github.com/adigostin/mstp-lib
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Host-side converter from the data produced by STP_ExportTrace to the Chrome trace event format (JSON),
+// which can be opened in chrome://tracing or https://ui.perfetto.dev.
+// Usage: trace_to_json [-t ticksPerMicrosecond] file... > trace.json
+// Each file holds the trace of one bridge (any number of exported chunks, one after the other), and is shown as one process.
+// To line up several bridges on the same timeline, their traces must have been taken with the same clock.
+
+#include "../../mstp-lib/stp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct CONVERTER
+{
+	unsigned int pid;
+	double ticksPerMicrosecond;
+	unsigned long long timeHigh;  // the clock is 32 bits wide and wraps around; we keep counting in 64 bits
+	unsigned int lastTime;
+	bool first;
+	bool firstEventInOutput;
+};
+
+// Writes the characters of a JSON string, without the quotes.
+static void WriteJsonChars (const char* s)
+{
+	for (; *s != 0; s++)
+	{
+		if ((*s == '"') || (*s == '\\'))
+			printf ("\\%c", *s);
+		else if ((unsigned char) *s < 0x20)
+			printf ("\\u%04x", *s);
+		else
+			putchar (*s);
+	}
+}
+
+static void WriteJsonString (const char* s)
+{
+	putchar ('"');
+	WriteJsonChars (s);
+	putchar ('"');
+}
+
+static void BeginEvent (CONVERTER* c, const STP_TRACE_EVENT* event, const char* phase, const char* category)
+{
+	if (c->first)
+		c->first = false;
+	else if (event->time < c->lastTime)
+		c->timeHigh += 0x100000000ull;
+	c->lastTime = event->time;
+
+	double ts = (double) (c->timeHigh + event->time) / c->ticksPerMicrosecond;
+	printf ("%s\n{\"ph\":\"%s\",\"cat\":\"%s\",\"pid\":%u,\"tid\":0,\"ts\":%.3f", c->firstEventInOutput ? "" : ",", phase, category, c->pid, ts);
+	c->firstEventInOutput = false;
+}
+
+static void WritePortTreeArgs (const STP_TRACE_EVENT* event)
+{
+	const char* separator = "";
+	if (event->port >= 0)
+	{
+		printf ("\"port\":%d", 1 + event->port);
+		separator = ",";
+	}
+
+	if (event->tree >= 0)
+		printf ("%s\"tree\":%d", separator, event->tree);
+}
+
+static void OnTraceEvent (const STP_TRACE_EVENT* event, void* applicationContext)
+{
+	CONVERTER* c = (CONVERTER*) applicationContext;
+
+	switch (event->type)
+	{
+		case STP_TRACE_EVENT_API_BEGIN:
+		case STP_TRACE_EVENT_API_END:
+			BeginEvent (c, event, (event->type == STP_TRACE_EVENT_API_BEGIN) ? "B" : "E", "api");
+			printf (",\"name\":");
+			WriteJsonString (event->name);
+			printf (",\"args\":{");
+			WritePortTreeArgs (event);
+			printf ("}}");
+			break;
+
+		case STP_TRACE_EVENT_PASS_BEGIN:
+		case STP_TRACE_EVENT_PASS_END:
+			BeginEvent (c, event, (event->type == STP_TRACE_EVENT_PASS_BEGIN) ? "B" : "E", "pass");
+			printf (",\"name\":\"Pass %u\"}", event->arg);
+			break;
+
+		case STP_TRACE_EVENT_TRANSITION:
+			BeginEvent (c, event, "i", "sm");
+			printf (",\"s\":\"t\",\"name\":");
+			if (event->name[0] != 0)
+			{
+				putchar ('"');
+				WriteJsonChars (event->name);
+				printf (": -> ");
+				WriteJsonChars (event->detail);
+				putchar ('"');
+			}
+			else
+				printf ("\"-> %u\"", event->arg);
+			printf (",\"args\":{");
+			WritePortTreeArgs (event);
+			printf ("}}");
+			break;
+
+		case STP_TRACE_EVENT_BPDU_RX:
+		case STP_TRACE_EVENT_BPDU_TX:
+			BeginEvent (c, event, "i", "bpdu");
+			if (event->type == STP_TRACE_EVENT_BPDU_RX)
+				printf (",\"s\":\"t\",\"name\":\"RX BPDU\"");
+			else
+			{
+				printf (",\"s\":\"t\",\"name\":\"TX ");
+				WriteJsonChars (event->detail);
+				printf (" BPDU\"");
+			}
+			printf (",\"args\":{");
+			WritePortTreeArgs (event);
+			printf (",\"size\":%u}}", event->arg);
+			break;
+
+		case STP_TRACE_EVENT_CALLBACK:
+			BeginEvent (c, event, "i", "hardware");
+			printf (",\"s\":\"t\",\"name\":");
+			WriteJsonString (event->name);
+			printf (",\"args\":{");
+			WritePortTreeArgs (event);
+			printf ("%s\"arg\":%u}}", ((event->port >= 0) || (event->tree >= 0)) ? "," : "", event->arg);
+			break;
+
+		case STP_TRACE_EVENT_EVENTS_LOST:
+			BeginEvent (c, event, "i", "trace");
+			printf (",\"s\":\"p\",\"name\":\"%u events lost\"}", event->arg);
+			break;
+
+		default:
+			fprintf (stderr, "unknown trace event type %u\n", (unsigned int) event->type);
+			break;
+	}
+}
+
+static bool ConvertFile (FILE* file, const char* name, CONVERTER* c)
+{
+	unsigned char* data = NULL;
+	size_t size = 0;
+	size_t capacity = 0;
+	while (true)
+	{
+		if (size == capacity)
+		{
+			capacity = (capacity == 0) ? 65536 : capacity * 2;
+			data = (unsigned char*) realloc (data, capacity);
+			if (data == NULL)
+			{
+				fprintf (stderr, "%s: out of memory\n", name);
+				return false;
+			}
+		}
+
+		size_t read = fread (&data[size], 1, capacity - size, file);
+		if (read == 0)
+			break;
+		size += read;
+	}
+
+	printf ("%s\n{\"ph\":\"M\",\"pid\":%u,\"name\":\"process_name\",\"args\":{\"name\":", c->firstEventInOutput ? "" : ",", c->pid);
+	WriteJsonString (name);
+	printf ("}}");
+	c->firstEventInOutput = false;
+
+	c->timeHigh = 0;
+	c->lastTime = 0;
+	c->first = true;
+	unsigned int decoded = STP_DecodeTrace (data, (unsigned int) size, OnTraceEvent, c);
+	free (data);
+
+	if (decoded != size)
+	{
+		fprintf (stderr, "%s: %u trailing bytes don't make up a complete event\n", name, (unsigned int) (size - decoded));
+		return false;
+	}
+
+	return true;
+}
+
+int main (int argc, char* argv[])
+{
+	CONVERTER c;
+	c.pid = 0;
+	c.ticksPerMicrosecond = 1;
+	c.firstEventInOutput = true;
+
+	int argi = 1;
+	if ((argi + 1 < argc) && (strcmp (argv[argi], "-t") == 0))
+	{
+		c.ticksPerMicrosecond = atof (argv[argi + 1]);
+		argi += 2;
+	}
+
+	if ((argi >= argc) || !(c.ticksPerMicrosecond > 0))
+	{
+		fprintf (stderr, "usage: trace_to_json [-t ticksPerMicrosecond] file... > trace.json\n");
+		return 1;
+	}
+
+	int result = 0;
+	printf ("{\"traceEvents\":[");
+	for (; argi < argc; argi++)
+	{
+		FILE* file = fopen (argv[argi], "rb");
+		if (file == NULL)
+		{
+			fprintf (stderr, "%s: cannot open\n", argv[argi]);
+			result = 1;
+			continue;
+		}
+
+		c.pid++;
+		if (!ConvertFile (file, argv[argi], &c))
+			result = 1;
+
+		fclose (file);
+	}
+
+	printf ("\n]}\n");
+	return result;
+}